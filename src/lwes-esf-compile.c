@@ -0,0 +1,936 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#include "lwes_event_type_db.h"
+#include "lwes_hash.h"
+#include "lwes_perfect_hash.h"
+
+#include <getopt.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char help[] =
+  "lwes-esf-compile [options]"                                         "\n"
+  ""                                                                   "\n"
+  "  where options are:"                                               "\n"
+  ""                                                                   "\n"
+  "    -f [one argument]"                                              "\n"
+  "       The ESF file to compile."                                    "\n"
+  ""                                                                   "\n"
+  "    -o [one argument]"                                              "\n"
+  "       The base name of the generated files, <name>.h and <name>.c" "\n"
+  "       (default: the ESF file name without .esf)"                   "\n"
+  ""                                                                   "\n"
+  "    -p [one argument]"                                              "\n"
+  "       The prefix of the generated names, so the setter for the"    "\n"
+  "       attribute userId of the event MyEvent is"                    "\n"
+  "       <prefix>_MyEvent_set_userId"                                 "\n"
+  "       (default: lwes)"                                             "\n"
+  ""                                                                   "\n"
+  "    -h"                                                             "\n"
+  "         show this message"                                         "\n"
+  ""                                                                   "\n"
+  "  Generates C tables of the events in the ESF file, with perfect"   "\n"
+  "  hashes from event and attribute names to their indices, and"      "\n"
+  "  typed functions to create each event and set and get each of"     "\n"
+  "  its attributes without looking anything up in an event type db."  "\n"
+  ""                                                                   "\n"
+  "  returns 0 if the files were generated, 1 otherwise."              "\n";
+
+/* how the generated code handles each type */
+struct compile_type
+{
+  LWES_TYPE   type;
+  /* suffix of the LWES_TYPE_ constant and the lwes_event functions */
+  const char *name;
+  /* type of the value passed to the setter, and pointed to by the getter */
+  const char *set_type;
+  const char *get_type;
+};
+
+static const struct compile_type compile_types[] =
+{
+  { LWES_TYPE_U_INT_16,         "U_INT_16",         "LWES_U_INT_16",
+                                                   "LWES_U_INT_16" },
+  { LWES_TYPE_INT_16,           "INT_16",           "LWES_INT_16",
+                                                   "LWES_INT_16" },
+  { LWES_TYPE_U_INT_32,         "U_INT_32",         "LWES_U_INT_32",
+                                                   "LWES_U_INT_32" },
+  { LWES_TYPE_INT_32,           "INT_32",           "LWES_INT_32",
+                                                   "LWES_INT_32" },
+  { LWES_TYPE_STRING,           "STRING",           "LWES_CONST_LONG_STRING",
+                                                   "LWES_LONG_STRING" },
+  { LWES_TYPE_IP_ADDR,          "IP_ADDR",          "LWES_IP_ADDR",
+                                                   "LWES_IP_ADDR" },
+  { LWES_TYPE_INT_64,           "INT_64",           "LWES_INT_64",
+                                                   "LWES_INT_64" },
+  { LWES_TYPE_U_INT_64,         "U_INT_64",         "LWES_U_INT_64",
+                                                   "LWES_U_INT_64" },
+  { LWES_TYPE_BOOLEAN,          "BOOLEAN",          "LWES_BOOLEAN",
+                                                   "LWES_BOOLEAN" },
+  { LWES_TYPE_BYTE,             "BYTE",             "LWES_BYTE",
+                                                   "LWES_BYTE" },
+  { LWES_TYPE_FLOAT,            "FLOAT",            "LWES_FLOAT",
+                                                   "LWES_FLOAT" },
+  { LWES_TYPE_DOUBLE,           "DOUBLE",           "LWES_DOUBLE",
+                                                   "LWES_DOUBLE" },
+  { LWES_TYPE_U_INT_16_ARRAY,   "U_INT_16_ARRAY",   "LWES_U_INT_16 *",
+                                                   "LWES_U_INT_16 *" },
+  { LWES_TYPE_INT_16_ARRAY,     "INT_16_ARRAY",     "LWES_INT_16 *",
+                                                   "LWES_INT_16 *" },
+  { LWES_TYPE_U_INT_32_ARRAY,   "U_INT_32_ARRAY",   "LWES_U_INT_32 *",
+                                                   "LWES_U_INT_32 *" },
+  { LWES_TYPE_INT_32_ARRAY,     "INT_32_ARRAY",     "LWES_INT_32 *",
+                                                   "LWES_INT_32 *" },
+  { LWES_TYPE_STRING_ARRAY,     "STRING_ARRAY",     "LWES_STRING *",
+                                                   "LWES_STRING *" },
+  { LWES_TYPE_IP_ADDR_ARRAY,    "IP_ADDR_ARRAY",    "LWES_IP_ADDR *",
+                                                   "LWES_IP_ADDR *" },
+  { LWES_TYPE_INT_64_ARRAY,     "INT_64_ARRAY",     "LWES_INT_64 *",
+                                                   "LWES_INT_64 *" },
+  { LWES_TYPE_U_INT_64_ARRAY,   "U_INT_64_ARRAY",   "LWES_U_INT_64 *",
+                                                   "LWES_U_INT_64 *" },
+  { LWES_TYPE_BOOLEAN_ARRAY,    "BOOLEAN_ARRAY",    "LWES_BOOLEAN *",
+                                                   "LWES_BOOLEAN *" },
+  { LWES_TYPE_BYTE_ARRAY,       "BYTE_ARRAY",       "LWES_BYTE *",
+                                                   "LWES_BYTE *" },
+  { LWES_TYPE_FLOAT_ARRAY,      "FLOAT_ARRAY",      "LWES_FLOAT *",
+                                                   "LWES_FLOAT *" },
+  { LWES_TYPE_DOUBLE_ARRAY,     "DOUBLE_ARRAY",     "LWES_DOUBLE *",
+                                                   "LWES_DOUBLE *" },
+  { LWES_TYPE_N_U_INT_16_ARRAY, "N_U_INT_16_ARRAY", "LWES_U_INT_16 **",
+                                                   "LWES_U_INT_16* *" },
+  { LWES_TYPE_N_INT_16_ARRAY,   "N_INT_16_ARRAY",   "LWES_INT_16 **",
+                                                   "LWES_INT_16* *" },
+  { LWES_TYPE_N_U_INT_32_ARRAY, "N_U_INT_32_ARRAY", "LWES_U_INT_32 **",
+                                                   "LWES_U_INT_32* *" },
+  { LWES_TYPE_N_INT_32_ARRAY,   "N_INT_32_ARRAY",   "LWES_INT_32 **",
+                                                   "LWES_INT_32* *" },
+  { LWES_TYPE_N_STRING_ARRAY,   "N_STRING_ARRAY",   "LWES_STRING *",
+                                                   "LWES_STRING*" },
+  { LWES_TYPE_N_IP_ADDR_ARRAY,  "N_IP_ADDR_ARRAY",  "LWES_IP_ADDR **",
+                                                   "LWES_IP_ADDR* *" },
+  { LWES_TYPE_N_INT_64_ARRAY,   "N_INT_64_ARRAY",   "LWES_INT_64 **",
+                                                   "LWES_INT_64* *" },
+  { LWES_TYPE_N_U_INT_64_ARRAY, "N_U_INT_64_ARRAY", "LWES_U_INT_64 **",
+                                                   "LWES_U_INT_64* *" },
+  { LWES_TYPE_N_BOOLEAN_ARRAY,  "N_BOOLEAN_ARRAY",  "LWES_BOOLEAN **",
+                                                   "LWES_BOOLEAN* *" },
+  { LWES_TYPE_N_BYTE_ARRAY,     "N_BYTE_ARRAY",     "LWES_BYTE **",
+                                                   "LWES_BYTE* *" },
+  { LWES_TYPE_N_FLOAT_ARRAY,    "N_FLOAT_ARRAY",    "LWES_FLOAT **",
+                                                   "LWES_FLOAT* *" },
+  { LWES_TYPE_N_DOUBLE_ARRAY,   "N_DOUBLE_ARRAY",   "LWES_DOUBLE **",
+                                                   "LWES_DOUBLE* *" }
+};
+
+struct compile_attribute
+{
+  const char                                 *name;
+  char                                       *ident;
+  const struct lwes_event_field_db_attribute *field;
+  const struct compile_type                  *type;
+};
+
+struct compile_event
+{
+  const char               *name;
+  char                     *ident;
+  int                       number_of_attributes;
+  struct compile_attribute *attributes;
+  /* perfect hash of the attribute names, and the index in each slot */
+  struct lwes_perfect_hash *hash;
+  int                      *slots;
+};
+
+/* prototypes */
+static int
+compile_perfect_hash
+  (const char **names,
+   int count,
+   struct lwes_perfect_hash **hash,
+   int **slots);
+
+static char *
+compile_ident
+  (const char *name);
+
+static const struct compile_type *
+compile_find_type
+  (LWES_BYTE type);
+
+static int
+compile_add_attributes
+  (struct compile_event *event,
+   struct lwes_hash *attributes);
+
+static void
+compile_write_hash
+  (FILE *out,
+   const char *name,
+   const struct lwes_perfect_hash *hash,
+   const int *slots);
+
+static void
+compile_write_header
+  (FILE *out,
+   const char *esf,
+   const char *guard,
+   const char *prefix,
+   struct compile_event *events,
+   int number_of_events);
+
+static void
+compile_write_source
+  (FILE *out,
+   const char *esf,
+   const char *header,
+   const char *prefix,
+   struct compile_event *events,
+   int number_of_events,
+   const struct lwes_perfect_hash *hash,
+   const int *slots);
+
+int main (int argc, char *argv[]) {
+
+  const char *filename = NULL;
+  const char *prefix   = "lwes";
+  char *output         = NULL;
+  char *optarg_output   = NULL;
+  char *path;
+  char *guard;
+  const char *header;
+  const char *base;
+  struct lwes_event_type_db *db;
+  struct lwes_hash_enumeration e;
+  struct lwes_hash *meta;
+  struct compile_event *events;
+  const char **names;
+  int number_of_events;
+  int i;
+  int j;
+  struct lwes_perfect_hash *hash;
+  int *slots;
+  FILE *out;
+
+  opterr = 0;
+  while (1) {
+    char c = getopt (argc, argv, "f:o:p:h");
+
+    if (c == -1) {
+      break;
+    }
+
+    switch (c) {
+      case 'f':
+        filename = optarg;
+        break;
+
+      case 'o':
+        output = optarg_output = optarg;
+        break;
+
+      case 'p':
+        prefix = optarg;
+        break;
+
+      case 'h':
+        fprintf (stderr, "%s", help);
+        return 1;
+
+      default:
+        fprintf (stderr,
+                 "error: unrecognized command line option -%c\n",
+                 optopt);
+        return 1;
+    }
+  }
+
+  if (filename == NULL) {
+    fprintf (stderr, "error: no ESF file given, use -f\n");
+    return 1;
+  }
+
+  for (i = 0; isalnum ((unsigned char)prefix[i]) || prefix[i] == '_'; i++)
+    ;
+  if (i == 0 || prefix[i] != '\0' || isdigit ((unsigned char)prefix[0])) {
+    fprintf (stderr, "error: prefix %s is not a C identifier\n", prefix);
+    return 1;
+  }
+
+  if (output == NULL) {
+    output = strdup (filename);
+    if (output != NULL && strlen (output) > 4
+        && strcmp (output + strlen (output) - 4, ".esf") == 0) {
+      output[strlen (output) - 4] = '\0';
+    }
+  }
+
+  db = lwes_event_type_db_create (filename);
+  if (db == NULL) {
+    fprintf (stderr, "error: could not parse %s\n", filename);
+    return 1;
+  }
+
+  /* every event also has the attributes of the meta event */
+  meta = (struct lwes_hash *) lwes_hash_get (db->events,
+                                             LWES_META_INFO_STRING);
+
+  number_of_events = lwes_hash_size (db->events);
+  events = (struct compile_event *)
+    calloc (number_of_events + 1, sizeof (struct compile_event));
+  names = (const char **) calloc (number_of_events + 1, sizeof (char *));
+  if (events == NULL || names == NULL) {
+    fprintf (stderr, "error: out of memory\n");
+    return 1;
+  }
+
+  i = 0;
+  if (lwes_hash_keys (db->events, &e)) {
+    while (lwes_hash_enumeration_has_more_elements (&e)) {
+      const char *name = lwes_hash_enumeration_next_element (&e);
+      struct lwes_hash *attributes =
+        (struct lwes_hash *) lwes_hash_get (db->events, name);
+
+      events[i].name  = name;
+      events[i].ident = compile_ident (name);
+      names[i]        = name;
+      for (j = 0; j < i; j++) {
+        if (strcmp (events[j].ident, events[i].ident) == 0) {
+          fprintf (stderr, "error: %s and %s are both %s in C\n",
+                   events[j].name, name, events[i].ident);
+          return 1;
+        }
+      }
+      if (compile_add_attributes (&(events[i]), attributes) < 0
+          || (attributes != meta
+              && compile_add_attributes (&(events[i]), meta) < 0)) {
+        fprintf (stderr, "error: could not compile %s\n", name);
+        return 1;
+      }
+      i++;
+    }
+  }
+
+  if (compile_perfect_hash (names, number_of_events, &hash, &slots) < 0) {
+    fprintf (stderr, "error: could not hash the event names\n");
+    return 1;
+  }
+
+  /* <output>.h and <output>.c, with the header included by its base name */
+  path  = (char *) malloc (strlen (output) + 3);
+  guard = (char *) malloc (strlen (output) + 16);
+  if (path == NULL || guard == NULL) {
+    fprintf (stderr, "error: out of memory\n");
+    return 1;
+  }
+  base = strrchr (output, '/');
+  base = (base == NULL ? output : base + 1);
+  snprintf (guard, strlen (output) + 16, "__%s_H", base);
+  for (i = 0; guard[i] != '\0'; i++) {
+    guard[i] = (isalnum ((unsigned char)guard[i])
+                  ? toupper ((unsigned char)guard[i]) : '_');
+  }
+
+  sprintf (path, "%s.h", output);
+  if ((out = fopen (path, "w")) == NULL) {
+    fprintf (stderr, "error: could not write %s\n", path);
+    return 1;
+  }
+  compile_write_header (out, filename, guard, prefix,
+                        events, number_of_events);
+  fclose (out);
+
+  header = strrchr (path, '/');
+  header = (header == NULL ? path : header + 1);
+  header = strdup (header);
+  sprintf (path, "%s.c", output);
+  if (header == NULL || (out = fopen (path, "w")) == NULL) {
+    fprintf (stderr, "error: could not write %s\n", path);
+    return 1;
+  }
+  compile_write_source (out, filename, header, prefix,
+                        events, number_of_events, hash, slots);
+  fclose (out);
+
+  for (i = 0; i < number_of_events; i++) {
+    for (j = 0; j < events[i].number_of_attributes; j++) {
+      free (events[i].attributes[j].ident);
+    }
+    free (events[i].attributes);
+    lwes_perfect_hash_destroy (events[i].hash);
+    free (events[i].slots);
+    free (events[i].ident);
+  }
+  free (events);
+  free (names);
+  lwes_perfect_hash_destroy (hash);
+  free (slots);
+  free (path);
+  free (guard);
+  free ((char *)header);
+  if (output != optarg_output) {
+    free (output);
+  }
+  lwes_event_type_db_destroy (db);
+
+  return 0;
+}
+
+/* hashes the names with the perfect hash lwes_event_type_db uses, the
+   table of slots holds the index of the name in each slot and -1 in the
+   empty ones */
+static int
+compile_perfect_hash
+  (const char **names,
+   int count,
+   struct lwes_perfect_hash **hash,
+   int **slots)
+{
+  struct lwes_perfect_hash_key *keys;
+  LWES_U_INT_32 *placed;
+  LWES_U_INT_32 slot;
+  int i;
+
+  *hash  = NULL;
+  *slots = NULL;
+  keys   = (struct lwes_perfect_hash_key *)
+    malloc (sizeof (struct lwes_perfect_hash_key) * (count + 1));
+  placed = (LWES_U_INT_32 *) malloc (sizeof (LWES_U_INT_32) * (count + 1));
+  if (keys != NULL && placed != NULL) {
+    for (i = 0; i < count; i++) {
+      keys[i].event_name = names[i];
+      keys[i].attr_name  = NULL;
+    }
+    *hash = lwes_perfect_hash_create (keys, (LWES_U_INT_32)count, placed);
+  }
+  if (*hash != NULL) {
+    *slots = (int *) malloc (sizeof (int) * ((size_t)(*hash)->mask + 1));
+  }
+  if (*slots != NULL) {
+    for (slot = 0; slot <= (*hash)->mask; slot++) {
+      (*slots)[slot] = -1;
+    }
+    for (i = 0; i < count; i++) {
+      (*slots)[placed[i]] = i;
+    }
+  }
+  free (keys);
+  free (placed);
+  return (*slots == NULL ? -1 : 0);
+}
+
+/* an identifier for a name, anything which can not be in one is a '_' */
+static char *
+compile_ident
+  (const char *name)
+{
+  char *ident = strdup (name);
+  int i;
+
+  if (ident == NULL) {
+    fprintf (stderr, "error: out of memory\n");
+    exit (1);
+  }
+  for (i = 0; ident[i] != '\0'; i++) {
+    if (! isalnum ((unsigned char)ident[i])) {
+      ident[i] = '_';
+    }
+  }
+  return ident;
+}
+
+static const struct compile_type *
+compile_find_type
+  (LWES_BYTE type)
+{
+  unsigned int i;
+
+  for (i = 0; i < sizeof (compile_types) / sizeof (compile_types[0]); i++) {
+    if (compile_types[i].type == type) {
+      return &(compile_types[i]);
+    }
+  }
+  return NULL;
+}
+
+/* appends the attributes the event does not have yet, in ESF order, fails
+   if two attribute names make the same identifier */
+static int
+compile_add_attributes
+  (struct compile_event *event,
+   struct lwes_hash *attributes)
+{
+  struct lwes_hash_enumeration e;
+  struct compile_attribute *attribute;
+  const char *name;
+  int n;
+  int i;
+
+  if (attributes == NULL || ! lwes_hash_keys (attributes, &e)) {
+    return 0;
+  }
+
+  n = event->number_of_attributes + lwes_hash_size (attributes);
+  event->attributes = (struct compile_attribute *)
+    realloc (event->attributes, sizeof (struct compile_attribute) * (n + 1));
+  if (event->attributes == NULL) {
+    return -1;
+  }
+
+  while (lwes_hash_enumeration_has_more_elements (&e)) {
+    name = lwes_hash_enumeration_next_element (&e);
+    for (i = 0; i < event->number_of_attributes; i++) {
+      if (strcmp (event->attributes[i].name, name) == 0) {
+        break;
+      }
+    }
+    if (i < event->number_of_attributes) {
+      continue;
+    }
+
+    attribute = &(event->attributes[event->number_of_attributes]);
+    attribute->name  = name;
+    attribute->ident = compile_ident (name);
+    attribute->field = (const struct lwes_event_field_db_attribute *)
+      lwes_hash_get (attributes, name);
+    attribute->type  = compile_find_type (attribute->field->type);
+    if (attribute->type == NULL) {
+      return -1;
+    }
+    for (i = 0; i < event->number_of_attributes; i++) {
+      if (strcmp (event->attributes[i].ident, attribute->ident) == 0) {
+        return -1;
+      }
+    }
+    event->number_of_attributes++;
+  }
+
+  return 0;
+}
+
+/* the displacements of a perfect hash as <name>_displacements, and the
+   index in each of its slots as <name>_slots */
+static void
+compile_write_hash
+  (FILE *out,
+   const char *name,
+   const struct lwes_perfect_hash *hash,
+   const int *slots)
+{
+  unsigned int i;
+
+  fprintf (out, "static const LWES_U_INT_32 %s_displacements[%u] =\n{",
+           name, hash->number_of_buckets);
+  for (i = 0; i < hash->number_of_buckets; i++) {
+    fprintf (out, "%s%s%u", (i == 0 ? "" : ","),
+             (i % 8 == 0 ? "\n  " : " "), hash->displacements[i]);
+  }
+  fprintf (out, "\n};\n\n");
+
+  fprintf (out, "static const int %s_slots[%u] =\n{", name, hash->mask + 1);
+  for (i = 0; i <= hash->mask; i++) {
+    fprintf (out, "%s%s%d", (i == 0 ? "" : ","),
+             (i % 16 == 0 ? "\n  " : " "), slots[i]);
+  }
+  fprintf (out, "\n};\n\n");
+}
+
+static void
+compile_write_header
+  (FILE *out,
+   const char *esf,
+   const char *guard,
+   const char *prefix,
+   struct compile_event *events,
+   int number_of_events)
+{
+  struct compile_event *event;
+  struct compile_attribute *attr;
+  int i;
+  int j;
+
+  fprintf (out,
+"/* Generated by lwes-esf-compile from %s, do not edit */\n"
+"\n"
+"#ifndef %s\n"
+"#define %s\n"
+"\n"
+"#include \"lwes_event.h\"\n"
+"#include \"lwes_perfect_hash.h\"\n"
+"\n"
+"#ifdef __cplusplus\n"
+"extern \"C\" {\n"
+"#endif\n"
+"\n"
+"/*! \\brief An attribute of an event in the ESF file */\n"
+"struct %s_attribute\n"
+"{\n"
+"  /*! name of the attribute */\n"
+"  LWES_CONST_SHORT_STRING name;\n"
+"  /*! LWES_TYPE of the attribute */\n"
+"  LWES_TYPE               type;\n"
+"  /*! ATTRIBUTE_ flags of the attribute */\n"
+"  LWES_INT_32             flags;\n"
+"  /*! maximum size of an arrayed attribute */\n"
+"  LWES_INT_16             array_size;\n"
+"  /*! maximum length of a string attribute */\n"
+"  LWES_INT_16             max_str_size;\n"
+"};\n"
+"\n"
+"/*! \\brief An event in the ESF file */\n"
+"struct %s_event\n"
+"{\n"
+"  /*! name of the event */\n"
+"  LWES_CONST_SHORT_STRING          name;\n"
+"  /*! number of attributes, including those of %s */\n"
+"  int                              number_of_attributes;\n"
+"  /*! the attributes, in the order of the ESF file */\n"
+"  const struct %s_attribute *attributes;\n"
+"  /*! perfect hash of the attribute names */\n"
+"  struct lwes_perfect_hash         hash;\n"
+"  /*! index of the attribute in each slot of the hash, -1 if empty */\n"
+"  const int                       *slots;\n"
+"};\n"
+"\n",
+           esf, guard, guard, prefix, prefix, LWES_META_INFO_STRING,
+           prefix);
+
+  fprintf (out, "/*! \\brief Indices of the events in %s_events */\n"
+                "enum %s_event_index\n{\n", prefix, prefix);
+  for (i = 0; i < number_of_events; i++) {
+    fprintf (out, "  %s_EVENT_%s = %d,\n", prefix, events[i].ident, i);
+  }
+  fprintf (out, "  %s_NUMBER_OF_EVENTS = %d\n};\n\n",
+           prefix, number_of_events);
+
+  fprintf (out,
+"/*! \\brief The events of the ESF file */\n"
+"extern const struct %s_event %s_events[%s_NUMBER_OF_EVENTS];\n"
+"\n"
+"/*! \\brief Find an event by name\n"
+" *\n"
+" *  \\return the index of the event in %s_events, or -1 if it is not\n"
+" *          in the ESF file\n"
+" */\n"
+"int\n"
+"%s_event_index\n"
+"  (LWES_CONST_SHORT_STRING name);\n"
+"\n"
+"/*! \\brief Find an attribute of an event by name\n"
+" *\n"
+" *  \\return the index of the attribute in the event's attributes, or -1\n"
+" *          if the event does not have it\n"
+" */\n"
+"int\n"
+"%s_attribute_index\n"
+"  (int event_index,\n"
+"   LWES_CONST_SHORT_STRING name);\n"
+"\n"
+"/*! \\brief Check an attribute as an lwes_event_type_db would\n"
+" *\n"
+" *  \\return 0 if the event has the attribute with the given type, -1 if\n"
+" *          it does not have the attribute and -2 if the type is wrong\n"
+" */\n"
+"int\n"
+"%s_check_attribute\n"
+"  (int event_index,\n"
+"   LWES_CONST_SHORT_STRING name,\n"
+"   LWES_TYPE type);\n"
+"\n",
+           prefix, prefix, prefix, prefix, prefix, prefix, prefix);
+
+  for (i = 0; i < number_of_events; i++) {
+    event = &(events[i]);
+    fprintf (out, "/* %s */\n\n", event->name);
+    if (event->number_of_attributes > 0) {
+      fprintf (out, "/*! \\brief Indices of the attributes of %s */\n"
+                    "enum %s_%s_attribute_index\n{\n",
+               event->name, prefix, event->ident);
+      for (j = 0; j < event->number_of_attributes; j++) {
+        fprintf (out, "  %s_%s_ATTR_%s = %d,\n", prefix, event->ident,
+                 event->attributes[j].ident, j);
+      }
+      fprintf (out, "  %s_%s_NUMBER_OF_ATTRIBUTES = %d\n};\n\n",
+               prefix, event->ident, event->number_of_attributes);
+    }
+
+    fprintf (out, "/*! \\brief Create a %s event, which is not checked "
+                  "against a type db\n"
+                  " *  as the functions below can only set what the ESF "
+                  "file allows */\n"
+                  "struct lwes_event *\n%s_%s_create\n  (void);\n\n",
+             event->name, prefix, event->ident);
+
+    for (j = 0; j < event->number_of_attributes; j++) {
+      attr = &(event->attributes[j]);
+      if (attr->type->type < LWES_TYPE_U_INT_16_ARRAY) {
+        fprintf (out, "int\n%s_%s_set_%s\n"
+                      "  (struct lwes_event *event,\n"
+                      "   %s value);\n\n",
+                 prefix, event->ident, attr->ident, attr->type->set_type);
+        fprintf (out, "int\n%s_%s_get_%s\n"
+                      "  (struct lwes_event *event,\n"
+                      "   %s *value);\n\n",
+                 prefix, event->ident, attr->ident, attr->type->get_type);
+      } else {
+        fprintf (out, "int\n%s_%s_set_%s\n"
+                      "  (struct lwes_event *event,\n"
+                      "   LWES_U_INT_16 length,\n"
+                      "   %s value);\n\n",
+                 prefix, event->ident, attr->ident, attr->type->set_type);
+        fprintf (out, "int\n%s_%s_get_%s\n"
+                      "  (struct lwes_event *event,\n"
+                      "   LWES_U_INT_16 *length,\n"
+                      "   %s *value);\n\n",
+                 prefix, event->ident, attr->ident, attr->type->get_type);
+      }
+    }
+  }
+
+  fprintf (out,
+"#ifdef __cplusplus\n"
+"}\n"
+"#endif\n"
+"\n"
+"#endif /* %s */\n", guard);
+}
+
+static void
+compile_write_source
+  (FILE *out,
+   const char *esf,
+   const char *header,
+   const char *prefix,
+   struct compile_event *events,
+   int number_of_events,
+   const struct lwes_perfect_hash *hash,
+   const int *slots)
+{
+  struct compile_event *event;
+  struct compile_attribute *attr;
+  const char **names;
+  char table[1024];
+  int i;
+  int j;
+
+  fprintf (out,
+"/* Generated by lwes-esf-compile from %s, do not edit */\n"
+"\n"
+"#include \"%s\"\n"
+"\n"
+"#include <string.h>\n"
+"\n",
+           esf, header);
+
+  for (i = 0; i < number_of_events; i++) {
+    event = &(events[i]);
+    if (event->number_of_attributes == 0) {
+      continue;
+    }
+
+    names = (const char **)
+      malloc (sizeof (char *) * event->number_of_attributes);
+    if (names == NULL) {
+      fprintf (stderr, "error: out of memory\n");
+      exit (1);
+    }
+    for (j = 0; j < event->number_of_attributes; j++) {
+      names[j] = event->attributes[j].name;
+    }
+    if (compile_perfect_hash (names, event->number_of_attributes,
+                              &(event->hash), &(event->slots)) < 0) {
+      fprintf (stderr, "error: could not hash the attributes of %s\n",
+               event->name);
+      exit (1);
+    }
+    free (names);
+
+    fprintf (out, "static const struct %s_attribute %s_%s_attributes[%d] ="
+                  "\n{\n", prefix, prefix, event->ident,
+             event->number_of_attributes);
+    for (j = 0; j < event->number_of_attributes; j++) {
+      attr = &(event->attributes[j]);
+      fprintf (out, "  { \"%s\", LWES_TYPE_%s, %d, %d, %d }%s\n",
+               attr->name, attr->type->name, (int)attr->field->attr_flags,
+               (int)attr->field->array_size, (int)attr->field->max_str_size,
+               (j + 1 < event->number_of_attributes ? "," : ""));
+    }
+    fprintf (out, "};\n\n");
+
+    snprintf (table, sizeof (table), "%s_%s", prefix, event->ident);
+    compile_write_hash (out, table, event->hash, event->slots);
+  }
+
+  fprintf (out, "const struct %s_event %s_events[%s_NUMBER_OF_EVENTS] =\n{\n",
+           prefix, prefix, prefix);
+  for (i = 0; i < number_of_events; i++) {
+    event = &(events[i]);
+    if (event->number_of_attributes == 0) {
+      fprintf (out, "  { \"%s\", 0, NULL, { 0, 0, 0, NULL }, NULL }",
+               event->name);
+    } else {
+      fprintf (out, "  { \"%s\", %d, %s_%s_attributes,\n"
+                    "    { %lluULL, %uU, %uU, %s_%s_displacements },"
+                    " %s_%s_slots }",
+               event->name, event->number_of_attributes,
+               prefix, event->ident,
+               (unsigned long long)event->hash->seed,
+               event->hash->number_of_buckets, event->hash->mask,
+               prefix, event->ident, prefix, event->ident);
+    }
+    fprintf (out, "%s\n", (i + 1 < number_of_events ? "," : ""));
+  }
+  fprintf (out, "};\n\n");
+
+  snprintf (table, sizeof (table), "%s_event", prefix);
+  compile_write_hash (out, table, hash, slots);
+  fprintf (out, "static const struct lwes_perfect_hash %s_event_hash =\n"
+                "  { %lluULL, %uU, %uU, %s_event_displacements };\n\n",
+           prefix, (unsigned long long)hash->seed, hash->number_of_buckets,
+           hash->mask, prefix);
+
+  fprintf (out,
+"int\n"
+"%s_event_index\n"
+"  (LWES_CONST_SHORT_STRING name)\n"
+"{\n"
+"  int index;\n"
+"\n"
+"  if (name == NULL)\n"
+"    {\n"
+"      return -1;\n"
+"    }\n"
+"  index = %s_event_slots[lwes_perfect_hash_slot (&%s_event_hash,\n"
+"                                                   name, NULL)];\n"
+"  if (index < 0 || strcmp (%s_events[index].name, name) != 0)\n"
+"    {\n"
+"      return -1;\n"
+"    }\n"
+"  return index;\n"
+"}\n"
+"\n"
+"int\n"
+"%s_attribute_index\n"
+"  (int event_index,\n"
+"   LWES_CONST_SHORT_STRING name)\n"
+"{\n"
+"  const struct %s_event *event;\n"
+"  int index;\n"
+"\n"
+"  if (event_index < 0 || event_index >= %s_NUMBER_OF_EVENTS\n"
+"      || name == NULL)\n"
+"    {\n"
+"      return -1;\n"
+"    }\n"
+"  event = &(%s_events[event_index]);\n"
+"  if (event->number_of_attributes == 0)\n"
+"    {\n"
+"      return -1;\n"
+"    }\n"
+"  index = event->slots[lwes_perfect_hash_slot (&(event->hash),\n"
+"                                                name, NULL)];\n"
+"  if (index < 0 || strcmp (event->attributes[index].name, name) != 0)\n"
+"    {\n"
+"      return -1;\n"
+"    }\n"
+"  return index;\n"
+"}\n"
+"\n"
+"int\n"
+"%s_check_attribute\n"
+"  (int event_index,\n"
+"   LWES_CONST_SHORT_STRING name,\n"
+"   LWES_TYPE type)\n"
+"{\n"
+"  int index = %s_attribute_index (event_index, name);\n"
+"\n"
+"  if (index < 0)\n"
+"    {\n"
+"      return -1;\n"
+"    }\n"
+"  if (%s_events[event_index].attributes[index].type != type)\n"
+"    {\n"
+"      return -2;\n"
+"    }\n"
+"  return 0;\n"
+"}\n",
+           prefix, prefix, prefix, prefix,
+           prefix, prefix, prefix, prefix,
+           prefix, prefix, prefix);
+
+  for (i = 0; i < number_of_events; i++) {
+    event = &(events[i]);
+    fprintf (out,
+"\n"
+"struct lwes_event *\n"
+"%s_%s_create\n"
+"  (void)\n"
+"{\n"
+"  return lwes_event_create (NULL, \"%s\");\n"
+"}\n",
+             prefix, event->ident, event->name);
+
+    for (j = 0; j < event->number_of_attributes; j++) {
+      attr = &(event->attributes[j]);
+      if (attr->type->type < LWES_TYPE_U_INT_16_ARRAY) {
+        fprintf (out,
+"\n"
+"int\n"
+"%s_%s_set_%s\n"
+"  (struct lwes_event *event,\n"
+"   %s value)\n"
+"{\n"
+"  return lwes_event_set_%s (event, \"%s\", value);\n"
+"}\n"
+"\n"
+"int\n"
+"%s_%s_get_%s\n"
+"  (struct lwes_event *event,\n"
+"   %s *value)\n"
+"{\n"
+"  return lwes_event_get_%s (event, \"%s\", value);\n"
+"}\n",
+                 prefix, event->ident, attr->ident, attr->type->set_type,
+                 attr->type->name, attr->name,
+                 prefix, event->ident, attr->ident, attr->type->get_type,
+                 attr->type->name, attr->name);
+      } else {
+        fprintf (out,
+"\n"
+"int\n"
+"%s_%s_set_%s\n"
+"  (struct lwes_event *event,\n"
+"   LWES_U_INT_16 length,\n"
+"   %s value)\n"
+"{\n"
+"  return lwes_event_set_%s (event, \"%s\", length, value);\n"
+"}\n"
+"\n"
+"int\n"
+"%s_%s_get_%s\n"
+"  (struct lwes_event *event,\n"
+"   LWES_U_INT_16 *length,\n"
+"   %s *value)\n"
+"{\n"
+"  return lwes_event_get_%s (event, \"%s\", length, value);\n"
+"}\n",
+                 prefix, event->ident, attr->ident, attr->type->set_type,
+                 attr->type->name, attr->name,
+                 prefix, event->ident, attr->ident, attr->type->get_type,
+                 attr->type->name, attr->name);
+      }
+    }
+  }
+}
@@ -75,6 +75,7 @@ int main (int   argc,
   struct sigaction act;
 
   struct lwes_listener * listener;
+  struct lwes_event * event;
   int event_count = 0;
   time_t start_time = time (NULL);
   int frequency = 1;
@@ -150,45 +151,47 @@ int main (int   argc,
                                     (LWES_SHORT_STRING) mcast_iface,
                                     (LWES_U_INT_32)     mcast_port );
 
-  while ( ! done )
+  /* one event is reused for every packet, lwes_event_clear keeps its
+   * storage so steady state decoding does not allocate */
+  event = lwes_event_create_no_name ( NULL );
+
+  while ( ! done && event != NULL )
     {
-      struct lwes_event *event = lwes_event_create_no_name ( NULL );
+      time_t current_time;
+      int ret;
 
-      if ( event != NULL )
+      lwes_event_clear (event);
+      ret = lwes_listener_recv_by (listener, event,1000);
+      if ( ret > 0 )
         {
-          time_t current_time;
-          int ret = lwes_listener_recv_by (listener, event,1000);
-          if ( ret > 0 )
+          if (count)
             {
-              if (count)
-                {
-                  ++event_count;
-                }
-              if (! quiet)
-                {
-                  lwes_event_to_stream (event, stdout);
-                }
+              ++event_count;
             }
-          if (count)
+          if (! quiet)
             {
-              current_time = time (NULL);
-              if ((current_time - start_time) >= frequency)
-                {
-                  char timebuff[20];
-                  /* HH/MM/SS DD/MM/YYYY  */
-                  /* 12345678901234567890 */
-                  start_time = time (NULL);
-
-                  strftime (timebuff, 20, "%H:%M:%S %d/%m/%Y",
-                            localtime (&start_time));
-
-                  printf ("%s : %d\n", timebuff, event_count);
-                  event_count = 0;
-                }
+              lwes_event_to_stream (event, stdout);
+            }
+        }
+      if (count)
+        {
+          current_time = time (NULL);
+          if ((current_time - start_time) >= frequency)
+            {
+              char timebuff[20];
+              /* HH/MM/SS DD/MM/YYYY  */
+              /* 12345678901234567890 */
+              start_time = time (NULL);
+
+              strftime (timebuff, 20, "%H:%M:%S %d/%m/%Y",
+                        localtime (&start_time));
+
+              printf ("%s : %d\n", timebuff, event_count);
+              event_count = 0;
             }
         }
-      lwes_event_destroy (event);
     }
+  lwes_event_destroy (event);
 
   lwes_listener_destroy (listener);
 
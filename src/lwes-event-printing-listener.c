@@ -66,6 +66,7 @@ int main (int   argc,
   struct sigaction act;
 
   struct lwes_listener * listener;
+  struct lwes_event * event;
 
   opterr = 0;
   while (1)
@@ -129,20 +130,22 @@ int main (int   argc,
                                     (LWES_SHORT_STRING) mcast_iface,
                                     (LWES_U_INT_32)     mcast_port );
 
-  while ( ! done )
+  /* one event is reused for every packet, lwes_event_clear keeps its
+   * storage so steady state decoding does not allocate */
+  event = lwes_event_create_no_name ( NULL );
+
+  while ( ! done && event != NULL )
     {
-      struct lwes_event *event = lwes_event_create_no_name ( NULL );
+      int ret;
 
-      if ( event != NULL )
+      lwes_event_clear (event);
+      ret = lwes_listener_recv ( listener, event);
+      if ( ret > 0 )
         {
-          int ret = lwes_listener_recv ( listener, event);
-          if ( ret > 0 )
-            {
-              lwes_event_to_stream (event, stdout);
-            }
+          lwes_event_to_stream (event, stdout);
         }
-      lwes_event_destroy (event);
     }
+  lwes_event_destroy (event);
 
   lwes_listener_destroy (listener);
 
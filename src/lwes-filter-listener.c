@@ -11,6 +11,7 @@
  *======================================================================*/
 
 #include "lwes_listener.h"
+#include "lwes_event_filter.h"
 
 #ifdef HAVE_GETOPT_H
 #include <getopt.h>
@@ -48,10 +49,13 @@ static const char help[] =
   "       (default: 0.0.0.0)"                                          "\n"
   ""                                                                   "\n"
   "    -e [comma separated list]"                                      "\n"
-  "       The list of events to print out."                            "\n"
+  "       The list of events to print out, entries ending in ::*"   "\n"
+  "       match every event in that scope, such as Click::*"           "\n"
   ""                                                                   "\n"
-  "    -a [comma separated k=v pairs]"                                 "\n"
-  "       Key=value pairs to check before printing the event."         "\n"
+  "    -a [filter expression]"                                         "\n"
+  "       Attributes to check before printing the event, such as"      "\n"
+  "       'k1=v1,k2=v2' or '(n >= 10 || s ^= abc) && t in (1, 2)'"     "\n"
+  "       comparisons are = != < <= > >= ^= (prefix) ~= (regex)"       "\n"
   ""                                                                   "\n"
   "    -h"                                                             "\n"
   "         show this message"                                         "\n"
@@ -66,13 +70,17 @@ int main (int   argc, char *argv[]) {
   const char *mcast_ip    = "224.1.1.11";
   const char *mcast_iface = NULL;
   int         mcast_port  = 12345;
-  const char *event_name = NULL;
+  char       *event_names = NULL;
+  char       *event_name;
   const char *attr_list = NULL;
 
   sigset_t fullset;
   struct sigaction act;
 
   struct lwes_listener * listener;
+  struct lwes_event * event;
+  struct lwes_event_filter * filter = NULL;
+  size_t error_offset;
 
   opterr = 0;
   while (1) {
@@ -100,7 +108,7 @@ int main (int   argc, char *argv[]) {
         break;
 
       case 'e':
-        event_name = optarg;
+        event_names = optarg;
         break;
 
       case 'a':
@@ -115,7 +123,15 @@ int main (int   argc, char *argv[]) {
     }
   }
 
-  (void)attr_list; /* appease -Wall -Werror */
+  if (attr_list != NULL) {
+    filter = lwes_event_filter_create (attr_list, &error_offset);
+    if (filter == NULL) {
+      fprintf (stderr, "error: bad filter expression at offset %u: %s\n",
+               (unsigned int)error_offset, attr_list + error_offset);
+      return 1;
+    }
+  }
+
   sigfillset (&fullset);
   sigprocmask (SIG_SETMASK, &fullset, NULL);
 
@@ -138,20 +154,48 @@ int main (int   argc, char *argv[]) {
       (LWES_SHORT_STRING) mcast_iface,
       (LWES_U_INT_32)     mcast_port);
 
-  while ( ! done ) {
-    struct lwes_event *event = lwes_event_create_no_name ( NULL );
+  /* drop the events we are not interested in before decoding them, in the
+     kernel where socket filters are supported */
+  if (listener != NULL && event_names != NULL) {
+    lwes_listener_set_kernel_filter (listener, TRUE);
+    for (event_name = strtok (event_names, ",");
+         event_name != NULL;
+         event_name = strtok (NULL, ",")) {
+      if (lwes_listener_subscribe (listener, event_name) != 0) {
+        fprintf (stderr, "error: bad event name %s\n", event_name);
+        lwes_listener_destroy (listener);
+        return 1;
+      }
+    }
+  }
 
-    if ( event != NULL ) {
-      int ret = lwes_listener_recv ( listener, event);
-      if ( ret > 0 ) {
-        if (event_name == NULL ||
-            strcmp(event->eventName, event_name) == 0) {
+  /* reuse one event for every packet, clearing keeps its storage */
+  event = lwes_event_create_no_name ( NULL );
+
+  while ( ! done && listener != NULL && event != NULL ) {
+    int ret;
+    size_t len;
+
+    /* check the filter against the bytes, so only the events which are
+       printed get deserialized */
+    ret = lwes_listener_recv_bytes (listener, listener->buffer, MAX_MSG_SIZE);
+    if ( ret > 0 ) {
+      len = ret;
+      if (lwes_listener_add_header_fields (listener, listener->buffer,
+                                           MAX_MSG_SIZE, &len) == 0
+          && (filter == NULL
+              || lwes_event_filter_matches (filter, listener->buffer,
+                                            len) > 0)) {
+        lwes_event_clear (event);
+        if (lwes_event_from_bytes (event, listener->buffer, len, 0,
+                                   listener->dtmp) > 0) {
           lwes_event_to_stream (event, stdout);
         }
       }
     }
-    lwes_event_destroy (event);
   }
+  lwes_event_destroy (event);
+  lwes_event_filter_destroy (filter);
 
   lwes_listener_destroy (listener);
 
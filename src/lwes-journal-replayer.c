@@ -0,0 +1,402 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#include "lwes_emitter.h"
+#include "lwes_journal_reader.h"
+
+#ifdef HAVE_GETOPT_H
+#include <getopt.h>
+#endif
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+/* prototypes */
+static void signal_handler(int sig);
+
+/* global variable used to indicate what signal (if any) has been caught */
+static volatile int done = 0;
+
+/* the most events sent with one call */
+#define REPLAY_MAX_BATCH 64
+
+/* the last part of a wait is spun rather than slept, as a sleep can
+   overshoot, by at least this much and at most this much, adjusting to
+   the overshoots seen */
+#define REPLAY_MIN_SPIN_NSEC 100000LL
+#define REPLAY_MAX_SPIN_NSEC 2000000LL
+
+static const char help[] =
+  "lwes-journal-replayer [options] journal-file..."                    "\n"
+  ""                                                                   "\n"
+  "  where options are:"                                               "\n"
+  ""                                                                   "\n"
+  "    -m [one argument]"                                              "\n"
+  "       The multicast ip address to emit to."                        "\n"
+  "       (default: 224.1.1.11)"                                       "\n"
+  ""                                                                   "\n"
+  "    -p [one argument]"                                              "\n"
+  "       The ip port to emit to."                                     "\n"
+  "       (default: 12345)"                                            "\n"
+  ""                                                                   "\n"
+  "    -i [one argument]"                                              "\n"
+  "       The interface to emit from."                                 "\n"
+  "       (default: 0.0.0.0)"                                          "\n"
+  ""                                                                   "\n"
+  "    -r [one argument]"                                              "\n"
+  "       Replay this many times faster than the events were received" "\n"
+  "       (default: 1)"                                                "\n"
+  ""                                                                   "\n"
+  "    -f"                                                             "\n"
+  "       Replay as fast as possible"                                  "\n"
+  ""                                                                   "\n"
+  "    -b [one argument]"                                              "\n"
+  "       The most events to send at once, up to 64."                  "\n"
+  "       (default: 32)"                                               "\n"
+  ""                                                                   "\n"
+  "    -q"                                                             "\n"
+  "       Quiet mode, only print the summary at the end"               "\n"
+  ""                                                                   "\n"
+  "    -h"                                                             "\n"
+  "         show this message"                                         "\n"
+  ""                                                                   "\n"
+  "  The journal files, as written by lwes-journaller, are replayed"   "\n"
+  "  in the order given, keeping the gaps between them."               "\n"
+  ""                                                                   "\n"
+  "  arguments are specified as -option value or -optionvalue"         "\n"
+  ""                                                                   "\n";
+
+/* where a replay is up to, and how well it is keeping to schedule */
+struct replay
+{
+  struct lwes_emitter *emitter;
+  /* how many times faster than received, 0 for as fast as possible */
+  double        speedup;
+  unsigned int  batch_size;
+  /* how long before an event is due to stop sleeping and spin */
+  LWES_INT_64   spin_nsec;
+  int           quiet;
+  /* receipt time of the first event, and when it was sent */
+  LWES_INT_64   capture_start;
+  LWES_INT_64   replay_start;
+  LWES_INT_64   capture_last;
+  /* events waiting to be sent, and when each was due */
+  LWES_BYTE_P   bytes[REPLAY_MAX_BATCH];
+  size_t        lens[REPLAY_MAX_BATCH];
+  LWES_INT_64   due[REPLAY_MAX_BATCH];
+  unsigned int  pending;
+  /* totals */
+  LWES_U_INT_64 events;
+  LWES_U_INT_64 failed;
+  LWES_INT_64   late_total;
+  LWES_INT_64   late_max;
+  /* for the report printed every second */
+  LWES_INT_64   report_time;
+  LWES_U_INT_64 report_events;
+};
+
+/* a monotonic clock, in nanoseconds */
+static LWES_INT_64 replay_now (void) {
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (LWES_INT_64) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* sleeps until shortly before due, then spins until it, which is accurate
+   to a few microseconds without spinning through long gaps */
+static LWES_INT_64 replay_wait_until (struct replay *replay,
+                                      LWES_INT_64 due) {
+  struct timespec ts;
+  LWES_INT_64 now = replay_now ();
+  LWES_INT_64 wake;
+  LWES_INT_64 spin;
+
+  while (! done && due - now > replay->spin_nsec) {
+    wake = due - replay->spin_nsec;
+    ts.tv_sec = (time_t) ((wake - now) / 1000000000LL);
+    ts.tv_nsec = (long) ((wake - now) % 1000000000LL);
+    nanosleep (&ts, NULL);
+    now = replay_now ();
+
+    /* spin for about twice the usual overshoot */
+    spin = 2 * (now - wake);
+    if (spin < REPLAY_MIN_SPIN_NSEC) {
+      spin = REPLAY_MIN_SPIN_NSEC;
+    } else if (spin > REPLAY_MAX_SPIN_NSEC) {
+      spin = REPLAY_MAX_SPIN_NSEC;
+    }
+    replay->spin_nsec = (7 * replay->spin_nsec + spin) / 8;
+  }
+  while (! done && now < due) {
+    now = replay_now ();
+  }
+  return now;
+}
+
+/* when an event received at receipt_time should be sent */
+static LWES_INT_64 replay_due (struct replay *replay,
+                               LWES_INT_64 receipt_time) {
+  if (replay->speedup <= 0) {
+    return replay->replay_start;
+  }
+  return replay->replay_start
+         + (LWES_INT_64) ((double) (receipt_time - replay->capture_start)
+                          / replay->speedup);
+}
+
+static void replay_report (struct replay *replay, LWES_INT_64 now) {
+  double seconds = (now - replay->report_time) / 1e9;
+
+  if (! replay->quiet) {
+    printf ("sent %llu events, %.1f events/s\n",
+            (unsigned long long) replay->events,
+            (replay->events - replay->report_events) / seconds);
+  }
+  replay->report_time = now;
+  replay->report_events = replay->events;
+}
+
+/* sends the pending events with as few system calls as possible */
+static void replay_flush (struct replay *replay) {
+  LWES_INT_64 now;
+  LWES_INT_64 late;
+  unsigned int i;
+  int sent;
+
+  if (replay->pending == 0) {
+    return;
+  }
+
+  now = replay_now ();
+  sent = lwes_emitter_emit_serialized (replay->emitter, replay->bytes,
+                                       replay->lens, replay->pending);
+  if (sent < 0) {
+    sent = 0;
+  }
+  for (i = 0; i < replay->pending; ++i) {
+    late = now - replay->due[i];
+    replay->late_total += late;
+    if (late > replay->late_max) {
+      replay->late_max = late;
+    }
+  }
+  replay->events += (unsigned int) sent;
+  replay->failed += replay->pending - (unsigned int) sent;
+  replay->pending = 0;
+
+  if (now - replay->report_time >= 1000000000LL) {
+    replay_report (replay, now);
+  }
+}
+
+/* replays every record of a journal file, returning 0 on success */
+static int replay_file (struct replay *replay, const char *path) {
+  struct lwes_journal_reader *reader;
+  struct lwes_journal_cursor cursor;
+  struct lwes_journal_record record;
+  LWES_INT_64 due;
+  int ret;
+
+  reader = lwes_journal_reader_open (path);
+  if (reader == NULL) {
+    fprintf (stderr, "error: could not read %s\n", path);
+    return -1;
+  }
+  if (reader->valid_size != reader->size) {
+    fprintf (stderr, "warning: %s ends with a partial block\n", path);
+  }
+
+  lwes_journal_cursor_init (reader, &cursor, 0, reader->size);
+  while (! done && (ret = lwes_journal_cursor_next (&cursor, &record)) == 1) {
+    if (replay->events + replay->failed + replay->pending == 0) {
+      replay->capture_start = record.receipt_time;
+      replay->replay_start = replay_now ();
+      replay->report_time = replay->replay_start;
+    }
+    replay->capture_last = record.receipt_time;
+
+    /* what is already due goes out before waiting for what is not */
+    due = replay_due (replay, record.receipt_time);
+    if (due > replay_now ()) {
+      replay_flush (replay);
+      replay_wait_until (replay, due);
+    }
+
+    replay->bytes[replay->pending] = record.bytes;
+    replay->lens[replay->pending] = record.length;
+    replay->due[replay->pending] = due;
+    if (++replay->pending >= replay->batch_size) {
+      replay_flush (replay);
+    }
+  }
+  /* the records are in the mapping, so they are sent before it goes */
+  replay_flush (replay);
+  lwes_journal_reader_close (reader);
+
+  if (ret < 0) {
+    fprintf (stderr, "error: %s has a malformed record\n", path);
+    return -1;
+  }
+  return 0;
+}
+
+static void replay_summary (struct replay *replay) {
+  LWES_U_INT_64 attempted = replay->events + replay->failed;
+  double elapsed = (replay_now () - replay->replay_start) / 1e9;
+  double span = (replay->capture_last - replay->capture_start) / 1e9;
+
+  if (attempted == 0) {
+    printf ("no events replayed\n");
+    return;
+  }
+
+  printf ("replayed %llu events in %.3f seconds, %.1f events/s",
+          (unsigned long long) replay->events, elapsed,
+          attempted / (elapsed > 0 ? elapsed : 1e-9));
+  if (replay->speedup > 0 && span > 0) {
+    printf (" (target %.1f events/s)\n",
+            attempted / (span / replay->speedup));
+    printf ("late by %.1f us on average and %.1f us at most\n",
+            replay->late_total / 1e3 / attempted, replay->late_max / 1e3);
+  } else {
+    printf (" (target unlimited)\n");
+  }
+  printf ("%llu failed\n", (unsigned long long) replay->failed);
+}
+
+int main (int   argc, char *argv[]) {
+
+  const char *mcast_ip    = "224.1.1.11";
+  const char *mcast_iface = NULL;
+  int         mcast_port  = 12345;
+  struct replay replay;
+
+  sigset_t fullset;
+  struct sigaction act;
+  int ret = 0;
+
+  memset (&replay, 0, sizeof (replay));
+  replay.speedup = 1.0;
+  replay.batch_size = 32;
+  replay.spin_nsec = REPLAY_MIN_SPIN_NSEC;
+
+  opterr = 0;
+  while (1) {
+    char c = getopt (argc, argv, "m:p:i:r:fb:qh");
+
+    if (c == -1) {
+      break;
+    }
+
+    switch (c) {
+      case 'm':
+        mcast_ip = optarg;
+        break;
+
+      case 'p':
+        mcast_port = atoi(optarg);
+        break;
+
+      case 'i':
+        mcast_iface = optarg;
+        break;
+
+      case 'r':
+        replay.speedup = atof (optarg);
+        if (replay.speedup <= 0) {
+          fprintf (stderr, "error: the speedup must be positive\n");
+          return 1;
+        }
+        break;
+
+      case 'f':
+        replay.speedup = 0;
+        break;
+
+      case 'b':
+        replay.batch_size = (unsigned int) atoi (optarg);
+        if (replay.batch_size < 1 || replay.batch_size > REPLAY_MAX_BATCH) {
+          fprintf (stderr, "error: the batch size must be from 1 to %d\n",
+                   REPLAY_MAX_BATCH);
+          return 1;
+        }
+        break;
+
+      case 'q':
+        replay.quiet = 1;
+        break;
+
+      case 'h':
+        fprintf (stderr, "%s", help);
+        return 1;
+
+      default:
+        fprintf (stderr,
+                 "error: unrecognized command line option -%c\n",
+                 optopt);
+        return 1;
+    }
+  }
+
+  if (optind >= argc) {
+    fprintf (stderr, "error: no journal files given\n");
+    return 1;
+  }
+
+  sigfillset (&fullset);
+  sigprocmask (SIG_SETMASK, &fullset, NULL);
+
+  memset (&act, 0, sizeof (act));
+  act.sa_handler = signal_handler;
+  sigfillset (&act.sa_mask);
+
+  sigaction (SIGINT, &act, NULL);
+  sigaction (SIGTERM, &act, NULL);
+  sigaction (SIGPIPE, &act, NULL);
+
+  sigdelset (&fullset, SIGINT);
+  sigdelset (&fullset, SIGTERM);
+  sigdelset (&fullset, SIGPIPE);
+
+  sigprocmask (SIG_SETMASK, &fullset, NULL);
+
+  replay.emitter = lwes_emitter_create (
+      (LWES_SHORT_STRING) mcast_ip,
+      (LWES_SHORT_STRING) mcast_iface,
+      (LWES_U_INT_32)     mcast_port,
+      0,
+      60);
+  if (replay.emitter == NULL) {
+    fprintf (stderr, "error: could not create an emitter to %s:%d\n",
+             mcast_ip, mcast_port);
+    return 1;
+  }
+
+  for (; ! done && optind < argc; ++optind) {
+    if (replay_file (&replay, argv[optind]) != 0) {
+      ret = 1;
+    }
+  }
+  replay_summary (&replay);
+
+  lwes_emitter_destroy (replay.emitter);
+
+  return ret;
+}
+
+static void signal_handler(int sig) {
+  (void)sig; /* appease compiler */
+  done = 1;
+}
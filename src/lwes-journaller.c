@@ -0,0 +1,256 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#include "lwes_listener.h"
+#include "lwes_journal.h"
+#include "lwes_time_functions.h"
+
+#ifdef HAVE_GETOPT_H
+#include <getopt.h>
+#endif
+
+#include <signal.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <stdio.h>
+
+/* prototypes */
+static void signal_handler(int sig);
+
+/* global variable used to indicate what signal (if any) has been caught */
+static volatile int done = 0;
+
+/* the most packets handled per receive */
+#define JOURNALLER_BATCH 64
+
+static const char help[] =
+  "lwes-journaller [options]"                                          "\n"
+  ""                                                                   "\n"
+  "  where options are:"                                               "\n"
+  ""                                                                   "\n"
+  "    -m [one argument]"                                              "\n"
+  "       The multicast ip address to listen on."                      "\n"
+  "       (default: 224.1.1.11)"                                       "\n"
+  ""                                                                   "\n"
+  "    -p [one argument]"                                              "\n"
+  "       The ip port to listen on."                                   "\n"
+  "       (default: 12345)"                                            "\n"
+  ""                                                                   "\n"
+  "    -i [one argument]"                                              "\n"
+  "       The interface to listen on."                                 "\n"
+  "       (default: 0.0.0.0)"                                          "\n"
+  ""                                                                   "\n"
+  "    -o [one argument]"                                              "\n"
+  "       The path the journal file names start with."                 "\n"
+  "       (default: lwes-journal)"                                     "\n"
+  ""                                                                   "\n"
+  "    -b [one argument]"                                              "\n"
+  "       The size of a block in kilobytes."                           "\n"
+  "       (default: 1024)"                                             "\n"
+  ""                                                                   "\n"
+  "    -s [one argument]"                                              "\n"
+  "       Start a new file rather than grow one beyond this many"      "\n"
+  "       megabytes, 0 for no limit."                                  "\n"
+  "       (default: 1024)"                                             "\n"
+  ""                                                                   "\n"
+  "    -t [one argument]"                                              "\n"
+  "       Start a new file after this many seconds, 0 for no limit."   "\n"
+  "       (default: 3600)"                                             "\n"
+  ""                                                                   "\n"
+  "    -n"                                                             "\n"
+  "       Add a ReceiptTimeNanos header to the events"                 "\n"
+  ""                                                                   "\n"
+  "    -k"                                                             "\n"
+  "       Use the kernel's receive time as the receipt time"           "\n"
+  ""                                                                   "\n"
+  "    -h"                                                             "\n"
+  "         show this message"                                         "\n"
+  ""                                                                   "\n"
+  "  Blocks are written when they are full, and at least every second" "\n"
+  ""                                                                   "\n"
+  "  arguments are specified as -option value or -optionvalue"         "\n"
+  ""                                                                   "\n";
+
+
+
+int main (int   argc, char *argv[]) {
+
+  const char *mcast_ip    = "224.1.1.11";
+  const char *mcast_iface = NULL;
+  int         mcast_port  = 12345;
+  const char *prefix      = "lwes-journal";
+  size_t      block_size  = 1024 * 1024;
+  size_t      file_size   = (size_t) 1024 * 1024 * 1024;
+  unsigned int file_seconds = 3600;
+  int         nanos       = 0;
+  int         kernel_time = 0;
+
+  sigset_t fullset;
+  struct sigaction act;
+
+  struct lwes_listener * listener;
+  struct lwes_listener_packet * packets;
+  struct lwes_journal * journal;
+  LWES_INT_64 last_tick = currentTimeNanosLongLong ();
+  int ret = 0;
+
+  opterr = 0;
+  while (1) {
+    char c = getopt (argc, argv, "m:p:i:o:b:s:t:nkh");
+
+    if (c == -1) {
+      break;
+    }
+
+    switch (c) {
+      case 'm':
+        mcast_ip = optarg;
+        break;
+
+      case 'p':
+        mcast_port = atoi(optarg);
+        break;
+
+      case 'i':
+        mcast_iface = optarg;
+        break;
+
+      case 'o':
+        prefix = optarg;
+        break;
+
+      case 'b':
+        block_size = (size_t) strtoul (optarg, NULL, 10) * 1024;
+        break;
+
+      case 's':
+        file_size = (size_t) strtoul (optarg, NULL, 10) * 1024 * 1024;
+        break;
+
+      case 't':
+        file_seconds = (unsigned int) strtoul (optarg, NULL, 10);
+        break;
+
+      case 'n':
+        nanos = 1;
+        break;
+
+      case 'k':
+        kernel_time = 1;
+        break;
+
+      case 'h':
+        fprintf (stderr, "%s", help);
+        return 1;
+
+      default:
+        fprintf (stderr,
+                 "error: unrecognized command line option -%c\n",
+                 optopt);
+        return 1;
+    }
+  }
+
+  journal = lwes_journal_create (prefix, block_size, file_size,
+                                 file_seconds);
+  if (journal == NULL) {
+    fprintf (stderr, "error: could not create a journal at %s\n", prefix);
+    return 1;
+  }
+
+  sigfillset (&fullset);
+  sigprocmask (SIG_SETMASK, &fullset, NULL);
+
+  memset (&act, 0, sizeof (act));
+  act.sa_handler = signal_handler;
+  sigfillset (&act.sa_mask);
+
+  sigaction (SIGINT, &act, NULL);
+  sigaction (SIGTERM, &act, NULL);
+  sigaction (SIGPIPE, &act, NULL);
+
+  sigdelset (&fullset, SIGINT);
+  sigdelset (&fullset, SIGTERM);
+  sigdelset (&fullset, SIGPIPE);
+
+  sigprocmask (SIG_SETMASK, &fullset, NULL);
+
+  listener = lwes_listener_create (
+      (LWES_SHORT_STRING) mcast_ip,
+      (LWES_SHORT_STRING) mcast_iface,
+      (LWES_U_INT_32)     mcast_port);
+  if (listener == NULL) {
+    fprintf (stderr, "error: could not listen on %s:%d\n",
+             mcast_ip, mcast_port);
+    lwes_journal_destroy (journal);
+    return 1;
+  }
+
+  lwes_listener_set_receipt_time_nanos (listener, nanos ? TRUE : FALSE);
+  if (kernel_time
+      && lwes_listener_set_kernel_timestamps (listener, TRUE) != 0) {
+    fprintf (stderr, "warning: kernel timestamps are not supported\n");
+  }
+
+  while ( ! done ) {
+    LWES_INT_64 now;
+    LWES_INT_64 receipt_time;
+    int n;
+    int i;
+
+    /* the events are journaled as they were received, along with the
+       header fields, without being deserialized */
+    n = lwes_listener_recv_batch_by (listener, &packets,
+                                     JOURNALLER_BATCH, 1000);
+    for (i = 0; i < n; ++i) {
+      if (lwes_listener_packet_add_header_fields (&packets[i]) != 0) {
+        continue;
+      }
+      receipt_time = packets[i].receipt_time_nanos != 0
+                       ? packets[i].receipt_time_nanos
+                       : packets[i].receipt_time * 1000000LL;
+      if (lwes_journal_write (journal, packets[i].bytes, packets[i].length,
+                              receipt_time, packets[i].sender.sin_addr,
+                              ntohs (packets[i].sender.sin_port)) == -2) {
+        fprintf (stderr, "error: could not write to the journal at %s\n",
+                 prefix);
+      }
+    }
+
+    now = currentTimeNanosLongLong ();
+    if (now - last_tick >= 1000000000LL) {
+      last_tick = now;
+      if (lwes_journal_tick (journal, now) == -2) {
+        fprintf (stderr, "error: could not write to the journal at %s\n",
+                 prefix);
+      }
+    }
+  }
+
+  lwes_listener_destroy (listener);
+
+  if (lwes_journal_destroy (journal) != 0) {
+    fprintf (stderr, "error: could not write to the journal at %s\n",
+             prefix);
+    ret = 1;
+  }
+
+  return ret;
+}
+
+static void signal_handler(int sig) {
+  (void)sig; /* appease compiler */
+  done = 1;
+}
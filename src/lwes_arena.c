@@ -0,0 +1,187 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#include "lwes_arena.h"
+
+#include <stdlib.h>
+
+/* every allocation is rounded up to this, which suits any LWES type */
+#define LWES_ARENA_ALIGN 16
+
+#define LWES_ARENA_ROUND(n) \
+  (((n) + (LWES_ARENA_ALIGN - 1)) & ~((size_t)LWES_ARENA_ALIGN - 1))
+
+/* start of the storage of a block */
+#define LWES_ARENA_DATA(block) \
+  ((char *)(block) + LWES_ARENA_ROUND (sizeof (struct lwes_arena_block)))
+
+/*************************************************************************
+  PRIVATE API prototypes, shouldn't be called by a user of the library.
+ *************************************************************************/
+static struct lwes_arena_block *
+lwes_arena_block_create
+  (size_t size);
+
+/*************************************************************************
+  PUBLIC API
+ *************************************************************************/
+struct lwes_arena *
+lwes_arena_create
+  (size_t block_size)
+{
+  struct lwes_arena *arena;
+
+  arena = (struct lwes_arena *)malloc (sizeof (struct lwes_arena));
+  if (arena == NULL)
+    {
+      return NULL;
+    }
+
+  arena->block_size =
+    LWES_ARENA_ROUND (block_size > 0 ? block_size
+                                     : LWES_ARENA_DEFAULT_BLOCK_SIZE);
+  arena->first = lwes_arena_block_create (arena->block_size);
+  if (arena->first == NULL)
+    {
+      free (arena);
+      return NULL;
+    }
+  arena->current = arena->first;
+
+  return arena;
+}
+
+void *
+lwes_arena_alloc
+  (struct lwes_arena *arena,
+   size_t size)
+{
+  struct lwes_arena_block *block;
+  void *ret;
+
+  if (arena == NULL)
+    {
+      return NULL;
+    }
+
+  size  = LWES_ARENA_ROUND (size);
+  block = arena->current;
+
+  if (block->size - block->used < size)
+    {
+      /* move on to a block kept from before a rewind if it is big enough,
+       * otherwise put a new one in front of it */
+      if (block->next != NULL && block->next->size >= size)
+        {
+          block = block->next;
+        }
+      else
+        {
+          struct lwes_arena_block *new_block =
+            lwes_arena_block_create (size > arena->block_size
+                                     ? size : arena->block_size);
+          if (new_block == NULL)
+            {
+              return NULL;
+            }
+          new_block->next = block->next;
+          block->next     = new_block;
+          block           = new_block;
+        }
+      block->used    = 0;
+      arena->current = block;
+    }
+
+  ret = LWES_ARENA_DATA (block) + block->used;
+  block->used += size;
+
+  return ret;
+}
+
+void
+lwes_arena_mark
+  (struct lwes_arena *arena,
+   struct lwes_arena_mark *mark)
+{
+  mark->block = arena->current;
+  mark->used  = arena->current->used;
+}
+
+void
+lwes_arena_rewind
+  (struct lwes_arena *arena,
+   const struct lwes_arena_mark *mark)
+{
+  if (mark != NULL)
+    {
+      arena->current       = mark->block;
+      arena->current->used = mark->used;
+    }
+  else
+    {
+      arena->current       = arena->first;
+      arena->current->used = 0;
+    }
+}
+
+void
+lwes_arena_trim
+  (struct lwes_arena *arena)
+{
+  struct lwes_arena_block *block = arena->current->next;
+
+  while (block != NULL)
+    {
+      struct lwes_arena_block *next = block->next;
+      free (block);
+      block = next;
+    }
+  arena->current->next = NULL;
+}
+
+void
+lwes_arena_destroy
+  (struct lwes_arena *arena)
+{
+  if (arena == NULL)
+    {
+      return;
+    }
+
+  arena->current = arena->first;
+  lwes_arena_trim (arena);
+  free (arena->first);
+  free (arena);
+}
+
+/*************************************************************************
+  PRIVATE API
+ *************************************************************************/
+static struct lwes_arena_block *
+lwes_arena_block_create
+  (size_t size)
+{
+  struct lwes_arena_block *block =
+    (struct lwes_arena_block *)
+      malloc (LWES_ARENA_ROUND (sizeof (struct lwes_arena_block)) + size);
+
+  if (block == NULL)
+    {
+      return NULL;
+    }
+
+  block->next = NULL;
+  block->size = size;
+  block->used = 0;
+
+  return block;
+}
@@ -0,0 +1,138 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#ifndef __LWES_ARENA_H
+#define __LWES_ARENA_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! \file lwes_arena.h
+ *  \brief A growable region for allocations which are freed together
+ */
+
+/*! Default number of bytes in each block of an arena */
+#define LWES_ARENA_DEFAULT_BLOCK_SIZE 4096
+
+/*! \struct lwes_arena_block lwes_arena.h
+ *  \brief One contiguous block of an arena, its storage follows the header
+ */
+struct lwes_arena_block
+{
+  /*! the next block, which may be kept from before a rewind */
+  struct lwes_arena_block *next;
+  /*! number of usable bytes in this block */
+  size_t size;
+  /*! number of bytes handed out from this block */
+  size_t used;
+};
+
+/*! \struct lwes_arena lwes_arena.h
+ *  \brief A list of blocks which allocations are carved from in order
+ */
+struct lwes_arena
+{
+  /*! the first block */
+  struct lwes_arena_block *first;
+  /*! the block allocations currently come from */
+  struct lwes_arena_block *current;
+  /*! size of blocks added when the current one is full */
+  size_t block_size;
+};
+
+/*! \struct lwes_arena_mark lwes_arena.h
+ *  \brief A position in an arena which it can be rewound to
+ */
+struct lwes_arena_mark
+{
+  /*! the block current at the time of the mark */
+  struct lwes_arena_block *block;
+  /*! bytes used in that block at the time of the mark */
+  size_t used;
+};
+
+/*! \brief Create an arena
+ *
+ * \param[in] block_size the size of each block, 0 for
+ *            LWES_ARENA_DEFAULT_BLOCK_SIZE
+ *
+ * \return the new arena, or NULL if memory could not be allocated
+ */
+struct lwes_arena *
+lwes_arena_create
+  (size_t block_size);
+
+/*! \brief Allocate memory from an arena
+ *
+ * The memory is suitably aligned for any type, and is only released by
+ * lwes_arena_rewind, lwes_arena_trim or lwes_arena_destroy.  Requests
+ * larger than the block size get a block of their own.
+ *
+ * \param[in] arena the arena to allocate from
+ * \param[in] size the number of bytes wanted
+ *
+ * \return the memory, or NULL if a new block could not be allocated
+ */
+void *
+lwes_arena_alloc
+  (struct lwes_arena *arena,
+   size_t size);
+
+/*! \brief Record the current position of an arena
+ *
+ * \param[in] arena the arena
+ * \param[out] mark where to store the position
+ */
+void
+lwes_arena_mark
+  (struct lwes_arena *arena,
+   struct lwes_arena_mark *mark);
+
+/*! \brief Release everything allocated since a mark
+ *
+ * The blocks are kept and reused by later allocations.
+ *
+ * \param[in] arena the arena
+ * \param[in] mark a position returned by lwes_arena_mark on this arena,
+ *            NULL to release everything
+ */
+void
+lwes_arena_rewind
+  (struct lwes_arena *arena,
+   const struct lwes_arena_mark *mark);
+
+/*! \brief Free the blocks after the current one
+ *
+ * Returns the memory kept by lwes_arena_rewind to the system.
+ *
+ * \param[in] arena the arena
+ */
+void
+lwes_arena_trim
+  (struct lwes_arena *arena);
+
+/*! \brief Free an arena and everything allocated from it
+ *
+ * \param[in] arena the arena to free
+ */
+void
+lwes_arena_destroy
+  (struct lwes_arena *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LWES_ARENA_H */
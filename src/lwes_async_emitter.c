@@ -0,0 +1,505 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#include "lwes_async_emitter.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+/*
+ * The queue is a bounded array of slots each carrying a sequence number,
+ * after Dmitry Vyukov's bounded MPMC queue.  A slot at position pos is free
+ * for a producer when its sequence equals pos, and holds a published event
+ * when its sequence equals pos + 1.  Producers and the consumer claim
+ * positions with a compare and swap on enqueue_pos and dequeue_pos, so no
+ * locks are taken, and hand the slot on by storing the next sequence.
+ * Under LWES_ASYNC_DROP_OLDEST a producer finding the queue full takes the
+ * oldest event only if it is still queued in the very slot the producer
+ * needs.  If the sender already holds that slot in the batch it is sending,
+ * dropping any newer event would not make room, so the producer waits for
+ * the batch to be released just as under LWES_ASYNC_BLOCK.
+ *
+ * Nobody spins while there is nothing to do.  The sender thread parks on
+ * not_empty when the queue is empty, and producers blocked by a full queue
+ * park on not_full.  Each side advertises that it is parked (sender_waiting,
+ * producers_waiting) before re-checking the queue under the mutex, and the
+ * other side checks the flag after publishing or releasing a slot, with a
+ * full fence in between on both sides, so the fast path only takes the
+ * mutex when someone is actually asleep and no wakeup is lost.
+ */
+
+/*************************************************************************
+  PRIVATE API prototypes, shouldn't be called by a user of the library.
+ *************************************************************************/
+static struct lwes_async_emitter_slot *
+lwes_async_emitter_dequeue
+  (struct lwes_async_emitter *async,
+   size_t *pos);
+
+static void
+lwes_async_emitter_release
+  (struct lwes_async_emitter *async,
+   struct lwes_async_emitter_slot *slot,
+   size_t pos);
+
+static int
+lwes_async_emitter_drop_oldest
+  (struct lwes_async_emitter *async,
+   struct lwes_async_emitter_slot *slot,
+   size_t pos);
+
+static void
+lwes_async_emitter_wait_for_room
+  (struct lwes_async_emitter *async,
+   struct lwes_async_emitter_slot *slot,
+   size_t pos);
+
+static void
+lwes_async_emitter_park
+  (struct lwes_async_emitter *async);
+
+static void *
+lwes_async_emitter_sender
+  (void *arg);
+
+static void
+lwes_async_emitter_heartbeat
+  (struct lwes_event *heartbeat,
+   void *data);
+
+/*************************************************************************
+  PUBLIC API
+ *************************************************************************/
+struct lwes_async_emitter *
+lwes_async_emitter_create
+  (LWES_CONST_SHORT_STRING address,
+   LWES_CONST_SHORT_STRING iface,
+   LWES_U_INT_32 port,
+   LWES_BOOLEAN emit_heartbeat,
+   LWES_INT_16 freq,
+   unsigned int queue_size,
+   size_t slot_size,
+   LWES_ASYNC_OVERFLOW_POLICY policy)
+{
+  struct lwes_async_emitter *async;
+  void *memory;
+  size_t capacity = 1;
+  size_t i;
+
+  while (capacity < queue_size)
+    {
+      capacity <<= 1;
+    }
+  if (slot_size == 0 || slot_size > MAX_MSG_SIZE)
+    {
+      slot_size = MAX_MSG_SIZE;
+    }
+
+  /* aligned so the hot fields really do get a cache line each */
+  if (posix_memalign (&memory, LWES_ASYNC_CACHE_LINE,
+                      sizeof (struct lwes_async_emitter)) != 0)
+    {
+      return NULL;
+    }
+  async = (struct lwes_async_emitter *) memory;
+
+  async->slots = (struct lwes_async_emitter_slot *)
+    malloc (sizeof (struct lwes_async_emitter_slot) * capacity);
+  async->slot_buffer = (LWES_BYTE_P) malloc (slot_size * capacity);
+  if (async->slots == NULL || async->slot_buffer == NULL)
+    {
+      free (async->slots);
+      free (async->slot_buffer);
+      free (async);
+      return NULL;
+    }
+  for (i = 0; i < capacity; i++)
+    {
+      async->slots[i].sequence = i;
+      async->slots[i].length = 0;
+      async->slots[i].bytes = async->slot_buffer + i * slot_size;
+    }
+
+  async->slot_size = slot_size;
+  async->mask = capacity - 1;
+  async->policy = policy;
+  async->enqueue_pos = 0;
+  async->dequeue_pos = 0;
+  async->enqueued = 0;
+  async->dropped = 0;
+  async->sent = 0;
+  async->running = 1;
+  async->sender_waiting = 0;
+  async->producers_waiting = 0;
+
+  /* the emitter sends its startup event from this thread, after that it
+     belongs to the sender thread */
+  async->emitter = lwes_emitter_create (address, iface, port,
+                                        emit_heartbeat, freq);
+  if (async->emitter == NULL)
+    {
+      free (async->slots);
+      free (async->slot_buffer);
+      free (async);
+      return NULL;
+    }
+  async->emitter->heartbeat_callback = lwes_async_emitter_heartbeat;
+  async->emitter->heartbeat_data = async;
+
+  pthread_mutex_init (&(async->mutex), NULL);
+  pthread_cond_init (&(async->not_empty), NULL);
+  pthread_cond_init (&(async->not_full), NULL);
+
+  if (pthread_create (&(async->thread), NULL,
+                      lwes_async_emitter_sender, async) != 0)
+    {
+      pthread_cond_destroy (&(async->not_full));
+      pthread_cond_destroy (&(async->not_empty));
+      pthread_mutex_destroy (&(async->mutex));
+      lwes_emitter_destroy (async->emitter);
+      free (async->slots);
+      free (async->slot_buffer);
+      free (async);
+      return NULL;
+    }
+
+  return async;
+}
+
+int
+lwes_async_emitter_emit
+  (struct lwes_async_emitter *async,
+   struct lwes_event *event)
+{
+  struct lwes_async_emitter_slot *slot;
+  size_t pos;
+  size_t seq;
+  int size;
+
+  if (async == NULL || event == NULL)
+    {
+      return -1;
+    }
+
+  /* don't claim a slot, or drop an older event for it, if it won't fit */
+  if (lwes_event_serialized_size (event) > async->slot_size)
+    {
+      return -1;
+    }
+
+  pos = __atomic_load_n (&(async->enqueue_pos), __ATOMIC_RELAXED);
+  for (;;)
+    {
+      slot = &(async->slots[pos & async->mask]);
+      seq = __atomic_load_n (&(slot->sequence), __ATOMIC_ACQUIRE);
+      if (seq == pos)
+        {
+          if (__atomic_compare_exchange_n (&(async->enqueue_pos), &pos,
+                                           pos + 1, 1,
+                                           __ATOMIC_RELAXED,
+                                           __ATOMIC_RELAXED))
+            {
+              break;
+            }
+          /* lost the race, pos now holds the current value */
+        }
+      else if ((ptrdiff_t)(seq - pos) < 0)
+        {
+          /* the queue is full */
+          if (async->policy == LWES_ASYNC_DROP_NEWEST)
+            {
+              __atomic_fetch_add (&(async->dropped), 1, __ATOMIC_RELAXED);
+              return -2;
+            }
+          if (async->policy == LWES_ASYNC_DROP_OLDEST
+              && lwes_async_emitter_drop_oldest (async, slot, pos))
+            {
+              __atomic_fetch_add (&(async->dropped), 1, __ATOMIC_RELAXED);
+            }
+          else
+            {
+              lwes_async_emitter_wait_for_room (async, slot, pos);
+            }
+          pos = __atomic_load_n (&(async->enqueue_pos), __ATOMIC_RELAXED);
+        }
+      else
+        {
+          pos = __atomic_load_n (&(async->enqueue_pos), __ATOMIC_RELAXED);
+        }
+    }
+
+  /* the slot is ours until the sequence is published, and it has to be
+     published even if serialization fails since the position is claimed */
+  size = lwes_event_to_bytes (event, slot->bytes, async->slot_size, 0);
+  slot->length = (size < 0 ? 0 : (size_t)size);
+  __atomic_store_n (&(slot->sequence), pos + 1, __ATOMIC_RELEASE);
+
+  __atomic_thread_fence (__ATOMIC_SEQ_CST);
+  if (__atomic_load_n (&(async->sender_waiting), __ATOMIC_RELAXED))
+    {
+      pthread_mutex_lock (&(async->mutex));
+      pthread_cond_signal (&(async->not_empty));
+      pthread_mutex_unlock (&(async->mutex));
+    }
+
+  if (size < 0)
+    {
+      return -1;
+    }
+  __atomic_fetch_add (&(async->enqueued), 1, __ATOMIC_RELAXED);
+
+  return 0;
+}
+
+int
+lwes_async_emitter_destroy
+  (struct lwes_async_emitter *async)
+{
+  int ret = 0;
+
+  if (async == NULL)
+    {
+      return -1;
+    }
+
+  pthread_mutex_lock (&(async->mutex));
+  __atomic_store_n (&(async->running), 0, __ATOMIC_RELEASE);
+  pthread_cond_signal (&(async->not_empty));
+  pthread_mutex_unlock (&(async->mutex));
+  if (pthread_join (async->thread, NULL) != 0)
+    {
+      ret = -2;
+    }
+
+  if (lwes_emitter_destroy (async->emitter) < 0)
+    {
+      ret = -3;
+    }
+  pthread_cond_destroy (&(async->not_full));
+  pthread_cond_destroy (&(async->not_empty));
+  pthread_mutex_destroy (&(async->mutex));
+  free (async->slots);
+  free (async->slot_buffer);
+  free (async);
+
+  return ret;
+}
+
+/*************************************************************************
+  PRIVATE API
+ *************************************************************************/
+static struct lwes_async_emitter_slot *
+lwes_async_emitter_dequeue
+  (struct lwes_async_emitter *async,
+   size_t *pos_out)
+{
+  struct lwes_async_emitter_slot *slot;
+  size_t pos;
+  size_t seq;
+
+  pos = __atomic_load_n (&(async->dequeue_pos), __ATOMIC_RELAXED);
+  for (;;)
+    {
+      slot = &(async->slots[pos & async->mask]);
+      seq = __atomic_load_n (&(slot->sequence), __ATOMIC_ACQUIRE);
+      if (seq == pos + 1)
+        {
+          if (__atomic_compare_exchange_n (&(async->dequeue_pos), &pos,
+                                           pos + 1, 1,
+                                           __ATOMIC_RELAXED,
+                                           __ATOMIC_RELAXED))
+            {
+              *pos_out = pos;
+              return slot;
+            }
+        }
+      else if ((ptrdiff_t)(seq - (pos + 1)) < 0)
+        {
+          /* empty, or the oldest event is still being written */
+          return NULL;
+        }
+      else
+        {
+          pos = __atomic_load_n (&(async->dequeue_pos), __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static void
+lwes_async_emitter_release
+  (struct lwes_async_emitter *async,
+   struct lwes_async_emitter_slot *slot,
+   size_t pos)
+{
+  __atomic_store_n (&(slot->sequence), pos + async->mask + 1,
+                    __ATOMIC_RELEASE);
+}
+
+static int
+lwes_async_emitter_drop_oldest
+  (struct lwes_async_emitter *async,
+   struct lwes_async_emitter_slot *slot,
+   size_t pos)
+{
+  size_t oldest = pos - (async->mask + 1);
+  size_t expected = oldest;
+
+  /* the event in the slot must still be queued, not being written or held
+     by the sender, and claiming it must not race the sender */
+  if (__atomic_load_n (&(slot->sequence), __ATOMIC_ACQUIRE) != oldest + 1
+      || ! __atomic_compare_exchange_n (&(async->dequeue_pos), &expected,
+                                        oldest + 1, 0,
+                                        __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED))
+    {
+      return 0;
+    }
+  lwes_async_emitter_release (async, slot, oldest);
+  return 1;
+}
+
+static void
+lwes_async_emitter_wait_for_room
+  (struct lwes_async_emitter *async,
+   struct lwes_async_emitter_slot *slot,
+   size_t pos)
+{
+  pthread_mutex_lock (&(async->mutex));
+  __atomic_fetch_add (&(async->producers_waiting), 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence (__ATOMIC_SEQ_CST);
+  /* the slot at pos is free once the sender has released it */
+  while ((ptrdiff_t)(__atomic_load_n (&(slot->sequence), __ATOMIC_ACQUIRE)
+                     - pos) < 0)
+    {
+      pthread_cond_wait (&(async->not_full), &(async->mutex));
+    }
+  __atomic_fetch_sub (&(async->producers_waiting), 1, __ATOMIC_RELAXED);
+  pthread_mutex_unlock (&(async->mutex));
+}
+
+static void
+lwes_async_emitter_park
+  (struct lwes_async_emitter *async)
+{
+  struct lwes_async_emitter_slot *slot;
+  size_t pos;
+
+  pthread_mutex_lock (&(async->mutex));
+  __atomic_store_n (&(async->sender_waiting), 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence (__ATOMIC_SEQ_CST);
+  pos = __atomic_load_n (&(async->dequeue_pos), __ATOMIC_RELAXED);
+  slot = &(async->slots[pos & async->mask]);
+  /* a wakeup may be spurious, the caller just looks at the queue again */
+  if (__atomic_load_n (&(async->running), __ATOMIC_ACQUIRE)
+      && __atomic_load_n (&(slot->sequence), __ATOMIC_ACQUIRE) != pos + 1)
+    {
+      pthread_cond_wait (&(async->not_empty), &(async->mutex));
+    }
+  __atomic_store_n (&(async->sender_waiting), 0, __ATOMIC_RELAXED);
+  pthread_mutex_unlock (&(async->mutex));
+}
+
+static void *
+lwes_async_emitter_sender
+  (void *arg)
+{
+  struct lwes_async_emitter *async = (struct lwes_async_emitter *)arg;
+  struct lwes_async_emitter_slot *slots[LWES_NET_MAX_BATCH];
+  size_t positions[LWES_NET_MAX_BATCH];
+  LWES_BYTE_P bufs[LWES_NET_MAX_BATCH];
+  size_t lens[LWES_NET_MAX_BATCH];
+  unsigned int n;
+  unsigned int count;
+  unsigned int i;
+  int ret;
+
+  for (;;)
+    {
+      for (n = 0; n < LWES_NET_MAX_BATCH; n++)
+        {
+          slots[n] = lwes_async_emitter_dequeue (async, &(positions[n]));
+          if (slots[n] == NULL)
+            {
+              break;
+            }
+        }
+
+      if (n == 0)
+        {
+          /* only exit once the queue has been drained */
+          if (! __atomic_load_n (&(async->running), __ATOMIC_ACQUIRE)
+              && __atomic_load_n (&(async->dequeue_pos), __ATOMIC_ACQUIRE)
+                 == __atomic_load_n (&(async->enqueue_pos), __ATOMIC_ACQUIRE))
+            {
+              break;
+            }
+          lwes_async_emitter_park (async);
+          continue;
+        }
+
+      /* events which failed to serialize hold their place with length 0 */
+      count = 0;
+      for (i = 0; i < n; i++)
+        {
+          if (slots[i]->length > 0)
+            {
+              bufs[count] = slots[i]->bytes;
+              lens[count] = slots[i]->length;
+              count++;
+            }
+        }
+
+      if (count > 0)
+        {
+          ret = lwes_emitter_emit_serialized (async->emitter,
+                                              bufs, lens, count);
+          if (ret > 0)
+            {
+              __atomic_fetch_add (&(async->sent), (LWES_INT_64)ret,
+                                  __ATOMIC_RELAXED);
+            }
+        }
+
+      for (i = 0; i < n; i++)
+        {
+          lwes_async_emitter_release (async, slots[i], positions[i]);
+        }
+
+      __atomic_thread_fence (__ATOMIC_SEQ_CST);
+      if (__atomic_load_n (&(async->producers_waiting), __ATOMIC_RELAXED) > 0)
+        {
+          pthread_mutex_lock (&(async->mutex));
+          pthread_cond_broadcast (&(async->not_full));
+          pthread_mutex_unlock (&(async->mutex));
+        }
+    }
+
+  return NULL;
+}
+
+static void
+lwes_async_emitter_heartbeat
+  (struct lwes_event *heartbeat,
+   void *data)
+{
+  struct lwes_async_emitter *async = (struct lwes_async_emitter *)data;
+
+  lwes_event_set_INT_64 (heartbeat, (LWES_SHORT_STRING)"enqueued",
+                         __atomic_load_n (&(async->enqueued),
+                                          __ATOMIC_RELAXED));
+  lwes_event_set_INT_64 (heartbeat, (LWES_SHORT_STRING)"dropped",
+                         __atomic_load_n (&(async->dropped),
+                                          __ATOMIC_RELAXED));
+  lwes_event_set_INT_64 (heartbeat, (LWES_SHORT_STRING)"sent",
+                         __atomic_load_n (&(async->sent),
+                                          __ATOMIC_RELAXED));
+}
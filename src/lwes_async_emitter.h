@@ -0,0 +1,175 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#ifndef __LWES_ASYNC_EMITTER_H
+#define __LWES_ASYNC_EMITTER_H
+
+#include "lwes_types.h"
+#include "lwes_emitter.h"
+#include "lwes_event.h"
+
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! \file lwes_async_emitter.h
+ *  \brief Functions for emitting LWES events from a background thread
+ */
+
+/*! \brief Size of the cache line the hot fields of an async emitter are
+ *  kept apart on, so producers and the sender thread don't false share
+ */
+#define LWES_ASYNC_CACHE_LINE 64
+
+/*! \brief What lwes_async_emitter_emit does when the queue is full
+ */
+typedef enum {
+    LWES_ASYNC_DROP_NEWEST = 0, /*!< discard the event being emitted */
+    LWES_ASYNC_DROP_OLDEST = 1, /*!< discard the oldest queued event */
+    LWES_ASYNC_BLOCK       = 2  /*!< wait for the sender thread */
+} LWES_ASYNC_OVERFLOW_POLICY;
+
+/*! \struct lwes_async_emitter_slot lwes_async_emitter.h
+ *  \brief One serialized event in the queue of an async emitter
+ */
+struct lwes_async_emitter_slot
+{
+  /*! position in the queue this slot is ready for, see the queue notes in
+      lwes_async_emitter.c */
+  size_t sequence;
+  /*! length of the serialized event, 0 if serialization failed */
+  size_t length;
+  /*! slot_size bytes of storage for the serialized event */
+  LWES_BYTE_P bytes;
+};
+
+/*! \struct lwes_async_emitter lwes_async_emitter.h
+ *  \brief Emits LWES events through a queue drained by a sender thread
+ *
+ *  Any number of threads may call lwes_async_emitter_emit at once, the
+ *  underlying emitter is only touched by the sender thread.
+ */
+struct lwes_async_emitter
+{
+  /*! the emitter used by the sender thread */
+  struct lwes_emitter *emitter;
+  /*! the queue, queue_size slots */
+  struct lwes_async_emitter_slot *slots;
+  /*! storage for all the slots */
+  LWES_BYTE_P slot_buffer;
+  /*! number of bytes available to each serialized event */
+  size_t slot_size;
+  /*! number of slots minus one, the number of slots is a power of two */
+  size_t mask;
+  /*! what to do when the queue is full */
+  LWES_ASYNC_OVERFLOW_POLICY policy;
+  /*! boolean, cleared to ask the sender thread to drain and exit */
+  int running;
+  /*! the sender thread */
+  pthread_t thread;
+  /*! protects the waits on not_empty and not_full */
+  pthread_mutex_t mutex;
+  /*! signalled when an event is queued while the sender thread is parked */
+  pthread_cond_t not_empty;
+  /*! signalled when the sender thread frees slots for blocked producers */
+  pthread_cond_t not_full;
+  /*! boolean, set while the sender thread is parked on not_empty */
+  int sender_waiting;
+  /*! number of producers parked on not_full */
+  int producers_waiting;
+
+  /* The fields below are each written on every event, by producers or by
+     the sender thread, so each is kept on a cache line of its own. */
+
+  /*! next position to be claimed by a producer */
+  size_t enqueue_pos __attribute__ ((aligned (LWES_ASYNC_CACHE_LINE)));
+  /*! next position to be claimed by the sender */
+  size_t dequeue_pos __attribute__ ((aligned (LWES_ASYNC_CACHE_LINE)));
+  /*! count of events successfully queued */
+  LWES_INT_64 enqueued __attribute__ ((aligned (LWES_ASYNC_CACHE_LINE)));
+  /*! count of events discarded because the queue was full */
+  LWES_INT_64 dropped __attribute__ ((aligned (LWES_ASYNC_CACHE_LINE)));
+  /*! count of events sent by the sender thread */
+  LWES_INT_64 sent __attribute__ ((aligned (LWES_ASYNC_CACHE_LINE)));
+};
+
+/*! \brief Create an asynchronous Emitter
+ *
+ *  \param[in] address        The multicast ip address as a dotted quad string
+ *                            of the channel to emit to.
+ *  \param[in] iface          The dotted quad ip address of the interface to
+ *                            send messages on, can be NULL to use default.
+ *  \param[in] port           The port of the channel to emit to.
+ *  \param[in] emit_heartbeat Set to 1 to emit heartbeats, set to 0 to not
+ *                            emit heartbeats.  Heartbeats also carry the
+ *                            enqueued, dropped and sent counters.
+ *  \param[in] freq           Number of seconds between heartbeats.
+ *  \param[in] queue_size     Number of events the queue holds, rounded up to
+ *                            a power of two.
+ *  \param[in] slot_size      Largest serialized event that can be queued, 0
+ *                            for MAX_MSG_SIZE.
+ *  \param[in] policy         What to do when the queue is full.
+ *
+ *  \see lwes_async_emitter_destroy
+ *
+ *  \return A newly created emitter, use lwes_async_emitter_destroy to free
+ */
+struct lwes_async_emitter *
+lwes_async_emitter_create
+  (LWES_CONST_SHORT_STRING address,
+   LWES_CONST_SHORT_STRING iface,
+   LWES_U_INT_32 port,
+   LWES_BOOLEAN emit_heartbeat,
+   LWES_INT_16 freq,
+   unsigned int queue_size,
+   size_t slot_size,
+   LWES_ASYNC_OVERFLOW_POLICY policy);
+
+/*! \brief Queue an event to be emitted by the sender thread
+ *
+ *  The event is serialized straight into the queue, so it may be destroyed
+ *  or reused as soon as this returns.  This may be called from any thread.
+ *  Under LWES_ASYNC_DROP_OLDEST each emit into a full queue drops at most
+ *  the one oldest event, and waits instead if the sender thread is still
+ *  sending it.
+ *
+ *  \param[in] async The emitter to emit to
+ *  \param[in] event The event to emit
+ *
+ *  \return 0 on success, -1 if the event could not be serialized (or is
+ *  larger than slot_size), -2 if it was dropped because the queue was full
+ */
+int
+lwes_async_emitter_emit
+  (struct lwes_async_emitter *async,
+   struct lwes_event *event);
+
+/*! \brief Destroy an asynchronous Emitter
+ *
+ *  Stops the sender thread once everything queued has been sent, then
+ *  destroys the underlying emitter.
+ *
+ * \param[in] async The emitter to destroy
+ *
+ * \return 0 on success, negative number on failure
+ */
+int
+lwes_async_emitter_destroy
+  (struct lwes_async_emitter *async);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LWES_ASYNC_EMITTER_H */
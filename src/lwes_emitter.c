@@ -12,6 +12,8 @@
 
 #include "lwes_emitter.h"
 
+#include <string.h>
+
 /*************************************************************************
   PRIVATE API prototypes, shouldn't be called by a user of the library.
  *************************************************************************/
@@ -24,6 +26,35 @@ int
 lwes_emitter_collect_statistics
   (struct lwes_emitter *emitter);
 
+int
+lwes_emitter_batch_alloc
+  (struct lwes_emitter *emitter,
+   unsigned int slots);
+
+int
+lwes_emitter_queue_event
+  (struct lwes_emitter *emitter,
+   struct lwes_event *event);
+
+int
+lwes_emitter_queue_bytes
+  (struct lwes_emitter *emitter,
+   LWES_BYTE_P bytes,
+   size_t length);
+
+struct lwes_emitter_cached_connection *
+lwes_emitter_cache_get
+  (struct lwes_emitter_connection_cache *cache,
+   const char *key,
+   LWES_SHORT_STRING address,
+   LWES_SHORT_STRING iface,
+   LWES_U_INT_32 port);
+
+void
+lwes_emitter_cache_evict
+  (struct lwes_emitter_connection_cache *cache,
+   struct lwes_emitter_cached_connection *entry);
+
 void lwes_emitter_calculate_and_send_statistics
   (struct lwes_emitter *emitter,
    struct lwes_event *stats_event,
@@ -90,6 +121,14 @@ lwes_emitter_create_with_ttl
   emitter->sequence = 0;
   emitter->frequency = freq;
   emitter->emitHeartbeat = emit_heartbeat;
+  emitter->batch_buffer = NULL;
+  emitter->batch_lengths = NULL;
+  emitter->batch_capacity = 0;
+  emitter->batch_count = 0;
+  emitter->batch_accumulate = FALSE;
+  emitter->emitto_cache = NULL;
+  emitter->heartbeat_callback = NULL;
+  emitter->heartbeat_data = NULL;
 
   /* Send an event saying we are starting up */
   if (emitter->emitHeartbeat)
@@ -134,9 +173,10 @@ lwes_emitter_emitto
    struct lwes_emitter *emitter,
    struct lwes_event *event)
 {
+  char key[LWES_EMITTER_CACHE_KEY_MAX];
   int size;
 
-  if(emitter == NULL)
+  if(emitter == NULL || address == NULL)
   {
     return -1;
   }
@@ -147,6 +187,28 @@ lwes_emitter_emitto
       return -1;
     }
 
+  if (emitter->emitto_cache != NULL
+      && snprintf (key, sizeof (key), "%s:%u:%s",
+                   address, (unsigned int)port,
+                   (iface == NULL ? "" : iface)) < (int)sizeof (key))
+    {
+      struct lwes_emitter_cached_connection *cached =
+        lwes_emitter_cache_get (emitter->emitto_cache,
+                                key, address, iface, port);
+      if (cached == NULL)
+        {
+          return -2;
+        }
+      if (lwes_net_send_bytes (&(cached->connection),
+                               emitter->buffer, size) < 0)
+        {
+          /* don't keep a socket around that has started failing */
+          lwes_emitter_cache_evict (emitter->emitto_cache, cached);
+          return -2;
+        }
+      return 0;
+    }
+
   if (lwes_net_sendto_bytes (&(emitter->connection),
                              address,
                              iface,
@@ -159,6 +221,224 @@ lwes_emitter_emitto
   return 0;
 }
 
+int
+lwes_emitter_set_batch_size
+  (struct lwes_emitter *emitter,
+   unsigned int batch_size)
+{
+  if (emitter == NULL)
+    {
+      return -1;
+    }
+
+  lwes_emitter_flush (emitter);
+
+  if (batch_size <= 1)
+    {
+      emitter->batch_accumulate = FALSE;
+      return lwes_emitter_batch_alloc (emitter, 0);
+    }
+
+  if (lwes_emitter_batch_alloc (emitter, batch_size) < 0)
+    {
+      emitter->batch_accumulate = FALSE;
+      return -2;
+    }
+  emitter->batch_accumulate = TRUE;
+
+  return 0;
+}
+
+int
+lwes_emitter_flush
+  (struct lwes_emitter *emitter)
+{
+  LWES_BYTE_P bufs[LWES_NET_MAX_BATCH];
+  unsigned int sent = 0;
+  unsigned int n;
+  unsigned int i;
+  int ret;
+
+  if (emitter == NULL)
+    {
+      return -1;
+    }
+
+  while (sent < emitter->batch_count)
+    {
+      n = emitter->batch_count - sent;
+      if (n > LWES_NET_MAX_BATCH)
+        {
+          n = LWES_NET_MAX_BATCH;
+        }
+      for (i = 0; i < n; i++)
+        {
+          bufs[i] = emitter->batch_buffer + (size_t)(sent + i) * MAX_MSG_SIZE;
+        }
+      ret = lwes_net_send_bytes_batch (&(emitter->connection),
+                                       bufs,
+                                       emitter->batch_lengths + sent,
+                                       n);
+      if (ret <= 0)
+        {
+          emitter->batch_count = 0;
+          return -2;
+        }
+      sent += (unsigned int)ret;
+    }
+  emitter->batch_count = 0;
+
+  return (int)sent;
+}
+
+int
+lwes_emitter_emit_batch
+  (struct lwes_emitter *emitter,
+   struct lwes_event **events,
+   unsigned int count)
+{
+  LWES_BOOLEAN accumulate;
+  unsigned int sent = 0;
+  unsigned int i;
+  int ret = 0;
+
+  if (emitter == NULL || events == NULL)
+    {
+      return -1;
+    }
+
+  if (emitter->batch_capacity == 0
+      && lwes_emitter_batch_alloc (emitter,
+                                   LWES_EMITTER_DEFAULT_BATCH_SIZE) < 0)
+    {
+      return -2;
+    }
+
+  /* emit through the normal path so that each event is counted (and
+     heartbeats are interleaved in order), but force accumulation.  An
+     event which can't be serialized is skipped, a failed send stops */
+  accumulate = emitter->batch_accumulate;
+  emitter->batch_accumulate = TRUE;
+  for (i = 0; i < count && ret != -2; i++)
+    {
+      ret = lwes_emitter_emit (emitter, events[i]);
+      if (ret == 0)
+        {
+          sent++;
+        }
+    }
+  emitter->batch_accumulate = accumulate;
+
+  if (lwes_emitter_flush (emitter) < 0 || ret == -2)
+    {
+      return -2;
+    }
+
+  return (int)sent;
+}
+
+int
+lwes_emitter_emit_serialized
+  (struct lwes_emitter *emitter,
+   LWES_BYTE_P *bytes,
+   size_t *lens,
+   unsigned int count)
+{
+  unsigned int sent = 0;
+  unsigned int i;
+  int ret;
+
+  if (emitter == NULL || bytes == NULL || lens == NULL)
+    {
+      return -1;
+    }
+
+  /* anything pending was emitted first, so it goes out first */
+  if (emitter->batch_count > 0 && lwes_emitter_flush (emitter) < 0)
+    {
+      return -2;
+    }
+
+  while (sent < count)
+    {
+      ret = lwes_net_send_bytes_batch (&(emitter->connection),
+                                       bytes + sent, lens + sent,
+                                       count - sent);
+      if (ret <= 0)
+        {
+          break;
+        }
+      for (i = 0; i < (unsigned int)ret; i++)
+        {
+          lwes_emitter_collect_statistics (emitter);
+        }
+      sent += (unsigned int)ret;
+    }
+
+  if (sent == 0 && count > 0)
+    {
+      return -2;
+    }
+
+  return (int)sent;
+}
+
+int
+lwes_emitter_set_emitto_cache_size
+  (struct lwes_emitter *emitter,
+   unsigned int max_connections)
+{
+  struct lwes_emitter_connection_cache *cache;
+
+  if (emitter == NULL)
+    {
+      return -1;
+    }
+
+  cache = emitter->emitto_cache;
+  if (cache == NULL)
+    {
+      if (max_connections == 0)
+        {
+          return 0;
+        }
+      cache = (struct lwes_emitter_connection_cache *)
+        malloc (sizeof (struct lwes_emitter_connection_cache));
+      if (cache == NULL)
+        {
+          return -2;
+        }
+      cache->connections = lwes_hash_create_with_bins (2 * max_connections);
+      if (cache->connections == NULL)
+        {
+          free (cache);
+          return -2;
+        }
+      cache->head = NULL;
+      cache->tail = NULL;
+      cache->size = 0;
+      cache->hits = 0;
+      cache->misses = 0;
+      cache->evictions = 0;
+      emitter->emitto_cache = cache;
+    }
+
+  cache->capacity = max_connections;
+  while (cache->size > cache->capacity)
+    {
+      lwes_emitter_cache_evict (cache, cache->tail);
+    }
+
+  if (max_connections == 0)
+    {
+      lwes_hash_destroy (cache->connections);
+      free (cache);
+      emitter->emitto_cache = NULL;
+    }
+
+  return 0;
+}
+
 int
 lwes_emitter_destroy
   (struct lwes_emitter *emitter)
@@ -179,6 +459,12 @@ lwes_emitter_destroy
                                                       current_time);
         }
 
+      /* anything still waiting in a batch (including the shutdown event)
+         needs to go out before the socket is closed */
+      lwes_emitter_flush (emitter);
+
+      lwes_emitter_set_emitto_cache_size (emitter, 0);
+
       /* shutdown the network, use the return code here for library users */
       ret = lwes_net_close (&(emitter->connection));
 
@@ -187,6 +473,7 @@ lwes_emitter_destroy
         {
           free(emitter->buffer);
         }
+      lwes_emitter_batch_alloc (emitter, 0);
       free(emitter);
    }
 
@@ -199,6 +486,11 @@ lwes_emitter_emit_bytes
    LWES_BYTE_P bytes,
    size_t length)
 {
+  /* join the pending batch rather than overtake it */
+  if (emitter->batch_accumulate)
+    {
+      return lwes_emitter_queue_bytes (emitter, bytes, length);
+    }
   return lwes_net_send_bytes (&(emitter->connection), bytes ,length);
 }
 
@@ -212,6 +504,11 @@ lwes_emitter_emit_event
 {
   int size;
 
+  if (emitter->batch_accumulate)
+    {
+      return lwes_emitter_queue_event (emitter, event);
+    }
+
   if ((size = lwes_event_to_bytes (event,emitter->buffer,MAX_MSG_SIZE,0)) < 0)
   {
     return -1;
@@ -255,6 +552,10 @@ void lwes_emitter_calculate_and_send_statistics
                             emitter->count_since_last_beat);
       lwes_event_set_INT_64(stats_event,(LWES_SHORT_STRING)"total",
                             emitter->count);
+      if (emitter->heartbeat_callback != NULL)
+        {
+          emitter->heartbeat_callback (stats_event, emitter->heartbeat_data);
+        }
       lwes_emitter_emit_event(emitter,stats_event);
       lwes_event_destroy(stats_event);
     }
@@ -289,3 +590,192 @@ lwes_emitter_collect_statistics
     }
   return 0;
 }
+
+int
+lwes_emitter_batch_alloc
+  (struct lwes_emitter *emitter,
+   unsigned int slots)
+{
+  LWES_BYTE_P buffer = NULL;
+  size_t *lengths = NULL;
+
+  if (slots == emitter->batch_capacity)
+    {
+      return 0;
+    }
+
+  if (slots > 0)
+    {
+      buffer = (LWES_BYTE_P) malloc ((size_t)slots * MAX_MSG_SIZE);
+      lengths = (size_t *) malloc (sizeof (size_t) * slots);
+      if (buffer == NULL || lengths == NULL)
+        {
+          free (buffer);
+          free (lengths);
+          return -1;
+        }
+    }
+
+  free (emitter->batch_buffer);
+  free (emitter->batch_lengths);
+  emitter->batch_buffer = buffer;
+  emitter->batch_lengths = lengths;
+  emitter->batch_capacity = slots;
+  emitter->batch_count = 0;
+
+  return 0;
+}
+
+int
+lwes_emitter_queue_event
+  (struct lwes_emitter *emitter,
+   struct lwes_event *event)
+{
+  LWES_BYTE_P slot;
+  int size;
+
+  slot = emitter->batch_buffer + (size_t)emitter->batch_count * MAX_MSG_SIZE;
+  if ((size = lwes_event_to_bytes (event, slot, MAX_MSG_SIZE, 0)) < 0)
+    {
+      return -1;
+    }
+  emitter->batch_lengths[emitter->batch_count++] = (size_t)size;
+
+  if (emitter->batch_count == emitter->batch_capacity
+      && lwes_emitter_flush (emitter) < 0)
+    {
+      return -2;
+    }
+
+  return 0;
+}
+
+int
+lwes_emitter_queue_bytes
+  (struct lwes_emitter *emitter,
+   LWES_BYTE_P bytes,
+   size_t length)
+{
+  if (length > MAX_MSG_SIZE)
+    {
+      return -1;
+    }
+  memcpy (emitter->batch_buffer + (size_t)emitter->batch_count * MAX_MSG_SIZE,
+          bytes, length);
+  emitter->batch_lengths[emitter->batch_count++] = length;
+
+  if (emitter->batch_count == emitter->batch_capacity
+      && lwes_emitter_flush (emitter) < 0)
+    {
+      return -2;
+    }
+
+  return (int)length;
+}
+
+struct lwes_emitter_cached_connection *
+lwes_emitter_cache_get
+  (struct lwes_emitter_connection_cache *cache,
+   const char *key,
+   LWES_SHORT_STRING address,
+   LWES_SHORT_STRING iface,
+   LWES_U_INT_32 port)
+{
+  struct lwes_emitter_cached_connection *entry =
+    (struct lwes_emitter_cached_connection *)
+      lwes_hash_get (cache->connections, key);
+
+  if (entry != NULL)
+    {
+      cache->hits++;
+      /* move to the front of the list */
+      if (entry != cache->head)
+        {
+          entry->prev->next = entry->next;
+          if (entry->next != NULL)
+            {
+              entry->next->prev = entry->prev;
+            }
+          else
+            {
+              cache->tail = entry->prev;
+            }
+          entry->prev = NULL;
+          entry->next = cache->head;
+          cache->head->prev = entry;
+          cache->head = entry;
+        }
+      return entry;
+    }
+
+  cache->misses++;
+  entry = (struct lwes_emitter_cached_connection *)
+    malloc (sizeof (struct lwes_emitter_cached_connection));
+  if (entry == NULL)
+    {
+      return NULL;
+    }
+  strcpy (entry->key, key);
+
+  if (lwes_net_open (&(entry->connection), address, iface, port) < 0)
+    {
+      free (entry);
+      return NULL;
+    }
+
+  if (lwes_hash_put (cache->connections, entry->key, entry) != NULL)
+    {
+      lwes_net_close (&(entry->connection));
+      free (entry);
+      return NULL;
+    }
+
+  if (cache->size >= cache->capacity)
+    {
+      cache->evictions++;
+      lwes_emitter_cache_evict (cache, cache->tail);
+    }
+
+  entry->prev = NULL;
+  entry->next = cache->head;
+  if (cache->head != NULL)
+    {
+      cache->head->prev = entry;
+    }
+  else
+    {
+      cache->tail = entry;
+    }
+  cache->head = entry;
+  cache->size++;
+
+  return entry;
+}
+
+void
+lwes_emitter_cache_evict
+  (struct lwes_emitter_connection_cache *cache,
+   struct lwes_emitter_cached_connection *entry)
+{
+  if (entry->prev != NULL)
+    {
+      entry->prev->next = entry->next;
+    }
+  else
+    {
+      cache->head = entry->next;
+    }
+  if (entry->next != NULL)
+    {
+      entry->next->prev = entry->prev;
+    }
+  else
+    {
+      cache->tail = entry->prev;
+    }
+  cache->size--;
+
+  lwes_hash_remove (cache->connections, entry->key);
+  (void) lwes_net_close (&(entry->connection));
+  free (entry);
+}
@@ -28,6 +28,49 @@ extern "C" {
  *  \brief Functions for emitting LWES events
  */
 
+/*! \brief Longest "address:port:iface" key lwes_emitter_emitto will cache,
+ *  including the terminating nul
+ */
+#define LWES_EMITTER_CACHE_KEY_MAX 64
+
+/*! \struct lwes_emitter_cached_connection lwes_emitter.h
+ *  \brief An open connection kept for reuse by lwes_emitter_emitto
+ */
+struct lwes_emitter_cached_connection
+{
+  /*! the open channel */
+  struct lwes_net_connection connection;
+  /*! "address:port:iface" the channel was opened with */
+  char key[LWES_EMITTER_CACHE_KEY_MAX];
+  /*! next more recently used connection */
+  struct lwes_emitter_cached_connection *prev;
+  /*! next less recently used connection */
+  struct lwes_emitter_cached_connection *next;
+};
+
+/*! \struct lwes_emitter_connection_cache lwes_emitter.h
+ *  \brief Bounded LRU cache of connections used by lwes_emitter_emitto
+ */
+struct lwes_emitter_connection_cache
+{
+  /*! lookup of cached connections by key */
+  struct lwes_hash *connections;
+  /*! most recently used connection */
+  struct lwes_emitter_cached_connection *head;
+  /*! least recently used connection, the first to be evicted */
+  struct lwes_emitter_cached_connection *tail;
+  /*! number of connections currently open */
+  unsigned int size;
+  /*! maximum number of connections to keep open */
+  unsigned int capacity;
+  /*! number of sends which reused an open connection */
+  LWES_INT_64 hits;
+  /*! number of sends which had to open a connection */
+  LWES_INT_64 misses;
+  /*! number of connections closed to make room for another */
+  LWES_INT_64 evictions;
+};
+
 /*! \struct lwes_emitter lwes_emitter.h
  *  \brief Emits LWES events
  */
@@ -49,8 +92,29 @@ struct lwes_emitter
   LWES_BOOLEAN emitHeartbeat;
   /*! time of last heartbeat */
   time_t last_beat_time;
+  /*! serialization slots for batched emission, MAX_MSG_SIZE bytes each */
+  LWES_BYTE_P batch_buffer;
+  /*! serialized length of each pending slot in batch_buffer */
+  size_t *batch_lengths;
+  /*! number of slots allocated in batch_buffer */
+  unsigned int batch_capacity;
+  /*! number of serialized events waiting to be sent */
+  unsigned int batch_count;
+  /*! boolean, TRUE if emitted events should be accumulated into batches */
+  LWES_BOOLEAN batch_accumulate;
+  /*! connections kept open for lwes_emitter_emitto, NULL if not caching */
+  struct lwes_emitter_connection_cache *emitto_cache;
+  /*! called to add extra attributes to each heartbeat, may be NULL */
+  void (*heartbeat_callback) (struct lwes_event *heartbeat, void *data);
+  /*! passed through to heartbeat_callback */
+  void *heartbeat_data;
 };
 
+/*! \brief Number of slots allocated by lwes_emitter_emit_batch when batching
+ *  has not been configured with lwes_emitter_set_batch_size
+ */
+#define LWES_EMITTER_DEFAULT_BATCH_SIZE 32
+
 /*! \brief Create an Emitter
  *
  *  \param[in] address        The multicast ip address as a dotted quad string
@@ -131,16 +195,63 @@ lwes_emitter_emitto
    struct lwes_emitter *emitter,
    struct lwes_event *event);
 
+/*! \brief Emit already serialized events, counting them as emitted events
+ *
+ * Unlike lwes_emitter_emit_bytes each datagram sent is counted in the
+ * heartbeat statistics, and the datagrams are sent with as few system calls
+ * as the platform allows.  This is meant for code which serializes events
+ * itself, such as lwes_async_emitter.  Any events pending in the emitter's
+ * batch are sent first.
+ *
+ *  \param[in] emitter The emitter to emit to
+ *  \param[in] bytes   An array of count serialized events
+ *  \param[in] lens    The length of each serialized event
+ *  \param[in] count   The number of serialized events
+ *
+ *  \return the number of events sent on success, a negative number on
+ *  failure
+ */
+int
+lwes_emitter_emit_serialized
+  (struct lwes_emitter *emitter,
+   LWES_BYTE_P *bytes,
+   size_t *lens,
+   unsigned int count);
+
+/*! \brief Keep connections used by lwes_emitter_emitto open for reuse
+ *
+ * Without a cache every lwes_emitter_emitto opens a socket, sends and
+ * closes it again.  With one, up to max_connections channels stay open,
+ * keyed by (address, iface, port), and the least recently used is closed
+ * when another is needed.  Hit, miss and eviction counts are kept in
+ * emitter->emitto_cache.
+ *
+ *  \param[in] emitter         The emitter to configure
+ *  \param[in] max_connections The most connections to hold open, 0 closes
+ *                             them all and turns caching off.
+ *
+ *  \return 0 on success, a negative number on failure
+ */
+int
+lwes_emitter_set_emitto_cache_size
+  (struct lwes_emitter *emitter,
+   unsigned int max_connections);
+
 /*! \brief Emit bytes to a multicast channel
  *
  * Use this in re-emitter's so that you don't have to deserialize and
  * reserialize, NOTE: this will not result in statistics being incremented
  *
+ * When accumulation is turned on with lwes_emitter_set_batch_size the bytes
+ * are added to the pending batch, so they go out in the order they were
+ * emitted relative to events passed to lwes_emitter_emit.
+ *
  *  \param[in] emitter The emitter to emit to
  *  \param[in] bytes   The bytes to emit
  *  \param[in] length  The number of bytes to emit
  *
- *  \return the number of bytes sent on success, a negative number on failure
+ *  \return the number of bytes sent (or added to the batch) on success, a
+ *  negative number on failure
  */
 int
 lwes_emitter_emit_bytes
@@ -148,6 +259,64 @@ lwes_emitter_emit_bytes
    LWES_BYTE_P bytes,
    size_t length);
 
+/*! \brief Turn on accumulation of events into batches
+ *
+ * Once a batch size greater than one is set, lwes_emitter_emit serializes
+ * events into a pending batch instead of sending them right away.  When
+ * batch_size events are pending they are all sent with as few system calls
+ * as the platform allows (a single sendmmsg(2) on linux).  Heartbeat
+ * statistics still count every event.  Any pending events are sent before
+ * the batch size is changed.
+ *
+ *  \param[in] emitter    The emitter to configure
+ *  \param[in] batch_size The number of events to accumulate before sending,
+ *                        0 or 1 turns accumulation off.
+ *
+ *  \see lwes_emitter_flush
+ *
+ *  \return 0 on success, a negative number on failure
+ */
+int
+lwes_emitter_set_batch_size
+  (struct lwes_emitter *emitter,
+   unsigned int batch_size);
+
+/*! \brief Send any events pending in the emitter's batch
+ *
+ * Call this periodically when accumulating so that a partially filled
+ * batch is not held back indefinitely.  Pending events are discarded if the
+ * send fails, as they would be for a failed lwes_emitter_emit.
+ *
+ *  \param[in] emitter The emitter to flush
+ *
+ *  \return the number of events sent on success, a negative number on
+ *  failure
+ */
+int
+lwes_emitter_flush
+  (struct lwes_emitter *emitter);
+
+/*! \brief Emit several events to the multicast channel defined in the
+ *  emitter
+ *
+ * The events are serialized into the emitter's batch and sent with as few
+ * system calls as possible before this returns, whether or not accumulation
+ * has been turned on with lwes_emitter_set_batch_size.  An event which can
+ * not be serialized is skipped and the rest are still emitted.
+ *
+ *  \param[in] emitter The emitter to emit to
+ *  \param[in] events  An array of events to emit
+ *  \param[in] count   The number of events in the array
+ *
+ *  \return the number of events from the array which were sent, less than
+ *  count if some were skipped, or a negative number if sending failed
+ */
+int
+lwes_emitter_emit_batch
+  (struct lwes_emitter *emitter,
+   struct lwes_event **events,
+   unsigned int count);
+
 /*! \brief Destroy an Emitter
  *
  * \param[in] emitter The emitter to destroy by freeing all of it's used
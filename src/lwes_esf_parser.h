@@ -32,6 +32,8 @@ extern "C" {
 struct lwes_parser_state
 {
   struct lwes_event_type_db *db;
+  /* the reentrant flex scanner reading the esf */
+  void *scanner;
   char *lastType;
   char *lastEvent;
   char *lastField;
@@ -50,6 +52,13 @@ lwes_parse_esf
   (struct lwes_event_type_db *database,
    const char *file_name);
 
+extern int
+lwes_parse_esf_buffer
+  (struct lwes_event_type_db *database,
+   const char *buffer,
+   size_t length);
+
+/* does nothing, each parse frees its own scanner */
 extern void
 lwes_parse_esf_destroy
   (void);
@@ -29,8 +29,14 @@
 
 int lwesparse(void *param);
 int lweslex(YYSTYPE *lvalp, void *param);
-void lweslexdestroy (void);
-void lwesrestart(FILE *input_file);
+int lwes_esf_lex_create_from_file
+  (struct lwes_parser_state *state, FILE *file);
+int lwes_esf_lex_create_from_buffer
+  (struct lwes_parser_state *state, const char *buffer, size_t length);
+void lwes_esf_lex_destroy (struct lwes_parser_state *state);
+static int lwes_parse_esf_state (struct lwes_parser_state *state);
+static void lwes_init_parser_state
+  (struct lwes_parser_state *state, struct lwes_event_type_db *database);
 
 void duplicate_lex_string (void* param, char* *dest, const char* str, const char* label);
 void lwes_add_type_to_state(void* param, const char* type);
@@ -197,7 +203,45 @@ modifier:
 
 %%
 
-extern FILE *lwesin;
+static void
+lwes_init_parser_state
+  (struct lwes_parser_state *state,
+   struct lwes_event_type_db *database)
+{
+  state->db = database;
+  state->scanner = NULL;
+  state->lastType = NULL;
+  state->lastEvent = NULL;
+  state->lastField = NULL;
+  state->flags = 0;
+  state->arrayTypeSize = 0;
+  state->strMaxSize = 0;
+  state->lineno = 1;
+  state->in_event = 0;
+  state->in_array = 0;
+  state->in_str_size = 0;
+  state->errors = 0;
+}
+
+/* parses with the scanner of the state, then frees everything but the db */
+static int
+lwes_parse_esf_state
+  (struct lwes_parser_state *state)
+{
+  lwesparse((void *) state);
+  lwes_esf_lex_destroy(state);
+  free(state->lastType);
+  state->lastType = NULL;
+  free(state->lastEvent);
+  state->lastEvent = NULL;
+  free(state->lastField);
+  state->lastField = NULL;
+
+  if (state->errors)
+    return 1;
+
+  return 0;
+}
 
 int
 lwes_parse_esf
@@ -205,55 +249,57 @@ lwes_parse_esf
    const char *filename)
 {
   FILE *fd = NULL;
+  int ret = 0;
   struct lwes_parser_state state;
 
-  state.db = database;
-  state.lastType = NULL;
-  state.lastEvent = NULL;
-  state.lastField = NULL;
-  state.flags = 0;
-  state.arrayTypeSize = 0;
-  state.strMaxSize = 0;
-  state.lineno = 1;
-  state.in_event = 0;
-  state.in_array = 0;
-  state.in_str_size = 0;
-  state.errors = 0;
+  lwes_init_parser_state(&state, database);
 
   /* open the file */
   fd = fopen (filename, "r");
 
-  if ( fd != NULL )
+  if ( fd == NULL )
   {
-    lwesin = fd;
-    lwesrestart(lwesin);
-    lwesparse((void *) &state);
-    lweslexdestroy();
-    free(state.lastType);
-    state.lastType = NULL;
-    free(state.lastEvent);
-    state.lastEvent = NULL;
-    free(state.lastField);
-    state.lastField = NULL;
-    fclose (fd);
+    fprintf (stderr,"ERROR: No such file : \"%s\"\n",filename);
+    return 1;
   }
-  else
+  if (lwes_esf_lex_create_from_file(&state, fd) != 0)
   {
-    fprintf (stderr,"ERROR: No such file : \"%s\"\n",filename);
-    state.errors++;
+    fprintf (stderr,"ERROR: Could not create a scanner for \"%s\"\n",
+             filename);
+    fclose (fd);
+    return 1;
   }
 
-  if (state.errors)
+  ret = lwes_parse_esf_state(&state);
+  fclose (fd);
+
+  return ret;
+}
+
+int
+lwes_parse_esf_buffer
+  (struct lwes_event_type_db *database,
+   const char *buffer,
+   size_t length)
+{
+  struct lwes_parser_state state;
+
+  lwes_init_parser_state(&state, database);
+
+  if (lwes_esf_lex_create_from_buffer(&state, buffer, length) != 0)
+  {
+    fprintf (stderr,"ERROR: Could not create a scanner for a buffer\n");
     return 1;
+  }
 
-  return 0;
+  return lwes_parse_esf_state(&state);
 }
 
 void
 lwes_parse_esf_destroy
   (void)
 {
-  lweslexdestroy ();
+  /* each parse frees its own scanner, there is nothing global left */
 }
 
 void
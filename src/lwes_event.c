@@ -21,19 +21,61 @@
 #include "lwes_hash.h"
 #include "lwes_marshall_functions.h"
 
+/* an event without a name or attributes serializes to an empty name and
+ * an attribute count */
+#define LWES_EVENT_EMPTY_SERIALIZED_SIZE 3
+
 /*************************************************************************
   PRIVATE API prototypes, shouldn't be called by a user of the library.
  *************************************************************************/
 
+/* Fill in a newly allocated event, creating its attribute hash */
+static int
+lwes_event_init
+  (struct lwes_event *event,
+   struct lwes_event_type_db *db,
+   struct lwes_arena *arena);
+
+/* Whether a name or a string value can be marshalled at all */
+static LWES_BOOLEAN
+lwes_event_name_is_valid
+  (LWES_CONST_SHORT_STRING name);
+
+static LWES_BOOLEAN
+lwes_event_string_is_valid
+  (LWES_CONST_LONG_STRING value);
+
+/* Allocate and free storage for an event */
+static void *
+lwes_event_alloc
+  (struct lwes_event *event,
+   size_t size);
+
+static void
+lwes_event_free
+  (struct lwes_event *event,
+   void *ptr);
+
 /* Create the memory for an event attribute */
 static struct lwes_event_attribute *
-lwes_event_attribute_create (LWES_BYTE       attrType,
+lwes_event_attribute_create (struct lwes_event* event,
+                             LWES_BYTE       attrType,
                              void*           attrValue,
                              LWES_U_INT_16   arrayLen);
 
 static void
 lwes_event_attribute_destroy 
-  (struct lwes_event_attribute* attr);
+  (struct lwes_event* event,
+   struct lwes_event_attribute* attr);
+
+static int
+lwes_event_check_attr
+  (struct lwes_event*           event,
+   LWES_CONST_SHORT_STRING      attrNameIn,
+   LWES_BYTE                    attrType,
+   LWES_CONST_SHORT_STRING*     internedName,
+   unsigned int*                nameHash,
+   int*                         position);
 
 static int
 lwes_event_add_attr
@@ -41,6 +83,62 @@ lwes_event_add_attr
    LWES_CONST_SHORT_STRING      attrNameIn,
    struct lwes_event_attribute* attribute);
 
+static struct lwes_event_attribute *
+lwes_event_take_spare
+  (struct lwes_event*           event,
+   LWES_CONST_SHORT_STRING      attrName,
+   LWES_SHORT_STRING*           spareName);
+
+static int
+lwes_event_reuse_spare
+  (struct lwes_event*           event,
+   LWES_SHORT_STRING            spareName,
+   struct lwes_event_attribute* attribute,
+   LWES_BYTE                    attrType,
+   int                          attrSize,
+   void*                        attrValue);
+
+static void
+lwes_event_free_attributes
+  (struct lwes_event *event);
+
+/* Keep attributes in the order the event serializes in */
+static int
+lwes_event_reserve_ordered
+  (struct lwes_event *event);
+
+static int
+lwes_event_compare_ordered
+  (int                      position,
+   LWES_CONST_SHORT_STRING  attrName,
+   const struct lwes_event_ordered *entry);
+
+static void
+lwes_event_put_ordered
+  (struct lwes_event*           event,
+   LWES_SHORT_STRING            attrName,
+   int                          position,
+   struct lwes_event_attribute* attribute);
+
+static int
+lwes_event_next_in_order
+  (struct lwes_event*             event,
+   struct lwes_hash_enumeration*  e,
+   int*                           index,
+   LWES_SHORT_STRING*             attrName,
+   struct lwes_event_attribute**  attribute);
+
+/* The number of bytes lwes_event_to_bytes marshals an attribute to */
+static size_t
+lwes_event_attribute_serialized_size
+  (LWES_CONST_SHORT_STRING      attrName,
+   struct lwes_event_attribute* attribute);
+
+static size_t
+lwes_event_value_serialized_size
+  (LWES_BYTE   type,
+   const void* value);
+
 static int
 lwes_event_add
   (struct lwes_event*       event,
@@ -90,11 +188,7 @@ lwes_event_create_no_name
       return NULL;
     }
 
-  event->eventName            = NULL;
-  event->number_of_attributes = 0;
-  event->type_db              = db;
-  event->attributes           = lwes_hash_create ();
-  if (event->attributes == NULL)
+  if (lwes_event_init (event, db, NULL) < 0)
     {
       free(event);
       return NULL;
@@ -123,11 +217,7 @@ lwes_event_create
       return NULL;
     }
 
-  event->eventName            = NULL;
-  event->number_of_attributes = 0;
-  event->type_db              = db;
-  event->attributes           = lwes_hash_create ();
-  if (event->attributes == NULL)
+  if (lwes_event_init (event, db, NULL) < 0)
     {
       free(event);
       return NULL;
@@ -164,12 +254,7 @@ lwes_event_create_with_encoding
       return NULL;
     }
 
-  event->eventName            = NULL;
-  event->number_of_attributes = 0;
-  event->type_db              = db;
-  event->attributes           = lwes_hash_create ();
-
-  if (event->attributes == NULL)
+  if (lwes_event_init (event, db, NULL) < 0)
     {
       free (event);
       return NULL;
@@ -187,7 +272,7 @@ lwes_event_create_with_encoding
     {
       /* problem setting encoding, free up memory and bail */
       lwes_hash_destroy (event->attributes);
-      if (event->eventName != NULL)
+      if (event->eventName != NULL && ! event->name_interned)
         {
           free (event->eventName);
         }
@@ -198,25 +283,101 @@ lwes_event_create_with_encoding
   return event;
 }
 
+/* PUBLIC : Create an event whose storage all comes from one arena */
+struct lwes_event *
+lwes_event_create_in_arena
+  (struct lwes_event_type_db *db,
+   LWES_CONST_SHORT_STRING name,
+   size_t arena_size)
+{
+  struct lwes_arena *arena;
+  struct lwes_event *event;
+
+  arena = lwes_arena_create (arena_size);
+  if (arena == NULL)
+    {
+      return NULL;
+    }
+
+  event =
+    (struct lwes_event *)lwes_arena_alloc (arena, sizeof (struct lwes_event));
+  if (event == NULL)
+    {
+      lwes_arena_destroy (arena);
+      return NULL;
+    }
+
+  if (lwes_event_init (event, db, arena) < 0)
+    {
+      lwes_arena_destroy (arena);
+      return NULL;
+    }
+
+  if (name != NULL && lwes_event_set_name (event, name) < 0)
+    {
+      lwes_arena_destroy (arena);
+      return NULL;
+    }
+
+  return event;
+}
+
 int
 lwes_event_set_name
   (struct lwes_event *event,
    LWES_CONST_SHORT_STRING name)
 {
-  if (event == NULL || name == NULL || event->eventName != NULL)
+  LWES_CONST_SHORT_STRING interned = NULL;
+  size_t size;
+
+  if (event == NULL || name == NULL || event->eventName != NULL
+      || ! lwes_event_name_is_valid (name))
     {
       return -1;
     }
 
-  event->eventName =
-    (LWES_SHORT_STRING) malloc (sizeof (LWES_CHAR)*(strlen (name)+1));
+  /* share the db's copy of a name it knows, leaving any spare buffer for
+   * a name it does not */
+  if (event->type_db != NULL)
+    {
+      interned = lwes_event_type_db_intern (event->type_db, name);
+    }
+  if (interned != NULL)
+    {
+      event->eventName        = (LWES_SHORT_STRING) interned;
+      event->name_interned    = TRUE;
+      event->serialized_size += strlen (name);
+      return 0;
+    }
+  event->name_interned = FALSE;
 
-  if (event->eventName == NULL)
+  size = sizeof (LWES_CHAR)*(strlen (name)+1);
+
+  /* reuse the buffer kept by lwes_event_clear if the name fits */
+  if (event->spare_name != NULL && event->name_size >= size)
     {
-      return -3;
+      event->eventName  = event->spare_name;
+      event->spare_name = NULL;
+    }
+  else
+    {
+      if (event->spare_name != NULL)
+        {
+          lwes_event_free (event, event->spare_name);
+          event->spare_name = NULL;
+        }
+
+      event->eventName = (LWES_SHORT_STRING) lwes_event_alloc (event, size);
+
+      if (event->eventName == NULL)
+        {
+          return -3;
+        }
+      event->name_size = size;
     }
 
   strcpy (event->eventName,name);
+  event->serialized_size += strlen (name);
 
   return 0;
 }
@@ -240,6 +401,57 @@ lwes_event_set_encoding
   return -1;
 }
 
+/* PUBLIC : Set the order attributes are serialized in */
+int
+lwes_event_set_order
+  (struct lwes_event *event,
+   LWES_EVENT_ORDER order)
+{
+  struct lwes_hash_enumeration e;
+  LWES_SHORT_STRING attrName;
+  int position;
+
+  if (event == NULL
+      || (order != LWES_EVENT_ORDER_INSERTION
+          && order != LWES_EVENT_ORDER_NAME
+          && order != LWES_EVENT_ORDER_SCHEMA))
+    {
+      return -1;
+    }
+
+  /* sort what is already set once, from then on it stays sorted */
+  event->order             = order;
+  event->number_of_ordered = 0;
+  if (order != LWES_EVENT_ORDER_INSERTION
+      && lwes_hash_keys (event->attributes, &e))
+    {
+      while (lwes_hash_enumeration_has_more_elements (&e))
+        {
+          attrName = lwes_hash_enumeration_next_element (&e);
+          if (lwes_event_reserve_ordered (event) < 0)
+            {
+              event->order             = LWES_EVENT_ORDER_INSERTION;
+              event->number_of_ordered = 0;
+              return -3;
+            }
+          position = -1;
+          if (order == LWES_EVENT_ORDER_SCHEMA && event->type_db != NULL)
+            {
+              lwes_event_type_db_lookup_interned_attr (event->type_db,
+                                                       attrName,
+                                                       event->eventName,
+                                                       NULL, NULL,
+                                                       &position);
+            }
+          lwes_event_put_ordered (event, attrName, position,
+                                  (struct lwes_event_attribute *)
+                                    lwes_hash_get (event->attributes,
+                                                   attrName));
+        }
+    }
+  return 0;
+}
+
 
 int
 lwes_event_get_name
@@ -286,72 +498,187 @@ int
 lwes_event_destroy
   (struct lwes_event *event)
 {
-  struct lwes_event_attribute *tmp = NULL;
-  struct lwes_hash_enumeration e;
-
   if (event == NULL)
     {
       return 0;
     }
 
+  /* the event itself is in the arena, so this frees everything */
+  if (event->arena != NULL)
+    {
+      lwes_arena_destroy (event->arena);
+      return 0;
+    }
+
   /* free the parts of the event */
-  if (event->eventName != NULL)
+  lwes_event_reset (event);
+
+  /* free the now empty hash */
+  lwes_hash_destroy (event->attributes);
+
+  /* finally free the event structure */
+  free (event);
+
+  return 0;
+}
+
+/* PUBLIC : Empty an event but keep its storage for reuse */
+int
+lwes_event_clear
+  (struct lwes_event *event)
+{
+  struct lwes_event_spare *spares;
+  struct lwes_hash_enumeration e;
+  int count;
+  int index;
+
+  if (event == NULL)
     {
-      free(event->eventName);
+      return -1;
     }
 
-  /* clear out the hash */
-  if (lwes_hash_keys (event->attributes, &e))
+  /* everything after the event itself is released at once */
+  if (event->arena != NULL)
+    {
+      lwes_arena_rewind (event->arena, &event->arena_mark);
+      event->eventName            = NULL;
+      event->name_size            = 0;
+      event->number_of_attributes = 0;
+      event->serialized_size      = LWES_EVENT_EMPTY_SERIALIZED_SIZE;
+      event->ordered              = NULL;
+      event->number_of_ordered    = 0;
+      event->ordered_size         = 0;
+      event->attributes = lwes_hash_create_in_arena (event->arena,
+                                                     LWES_HASH_DEFAULT_SIZE);
+      return (event->attributes == NULL) ? -3 : 0;
+    }
+
+  if (event->eventName != NULL && ! event->name_interned)
+    {
+      if (event->spare_name != NULL)
+        {
+          free (event->spare_name);
+        }
+      event->spare_name = event->eventName;
+    }
+  event->eventName = NULL;
+
+  count = lwes_hash_size (event->attributes);
+  if (count > 0 && event->number_of_spares + count > event->spares_size)
+    {
+      spares = (struct lwes_event_spare *)
+        realloc (event->spares, sizeof (struct lwes_event_spare)
+                                  * (event->number_of_spares + count));
+      if (spares == NULL)
+        {
+          /* can't keep them, so just let them go */
+          lwes_event_free_attributes (event);
+          return 0;
+        }
+      event->spares      = spares;
+      event->spares_size = event->number_of_spares + count;
+    }
+
+  /* move the attributes out of the hash, so enumeration of the refilled
+   * event behaves exactly as for a new one.  They are stacked in reverse,
+   * as the next event is most likely to set them in hash order and
+   * lwes_event_take_spare looks from the top of the stack. */
+  index = event->number_of_spares + count;
+  if (count > 0 && lwes_hash_keys (event->attributes, &e))
     {
       while (lwes_hash_enumeration_has_more_elements (&e))
         {
           LWES_SHORT_STRING tmpAttrName =
             lwes_hash_enumeration_next_element (&e);
-          tmp =
+          --index;
+          event->spares[index].name = tmpAttrName;
+          event->spares[index].attribute =
             (struct lwes_event_attribute *)lwes_hash_remove (event->attributes,
                                                              tmpAttrName);
-          /* free the attribute name and value*/
-          if (tmpAttrName != NULL)
-            {
-              free(tmpAttrName);
-            }
-          /* free the attribute itself*/
-          lwes_event_attribute_destroy(tmp);
         }
+      event->number_of_spares += count;
     }
 
-  /* free the now empty hash */
-  lwes_hash_destroy (event->attributes);
-
-  /* finally free the event structure */
-  free (event);
+  event->number_of_attributes = 0;
+  event->number_of_ordered    = 0;
+  event->serialized_size      = LWES_EVENT_EMPTY_SERIALIZED_SIZE;
 
   return 0;
 }
 
+/* PUBLIC : Empty an event and release its storage */
+int
+lwes_event_reset
+  (struct lwes_event *event)
+{
+  int i;
+
+  if (event == NULL)
+    {
+      return -1;
+    }
+
+  if (event->arena != NULL)
+    {
+      if (lwes_event_clear (event) < 0)
+        {
+          return -3;
+        }
+      lwes_arena_trim (event->arena);
+      return 0;
+    }
+
+  if (event->eventName != NULL && ! event->name_interned)
+    {
+      free (event->eventName);
+    }
+  event->eventName = NULL;
+  if (event->spare_name != NULL)
+    {
+      free (event->spare_name);
+      event->spare_name = NULL;
+    }
+  event->name_size = 0;
+
+  lwes_event_free_attributes (event);
 
+  for (i = 0; i < event->number_of_spares; ++i)
+    {
+      if (! event->spares[i].attribute->name_interned)
+        {
+          free (event->spares[i].name);
+        }
+      lwes_event_attribute_destroy (event, event->spares[i].attribute);
+    }
+  if (event->spares != NULL)
+    {
+      free (event->spares);
+      event->spares = NULL;
+    }
+  event->number_of_spares = 0;
+  event->spares_size      = 0;
 
-#define TYPED_EVENT_FIELD_TO_BYTES(typ, fail_ret) \
-  else if (tmp->type == LWES_TYPE_##typ)          \
-  {                                               \
-    if (!marshall_##typ                           \
-                (*((LWES_##typ *)tmp->value),     \
-                bytes, num_bytes, &tmpOffset))    \
-      { ret = fail_ret; }                         \
-  }                                               \
-  else if (tmp->type == LWES_TYPE_##typ##_ARRAY)  \
-  {                                               \
-    if (!marshall_array_attribute                 \
-          (tmp, bytes, num_bytes, &tmpOffset))    \
-      { ret = fail_ret-100; }                     \
-  }                                               \
-  else if (tmp->type == LWES_TYPE_N_##typ##_ARRAY)\
-  {                                               \
-    if (!marshall_array_attribute                 \
-          (tmp, bytes, num_bytes, &tmpOffset))    \
-      { ret = fail_ret-150; }                     \
-  }
+  if (event->ordered != NULL)
+    {
+      free (event->ordered);
+      event->ordered = NULL;
+    }
+  event->ordered_size = 0;
 
+  return 0;
+}
+
+/* PUBLIC : the number of bytes lwes_event_to_bytes writes for the event */
+size_t
+lwes_event_serialized_size
+  (struct lwes_event *event)
+{
+  if (event == NULL)
+    {
+      return 0;
+    }
+  return event->serialized_size;
+}
 
 /* PUBLIC : serialize the event and put it into a byte array */
 int
@@ -365,7 +692,8 @@ lwes_event_to_bytes
   struct lwes_event_attribute *encodingAttr;
   size_t tmpOffset = offset;
   struct lwes_hash_enumeration e;
-  int ret = 0;
+  LWES_SHORT_STRING tmpAttrName;
+  int index = 0;
 
   if (   event == NULL
       || bytes == NULL
@@ -375,137 +703,75 @@ lwes_event_to_bytes
       return -1;
     }
 
-  /* start with the event name */
-  if (marshall_SHORT_STRING (event->eventName,
-                              bytes,
-                              num_bytes,
-                              &tmpOffset))
+  /* the whole event fits or nothing is written.  The setters only accept
+   * names and values which can be marshalled, and serialized_size is the
+   * exact size of all of them, so once it fits nothing below needs to be
+   * checked again */
+  if (num_bytes - offset < event->serialized_size)
     {
-      /* then the number of attributes */
-      if (marshall_U_INT_16     (event->number_of_attributes,
-                                  bytes,
-                                  num_bytes,
-                                  &tmpOffset))
+      return -21;
+    }
+  if (event->eventName == NULL)
+    {
+      return -17;
+    }
+
+  /* handle encoding first if it is set */
+  encodingAttr =
+    (struct lwes_event_attribute *)
+      lwes_hash_get (event->attributes, (LWES_SHORT_STRING)LWES_ENCODING);
+  if (encodingAttr)
+    {
+      if (encodingAttr->value == NULL)
         {
-          /* handle encoding first if it is set */
-          encodingAttr =
-            (struct lwes_event_attribute *)
-              lwes_hash_get (event->attributes,
-                             (LWES_SHORT_STRING)LWES_ENCODING);
+          return -4;
+        }
+      if (encodingAttr->type != LWES_TYPE_INT_16)
+        {
+          return -3;
+        }
+    }
+
+  /* start with the event name, then the number of attributes */
+  marshall_SHORT_STRING_unchecked (event->eventName, bytes, &tmpOffset);
+  marshall_value_unchecked (LWES_TYPE_U_INT_16, &(event->number_of_attributes),
+                            bytes, &tmpOffset);
+
+  if (encodingAttr)
+    {
+      marshall_SHORT_STRING_unchecked (LWES_ENCODING, bytes, &tmpOffset);
+      bytes[tmpOffset++] = encodingAttr->type;
+      marshall_value_unchecked (encodingAttr->type, encodingAttr->value,
+                                bytes, &tmpOffset);
+    }
 
-          if (encodingAttr)
+  /* now iterate over all the other values, in the event's order */
+  if (lwes_hash_keys (event->attributes, &e))
+    {
+      while (lwes_event_next_in_order (event, &e, &index, &tmpAttrName, &tmp))
+        {
+          /* skip encoding as we've dealt with it above */
+          if (tmp == encodingAttr)
             {
-              void* encodingValue = encodingAttr->value;
-              LWES_BYTE encodingType = encodingAttr->type;
-              if (encodingValue)
-                {
-                  if (encodingType == LWES_TYPE_INT_16)
-                    {
-                      if (   0 == marshall_SHORT_STRING
-                                    ((LWES_SHORT_STRING)LWES_ENCODING,
-                                     bytes, num_bytes, &tmpOffset)
-                          || 0 == marshall_BYTE
-                                    (encodingType,
-                                     bytes, num_bytes, &tmpOffset)
-                          || 0 == marshall_INT_16
-                                    (*((LWES_INT_16 *)encodingValue),
-                                     bytes, num_bytes, &tmpOffset) ) {
-                          return -2;
-                        }
-                    }
-                  else
-                    {
-                      return -3;
-                    }
-                }
-              else
-                {
-                  return -4;
-                }
+              continue;
             }
 
-          /* now iterate over all the other values in the hash */
-          if (lwes_hash_keys (event->attributes, &e))
+          marshall_SHORT_STRING_unchecked (tmpAttrName, bytes, &tmpOffset);
+          bytes[tmpOffset++] = tmp->type;
+          if (lwes_type_is_array (tmp->type))
             {
-              while (lwes_hash_enumeration_has_more_elements (&e) && ret == 0)
-                {
-                  LWES_SHORT_STRING tmpAttrName =
-                    lwes_hash_enumeration_next_element (&e);
-
-                  /* skip encoding as we've dealt with it above */
-                  if (! strcmp(tmpAttrName, LWES_ENCODING))
-                    {
-                      continue;
-                    }
-
-                  tmp =
-                    (struct lwes_event_attribute *)
-                      lwes_hash_get (event->attributes, tmpAttrName);
-
-                  if (!marshall_SHORT_STRING (tmpAttrName,
-                                             bytes, num_bytes, &tmpOffset))
-                    {
-                      ret = -5;
-                    }
-                  else
-                    {
-                      if (!marshall_BYTE (tmp->type,
-                                         bytes, num_bytes, &tmpOffset))
-                        {
-                          ret = -6;
-                        }
-                      else
-                        {
-                          if (tmp->type == LWES_TYPE_UNDEFINED)
-                            {
-                            }
-                          TYPED_EVENT_FIELD_TO_BYTES(U_INT_16, -7)
-                          TYPED_EVENT_FIELD_TO_BYTES(INT_16,   -8)
-                          TYPED_EVENT_FIELD_TO_BYTES(U_INT_32, -9)
-                          TYPED_EVENT_FIELD_TO_BYTES(INT_32,   -10)
-                          TYPED_EVENT_FIELD_TO_BYTES(U_INT_64, -11)
-                          TYPED_EVENT_FIELD_TO_BYTES(INT_64,   -12)
-                          TYPED_EVENT_FIELD_TO_BYTES(BOOLEAN,  -13)
-                          TYPED_EVENT_FIELD_TO_BYTES(IP_ADDR,  -14)
-                          TYPED_EVENT_FIELD_TO_BYTES(BYTE,     -18)
-                          TYPED_EVENT_FIELD_TO_BYTES(FLOAT,    -19)
-                          TYPED_EVENT_FIELD_TO_BYTES(DOUBLE,   -20)
-                          else if (tmp->type == LWES_TYPE_STRING)
-                            {
-                              if (!marshall_LONG_STRING ((LWES_LONG_STRING)tmp->value,
-                                                        bytes, num_bytes, &tmpOffset)) {
-                                  ret = -15;
-                                }
-                            }
-                          else if ((tmp->type == LWES_TYPE_STRING_ARRAY) ||
-                                   (tmp->type == LWES_TYPE_N_STRING_ARRAY))
-                            {
-                              if (!marshall_array_attribute
-                                    (tmp, bytes, num_bytes, &tmpOffset))
-                                { ret = -115; }
-                            }
-                          else
-                            {
-                              /* should never be reached, but if it does,
-                               * there's some sort of  corruption with this
-                               * attribute of the event, so skip it */
-                            }
-                        }
-                    }
-                }
+              marshall_array_attribute_unchecked (tmp, bytes, &tmpOffset);
+            }
+          else
+            {
+              /* an unknown type has no value, as in its serialized size */
+              marshall_value_unchecked (tmp->type, tmp->value,
+                                        bytes, &tmpOffset);
             }
         }
-      else
-        {
-          ret = -16;
-        }
-    }
-  else
-    {
-      ret = -17;
     }
 
-  return ((ret < 0) ? ret : (int)(tmpOffset-offset));
+  return (int)(tmpOffset-offset);
 }
 
 /* PUBLIC : add common headers to a serialized event */
@@ -667,6 +933,81 @@ lwes_event_add_headers
   return 0;
 }
 
+/* PUBLIC : add common headers, including ReceiptTimeNanos, to a serialized
+ * event */
+int
+lwes_event_add_headers_nanos
+  (LWES_BYTE_P bytes,
+   size_t max,
+   size_t *len,
+   LWES_INT_64 receipt_time_nanos,
+   LWES_IP_ADDR sender_ip,
+   LWES_U_INT_16 sender_port)
+{
+  size_t n = *len;
+  size_t nanos_offset = *len;
+  size_t offset_to_num_attrs = 0;
+  size_t tmp_offset;
+  LWES_U_INT_16 num_attrs;
+  LWES_SHORT_STRING receipt_time_nanos_str =
+    (LWES_SHORT_STRING)"ReceiptTimeNanos";
+  /*   int64   ReceiptTimeNanos = 1 + 16 + 1 + 8 = 26 */
+  size_t nanos_len =
+    sizeof(LWES_BYTE) + strlen (receipt_time_nanos_str)
+    + sizeof(LWES_BYTE) + sizeof(LWES_INT_64);
+  int ret;
+
+  /* the usual headers, which are left alone if already there */
+  ret = lwes_event_add_headers (bytes, max, &n,
+                                receipt_time_nanos / 1000000,
+                                sender_ip, sender_port);
+  if (ret < 0 || n == *len)
+    {
+      return ret;
+    }
+
+  /* ReceiptTimeNanos goes in front of them, so they stay at the end where
+   * lwes_event_add_headers looks for them */
+  if (n + nanos_len > max)
+    {
+      return -3;
+    }
+  memmove (&bytes[nanos_offset + nanos_len], &bytes[nanos_offset],
+           n - nanos_offset);
+  if (   marshall_SHORT_STRING   (receipt_time_nanos_str,
+                                  bytes,
+                                  max,
+                                  &nanos_offset) == 0
+      || marshall_BYTE           (LWES_TYPE_INT_64,
+                                  bytes,
+                                  max,
+                                  &nanos_offset) == 0
+      || marshall_INT_64         (receipt_time_nanos,
+                                  bytes,
+                                  max,
+                                  &nanos_offset) == 0)
+    {
+      return -3;
+    }
+
+  /* and one more attribute */
+  if (unmarshall_SHORT_STRING (NULL, 0, bytes, max,
+                               &offset_to_num_attrs) == 0)
+    {
+      return -1;
+    }
+  tmp_offset = offset_to_num_attrs;
+  if (unmarshall_U_INT_16 (&num_attrs, bytes, max, &tmp_offset) == 0
+      || marshall_U_INT_16 (num_attrs + 1, bytes, max,
+                            &offset_to_num_attrs) == 0)
+    {
+      return -2;
+    }
+
+  *len = n + nanos_len;
+  return 0;
+}
+
 #define TYPED_BYTES_TO_EVENT_FIELD(typ,set_fail_ret,mar_fail_ret)    \
   else if (tmp_byte == LWES_TYPE_##typ)                              \
     {                                                                \
@@ -681,36 +1022,34 @@ lwes_event_add_headers
   else if (tmp_byte == LWES_TYPE_##typ##_ARRAY)                      \
     {                                                                \
       struct lwes_event_attribute* attr;                             \
-      attr = lwes_event_attribute_create(tmp_byte, NULL, 0);         \
-      if (!unmarshall_array_attribute                                \
-            (attr, bytes, num_bytes, &tmpOffset))                    \
+      attr = lwes_event_attribute_create(event, tmp_byte, NULL, 0);  \
+      if (!unmarshall_array_attribute_in_arena                       \
+            (attr, bytes, num_bytes, &tmpOffset, event->arena))      \
         {                                                            \
-          lwes_event_attribute_destroy(attr);                        \
+          lwes_event_attribute_destroy(event, attr);                 \
           return mar_fail_ret-100;                                   \
         }                                                            \
       if (0 > lwes_event_add_attr                                    \
             (event, tmp_short_str, attr))                            \
         {                                                            \
-          free(attr->value);                                         \
-          free(attr);                                                \
+          lwes_event_attribute_destroy(event, attr);                 \
           return set_fail_ret;                                       \
         }                                                            \
     }                                                                \
   else if (tmp_byte == LWES_TYPE_N_##typ##_ARRAY)                    \
     {                                                                \
       struct lwes_event_attribute* attr;                             \
-      attr = lwes_event_attribute_create(tmp_byte, NULL, 0);         \
-      if (!unmarshall_array_attribute                                \
-            (attr, bytes, num_bytes, &tmpOffset))                    \
+      attr = lwes_event_attribute_create(event, tmp_byte, NULL, 0);  \
+      if (!unmarshall_array_attribute_in_arena                       \
+            (attr, bytes, num_bytes, &tmpOffset, event->arena))      \
         {                                                            \
-          lwes_event_attribute_destroy(attr);                        \
+          lwes_event_attribute_destroy(event, attr);                 \
           return mar_fail_ret-150;                                   \
         }                                                            \
       if (0 > lwes_event_add_attr                                    \
             (event, tmp_short_str, attr))                            \
         {                                                            \
-          free(attr->value);                                         \
-          free(attr);                                                \
+          lwes_event_attribute_destroy(event, attr);                 \
           return set_fail_ret;                                       \
         }                                                            \
     }
@@ -817,17 +1156,17 @@ lwes_event_from_bytes_lax
                        (tmp_byte == LWES_TYPE_N_STRING_ARRAY))
                 {
                   struct lwes_event_attribute* attr;
-                  attr = lwes_event_attribute_create(tmp_byte, NULL, 0);
-                  if (!unmarshall_array_attribute
-                        (attr, bytes, num_bytes, &tmpOffset))
+                  attr = lwes_event_attribute_create(event, tmp_byte, NULL, 0);
+                  if (!unmarshall_array_attribute_in_arena
+                        (attr, bytes, num_bytes, &tmpOffset, event->arena))
                     {
-                      lwes_event_attribute_destroy(attr);
+                      lwes_event_attribute_destroy(event, attr);
                       return -119;
                     }
                   if (0 > lwes_event_add_attr
                         (event, tmp_short_str, attr))
                     {
-                      lwes_event_attribute_destroy(attr);
+                      lwes_event_attribute_destroy(event, attr);
                       return -118;
                     }
                 }
@@ -886,26 +1225,74 @@ lwes_event_set_generic
 {
   int ret = 0;
   char *attrCopy;
+  struct lwes_event_attribute *attribute;
+  LWES_SHORT_STRING spareName;
 
-  if (event == NULL || attrName == NULL || attrValue == NULL)
+  if (event == NULL || attrName == NULL || attrValue == NULL
+      || ! lwes_event_name_is_valid (attrName))
     {
       return -1;
     }
 
-  attrCopy = (char *)malloc (attrSize);
+  attribute =
+    (struct lwes_event_attribute *)lwes_hash_get (event->attributes, attrName);
+
+  /* overwrite a value which is already set in place, if it fits */
+  if (attribute != NULL
+      && attribute->value != NULL
+      && attribute->value_size >= (size_t)attrSize)
+    {
+      ret = lwes_event_check_attr (event, attrName, attrType,
+                                   NULL, NULL, NULL);
+      if (ret < 0)
+        {
+          return ret;
+        }
+      event->serialized_size -=
+        lwes_event_attribute_serialized_size (attrName, attribute);
+      memcpy (attribute->value, attrValue, attrSize);
+      attribute->type      = attrType;
+      attribute->array_len = 0;
+      event->serialized_size +=
+        lwes_event_attribute_serialized_size (attrName, attribute);
+      return event->number_of_attributes;
+    }
+
+  /* otherwise use the storage kept by lwes_event_clear, if any */
+  if (attribute == NULL && event->number_of_spares > 0)
+    {
+      attribute = lwes_event_take_spare (event, attrName, &spareName);
+      if (attribute != NULL)
+        {
+          return lwes_event_reuse_spare (event, spareName, attribute,
+                                         attrType, attrSize, attrValue);
+        }
+    }
+
+  attrCopy = (char *)lwes_event_alloc (event, attrSize);
+
+  if (attrCopy == NULL)
+    {
+      return -3;
+    }
+  memcpy(attrCopy, attrValue, attrSize);
 
-  if (attrCopy == NULL)
+  attribute = lwes_event_attribute_create (event, attrType, attrCopy, 0);
+  if (attribute == NULL)
     {
+      lwes_event_free (event, attrCopy);
       return -3;
     }
-  memcpy(attrCopy, attrValue, attrSize);
+  attribute->value_size = attrSize;
 
-  ret = lwes_event_add (event, attrName, attrType, attrCopy, 0);
-  if (ret < 0)
+  ret = lwes_event_add_attr (event, attrName, attribute);
+  if (ret)
     {
-      free (attrCopy);
+      lwes_event_attribute_destroy (event, attribute);
+      return ret;
     }
-  return ret;
+
+  return event->number_of_attributes;
 }
 
 static int
@@ -941,7 +1328,8 @@ lwes_event_set_array
   int i, ret = 0;
   char *attrCopy;
 
-  if (event == NULL || attrName == NULL || arr == NULL)
+  if (event == NULL || attrName == NULL || arr == NULL
+      || ! lwes_event_name_is_valid (attrName))
     {
       return -1;
     }
@@ -955,15 +1343,20 @@ lwes_event_set_array
   int attrSize = baseSize;
   if (LWES_TYPE_STRING == baseType)
     {
-      /* Sum up the size of all the strings, to allocate in one block */
+      /* Sum up the size of all the strings, to allocate in one block,
+       * only a nullable array may leave one out */
       LWES_CONST_SHORT_STRING *str = (LWES_CONST_SHORT_STRING*)arr;
       for (i=0; i< arr_length; ++i)
         {
-          attrSize += 1 + (str[i] ? strlen(str[i]) : 0);
+          if (! lwes_event_string_is_valid (str[i]))
+            {
+              return -1;
+            }
+          attrSize += 1 + strlen(str[i]);
         }
     }
 
-  attrCopy = (char *)malloc (attrSize);
+  attrCopy = (char *)lwes_event_alloc (event, attrSize);
   if (attrCopy == NULL)
     {
       return -3;
@@ -993,7 +1386,7 @@ lwes_event_set_array
   ret = lwes_event_add (event, attrName, type, attrCopy, arr_length);
   if (ret < 0)
     {
-      free (attrCopy);
+      lwes_event_free (event, attrCopy);
     }
   return ret;
 }
@@ -1048,7 +1441,8 @@ lwes_event_set_nullable_array
   int baseSize = arr_length * sizeof(char*);
   int attrSize = baseSize;
 
-  if (event == NULL || name == NULL || arr == NULL)
+  if (event == NULL || name == NULL || arr == NULL
+      || ! lwes_event_name_is_valid (name))
     {
       return -1;
     }
@@ -1062,6 +1456,11 @@ lwes_event_set_nullable_array
     {
       for (i=0; i< arr_length; ++i)
         {
+          if (pointersIn[i] != NULL
+              && ! lwes_event_string_is_valid ((char*)pointersIn[i]))
+            {
+              return -1;
+            }
           attrSize += (pointersIn[i] ? strlen((char*)pointersIn[i])+1 : 0);
         }
     }
@@ -1073,7 +1472,7 @@ lwes_event_set_nullable_array
         }
     }
 
-  tmp = (LWES_BYTE*)malloc (attrSize);
+  tmp = (LWES_BYTE*)lwes_event_alloc (event, attrSize);
   if (tmp == NULL)
     {
       return -3;
@@ -1104,7 +1503,7 @@ lwes_event_set_nullable_array
   ret = lwes_event_add (event, name, type, tmp, arr_length);
   if (ret < 0)
     {
-      free (tmp);
+      lwes_event_free (event, tmp);
     }
   return ret;
 }
@@ -1297,7 +1696,13 @@ int lwes_event_set_STRING (struct lwes_event *       event,
                            LWES_CONST_SHORT_STRING   attrName,
                            LWES_CONST_LONG_STRING    value)
 {
-  int size = (NULL == value) ? 0 : sizeof (LWES_CHAR)*(strlen (value)+1);
+  int size;
+
+  if (! lwes_event_string_is_valid (value))
+    {
+      return -1;
+    }
+  size = sizeof (LWES_CHAR)*(strlen (value)+1);
   return lwes_event_set_generic(event, attrName, LWES_TYPE_STRING, size, (char*)value);
 }
 
@@ -1327,42 +1732,114 @@ int lwes_event_set_IP_ADDR_w_string (struct lwes_event *       event,
                                      LWES_CONST_SHORT_STRING   attrName,
                                      LWES_CONST_SHORT_STRING  value)
 {
-  int ret = 0;
-  struct in_addr *attrValue;
+  LWES_IP_ADDR attrValue;
 
   if (event == NULL || attrName == NULL || value == NULL)
     {
       return -1;
     }
 
-  attrValue = (LWES_IP_ADDR *)malloc (sizeof (LWES_IP_ADDR));
-  if (attrValue == NULL)
+  attrValue.s_addr = inet_addr (value);
+
+  return lwes_event_set_generic (event, attrName, LWES_TYPE_IP_ADDR,
+                                 sizeof (LWES_IP_ADDR), &attrValue);
+}
+
+
+/*************************************************************************
+  PRIVATE API
+ *************************************************************************/
+/* Fill in a newly allocated event, the attribute hash of an event in an
+ * arena comes from the arena too */
+static int
+lwes_event_init
+  (struct lwes_event *event,
+   struct lwes_event_type_db *db,
+   struct lwes_arena *arena)
+{
+  event->eventName            = NULL;
+  event->number_of_attributes = 0;
+  event->type_db              = db;
+  event->spare_name           = NULL;
+  event->name_size            = 0;
+  event->spares               = NULL;
+  event->number_of_spares     = 0;
+  event->spares_size          = 0;
+  event->arena                = arena;
+  event->serialized_size      = LWES_EVENT_EMPTY_SERIALIZED_SIZE;
+  event->name_interned        = FALSE;
+  event->order                = LWES_EVENT_ORDER_INSERTION;
+  event->ordered              = NULL;
+  event->number_of_ordered    = 0;
+  event->ordered_size         = 0;
+
+  if (arena != NULL)
+    {
+      /* lwes_event_clear rewinds to here, and recreates the hash */
+      lwes_arena_mark (arena, &event->arena_mark);
+      event->attributes =
+        lwes_hash_create_in_arena (arena, LWES_HASH_DEFAULT_SIZE);
+    }
+  else
     {
-      return -3;
+      event->attributes = lwes_hash_create ();
     }
-  attrValue->s_addr = inet_addr (value);
 
-  ret = lwes_event_add (event, attrName, LWES_TYPE_IP_ADDR, attrValue, 0);
-  if (ret < 0)
+  return (event->attributes == NULL ? -1 : 0);
+}
+
+/* the setters refuse anything which could not be marshalled, so that
+ * lwes_event_to_bytes only has to check the size of the whole event */
+static LWES_BOOLEAN
+lwes_event_name_is_valid
+  (LWES_CONST_SHORT_STRING name)
+{
+  size_t length = strlen (name);
+  return (length > 0 && length <= SHORT_STRING_MAX);
+}
+
+static LWES_BOOLEAN
+lwes_event_string_is_valid
+  (LWES_CONST_LONG_STRING value)
+{
+  return (value != NULL && strlen (value) <= LONG_STRING_MAX);
+}
+
+/* Allocate storage for an event, from its arena if it has one */
+static void *
+lwes_event_alloc
+  (struct lwes_event *event,
+   size_t size)
+{
+  if (event->arena != NULL)
     {
-      free (attrValue);
+      return lwes_arena_alloc (event->arena, size);
     }
-  return ret;
+  return malloc (size);
 }
 
+/* Free storage of an event, which is a no-op for arena storage */
+static void
+lwes_event_free
+  (struct lwes_event *event,
+   void *ptr)
+{
+  if (event->arena == NULL && ptr != NULL)
+    {
+      free (ptr);
+    }
+}
 
-/*************************************************************************
-  PRIVATE API
- *************************************************************************/
 /* Create the memory for an attribute */
 static struct lwes_event_attribute *
-lwes_event_attribute_create (LWES_BYTE       attrType,
+lwes_event_attribute_create (struct lwes_event* event,
+                             LWES_BYTE       attrType,
                              void*           attrValue,
                              LWES_U_INT_16   arrayLen)
 {
   struct lwes_event_attribute *attribute =
     (struct lwes_event_attribute *)
-      malloc (sizeof (struct lwes_event_attribute));
+      lwes_event_alloc (event, sizeof (struct lwes_event_attribute));
 
   if (attribute == NULL)
     {
@@ -1372,23 +1849,66 @@ lwes_event_attribute_create (LWES_BYTE       attrType,
   attribute->type  = attrType;
   attribute->value = attrValue;
   attribute->array_len = arrayLen;
+  attribute->value_size = 0;
+  attribute->name_interned = FALSE;
 
   return attribute;
 }
 
 static void
 lwes_event_attribute_destroy 
-  (struct lwes_event_attribute* attr)
+  (struct lwes_event* event,
+   struct lwes_event_attribute* attr)
 {
   if (attr->value)
     { 
-      free(attr->value);
+      lwes_event_free(event, attr->value);
       attr->value = NULL;
     }
-  free(attr);
+  lwes_event_free(event, attr);
 }
 
 
+/* check an attribute against the event db */
+static int
+lwes_event_check_attr
+  (struct lwes_event*           event,
+   LWES_CONST_SHORT_STRING      attrNameIn,
+   LWES_BYTE                    attrType,
+   LWES_CONST_SHORT_STRING*     internedName,
+   unsigned int*                nameHash,
+   int*                         position)
+{
+  const struct lwes_event_field_db_attribute *attrRec = NULL;
+
+  if (position != NULL)
+    {
+      *position = -1;
+    }
+  if (event->type_db == NULL)
+    {
+      return 0;
+    }
+
+  /* one lookup answers both questions, and finds the db's copy of the
+   * name for the caller to share */
+  attrRec = lwes_event_type_db_lookup_interned_attr (event->type_db,
+                                                     attrNameIn,
+                                                     event->eventName,
+                                                     internedName,
+                                                     nameHash,
+                                                     position);
+  if (attrRec == NULL)
+    {
+      return -1;
+    }
+  if (attrRec->type != attrType)
+    {
+      return -2;
+    }
+  return 0;
+}
+
 static int
 lwes_event_add_attr
   (struct lwes_event*           event,
@@ -1396,45 +1916,92 @@ lwes_event_add_attr
    struct lwes_event_attribute* attribute)
 {
   struct lwes_event_attribute* attribute_out = NULL;
+  struct lwes_event_attribute* spare = NULL;
   LWES_SHORT_STRING attrName  = NULL;
+  LWES_CONST_SHORT_STRING interned = NULL;
+  LWES_BOOLEAN nameInterned = FALSE;
+  unsigned int hashValue = 0;
+  int position = -1;
   void* ret = NULL;
+  int check;
 
   /* check against the event db */
-  if (event->type_db != NULL
-       && lwes_event_type_db_check_for_attribute (event->type_db,
-                                                  attrNameIn,
-                                                  event->eventName) == 0)
+  check = lwes_event_check_attr (event, attrNameIn, attribute->type,
+                                 &interned, &hashValue, &position);
+  if (check < 0)
     {
-      return -1;
+      return check;
     }
-  if (event->type_db != NULL
-       && lwes_event_type_db_check_for_type (event->type_db,
-                                             attribute->type,
-                                             attrNameIn,
-                                             event->eventName) == 0)
+
+  /* make room to order a new attribute first, so it can't fail once the
+   * attribute is in the hash */
+  if (lwes_event_reserve_ordered (event) < 0)
     {
-      return -2;
+      return -3;
+    }
+
+  /* a spare of the same name must not outlive the new attribute, but its
+   * name can be used as the key */
+  if (event->number_of_spares > 0)
+    {
+      spare = lwes_event_take_spare (event,
+                                     interned != NULL ? interned : attrNameIn,
+                                     &attrName);
+      if (spare != NULL)
+        {
+          nameInterned = spare->name_interned;
+          lwes_event_attribute_destroy (event, spare);
+        }
+    }
+
+  /* the db's copy of the name is shared rather than copied */
+  if (interned != NULL)
+    {
+      if (attrName != NULL && ! nameInterned)
+        {
+          lwes_event_free (event, attrName);
+        }
+      attrName     = (LWES_SHORT_STRING) interned;
+      nameInterned = TRUE;
     }
 
   /* copy the attribute name */
-  attrName =
-      (LWES_SHORT_STRING) malloc( sizeof(LWES_CHAR)*(strlen (attrNameIn)+1));
   if (attrName == NULL)
     {
-      return -3;
+      attrName =
+          (LWES_SHORT_STRING) lwes_event_alloc
+            (event, sizeof(LWES_CHAR)*(strlen (attrNameIn)+1));
+      if (attrName == NULL)
+        {
+          return -3;
+        }
+      attrName[0] = '\0';
+      strcat (attrName,attrNameIn);
     }
-  attrName[0] = '\0';
-  strcat (attrName,attrNameIn);
 
-  /* Try and put something into the hash */
-  ret = lwes_hash_put (event->attributes, attrName, attribute);
+  attribute->name_interned = nameInterned;
+
+  /* Try and put something into the hash, an interned name was hashed by
+   * the db already */
+  if (interned != NULL)
+    {
+      ret = lwes_hash_put_with_hash (event->attributes, attrName, hashValue,
+                                     attribute);
+    }
+  else
+    {
+      ret = lwes_hash_put (event->attributes, attrName, attribute);
+    }
 
   /* if put returns the given attribute there was a failure of some sort, so free
    * memory and return -4
    */
   if (ret == attribute)
     {
-      free (attrName);
+      if (! nameInterned)
+        {
+          lwes_event_free (event, attrName);
+        }
       return -4;
     }
   else if (ret != NULL)
@@ -1443,18 +2010,25 @@ lwes_event_add_attr
       /* in this case we replaced the old value and it returned it, so free up the
        * old value and the key (since we reused the old key)
        */
-      if (attribute_out->value != NULL)
+      attribute->name_interned = attribute_out->name_interned;
+      event->serialized_size -=
+        lwes_event_attribute_serialized_size (attrName, attribute_out);
+      lwes_event_attribute_destroy (event, attribute_out);
+      if (! nameInterned)
         {
-          free (attribute_out->value);
+          lwes_event_free (event, attrName);
         }
-      free (attribute_out);
-      free (attrName);
+      lwes_event_put_ordered (event, (LWES_SHORT_STRING) attrNameIn,
+                              position, attribute);
     }
   else
     {
       /* we successfully added a new attribute, so increment the number of attributes */
       event->number_of_attributes++;
+      lwes_event_put_ordered (event, attrName, position, attribute);
     }
+  event->serialized_size +=
+    lwes_event_attribute_serialized_size (attrNameIn, attribute);
 
   return 0;
 }
@@ -1471,7 +2045,7 @@ lwes_event_add (struct lwes_event*       event,
   int ret                                = 0;
 
   /* create the attribute */
-  attribute = lwes_event_attribute_create (attrType, attrValue, arrayLen);
+  attribute = lwes_event_attribute_create (event, attrType, attrValue, arrayLen);
   if (attribute == NULL)
     {
       return -3;
@@ -1481,13 +2055,358 @@ lwes_event_add (struct lwes_event*       event,
 
   if (ret)
     {
-      free (attribute);
+      lwes_event_free (event, attribute);
+      return ret;
+    }
+
+  return event->number_of_attributes;
+}
+
+/* remove the spare attribute with the given name, searching from the
+ * top of the stack where lwes_event_clear left the likeliest one */
+static struct lwes_event_attribute *
+lwes_event_take_spare
+  (struct lwes_event*           event,
+   LWES_CONST_SHORT_STRING      attrName,
+   LWES_SHORT_STRING*           spareName)
+{
+  struct lwes_event_attribute *attribute;
+  int i;
+
+  for (i = event->number_of_spares - 1; i >= 0; --i)
+    {
+      if (event->spares[i].name == attrName
+          || strcmp (event->spares[i].name, attrName) == 0)
+        {
+          *spareName = event->spares[i].name;
+          attribute  = event->spares[i].attribute;
+          event->spares[i] = event->spares[--event->number_of_spares];
+          return attribute;
+        }
+    }
+  return NULL;
+}
+
+/* put a spare attribute back into the event with a new value */
+static int
+lwes_event_reuse_spare
+  (struct lwes_event*           event,
+   LWES_SHORT_STRING            spareName,
+   struct lwes_event_attribute* attribute,
+   LWES_BYTE                    attrType,
+   int                          attrSize,
+   void*                        attrValue)
+{
+  void *value;
+  int position;
+  int ret;
+
+  ret = lwes_event_check_attr (event, spareName, attrType, NULL, NULL,
+                               &position);
+  if (ret == 0 && lwes_event_reserve_ordered (event) < 0)
+    {
+      ret = -3;
+    }
+  if (ret == 0
+      && (attribute->value == NULL
+          || attribute->value_size < (size_t)attrSize))
+    {
+      value = lwes_event_alloc (event, attrSize);
+      if (value == NULL)
+        {
+          ret = -3;
+        }
+      else
+        {
+          if (attribute->value != NULL)
+            {
+              lwes_event_free (event, attribute->value);
+            }
+          attribute->value      = value;
+          attribute->value_size = attrSize;
+        }
+    }
+
+  if (ret == 0)
+    {
+      memcpy (attribute->value, attrValue, attrSize);
+      attribute->type      = attrType;
+      attribute->array_len = 0;
+      if (lwes_hash_put (event->attributes, spareName, attribute) == attribute)
+        {
+          ret = -4;
+        }
+    }
+
+  if (ret < 0)
+    {
+      /* still a spare, and there is always room since it was just taken */
+      event->spares[event->number_of_spares].name      = spareName;
+      event->spares[event->number_of_spares].attribute = attribute;
+      event->number_of_spares++;
       return ret;
     }
 
+  event->number_of_attributes++;
+  event->serialized_size +=
+    lwes_event_attribute_serialized_size (spareName, attribute);
+  lwes_event_put_ordered (event, spareName, position, attribute);
   return event->number_of_attributes;
 }
 
+/* free all the attributes currently set in an event */
+static void
+lwes_event_free_attributes
+  (struct lwes_event *event)
+{
+  struct lwes_event_attribute *tmp = NULL;
+  struct lwes_hash_enumeration e;
+
+  if (lwes_hash_keys (event->attributes, &e))
+    {
+      while (lwes_hash_enumeration_has_more_elements (&e))
+        {
+          LWES_SHORT_STRING tmpAttrName =
+            lwes_hash_enumeration_next_element (&e);
+          tmp =
+            (struct lwes_event_attribute *)lwes_hash_remove (event->attributes,
+                                                             tmpAttrName);
+          /* free the attribute name, unless it is the db's, and value*/
+          if (tmpAttrName != NULL && ! tmp->name_interned)
+            {
+              lwes_event_free(event, tmpAttrName);
+            }
+          /* free the attribute itself*/
+          lwes_event_attribute_destroy(event, tmp);
+        }
+    }
+  event->number_of_attributes = 0;
+  event->number_of_ordered    = 0;
+  event->serialized_size      = LWES_EVENT_EMPTY_SERIALIZED_SIZE
+    + (event->eventName == NULL ? 0 : strlen (event->eventName));
+}
+
+/* make sure one more attribute can be ordered */
+static int
+lwes_event_reserve_ordered
+  (struct lwes_event *event)
+{
+  struct lwes_event_ordered *ordered;
+  int size;
+
+  if (event->order == LWES_EVENT_ORDER_INSERTION
+      || event->number_of_ordered < event->ordered_size)
+    {
+      return 0;
+    }
+
+  size = (event->ordered_size == 0) ? 8 : event->ordered_size * 2;
+  ordered = (struct lwes_event_ordered *)
+    lwes_event_alloc (event, sizeof (struct lwes_event_ordered) * size);
+  if (ordered == NULL)
+    {
+      return -3;
+    }
+  if (event->number_of_ordered > 0)
+    {
+      memcpy (ordered, event->ordered,
+              sizeof (struct lwes_event_ordered) * event->number_of_ordered);
+    }
+  lwes_event_free (event, event->ordered);
+  event->ordered      = ordered;
+  event->ordered_size = size;
+  return 0;
+}
+
+/* compares by declared position, where attributes the db does not place
+ * come last, and then by name */
+static int
+lwes_event_compare_ordered
+  (int                      position,
+   LWES_CONST_SHORT_STRING  attrName,
+   const struct lwes_event_ordered *entry)
+{
+  if (position != entry->position)
+    {
+      if (position < 0)
+        {
+          return 1;
+        }
+      if (entry->position < 0)
+        {
+          return -1;
+        }
+      return (position < entry->position) ? -1 : 1;
+    }
+  if (attrName == entry->name)
+    {
+      return 0;
+    }
+  return strcmp (attrName, entry->name);
+}
+
+/* put an attribute in its place, or replace the one already there.  Room
+ * was made by lwes_event_reserve_ordered */
+static void
+lwes_event_put_ordered
+  (struct lwes_event*           event,
+   LWES_SHORT_STRING            attrName,
+   int                          position,
+   struct lwes_event_attribute* attribute)
+{
+  int low = 0;
+  int high;
+  int middle;
+  int cmp;
+
+  if (event->order == LWES_EVENT_ORDER_INSERTION)
+    {
+      return;
+    }
+  if (event->order == LWES_EVENT_ORDER_NAME)
+    {
+      position = -1;
+    }
+
+  high = event->number_of_ordered;
+  while (low < high)
+    {
+      middle = (low + high) / 2;
+      cmp = lwes_event_compare_ordered (position, attrName,
+                                        &(event->ordered[middle]));
+      if (cmp == 0)
+        {
+          event->ordered[middle].attribute = attribute;
+          return;
+        }
+      if (cmp < 0)
+        {
+          high = middle;
+        }
+      else
+        {
+          low = middle + 1;
+        }
+    }
+
+  memmove (&(event->ordered[low + 1]), &(event->ordered[low]),
+           sizeof (struct lwes_event_ordered)
+             * (event->number_of_ordered - low));
+  event->ordered[low].position  = position;
+  event->ordered[low].name      = attrName;
+  event->ordered[low].attribute = attribute;
+  event->number_of_ordered++;
+}
+
+/* the next attribute to serialize, 0 when there are no more */
+static int
+lwes_event_next_in_order
+  (struct lwes_event*             event,
+   struct lwes_hash_enumeration*  e,
+   int*                           index,
+   LWES_SHORT_STRING*             attrName,
+   struct lwes_event_attribute**  attribute)
+{
+  if (event->order == LWES_EVENT_ORDER_INSERTION)
+    {
+      if (! lwes_hash_enumeration_has_more_elements (e))
+        {
+          return 0;
+        }
+      *attrName  = lwes_hash_enumeration_next_element (e);
+      *attribute = (struct lwes_event_attribute *)
+        lwes_hash_get (event->attributes, *attrName);
+      return 1;
+    }
+
+  if (*index >= event->number_of_ordered)
+    {
+      return 0;
+    }
+  *attrName  = event->ordered[*index].name;
+  *attribute = event->ordered[*index].attribute;
+  (*index)++;
+  return 1;
+}
+
+static size_t
+lwes_event_attribute_serialized_size
+  (LWES_CONST_SHORT_STRING      attrName,
+   struct lwes_event_attribute* attribute)
+{
+  /* the name with its length, and the type */
+  size_t size = 1 + strlen (attrName) + 1;
+  LWES_BYTE baseType;
+  void *element;
+  int i;
+
+  if (! lwes_type_is_array (attribute->type))
+    {
+      return size + lwes_event_value_serialized_size (attribute->type,
+                                                      attribute->value);
+    }
+
+  baseType = lwes_array_type_to_base (attribute->type);
+  size += 2;
+  if (lwes_type_is_nullable_array (attribute->type))
+    {
+      /* the length again, a bit for each element which is set, and only
+       * the elements which are set */
+      size += 2 + ((attribute->array_len + 7) >> 3);
+      for (i = 0; i < attribute->array_len; ++i)
+        {
+          element = ((void **)attribute->value)[i];
+          if (element != NULL)
+            {
+              size += lwes_event_value_serialized_size (baseType, element);
+            }
+        }
+    }
+  else if (baseType == LWES_TYPE_STRING)
+    {
+      for (i = 0; i < attribute->array_len; ++i)
+        {
+          size += lwes_event_value_serialized_size
+                    (baseType, ((void **)attribute->value)[i]);
+        }
+    }
+  else
+    {
+      size += attribute->array_len
+                * lwes_event_value_serialized_size (baseType, NULL);
+    }
+  return size;
+}
+
+static size_t
+lwes_event_value_serialized_size
+  (LWES_BYTE   type,
+   const void* value)
+{
+  switch (type)
+    {
+      case LWES_TYPE_BOOLEAN:
+      case LWES_TYPE_BYTE:
+        return 1;
+      case LWES_TYPE_U_INT_16:
+      case LWES_TYPE_INT_16:
+        return 2;
+      case LWES_TYPE_U_INT_32:
+      case LWES_TYPE_INT_32:
+      case LWES_TYPE_IP_ADDR:
+      case LWES_TYPE_FLOAT:
+        return 4;
+      case LWES_TYPE_U_INT_64:
+      case LWES_TYPE_INT_64:
+      case LWES_TYPE_DOUBLE:
+        return 8;
+      case LWES_TYPE_STRING:
+        return 2 + (value == NULL ? 0 : strlen ((const char *)value));
+      default:
+        return 0;
+    }
+}
+
 int
 lwes_U_INT_64_from_hex_string
   (const char *buffer,
@@ -29,6 +29,28 @@ extern "C" {
  *  \brief Functions for dealing with LWES events
  */
 
+/*! \brief The order lwes_event_to_bytes writes the attributes of an event in
+ */
+typedef enum {
+    LWES_EVENT_ORDER_INSERTION = 0, /*!< the order they were first set in */
+    LWES_EVENT_ORDER_NAME      = 1, /*!< sorted by name */
+    LWES_EVENT_ORDER_SCHEMA    = 2  /*!< the order the type db declares them
+                                         in, then any others by name */
+} LWES_EVENT_ORDER;
+
+/*! \struct lwes_event_ordered lwes_event.h
+ *  \brief An attribute in the order an event serializes in
+ */
+struct lwes_event_ordered
+{
+  /*! Where the type db declares the attribute, -1 if it does not */
+  int                            position;
+  /*! The attribute name, the key in the attribute hash */
+  LWES_SHORT_STRING              name;
+  /*! The attribute */
+  struct lwes_event_attribute   *attribute;
+};
+
 /*! \struct lwes_event_deserialize_tmp lwes_event.h
  *  \brief Storage for use when deserializing strings from events
  */
@@ -57,6 +79,34 @@ struct lwes_event
    *   keyed by attribute name with a value of struct lwes_event_attribute
    */
   struct lwes_hash *           attributes;
+  /*! Name buffer kept by lwes_event_clear for reuse by lwes_event_set_name */
+  LWES_SHORT_STRING            spare_name;
+  /*! Number of bytes allocated for eventName (or spare_name) */
+  size_t                       name_size;
+  /*! Attributes removed by lwes_event_clear, kept for reuse */
+  struct lwes_event_spare *    spares;
+  /*! Number of entries in spares */
+  int                          number_of_spares;
+  /*! Number of entries allocated for spares */
+  int                          spares_size;
+  /*! If not NULL, the arena all storage of the event comes from */
+  struct lwes_arena *          arena;
+  /*! Position in the arena just after the event itself */
+  struct lwes_arena_mark       arena_mark;
+  /*! Number of bytes lwes_event_to_bytes writes, kept up to date as
+   *  attributes are set and removed */
+  size_t                       serialized_size;
+  /*! Whether eventName is the type db's copy, which is not freed */
+  LWES_BOOLEAN                 name_interned;
+  /*! The order attributes are serialized in */
+  LWES_EVENT_ORDER             order;
+  /*! Unless order is LWES_EVENT_ORDER_INSERTION, the attributes sorted in
+   *  that order as they are set */
+  struct lwes_event_ordered *  ordered;
+  /*! Number of entries in ordered */
+  int                          number_of_ordered;
+  /*! Number of entries allocated for ordered */
+  int                          ordered_size;
 };
 
 /*! \struct lwes_event_attribute lwes_event.h
@@ -70,6 +120,23 @@ struct lwes_event_attribute
   void             *value;
   /*! The array length, for array types only. */
   LWES_U_INT_16     array_len;
+  /*! Number of bytes allocated for value if it may be overwritten in
+   *  place, 0 otherwise */
+  size_t            value_size;
+  /*! Whether the attribute's name in the event is the type db's copy,
+   *  which is not freed */
+  LWES_BOOLEAN      name_interned;
+};
+
+/*! \struct lwes_event_spare lwes_event.h
+ *  \brief An attribute removed by lwes_event_clear, kept for reuse
+ */
+struct lwes_event_spare
+{
+  /*! The attribute name, formerly the key in the attribute hash */
+  LWES_SHORT_STRING              name;
+  /*! The attribute, including its value buffer */
+  struct lwes_event_attribute   *attribute;
 };
 
 /*! \struct lwes_event_enumeration lwes_event.h
@@ -128,6 +195,28 @@ lwes_event_create_with_encoding
    LWES_CONST_SHORT_STRING name,
    LWES_INT_16 encoding);
 
+/*! \brief Create an event whose storage all comes from one arena
+ *
+ * The event, its name, attribute names, values, arrays and hash
+ * elements are carved from a growable arena owned by the event instead
+ * of being allocated separately, and are all freed at once by
+ * lwes_event_destroy.  Memory of replaced attributes is not reclaimed
+ * until lwes_event_clear, which rewinds the arena.
+ *
+ * \param[in] db the event type db to use for this object, if NULL, disable
+ *            type checking.
+ * \param[in] name the name of the event, or NULL to set it later, as when
+ *            deserializing
+ * \param[in] arena_size the size of each arena block, 0 for the default
+ *
+ * \return the newly allocated event or NULL if an error occurred
+ */
+struct lwes_event *
+lwes_event_create_in_arena
+  (struct lwes_event_type_db *db,
+   LWES_CONST_SHORT_STRING name,
+   size_t arena_size);
+
 /*! \brief Cleanup the memory for an event
  *
  * \param[in] event the event to free
@@ -138,11 +227,44 @@ int
 lwes_event_destroy
   (struct lwes_event *event);
 
+/*! \brief Empty an event but keep its storage for reuse
+ *
+ * Removes the name and all attributes from the event, leaving it as if
+ * it had been created with lwes_event_create_no_name, but keeps the
+ * memory which held them.  Setting the same attributes again (as
+ * lwes_event_from_bytes does when another event of the same type is
+ * received) then reuses that memory rather than allocating.  Array
+ * values are always reallocated.  An event created with
+ * lwes_event_create_in_arena simply rewinds its arena.
+ *
+ * \param[in] event the event to clear
+ *
+ * \return 0 on success, a negative number on failure
+ */
+int
+lwes_event_clear
+  (struct lwes_event *event);
+
+/*! \brief Empty an event and release its storage
+ *
+ * Like lwes_event_clear, but frees the memory held for the name and
+ * attributes.  Useful to bound the memory of an event which is reused
+ * for many different event types.
+ *
+ * \param[in] event the event to reset
+ *
+ * \return 0 on success, a negative number on failure
+ */
+int
+lwes_event_reset
+  (struct lwes_event *event);
+
 /*! \brief Set the name of the event
  *
  *  Usually only used when lwes_event_create_no_name is used.
  *  This sets the name of the event, clears the memory of previous
- *  settings, allocates new memory as necessary.
+ *  settings, allocates new memory as necessary.  Like attribute names, the
+ *  name must be 1 to SHORT_STRING_MAX characters long.
  *
  *  \param[in] event the event to set the name of
  *  \param[in] name the new name of the event
@@ -169,6 +291,33 @@ lwes_event_set_encoding
   (struct lwes_event *event,
    LWES_INT_16 encoding);
 
+/*! \brief Set the order the attributes of the event are serialized in
+ *
+ *  By default attributes are written in the order they were first set, so
+ *  equal events built in a different order serialize differently.  With
+ *  LWES_EVENT_ORDER_NAME or LWES_EVENT_ORDER_SCHEMA the attributes are kept
+ *  sorted as they are set, so serializing does no sorting, and equal events
+ *  serialize to the same bytes however they were built.
+ *
+ *  LWES_EVENT_ORDER_SCHEMA uses the order attributes are declared in the
+ *  esf, with the MetaEventInfo attributes the event does not declare
+ *  itself following its own.  It needs a frozen type db, attributes it
+ *  can't place are written after those it can, sorted by name.
+ *
+ *  The order is kept by lwes_event_clear and lwes_event_reset.
+ *
+ *  \param[in] event the event to set the order of
+ *  \param[in] order the order to serialize in
+ *
+ *  \return 0 on success, -1 for a bad argument, -3 if there was no memory
+ *          for the order, in which case the event is left in insertion
+ *          order
+ */
+int
+lwes_event_set_order
+  (struct lwes_event *event,
+   LWES_EVENT_ORDER order);
+
 /*! \brief Add a LWES_U_INT_16 attribute to the event
  *
  *  \param[in] event the event to add the attribute to
@@ -294,6 +443,9 @@ lwes_event_set_INT_64_w_string
    LWES_CONST_SHORT_STRING value);
 
 /*! \brief Add an LWES_LONG_STRING attribute to the event
+ *
+ *  The value may be at most LONG_STRING_MAX characters long, a longer one
+ *  is refused as it could not be serialized.
  *
  *  \param[in] event the event to add the attribute to
  *  \param[in] name the name of the attribute
@@ -1462,6 +1614,20 @@ lwes_event_get_N_INT_64_ARRAY
 
 
 
+/*! \brief Get the number of bytes the serialized event takes
+
+    The size is kept up to date as the event changes, so this does not
+    walk the attributes.  An event which can be serialized at all needs
+    exactly this many bytes.
+
+    \param[in] event the event to size
+
+    \return the serialized size of the event, 0 if event is NULL
+*/
+size_t
+lwes_event_serialized_size
+  (struct lwes_event *event);
+
 /*! \brief Serialize an event
 
    Serialization format is
@@ -1587,8 +1753,12 @@ lwes_event_get_N_INT_64_ARRAY
     \param[in] num_bytes the size of the byte array
     \param[in] offset the offset into the array to start serializing at
 
+    Nothing is written unless the whole event fits, which is checked
+    against lwes_event_serialized_size before anything is marshalled.
+
     \return The number of bytes written to the array on success,
-             a negative number on failure
+             a negative number on failure, -21 if the event does not
+             fit in num_bytes - offset
 */
 int
 lwes_event_to_bytes
@@ -1619,6 +1789,31 @@ lwes_event_add_headers
    LWES_IP_ADDR sender_ip,
    LWES_U_INT_16 sender_port);
 
+/*! \brief Add common headers and ReceiptTimeNanos to a serialized event
+ *
+ *  As lwes_event_add_headers, with ReceiptTime derived from
+ *  receipt_time_nanos, and an additional ReceiptTimeNanos attribute holding
+ *  it at full resolution.
+ *
+ *  \param[in,out] bytes The serialized event to add the attributes to
+ *  \param[in] max      The maximum size of the serialzed event
+ *  \param[in,out] len  The current size of the serialized event
+ *  \param[in] receipt_time_nanos The time in nanoseconds since epoch at
+ *                                which the event was received
+ *  \param[in] sender_ip The ip address of the sender of the event
+ *  \param[in] sender_port The port of of the sender of the event
+ *
+ *  \return 0 upon success, a negative number upon failure
+ */
+int
+lwes_event_add_headers_nanos
+  (LWES_BYTE_P bytes,
+   size_t max,
+   size_t *len,
+   LWES_INT_64 receipt_time_nanos,
+   LWES_IP_ADDR sender_ip,
+   LWES_U_INT_16 sender_port);
+
 /*! \brief Deserialize an event
 
     \param[in] event the event to deserialize into
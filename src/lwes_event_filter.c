@@ -0,0 +1,1026 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#include "lwes_event_filter.h"
+#include "lwes_marshall_functions.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <regex.h>
+#include <arpa/inet.h>
+
+/* largest string attribute, the length is serialized as a U_INT_16 */
+#define LWES_EVENT_FILTER_MAX_STRING 65535
+
+#define LWES_EVENT_FILTER_CMP(a,b) ((a) < (b) ? -1 : ((a) > (b) ? 1 : 0))
+
+enum lwes_event_filter_op
+{
+  LWES_EVENT_FILTER_AND,
+  LWES_EVENT_FILTER_OR,
+  LWES_EVENT_FILTER_NOT,
+  LWES_EVENT_FILTER_EQ,
+  LWES_EVENT_FILTER_NE,
+  LWES_EVENT_FILTER_LT,
+  LWES_EVENT_FILTER_LE,
+  LWES_EVENT_FILTER_GT,
+  LWES_EVENT_FILTER_GE,
+  LWES_EVENT_FILTER_PREFIX,
+  LWES_EVENT_FILTER_REGEX,
+  LWES_EVENT_FILTER_IN
+};
+
+/* a value from the expression, read as every type it could be compared
+   against when the filter is compiled rather than for every event */
+struct lwes_event_filter_value
+{
+  LWES_CHAR    *string;
+  size_t        string_length;
+  LWES_BOOLEAN  is_int;
+  LWES_INT_64   int_value;
+  LWES_BOOLEAN  is_uint;
+  LWES_U_INT_64 uint_value;
+  LWES_BOOLEAN  is_double;
+  LWES_DOUBLE   double_value;
+  /* 1 for an integer above any 64 bit one, -1 for one below, else 0 */
+  int           overflow;
+  LWES_BOOLEAN  is_ip;
+  LWES_U_INT_32 ip_value;
+  LWES_BOOLEAN  is_boolean;
+  LWES_BOOLEAN  boolean_value;
+};
+
+struct lwes_event_filter_node
+{
+  enum lwes_event_filter_op       op;
+  /* operands of AND and OR, left is the operand of NOT */
+  struct lwes_event_filter_node  *left;
+  struct lwes_event_filter_node  *right;
+  /* attribute of a comparison, and the value or values to compare with */
+  LWES_CHAR                      *key;
+  struct lwes_event_filter_value *values;
+  int                             number_of_values;
+  regex_t                        *regex;
+};
+
+enum lwes_event_filter_token_type
+{
+  LWES_EVENT_FILTER_TOKEN_END,
+  LWES_EVENT_FILTER_TOKEN_WORD,
+  LWES_EVENT_FILTER_TOKEN_LPAREN,
+  LWES_EVENT_FILTER_TOKEN_RPAREN,
+  LWES_EVENT_FILTER_TOKEN_COMMA,
+  LWES_EVENT_FILTER_TOKEN_AND,
+  LWES_EVENT_FILTER_TOKEN_OR,
+  LWES_EVENT_FILTER_TOKEN_NOT,
+  LWES_EVENT_FILTER_TOKEN_OP,
+  LWES_EVENT_FILTER_TOKEN_ERROR
+};
+
+struct lwes_event_filter_parser
+{
+  const char                        *text;
+  /* the current token */
+  enum lwes_event_filter_token_type  type;
+  enum lwes_event_filter_op          op;
+  size_t                             start;
+  size_t                             end;
+  LWES_BOOLEAN                       quoted;
+  /* where the next token starts */
+  size_t                             position;
+  /* whether a ~= has been compiled */
+  LWES_BOOLEAN                       has_regex;
+};
+
+/*************************************************************************
+  PRIVATE API prototypes, shouldn't be called by a user of the library.
+ *************************************************************************/
+static void
+lwes_event_filter_next_token
+  (struct lwes_event_filter_parser *parser);
+
+static LWES_CHAR *
+lwes_event_filter_token_string
+  (struct lwes_event_filter_parser *parser,
+   size_t *length);
+
+static struct lwes_event_filter_node *
+lwes_event_filter_parse_or
+  (struct lwes_event_filter_parser *parser);
+
+static struct lwes_event_filter_node *
+lwes_event_filter_parse_and
+  (struct lwes_event_filter_parser *parser);
+
+static struct lwes_event_filter_node *
+lwes_event_filter_parse_unary
+  (struct lwes_event_filter_parser *parser);
+
+static struct lwes_event_filter_node *
+lwes_event_filter_parse_comparison
+  (struct lwes_event_filter_parser *parser);
+
+static int
+lwes_event_filter_parse_value
+  (struct lwes_event_filter_parser *parser,
+   struct lwes_event_filter_node *node);
+
+static struct lwes_event_filter_node *
+lwes_event_filter_node_create
+  (enum lwes_event_filter_op op,
+   struct lwes_event_filter_node *left,
+   struct lwes_event_filter_node *right);
+
+static void
+lwes_event_filter_node_destroy
+  (struct lwes_event_filter_node *node);
+
+static int
+lwes_event_filter_evaluate
+  (struct lwes_event_filter *filter,
+   struct lwes_event_view *view,
+   struct lwes_event_filter_node *node);
+
+static int
+lwes_event_filter_compare
+  (struct lwes_event_view *view,
+   const struct lwes_event_view_attribute *attr,
+   const struct lwes_event_filter_value *value,
+   int *result);
+
+/*************************************************************************
+  PUBLIC API
+ *************************************************************************/
+struct lwes_event_filter *
+lwes_event_filter_create
+  (LWES_CONST_SHORT_STRING expression,
+   size_t *error_offset)
+{
+  struct lwes_event_filter_parser parser;
+  struct lwes_event_filter *filter;
+
+  if (error_offset != NULL)
+    {
+      *error_offset = 0;
+    }
+  if (expression == NULL)
+    {
+      return NULL;
+    }
+
+  parser.text      = expression;
+  parser.position  = 0;
+  parser.has_regex = FALSE;
+  lwes_event_filter_next_token (&parser);
+
+  filter = (struct lwes_event_filter *)
+    malloc (sizeof (struct lwes_event_filter));
+  if (filter == NULL)
+    {
+      return NULL;
+    }
+  filter->view    = NULL;
+  filter->scratch = NULL;
+
+  filter->root = lwes_event_filter_parse_or (&parser);
+  if (filter->root == NULL
+      || parser.type != LWES_EVENT_FILTER_TOKEN_END)
+    {
+      if (error_offset != NULL)
+        {
+          *error_offset = parser.start;
+        }
+      lwes_event_filter_destroy (filter);
+      return NULL;
+    }
+
+  filter->view = (struct lwes_event_view *)
+    malloc (sizeof (struct lwes_event_view));
+  if (parser.has_regex)
+    {
+      filter->scratch = (LWES_CHAR *) malloc (LWES_EVENT_FILTER_MAX_STRING+1);
+    }
+  if (filter->view == NULL
+      || (parser.has_regex && filter->scratch == NULL))
+    {
+      lwes_event_filter_destroy (filter);
+      return NULL;
+    }
+
+  return filter;
+}
+
+void
+lwes_event_filter_destroy
+  (struct lwes_event_filter *filter)
+{
+  if (filter == NULL)
+    {
+      return;
+    }
+  lwes_event_filter_node_destroy (filter->root);
+  free (filter->view);
+  free (filter->scratch);
+  free (filter);
+}
+
+int
+lwes_event_filter_matches
+  (struct lwes_event_filter *filter,
+   LWES_BYTE_P bytes,
+   size_t num_bytes)
+{
+  if (filter == NULL || bytes == NULL)
+    {
+      return -1;
+    }
+
+  if (lwes_event_view_from_bytes (filter->view, bytes, num_bytes, 0) < 0)
+    {
+      return -2;
+    }
+
+  return lwes_event_filter_evaluate (filter, filter->view, filter->root);
+}
+
+int
+lwes_event_filter_matches_view
+  (struct lwes_event_filter *filter,
+   struct lwes_event_view *view)
+{
+  if (filter == NULL || view == NULL)
+    {
+      return -1;
+    }
+
+  return lwes_event_filter_evaluate (filter, view, filter->root);
+}
+
+/*************************************************************************
+  PRIVATE API
+ *************************************************************************/
+static void
+lwes_event_filter_next_token
+  (struct lwes_event_filter_parser *parser)
+{
+  const char *text = parser->text;
+  size_t i = parser->position;
+
+  while (text[i] == ' ' || text[i] == '\t' || text[i] == '\n'
+         || text[i] == '\r')
+    {
+      i++;
+    }
+
+  parser->start  = i;
+  parser->quoted = FALSE;
+
+  switch (text[i])
+    {
+      case '\0':
+        parser->type = LWES_EVENT_FILTER_TOKEN_END;
+        break;
+      case '(':
+        parser->type = LWES_EVENT_FILTER_TOKEN_LPAREN;
+        i++;
+        break;
+      case ')':
+        parser->type = LWES_EVENT_FILTER_TOKEN_RPAREN;
+        i++;
+        break;
+      case ',':
+        parser->type = LWES_EVENT_FILTER_TOKEN_COMMA;
+        i++;
+        break;
+      case '&':
+      case '|':
+        parser->type = (text[i] == '&' ? LWES_EVENT_FILTER_TOKEN_AND
+                                       : LWES_EVENT_FILTER_TOKEN_OR);
+        if (text[i + 1] != text[i])
+          {
+            parser->type = LWES_EVENT_FILTER_TOKEN_ERROR;
+          }
+        i += 2;
+        break;
+      case '!':
+        if (text[i + 1] == '=')
+          {
+            parser->type = LWES_EVENT_FILTER_TOKEN_OP;
+            parser->op   = LWES_EVENT_FILTER_NE;
+            i += 2;
+          }
+        else
+          {
+            parser->type = LWES_EVENT_FILTER_TOKEN_NOT;
+            i++;
+          }
+        break;
+      case '=':
+        parser->type = LWES_EVENT_FILTER_TOKEN_OP;
+        parser->op   = LWES_EVENT_FILTER_EQ;
+        i += (text[i + 1] == '=' ? 2 : 1);
+        break;
+      case '<':
+      case '>':
+        parser->type = LWES_EVENT_FILTER_TOKEN_OP;
+        if (text[i + 1] == '=')
+          {
+            parser->op = (text[i] == '<' ? LWES_EVENT_FILTER_LE
+                                         : LWES_EVENT_FILTER_GE);
+            i += 2;
+          }
+        else
+          {
+            parser->op = (text[i] == '<' ? LWES_EVENT_FILTER_LT
+                                         : LWES_EVENT_FILTER_GT);
+            i++;
+          }
+        break;
+      case '^':
+      case '~':
+        parser->type = LWES_EVENT_FILTER_TOKEN_OP;
+        parser->op   = (text[i] == '^' ? LWES_EVENT_FILTER_PREFIX
+                                       : LWES_EVENT_FILTER_REGEX);
+        if (text[i + 1] != '=')
+          {
+            parser->type = LWES_EVENT_FILTER_TOKEN_ERROR;
+          }
+        i += 2;
+        break;
+      case '"':
+        parser->type   = LWES_EVENT_FILTER_TOKEN_WORD;
+        parser->quoted = TRUE;
+        for (i++; text[i] != '"'; i++)
+          {
+            if (text[i] == '\\' && text[i + 1] != '\0')
+              {
+                i++;
+              }
+            else if (text[i] == '\0')
+              {
+                parser->type = LWES_EVENT_FILTER_TOKEN_ERROR;
+                break;
+              }
+          }
+        if (text[i] == '"')
+          {
+            i++;
+          }
+        break;
+      default:
+        parser->type = LWES_EVENT_FILTER_TOKEN_WORD;
+        while (text[i] != '\0' && strchr (" \t\n\r()=!<>^~,&|\"", text[i])
+                                    == NULL)
+          {
+            i++;
+          }
+        break;
+    }
+
+  /* an error token stays put so it is reported where it starts */
+  if (parser->type == LWES_EVENT_FILTER_TOKEN_ERROR)
+    {
+      i = parser->start;
+    }
+  parser->end      = i;
+  parser->position = i;
+}
+
+static LWES_CHAR *
+lwes_event_filter_token_string
+  (struct lwes_event_filter_parser *parser,
+   size_t *length)
+{
+  const char *text = parser->text + parser->start;
+  size_t text_length = parser->end - parser->start;
+  LWES_CHAR *string;
+  size_t i;
+  size_t n = 0;
+
+  /* drop the quotes, the string can only get shorter */
+  if (parser->quoted)
+    {
+      text++;
+      text_length -= 2;
+    }
+
+  string = (LWES_CHAR *) malloc (text_length + 1);
+  if (string == NULL)
+    {
+      return NULL;
+    }
+  for (i = 0; i < text_length; i++)
+    {
+      if (parser->quoted && text[i] == '\\'
+          && (text[i + 1] == '"' || text[i + 1] == '\\'))
+        {
+          i++;
+        }
+      string[n++] = text[i];
+    }
+  string[n] = '\0';
+  *length = n;
+
+  return string;
+}
+
+static struct lwes_event_filter_node *
+lwes_event_filter_parse_or
+  (struct lwes_event_filter_parser *parser)
+{
+  struct lwes_event_filter_node *left;
+  struct lwes_event_filter_node *right;
+  struct lwes_event_filter_node *node;
+
+  if ((left = lwes_event_filter_parse_and (parser)) == NULL)
+    {
+      return NULL;
+    }
+
+  while (parser->type == LWES_EVENT_FILTER_TOKEN_OR)
+    {
+      lwes_event_filter_next_token (parser);
+      if ((right = lwes_event_filter_parse_and (parser)) == NULL)
+        {
+          lwes_event_filter_node_destroy (left);
+          return NULL;
+        }
+      node = lwes_event_filter_node_create (LWES_EVENT_FILTER_OR,
+                                            left, right);
+      if (node == NULL)
+        {
+          lwes_event_filter_node_destroy (left);
+          lwes_event_filter_node_destroy (right);
+          return NULL;
+        }
+      left = node;
+    }
+
+  return left;
+}
+
+static struct lwes_event_filter_node *
+lwes_event_filter_parse_and
+  (struct lwes_event_filter_parser *parser)
+{
+  struct lwes_event_filter_node *left;
+  struct lwes_event_filter_node *right;
+  struct lwes_event_filter_node *node;
+
+  if ((left = lwes_event_filter_parse_unary (parser)) == NULL)
+    {
+      return NULL;
+    }
+
+  while (parser->type == LWES_EVENT_FILTER_TOKEN_AND
+         || parser->type == LWES_EVENT_FILTER_TOKEN_COMMA)
+    {
+      lwes_event_filter_next_token (parser);
+      if ((right = lwes_event_filter_parse_unary (parser)) == NULL)
+        {
+          lwes_event_filter_node_destroy (left);
+          return NULL;
+        }
+      node = lwes_event_filter_node_create (LWES_EVENT_FILTER_AND,
+                                            left, right);
+      if (node == NULL)
+        {
+          lwes_event_filter_node_destroy (left);
+          lwes_event_filter_node_destroy (right);
+          return NULL;
+        }
+      left = node;
+    }
+
+  return left;
+}
+
+static struct lwes_event_filter_node *
+lwes_event_filter_parse_unary
+  (struct lwes_event_filter_parser *parser)
+{
+  struct lwes_event_filter_node *child;
+  struct lwes_event_filter_node *node;
+
+  if (parser->type == LWES_EVENT_FILTER_TOKEN_NOT)
+    {
+      lwes_event_filter_next_token (parser);
+      if ((child = lwes_event_filter_parse_unary (parser)) == NULL)
+        {
+          return NULL;
+        }
+      node = lwes_event_filter_node_create (LWES_EVENT_FILTER_NOT,
+                                            child, NULL);
+      if (node == NULL)
+        {
+          lwes_event_filter_node_destroy (child);
+        }
+      return node;
+    }
+
+  if (parser->type == LWES_EVENT_FILTER_TOKEN_LPAREN)
+    {
+      lwes_event_filter_next_token (parser);
+      if ((node = lwes_event_filter_parse_or (parser)) == NULL)
+        {
+          return NULL;
+        }
+      if (parser->type != LWES_EVENT_FILTER_TOKEN_RPAREN)
+        {
+          lwes_event_filter_node_destroy (node);
+          return NULL;
+        }
+      lwes_event_filter_next_token (parser);
+      return node;
+    }
+
+  return lwes_event_filter_parse_comparison (parser);
+}
+
+static struct lwes_event_filter_node *
+lwes_event_filter_parse_comparison
+  (struct lwes_event_filter_parser *parser)
+{
+  struct lwes_event_filter_node *node;
+  size_t length;
+  int flags;
+
+  if (parser->type != LWES_EVENT_FILTER_TOKEN_WORD)
+    {
+      return NULL;
+    }
+
+  node = lwes_event_filter_node_create (LWES_EVENT_FILTER_EQ, NULL, NULL);
+  if (node == NULL)
+    {
+      return NULL;
+    }
+  node->key = lwes_event_filter_token_string (parser, &length);
+  if (node->key == NULL || length == 0 || length > SHORT_STRING_MAX)
+    {
+      lwes_event_filter_node_destroy (node);
+      return NULL;
+    }
+  lwes_event_filter_next_token (parser);
+
+  /* key in (value, ...) */
+  if (parser->type == LWES_EVENT_FILTER_TOKEN_WORD
+      && ! parser->quoted
+      && parser->end - parser->start == 2
+      && strncasecmp (parser->text + parser->start, "in", 2) == 0)
+    {
+      node->op = LWES_EVENT_FILTER_IN;
+      lwes_event_filter_next_token (parser);
+      if (parser->type != LWES_EVENT_FILTER_TOKEN_LPAREN)
+        {
+          lwes_event_filter_node_destroy (node);
+          return NULL;
+        }
+      do
+        {
+          lwes_event_filter_next_token (parser);
+          if (lwes_event_filter_parse_value (parser, node) < 0)
+            {
+              lwes_event_filter_node_destroy (node);
+              return NULL;
+            }
+        }
+      while (parser->type == LWES_EVENT_FILTER_TOKEN_COMMA);
+      if (parser->type != LWES_EVENT_FILTER_TOKEN_RPAREN)
+        {
+          lwes_event_filter_node_destroy (node);
+          return NULL;
+        }
+      lwes_event_filter_next_token (parser);
+      return node;
+    }
+
+  if (parser->type != LWES_EVENT_FILTER_TOKEN_OP)
+    {
+      lwes_event_filter_node_destroy (node);
+      return NULL;
+    }
+  node->op = parser->op;
+  lwes_event_filter_next_token (parser);
+  if (lwes_event_filter_parse_value (parser, node) < 0)
+    {
+      lwes_event_filter_node_destroy (node);
+      return NULL;
+    }
+
+  if (node->op == LWES_EVENT_FILTER_REGEX)
+    {
+      node->regex = (regex_t *) malloc (sizeof (regex_t));
+      if (node->regex == NULL)
+        {
+          lwes_event_filter_node_destroy (node);
+          return NULL;
+        }
+      flags = REG_EXTENDED | REG_NOSUB;
+      if (regcomp (node->regex, node->values[0].string, flags) != 0)
+        {
+          free (node->regex);
+          node->regex = NULL;
+          lwes_event_filter_node_destroy (node);
+          return NULL;
+        }
+      parser->has_regex = TRUE;
+    }
+
+  return node;
+}
+
+/* reads the current token as a value, appends it to the node's values and
+   moves on to the next token */
+static int
+lwes_event_filter_parse_value
+  (struct lwes_event_filter_parser *parser,
+   struct lwes_event_filter_node *node)
+{
+  struct lwes_event_filter_value *values;
+  struct lwes_event_filter_value *value;
+  struct in_addr addr;
+  char *end;
+
+  if (parser->type != LWES_EVENT_FILTER_TOKEN_WORD)
+    {
+      return -1;
+    }
+
+  values = (struct lwes_event_filter_value *)
+    realloc (node->values, sizeof (struct lwes_event_filter_value)
+                             * (node->number_of_values + 1));
+  if (values == NULL)
+    {
+      return -3;
+    }
+  node->values = values;
+  value = &(values[node->number_of_values]);
+  memset (value, 0, sizeof (struct lwes_event_filter_value));
+
+  value->string = lwes_event_filter_token_string (parser,
+                                                  &(value->string_length));
+  if (value->string == NULL)
+    {
+      return -3;
+    }
+  node->number_of_values++;
+
+  if (value->string_length > 0)
+    {
+      errno = 0;
+      value->int_value = strtoll (value->string, &end, 10);
+      value->is_int = (*end == '\0' && errno == 0);
+      if (*end == '\0' && errno == ERANGE && value->string[0] == '-')
+        {
+          value->overflow = -1;
+        }
+
+      errno = 0;
+      value->uint_value = strtoull (value->string, &end, 10);
+      /* -0 is zero, which an unsigned attribute can be equal to */
+      value->is_uint = (*end == '\0' && errno == 0
+                        && (value->string[0] != '-' || value->uint_value == 0));
+      if (*end == '\0' && errno == ERANGE && value->string[0] != '-')
+        {
+          value->overflow = 1;
+        }
+
+      value->double_value = strtod (value->string, &end);
+      value->is_double = (*end == '\0');
+    }
+
+  if (inet_pton (AF_INET, value->string, &addr) == 1)
+    {
+      value->is_ip    = TRUE;
+      value->ip_value = ntohl (addr.s_addr);
+    }
+
+  if (strcasecmp (value->string, "true") == 0
+      || strcasecmp (value->string, "false") == 0)
+    {
+      value->is_boolean    = TRUE;
+      value->boolean_value = (value->string[0] == 't'
+                              || value->string[0] == 'T');
+    }
+  else if (value->is_int
+           && (value->int_value == 0 || value->int_value == 1))
+    {
+      value->is_boolean    = TRUE;
+      value->boolean_value = (LWES_BOOLEAN)value->int_value;
+    }
+
+  lwes_event_filter_next_token (parser);
+  return 0;
+}
+
+static struct lwes_event_filter_node *
+lwes_event_filter_node_create
+  (enum lwes_event_filter_op op,
+   struct lwes_event_filter_node *left,
+   struct lwes_event_filter_node *right)
+{
+  struct lwes_event_filter_node *node =
+    (struct lwes_event_filter_node *)
+      malloc (sizeof (struct lwes_event_filter_node));
+
+  if (node == NULL)
+    {
+      return NULL;
+    }
+  node->op               = op;
+  node->left             = left;
+  node->right            = right;
+  node->key              = NULL;
+  node->values           = NULL;
+  node->number_of_values = 0;
+  node->regex            = NULL;
+
+  return node;
+}
+
+static void
+lwes_event_filter_node_destroy
+  (struct lwes_event_filter_node *node)
+{
+  int i;
+
+  if (node == NULL)
+    {
+      return;
+    }
+  lwes_event_filter_node_destroy (node->left);
+  lwes_event_filter_node_destroy (node->right);
+  for (i = 0; i < node->number_of_values; i++)
+    {
+      free (node->values[i].string);
+    }
+  free (node->values);
+  free (node->key);
+  if (node->regex != NULL)
+    {
+      regfree (node->regex);
+      free (node->regex);
+    }
+  free (node);
+}
+
+static int
+lwes_event_filter_evaluate
+  (struct lwes_event_filter *filter,
+   struct lwes_event_view *view,
+   struct lwes_event_filter_node *node)
+{
+  const struct lwes_event_view_attribute *attr;
+  const struct lwes_event_filter_value *value;
+  LWES_U_INT_16 length;
+  size_t offset;
+  int result;
+  int i;
+
+  switch (node->op)
+    {
+      case LWES_EVENT_FILTER_AND:
+        return lwes_event_filter_evaluate (filter, view, node->left)
+               && lwes_event_filter_evaluate (filter, view, node->right);
+      case LWES_EVENT_FILTER_OR:
+        return lwes_event_filter_evaluate (filter, view, node->left)
+               || lwes_event_filter_evaluate (filter, view, node->right);
+      case LWES_EVENT_FILTER_NOT:
+        return ! lwes_event_filter_evaluate (filter, view, node->left);
+      default:
+        break;
+    }
+
+  attr = lwes_event_view_get_attribute (view, node->key);
+  if (attr == NULL)
+    {
+      return 0;
+    }
+  value = &(node->values[0]);
+
+  switch (node->op)
+    {
+      case LWES_EVENT_FILTER_IN:
+        for (i = 0; i < node->number_of_values; i++)
+          {
+            if (lwes_event_filter_compare (view, attr, &(node->values[i]),
+                                           &result) == 0
+                && result == 0)
+              {
+                return 1;
+              }
+          }
+        return 0;
+
+      case LWES_EVENT_FILTER_PREFIX:
+      case LWES_EVENT_FILTER_REGEX:
+        if (attr->type != LWES_TYPE_STRING)
+          {
+            return 0;
+          }
+        offset = attr->offset;
+        unmarshall_U_INT_16 (&length, view->bytes, view->num_bytes, &offset);
+        if (node->op == LWES_EVENT_FILTER_PREFIX)
+          {
+            return (length >= value->string_length
+                    && memcmp (view->bytes + offset, value->string,
+                               value->string_length) == 0);
+          }
+        /* regexec needs a null terminated string */
+        memcpy (filter->scratch, view->bytes + offset, length);
+        filter->scratch[length] = '\0';
+        return (regexec (node->regex, filter->scratch, 0, NULL, 0) == 0);
+
+      default:
+        break;
+    }
+
+  if (lwes_event_filter_compare (view, attr, value, &result) < 0)
+    {
+      return 0;
+    }
+
+  switch (node->op)
+    {
+      case LWES_EVENT_FILTER_EQ: return result == 0;
+      case LWES_EVENT_FILTER_NE: return result != 0;
+      case LWES_EVENT_FILTER_LT: return result < 0;
+      case LWES_EVENT_FILTER_LE: return result <= 0;
+      case LWES_EVENT_FILTER_GT: return result > 0;
+      case LWES_EVENT_FILTER_GE: return result >= 0;
+      default:                   return 0;
+    }
+}
+
+/* compares the attribute with the value, setting result to less than, equal
+   to or greater than zero, returns -1 if they can not be compared */
+static int
+lwes_event_filter_compare
+  (struct lwes_event_view *view,
+   const struct lwes_event_view_attribute *attr,
+   const struct lwes_event_filter_value *value,
+   int *result)
+{
+  size_t offset = attr->offset;
+  LWES_U_INT_64 u = 0;
+  LWES_INT_64 s = 0;
+  LWES_DOUBLE d = 0;
+  LWES_U_INT_16 u16;
+  LWES_INT_16 s16;
+  LWES_U_INT_32 u32;
+  LWES_INT_32 s32;
+  LWES_BYTE byte;
+  LWES_BOOLEAN b;
+  LWES_FLOAT f;
+  LWES_IP_ADDR ip;
+
+  switch (attr->type)
+    {
+      case LWES_TYPE_U_INT_16:
+        unmarshall_U_INT_16 (&u16, view->bytes, view->num_bytes, &offset);
+        u = u16;
+        break;
+      case LWES_TYPE_U_INT_32:
+        unmarshall_U_INT_32 (&u32, view->bytes, view->num_bytes, &offset);
+        u = u32;
+        break;
+      case LWES_TYPE_U_INT_64:
+        unmarshall_U_INT_64 (&u, view->bytes, view->num_bytes, &offset);
+        break;
+      case LWES_TYPE_BYTE:
+        unmarshall_BYTE (&byte, view->bytes, view->num_bytes, &offset);
+        u = byte;
+        break;
+      case LWES_TYPE_INT_16:
+        unmarshall_INT_16 (&s16, view->bytes, view->num_bytes, &offset);
+        s = s16;
+        break;
+      case LWES_TYPE_INT_32:
+        unmarshall_INT_32 (&s32, view->bytes, view->num_bytes, &offset);
+        s = s32;
+        break;
+      case LWES_TYPE_INT_64:
+        unmarshall_INT_64 (&s, view->bytes, view->num_bytes, &offset);
+        break;
+      case LWES_TYPE_FLOAT:
+        unmarshall_FLOAT (&f, view->bytes, view->num_bytes, &offset);
+        d = f;
+        break;
+      case LWES_TYPE_DOUBLE:
+        unmarshall_DOUBLE (&d, view->bytes, view->num_bytes, &offset);
+        break;
+
+      case LWES_TYPE_BOOLEAN:
+        if (! value->is_boolean)
+          {
+            return -1;
+          }
+        unmarshall_BOOLEAN (&b, view->bytes, view->num_bytes, &offset);
+        *result = LWES_EVENT_FILTER_CMP (b ? 1 : 0,
+                                         value->boolean_value ? 1 : 0);
+        return 0;
+
+      case LWES_TYPE_IP_ADDR:
+        if (! value->is_ip)
+          {
+            return -1;
+          }
+        unmarshall_IP_ADDR (&ip, view->bytes, view->num_bytes, &offset);
+        *result = LWES_EVENT_FILTER_CMP (ntohl (ip.s_addr), value->ip_value);
+        return 0;
+
+      case LWES_TYPE_STRING:
+        unmarshall_U_INT_16 (&u16, view->bytes, view->num_bytes, &offset);
+        *result = memcmp (view->bytes + offset, value->string,
+                          u16 < value->string_length ? u16
+                                                     : value->string_length);
+        if (*result == 0)
+          {
+            *result = LWES_EVENT_FILTER_CMP ((size_t)u16,
+                                             value->string_length);
+          }
+        return 0;
+
+      default:
+        return -1;
+    }
+
+  switch (attr->type)
+    {
+      case LWES_TYPE_FLOAT:
+      case LWES_TYPE_DOUBLE:
+        /* NaN is neither less than, equal to nor greater than anything */
+        if (! value->is_double || isnan (d) || isnan (value->double_value))
+          {
+            return -1;
+          }
+        *result = LWES_EVENT_FILTER_CMP (d, value->double_value);
+        return 0;
+
+      case LWES_TYPE_INT_16:
+      case LWES_TYPE_INT_32:
+      case LWES_TYPE_INT_64:
+        if (value->is_int)
+          {
+            *result = LWES_EVENT_FILTER_CMP (s, value->int_value);
+          }
+        else if (value->is_uint)
+          {
+            /* too big for a signed value */
+            *result = -1;
+          }
+        else if (value->overflow != 0)
+          {
+            /* beyond any 64 bit value, which a double can't tell apart */
+            *result = -value->overflow;
+          }
+        else if (value->is_double && ! isnan (value->double_value))
+          {
+            *result = LWES_EVENT_FILTER_CMP ((LWES_DOUBLE)s,
+                                             value->double_value);
+          }
+        else
+          {
+            return -1;
+          }
+        return 0;
+
+      default:
+        if (value->is_uint)
+          {
+            *result = LWES_EVENT_FILTER_CMP (u, value->uint_value);
+          }
+        else if (value->is_int)
+          {
+            /* negative */
+            *result = 1;
+          }
+        else if (value->overflow != 0)
+          {
+            *result = -value->overflow;
+          }
+        else if (value->is_double && ! isnan (value->double_value))
+          {
+            *result = LWES_EVENT_FILTER_CMP ((LWES_DOUBLE)u,
+                                             value->double_value);
+          }
+        else
+          {
+            return -1;
+          }
+        return 0;
+    }
+}
@@ -0,0 +1,135 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#ifndef __LWES_EVENT_FILTER_H
+#define __LWES_EVENT_FILTER_H
+
+#include "lwes_types.h"
+#include "lwes_event_view.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! \file lwes_event_filter.h
+ *  \brief Functions for matching serialized events against predicates
+ *
+ *  A filter is compiled once from an expression and can then be checked
+ *  against serialized events without deserializing them, the attributes
+ *  it needs are read in place with an lwes_event_view.
+ *
+ *  An expression is made up of comparisons of an attribute with a value
+ *    - key = value, key == value, key != value
+ *    - key < value, key <= value, key > value, key >= value
+ *    - key ^= value, the string attribute starts with value
+ *    - key ~= value, the string attribute matches the POSIX extended
+ *      regular expression value
+ *    - key in (value, value, ...), the attribute equals one of the values
+ *
+ *  which can be combined with && (or ,) and ||, negated with !, and
+ *  grouped with parentheses, && binding tighter than ||.  So the old
+ *  lwes-filter-listener syntax of comma separated key=value pairs is
+ *  still valid.
+ *
+ *  Keys and values are either bare words, made of anything except white
+ *  space and the characters ()=!<>^~,&|", or double quoted strings in
+ *  which \\" and \\\\ stand for a double quote and a backslash, any
+ *  other backslash is kept as it is for the sake of regular expressions.
+ *  Values are compared according to the type of the attribute in the
+ *  event: numerically for the integer and floating point types, as true
+ *  or false (or 1 or 0) for booleans, as dotted quads for ip addresses,
+ *  and byte by byte for strings.
+ *
+ *  A comparison is false if the attribute is missing, is an array, or the
+ *  value can not be read as the attribute's type, so "key != 1" only
+ *  matches events which have key, and "!(key = 1)" also matches events
+ *  which do not.
+ */
+
+struct lwes_event_filter_node;
+
+/*! \struct lwes_event_filter lwes_event_filter.h
+ *  \brief A compiled filter expression
+ */
+struct lwes_event_filter
+{
+  /*! Root of the compiled expression */
+  struct lwes_event_filter_node *root;
+  /*! View used by lwes_event_filter_matches to read events */
+  struct lwes_event_view        *view;
+  /*! Null terminated copy of a string for regular expression matching,
+      only allocated when the expression has a ~= comparison */
+  LWES_CHAR                     *scratch;
+};
+
+/*! \brief Compile a filter expression
+ *
+ *  \param[in] expression the expression to compile
+ *  \param[out] error_offset if not NULL, set to the offset in expression
+ *                           where compiling failed
+ *
+ *  \see lwes_event_filter_destroy
+ *
+ *  \return the compiled filter, or NULL if the expression is invalid or
+ *          memory could not be allocated
+ */
+struct lwes_event_filter *
+lwes_event_filter_create
+  (LWES_CONST_SHORT_STRING expression,
+   size_t *error_offset);
+
+/*! \brief Free a compiled filter
+ *
+ *  \param[in] filter the filter to free
+ */
+void
+lwes_event_filter_destroy
+  (struct lwes_event_filter *filter);
+
+/*! \brief Check a serialized event against a filter
+ *
+ *  The filter's view is reused for every event, so a filter should only be
+ *  used by one thread at a time.
+ *
+ *  \param[in] filter the filter to check against
+ *  \param[in] bytes the serialized event
+ *  \param[in] num_bytes the size of the serialized event
+ *
+ *  \return 1 if the event matches, 0 if it does not, a negative number if
+ *          the arguments are invalid or the event could not be read
+ */
+int
+lwes_event_filter_matches
+  (struct lwes_event_filter *filter,
+   LWES_BYTE_P bytes,
+   size_t num_bytes);
+
+/*! \brief Check an event which has already been read into a view
+ *
+ *  \param[in] filter the filter to check against
+ *  \param[in] view the view of the serialized event
+ *
+ *  \return 1 if the event matches, 0 if it does not, a negative number if
+ *          the arguments are invalid
+ */
+int
+lwes_event_filter_matches_view
+  (struct lwes_event_filter *filter,
+   struct lwes_event_view *view);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LWES_EVENT_FILTER_H */
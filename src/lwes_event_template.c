@@ -0,0 +1,394 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#include "lwes_event_template.h"
+#include "lwes_hash.h"
+#include "lwes_marshall_functions.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*************************************************************************
+  PRIVATE API prototypes, shouldn't be called by a user of the library.
+ *************************************************************************/
+static int
+lwes_event_template_set_fixed
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_TYPE type,
+   void *value);
+
+static void
+lwes_event_template_get_name
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_CHAR name[SHORT_STRING_MAX+1]);
+
+/*************************************************************************
+  PUBLIC API
+ *************************************************************************/
+struct lwes_event_template *
+lwes_event_template_create
+  (struct lwes_event *event)
+{
+  struct lwes_event_template *tmpl;
+
+  if (event == NULL)
+    {
+      return NULL;
+    }
+
+  tmpl = (struct lwes_event_template *)
+    malloc (sizeof (struct lwes_event_template));
+  if (tmpl == NULL)
+    {
+      return NULL;
+    }
+
+  tmpl->event      = event;
+  tmpl->bytes      = NULL;
+  tmpl->length     = 0;
+  tmpl->bytes_size = 0;
+  tmpl->encodes    = 0;
+
+  if (lwes_event_template_update (tmpl) < 0)
+    {
+      lwes_event_template_destroy (tmpl);
+      return NULL;
+    }
+
+  return tmpl;
+}
+
+int
+lwes_event_template_update
+  (struct lwes_event_template *tmpl)
+{
+  LWES_CHAR name[SHORT_STRING_MAX+1];
+  LWES_BYTE_P bytes;
+  size_t size;
+  int ret;
+  int i;
+
+  if (tmpl == NULL)
+    {
+      return -1;
+    }
+
+  /* nothing is usable until the event is serialized again */
+  tmpl->length = 0;
+  tmpl->view.number_of_attributes = 0;
+
+  size = lwes_event_serialized_size (tmpl->event);
+  if (size > tmpl->bytes_size)
+    {
+      bytes = (LWES_BYTE_P) realloc (tmpl->bytes, size);
+      if (bytes == NULL)
+        {
+          return -3;
+        }
+      tmpl->bytes      = bytes;
+      tmpl->bytes_size = size;
+    }
+
+  ret = lwes_event_to_bytes (tmpl->event, tmpl->bytes, tmpl->bytes_size, 0);
+  if (ret < 0)
+    {
+      return -2;
+    }
+  tmpl->encodes++;
+
+  if (lwes_event_view_from_bytes (&(tmpl->view), tmpl->bytes,
+                                  (size_t) ret, 0) < 0)
+    {
+      tmpl->view.number_of_attributes = 0;
+      return -2;
+    }
+  tmpl->length = (size_t) ret;
+
+  for (i = 0; i < tmpl->view.number_of_attributes; ++i)
+    {
+      lwes_event_template_get_name (tmpl, i, name);
+      tmpl->attributes[i] = (struct lwes_event_attribute *)
+        lwes_hash_get (tmpl->event->attributes, name);
+    }
+
+  return 0;
+}
+
+int
+lwes_event_template_get_index
+  (struct lwes_event_template *tmpl,
+   LWES_CONST_SHORT_STRING name)
+{
+  const struct lwes_event_view_attribute *attr;
+
+  if (tmpl == NULL || name == NULL || tmpl->length == 0)
+    {
+      return -1;
+    }
+
+  attr = lwes_event_view_get_attribute (&(tmpl->view), name);
+  if (attr == NULL)
+    {
+      return -1;
+    }
+  return (int) (attr - tmpl->view.attributes);
+}
+
+int
+lwes_event_template_set_U_INT_16
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_U_INT_16 value)
+{
+  return lwes_event_template_set_fixed (tmpl, index,
+                                        LWES_TYPE_U_INT_16, &value);
+}
+
+int
+lwes_event_template_set_INT_16
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_INT_16 value)
+{
+  return lwes_event_template_set_fixed (tmpl, index,
+                                        LWES_TYPE_INT_16, &value);
+}
+
+int
+lwes_event_template_set_U_INT_32
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_U_INT_32 value)
+{
+  return lwes_event_template_set_fixed (tmpl, index,
+                                        LWES_TYPE_U_INT_32, &value);
+}
+
+int
+lwes_event_template_set_INT_32
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_INT_32 value)
+{
+  return lwes_event_template_set_fixed (tmpl, index,
+                                        LWES_TYPE_INT_32, &value);
+}
+
+int
+lwes_event_template_set_U_INT_64
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_U_INT_64 value)
+{
+  return lwes_event_template_set_fixed (tmpl, index,
+                                        LWES_TYPE_U_INT_64, &value);
+}
+
+int
+lwes_event_template_set_INT_64
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_INT_64 value)
+{
+  return lwes_event_template_set_fixed (tmpl, index,
+                                        LWES_TYPE_INT_64, &value);
+}
+
+int
+lwes_event_template_set_BOOLEAN
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_BOOLEAN value)
+{
+  return lwes_event_template_set_fixed (tmpl, index,
+                                        LWES_TYPE_BOOLEAN, &value);
+}
+
+int
+lwes_event_template_set_IP_ADDR
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_IP_ADDR value)
+{
+  return lwes_event_template_set_fixed (tmpl, index,
+                                        LWES_TYPE_IP_ADDR, &value);
+}
+
+int
+lwes_event_template_set_BYTE
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_BYTE value)
+{
+  return lwes_event_template_set_fixed (tmpl, index,
+                                        LWES_TYPE_BYTE, &value);
+}
+
+int
+lwes_event_template_set_FLOAT
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_FLOAT value)
+{
+  return lwes_event_template_set_fixed (tmpl, index,
+                                        LWES_TYPE_FLOAT, &value);
+}
+
+int
+lwes_event_template_set_DOUBLE
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_DOUBLE value)
+{
+  return lwes_event_template_set_fixed (tmpl, index,
+                                        LWES_TYPE_DOUBLE, &value);
+}
+
+int
+lwes_event_template_set_STRING
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_CONST_LONG_STRING value)
+{
+  LWES_CHAR name[SHORT_STRING_MAX+1];
+  struct lwes_event_view_attribute *attr;
+  size_t length;
+  int ret;
+
+  if (   tmpl == NULL
+      || value == NULL
+      || index < 0
+      || index >= tmpl->view.number_of_attributes)
+    {
+      return -1;
+    }
+
+  attr = &(tmpl->view.attributes[index]);
+  if (attr->type != LWES_TYPE_STRING)
+    {
+      return -2;
+    }
+
+  lwes_event_template_get_name (tmpl, index, name);
+  ret = lwes_event_set_STRING (tmpl->event, name, value);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* another length moves every attribute after this one */
+  length = strlen (value);
+  if (length + 2 != attr->length)
+    {
+      return lwes_event_template_update (tmpl);
+    }
+
+  /* the event may have stored the string somewhere new */
+  tmpl->attributes[index] = (struct lwes_event_attribute *)
+    lwes_hash_get (tmpl->event->attributes, name);
+  memcpy (tmpl->bytes + attr->offset + 2, value, length);
+
+  return 0;
+}
+
+int
+lwes_event_template_to_bytes
+  (struct lwes_event_template *tmpl,
+   LWES_BYTE_P bytes,
+   size_t num_bytes,
+   size_t offset)
+{
+  if (   tmpl == NULL
+      || bytes == NULL
+      || num_bytes == 0
+      || offset >= num_bytes
+      || tmpl->length == 0)
+    {
+      return -1;
+    }
+
+  if (num_bytes - offset < tmpl->length)
+    {
+      return -21;
+    }
+  memcpy (bytes + offset, tmpl->bytes, tmpl->length);
+
+  return (int) tmpl->length;
+}
+
+int
+lwes_event_template_destroy
+  (struct lwes_event_template *tmpl)
+{
+  if (tmpl == NULL)
+    {
+      return 0;
+    }
+
+  if (tmpl->bytes != NULL)
+    {
+      free (tmpl->bytes);
+    }
+  free (tmpl);
+
+  return 0;
+}
+
+/*************************************************************************
+  PRIVATE API
+ *************************************************************************/
+
+/* copies the value into the event, and marshalls it over the old one */
+static int
+lwes_event_template_set_fixed
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_TYPE type,
+   void *value)
+{
+  struct lwes_event_view_attribute *attr;
+  size_t offset;
+
+  if (   tmpl == NULL
+      || index < 0
+      || index >= tmpl->view.number_of_attributes)
+    {
+      return -1;
+    }
+
+  attr = &(tmpl->view.attributes[index]);
+  if (attr->type != type)
+    {
+      return -2;
+    }
+
+  memcpy (tmpl->attributes[index]->value, value, lwes_type_to_size (type));
+  offset = attr->offset;
+  marshall_generic (type, value, tmpl->bytes, offset + attr->length, &offset);
+
+  return 0;
+}
+
+/* the name of an attribute, null terminated to look it up in the event */
+static void
+lwes_event_template_get_name
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_CHAR name[SHORT_STRING_MAX+1])
+{
+  struct lwes_event_view_attribute *attr = &(tmpl->view.attributes[index]);
+
+  memcpy (name, attr->name, attr->name_length);
+  name[attr->name_length] = '\0';
+}
@@ -0,0 +1,274 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#ifndef __LWES_EVENT_TEMPLATE_H
+#define __LWES_EVENT_TEMPLATE_H
+
+#include "lwes_types.h"
+#include "lwes_event.h"
+#include "lwes_event_view.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! \file lwes_event_template.h
+ *  \brief Functions for emitting an event repeatedly with few changes
+ *
+ *  A template keeps an event serialized along with where each attribute
+ *  is in the serialized form.  Setting a fixed width attribute through
+ *  the template patches its bytes in place, as does setting a string to
+ *  one of the same length, so emitting the event again is a copy rather
+ *  than a walk over all its attributes.  Only a string of another length
+ *  makes the template serialize the event again.
+ *
+ *  The template keeps the event in step with every change, but the event
+ *  remains the caller's.  If the event is changed other than through the
+ *  template, lwes_event_template_update must be called before the
+ *  template is used again.
+ */
+
+/*! \struct lwes_event_template lwes_event_template.h
+ *  \brief A serialized event whose attributes can be updated in place
+ */
+struct lwes_event_template
+{
+  /*! The event, owned by the caller */
+  struct lwes_event *          event;
+  /*! The serialized event */
+  LWES_BYTE_P                  bytes;
+  /*! Number of bytes in the serialized event */
+  size_t                       length;
+  /*! Number of bytes allocated for bytes */
+  size_t                       bytes_size;
+  /*! Number of times the event has been serialized */
+  LWES_U_INT_64                encodes;
+  /*! Where each attribute is in bytes, its index is the attribute's */
+  struct lwes_event_view       view;
+  /*! The attribute of the event behind each attribute of the view */
+  struct lwes_event_attribute *attributes[LWES_EVENT_VIEW_MAX_ATTRIBUTES];
+};
+
+/*! \brief Create a template for an event
+ *
+ *  \param[in] event the event, which must outlive the template
+ *
+ *  \see lwes_event_template_destroy
+ *
+ *  \return the newly created template, NULL if the event could not be
+ *          serialized, has more than LWES_EVENT_VIEW_MAX_ATTRIBUTES
+ *          attributes, or there is no memory
+ */
+struct lwes_event_template *
+lwes_event_template_create
+  (struct lwes_event *event);
+
+/*! \brief Serialize the event of a template again
+ *
+ *  Needed after the event is changed other than through the template,
+ *  which may also change the indexes of its attributes.
+ *
+ *  \param[in] tmpl the template to update
+ *
+ *  \return 0 on success, -1 on bad arguments, -2 if the event could not
+ *          be serialized or has too many attributes, -3 if there is no
+ *          memory
+ */
+int
+lwes_event_template_update
+  (struct lwes_event_template *tmpl);
+
+/*! \brief Get the index of an attribute of the template
+ *
+ *  Indexes stay valid until attributes are added to or removed from the
+ *  event.
+ *
+ *  \param[in] tmpl the template
+ *  \param[in] name the name of the attribute
+ *
+ *  \return the index of the attribute, -1 if there is no such attribute
+ */
+int
+lwes_event_template_get_index
+  (struct lwes_event_template *tmpl,
+   LWES_CONST_SHORT_STRING name);
+
+/*! \brief Set an LWES_U_INT_16 attribute, in place
+ *
+ *  The attribute must already be in the event with the same type.
+ *
+ *  \param[in] tmpl the template
+ *  \param[in] index the index of the attribute
+ *  \param[in] value the new value of the attribute
+ *
+ *  \return 0 on success, -1 on bad arguments or an index out of range,
+ *          -2 if the attribute has another type
+ */
+int
+lwes_event_template_set_U_INT_16
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_U_INT_16 value);
+
+/*! \brief Set an LWES_INT_16 attribute, in place
+ *
+ *  \see lwes_event_template_set_U_INT_16
+ */
+int
+lwes_event_template_set_INT_16
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_INT_16 value);
+
+/*! \brief Set an LWES_U_INT_32 attribute, in place
+ *
+ *  \see lwes_event_template_set_U_INT_16
+ */
+int
+lwes_event_template_set_U_INT_32
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_U_INT_32 value);
+
+/*! \brief Set an LWES_INT_32 attribute, in place
+ *
+ *  \see lwes_event_template_set_U_INT_16
+ */
+int
+lwes_event_template_set_INT_32
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_INT_32 value);
+
+/*! \brief Set an LWES_U_INT_64 attribute, in place
+ *
+ *  \see lwes_event_template_set_U_INT_16
+ */
+int
+lwes_event_template_set_U_INT_64
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_U_INT_64 value);
+
+/*! \brief Set an LWES_INT_64 attribute, in place
+ *
+ *  \see lwes_event_template_set_U_INT_16
+ */
+int
+lwes_event_template_set_INT_64
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_INT_64 value);
+
+/*! \brief Set an LWES_BOOLEAN attribute, in place
+ *
+ *  \see lwes_event_template_set_U_INT_16
+ */
+int
+lwes_event_template_set_BOOLEAN
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_BOOLEAN value);
+
+/*! \brief Set an LWES_IP_ADDR attribute, in place
+ *
+ *  \see lwes_event_template_set_U_INT_16
+ */
+int
+lwes_event_template_set_IP_ADDR
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_IP_ADDR value);
+
+/*! \brief Set an LWES_BYTE attribute, in place
+ *
+ *  \see lwes_event_template_set_U_INT_16
+ */
+int
+lwes_event_template_set_BYTE
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_BYTE value);
+
+/*! \brief Set an LWES_FLOAT attribute, in place
+ *
+ *  \see lwes_event_template_set_U_INT_16
+ */
+int
+lwes_event_template_set_FLOAT
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_FLOAT value);
+
+/*! \brief Set an LWES_DOUBLE attribute, in place
+ *
+ *  \see lwes_event_template_set_U_INT_16
+ */
+int
+lwes_event_template_set_DOUBLE
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_DOUBLE value);
+
+/*! \brief Set a string attribute
+ *
+ *  A string of the same length as the current one is patched in place,
+ *  any other makes the template serialize the event again.
+ *
+ *  \param[in] tmpl the template
+ *  \param[in] index the index of the attribute
+ *  \param[in] value the new value of the attribute
+ *
+ *  \return 0 on success, -1 on bad arguments or an index out of range,
+ *          -2 if the attribute has another type, -3 if there is no
+ *          memory, or a negative number from lwes_event_set_STRING
+ */
+int
+lwes_event_template_set_STRING
+  (struct lwes_event_template *tmpl,
+   int index,
+   LWES_CONST_LONG_STRING value);
+
+/*! \brief Copy the serialized event of a template into a byte array
+ *
+ *  \param[in] tmpl the template
+ *  \param[in] bytes the byte array to copy into
+ *  \param[in] num_bytes the size of the byte array
+ *  \param[in] offset the offset into the array to start copying at
+ *
+ *  \return the number of bytes copied on success, -1 on bad arguments,
+ *          -21 if the event does not fit in num_bytes - offset
+ */
+int
+lwes_event_template_to_bytes
+  (struct lwes_event_template *tmpl,
+   LWES_BYTE_P bytes,
+   size_t num_bytes,
+   size_t offset);
+
+/*! \brief Destroy a template, but not its event
+ *
+ *  \param[in] tmpl the template to destroy
+ *
+ *  \return 0 on success, a negative number on failure
+ */
+int
+lwes_event_template_destroy
+  (struct lwes_event_template *tmpl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LWES_EVENT_TEMPLATE_H */
@@ -13,12 +13,70 @@
 #include "lwes_event_type_db.h"
 #include "lwes_esf_parser.h"
 #include "lwes_hash.h"
+#include "lwes_perfect_hash.h"
 
 const LWES_U_INT_32 ATTRIBUTE_OPTIONAL =     0 ;
 const LWES_U_INT_32 ATTRIBUTE_REQUIRED = (1<<0);
 const LWES_U_INT_32 ATTRIBUTE_ARRAYED  = (1<<1);
 const LWES_U_INT_32 ATTRIBUTE_NULLABLE = (1<<2);
 
+/* an (event, attribute) pair in the index, attr_name is NULL in the entry
+   which only says that the event exists, event_name is NULL in empty slots.
+   Both names are the interned ones, and attr_hash is lwes_hash of attr_name
+   so events can use the name without hashing it again.  position is where
+   the attribute is declared in the event, followed by the meta attributes
+   the event does not declare itself */
+struct lwes_event_type_db_entry
+{
+  LWES_CONST_SHORT_STRING                     event_name;
+  LWES_CONST_SHORT_STRING                     attr_name;
+  unsigned int                                attr_hash;
+  int                                         position;
+  const struct lwes_event_field_db_attribute *attr;
+};
+
+/* a perfect hash of the entries, each kept in its slot */
+struct lwes_event_type_db_index
+{
+  struct lwes_perfect_hash        *hash;
+  struct lwes_event_type_db_entry *slots;
+  /* every event and attribute name once, each keyed and valued by the
+     one copy of it the db hands out */
+  struct lwes_hash                *names;
+};
+
+/*************************************************************************
+  PRIVATE API prototypes, shouldn't be called by a user of the library.
+ *************************************************************************/
+
+static const struct lwes_event_type_db_entry *
+lwes_event_type_db_index_find
+  (const struct lwes_event_type_db_index *index,
+   LWES_CONST_SHORT_STRING event_name,
+   LWES_CONST_SHORT_STRING attr_name);
+
+static int
+lwes_event_type_db_index_build
+  (struct lwes_event_type_db_index *index,
+   const struct lwes_event_type_db_entry *keys,
+   LWES_U_INT_32 number_of_keys);
+
+static LWES_SHORT_STRING
+lwes_event_type_db_intern_name
+  (struct lwes_hash *names,
+   LWES_SHORT_STRING name);
+
+static void
+lwes_event_type_db_forget_names
+  (struct lwes_hash *names);
+
+static void
+lwes_event_type_db_thaw
+  (struct lwes_event_type_db *db);
+
+/*************************************************************************
+  PUBLIC API
+ *************************************************************************/
 
 struct lwes_event_type_db *
 lwes_event_type_db_create
@@ -31,6 +89,8 @@ lwes_event_type_db_create
     {
       db->esf_filename[0] = '\0';
       strncat (db->esf_filename, filename, FILENAME_MAX - 1);
+      db->index = NULL;
+      db->share_names = FALSE;
 
       db->events = lwes_hash_create ();
       if (db->events != NULL)
@@ -40,6 +100,11 @@ lwes_event_type_db_create
               lwes_event_type_db_destroy(db);
               db = NULL;
             }
+          else
+            {
+              /* an unfrozen db still works, only its lookups are slower */
+              lwes_event_type_db_freeze (db);
+            }
         }
       else
         {
@@ -51,6 +116,48 @@ lwes_event_type_db_create
   return db;
 }
 
+struct lwes_event_type_db *
+lwes_event_type_db_create_from_buffer
+  (const char *buffer,
+   size_t length)
+{
+  struct lwes_event_type_db *db = NULL;
+
+  if (buffer == NULL)
+    {
+      return NULL;
+    }
+
+  db = (struct lwes_event_type_db *)
+         malloc (sizeof (struct lwes_event_type_db));
+  if (db != NULL)
+    {
+      db->esf_filename[0] = '\0';
+      db->index = NULL;
+      db->share_names = FALSE;
+
+      db->events = lwes_hash_create ();
+      if (db->events != NULL)
+        {
+          if (lwes_parse_esf_buffer (db, buffer, length) != 0)
+            {
+              lwes_event_type_db_destroy(db);
+              db = NULL;
+            }
+          else
+            {
+              lwes_event_type_db_freeze (db);
+            }
+        }
+      else
+        {
+          free (db);
+          db = NULL;
+        }
+    }
+
+  return db;
+}
 
 int
 lwes_event_type_db_destroy
@@ -64,6 +171,8 @@ lwes_event_type_db_destroy
   LWES_BYTE        *attrType  = NULL;
   if (db != NULL)
     {
+      lwes_event_type_db_thaw (db);
+
       /* clear out the hash */
       if (lwes_hash_keys (db->events, &e))
         {
@@ -97,8 +206,6 @@ lwes_event_type_db_destroy
       free (db);
     }
 
-  lwes_parse_esf_destroy ();
-
   return 0;
 }
 
@@ -109,8 +216,12 @@ lwes_event_type_db_add_event
 {
   void *ret = NULL;
   struct lwes_hash *eventHash = NULL;
+  LWES_SHORT_STRING eventHashKey = NULL;
+
+  lwes_event_type_db_thaw (db);
+
   /* try and allocate the key */
-  LWES_SHORT_STRING eventHashKey =
+  eventHashKey =
     (LWES_SHORT_STRING)malloc (sizeof (LWES_CHAR)*(strlen (event_name)+1));
   if (eventHashKey == NULL)
     {
@@ -153,6 +264,8 @@ lwes_event_type_db_add_attribute_ex
   LWES_SHORT_STRING tmpAttrName = NULL;
   struct lwes_event_field_db_attribute *tmpAttrRec = NULL;
 
+  lwes_event_type_db_thaw (db);
+
   tmpAttrName =
       (LWES_SHORT_STRING)malloc (sizeof (LWES_CHAR)*(strlen (attr_name)+1));
   if (tmpAttrName == NULL)
@@ -213,6 +326,11 @@ lwes_event_type_db_check_for_event
   (struct lwes_event_type_db *db,
    LWES_SHORT_STRING event_name)
 {
+  if (db->index != NULL)
+    {
+      return (lwes_event_type_db_index_find (db->index, event_name, NULL)
+              != NULL);
+    }
   return lwes_hash_contains_key (db->events, event_name);
 }
 
@@ -222,12 +340,68 @@ lwes_event_type_db_lookup_attr
    LWES_CONST_SHORT_STRING attr_name,
    LWES_CONST_SHORT_STRING event_name)
 {
-  struct lwes_hash *event =
-    (struct lwes_hash *)lwes_hash_get (db->events, event_name);
-  struct lwes_hash *meta_event =
-    (struct lwes_hash *)lwes_hash_get (db->events, LWES_META_INFO_STRING);
+  return lwes_event_type_db_lookup_interned_attr (db, attr_name, event_name,
+                                                  NULL, NULL, NULL);
+}
+
+const struct lwes_event_field_db_attribute*
+lwes_event_type_db_lookup_interned_attr
+  (struct lwes_event_type_db *db,
+   LWES_CONST_SHORT_STRING attr_name,
+   LWES_CONST_SHORT_STRING event_name,
+   LWES_CONST_SHORT_STRING *interned_name,
+   unsigned int *name_hash,
+   int *position)
+{
+  struct lwes_hash *event = NULL;
+  struct lwes_hash *meta_event = NULL;
   struct lwes_event_field_db_attribute *tmp_rec = NULL;
+  const struct lwes_event_type_db_entry *entry = NULL;
+
+  if (interned_name != NULL)
+    {
+      *interned_name = NULL;
+    }
+  if (position != NULL)
+    {
+      *position = -1;
+    }
+
+  if (db->index != NULL)
+    {
+      /* the meta attributes are already part of every event in the index,
+         only events which are not in the db fall back to the meta event */
+      entry = lwes_event_type_db_index_find (db->index, event_name, attr_name);
+      if (entry == NULL
+          && lwes_event_type_db_index_find (db->index, event_name, NULL)
+               == NULL)
+        {
+          entry = lwes_event_type_db_index_find (db->index,
+                                                 LWES_META_INFO_STRING,
+                                                 attr_name);
+        }
+      if (entry == NULL)
+        {
+          return NULL;
+        }
+      if (interned_name != NULL && db->share_names)
+        {
+          *interned_name = entry->attr_name;
+        }
+      if (name_hash != NULL)
+        {
+          *name_hash = entry->attr_hash;
+        }
+      if (position != NULL)
+        {
+          *position = entry->position;
+        }
+      return entry->attr;
+    }
 
+  event = (struct lwes_hash *)lwes_hash_get (db->events, event_name);
+  meta_event =
+    (struct lwes_hash *)lwes_hash_get (db->events, LWES_META_INFO_STRING);
   if (event != NULL)
   {
     tmp_rec = (struct lwes_event_field_db_attribute *)
@@ -265,3 +439,317 @@ lwes_event_type_db_check_for_type
 
   return ((NULL != attrRec) && (attrRec->type == type_value));
 }
+
+LWES_CONST_SHORT_STRING
+lwes_event_type_db_intern
+  (struct lwes_event_type_db *db,
+   LWES_CONST_SHORT_STRING name)
+{
+  if (db == NULL || name == NULL || db->index == NULL || ! db->share_names)
+    {
+      return NULL;
+    }
+  return (LWES_CONST_SHORT_STRING) lwes_hash_get (db->index->names, name);
+}
+
+int
+lwes_event_type_db_share_names
+  (struct lwes_event_type_db *db)
+{
+  if (db == NULL)
+    {
+      return -1;
+    }
+  db->share_names = TRUE;
+  return 0;
+}
+
+int
+lwes_event_type_db_freeze
+  (struct lwes_event_type_db *db)
+{
+  struct lwes_hash_enumeration e;
+  struct lwes_hash_enumeration e2;
+  struct lwes_hash *meta_event = NULL;
+  struct lwes_hash *attrHash = NULL;
+  struct lwes_event_type_db_index *index = NULL;
+  struct lwes_event_type_db_entry *keys = NULL;
+  LWES_SHORT_STRING eventName = NULL;
+  LWES_SHORT_STRING attrName = NULL;
+  LWES_U_INT_32 number_of_keys = 0;
+  LWES_U_INT_32 first = 0;
+  LWES_U_INT_32 i = 0;
+  int ret = 0;
+
+  if (db == NULL)
+    {
+      return -1;
+    }
+  if (db->index != NULL)
+    {
+      return 0;
+    }
+
+  meta_event =
+    (struct lwes_hash *)lwes_hash_get (db->events, LWES_META_INFO_STRING);
+
+  /* one key for each event, one for each of its attributes and one for
+     each meta attribute it does not have itself */
+  number_of_keys = lwes_hash_size (db->events);
+  if (lwes_hash_keys (db->events, &e))
+    {
+      while (lwes_hash_enumeration_has_more_elements (&e))
+        {
+          eventName = lwes_hash_enumeration_next_element (&e);
+          attrHash = (struct lwes_hash *)lwes_hash_get (db->events, eventName);
+          number_of_keys += lwes_hash_size (attrHash);
+          if (meta_event != NULL && attrHash != meta_event)
+            {
+              number_of_keys += lwes_hash_size (meta_event);
+            }
+        }
+    }
+
+  keys = (struct lwes_event_type_db_entry *)
+    malloc (sizeof (struct lwes_event_type_db_entry) * (number_of_keys + 1));
+  index = (struct lwes_event_type_db_index *)
+    malloc (sizeof (struct lwes_event_type_db_index));
+  if (keys == NULL || index == NULL)
+    {
+      free (keys);
+      free (index);
+      return -3;
+    }
+  index->names = lwes_hash_create ();
+  if (index->names == NULL)
+    {
+      free (keys);
+      free (index);
+      return -3;
+    }
+
+  if (lwes_hash_keys (db->events, &e))
+    {
+      while (lwes_hash_enumeration_has_more_elements (&e))
+        {
+          eventName = lwes_hash_enumeration_next_element (&e);
+          attrHash = (struct lwes_hash *)lwes_hash_get (db->events, eventName);
+
+          first = i;
+          keys[i].event_name = lwes_event_type_db_intern_name (index->names,
+                                                               eventName);
+          keys[i].attr_name  = NULL;
+          keys[i].attr_hash  = 0;
+          keys[i].position   = -1;
+          keys[i].attr       = NULL;
+          i++;
+          if (lwes_hash_keys (attrHash, &e2))
+            {
+              while (lwes_hash_enumeration_has_more_elements (&e2))
+                {
+                  attrName = lwes_hash_enumeration_next_element (&e2);
+                  keys[i].event_name = keys[first].event_name;
+                  keys[i].attr_name  =
+                    lwes_event_type_db_intern_name (index->names, attrName);
+                  keys[i].attr_hash  = lwes_hash (attrName);
+                  keys[i].position   = (int) (i - first - 1);
+                  keys[i].attr = (const struct lwes_event_field_db_attribute *)
+                    lwes_hash_get (attrHash, attrName);
+                  i++;
+                }
+            }
+          if (meta_event != NULL && attrHash != meta_event
+              && lwes_hash_keys (meta_event, &e2))
+            {
+              while (lwes_hash_enumeration_has_more_elements (&e2))
+                {
+                  attrName = lwes_hash_enumeration_next_element (&e2);
+                  if (lwes_hash_contains_key (attrHash, attrName))
+                    {
+                      continue;
+                    }
+                  keys[i].event_name = keys[first].event_name;
+                  keys[i].attr_name  =
+                    lwes_event_type_db_intern_name (index->names, attrName);
+                  keys[i].attr_hash  = lwes_hash (attrName);
+                  keys[i].position   = (int) (i - first - 1);
+                  keys[i].attr = (const struct lwes_event_field_db_attribute *)
+                    lwes_hash_get (meta_event, attrName);
+                  i++;
+                }
+            }
+        }
+    }
+
+  /* a name which could not be interned is NULL, which the index would
+     take for an empty slot */
+  while (ret == 0 && first < i)
+    {
+      if (keys[first].event_name == NULL
+          || (keys[first].attr_name == NULL && keys[first].attr != NULL))
+        {
+          ret = -3;
+        }
+      first++;
+    }
+  if (ret == 0)
+    {
+      ret = lwes_event_type_db_index_build (index, keys, i);
+    }
+  free (keys);
+  if (ret < 0)
+    {
+      lwes_event_type_db_forget_names (index->names);
+      free (index);
+      return ret;
+    }
+
+  db->index = index;
+  return 0;
+}
+
+int
+lwes_event_type_db_is_frozen
+  (struct lwes_event_type_db *db)
+{
+  return (db != NULL && db->index != NULL);
+}
+
+/*************************************************************************
+  PRIVATE API
+ *************************************************************************/
+
+static const struct lwes_event_type_db_entry *
+lwes_event_type_db_index_find
+  (const struct lwes_event_type_db_index *index,
+   LWES_CONST_SHORT_STRING event_name,
+   LWES_CONST_SHORT_STRING attr_name)
+{
+  const struct lwes_event_type_db_entry *entry;
+
+  if (event_name == NULL)
+    {
+      return NULL;
+    }
+
+  entry = &(index->slots[lwes_perfect_hash_slot (index->hash,
+                                                 event_name, attr_name)]);
+  if (entry->event_name == NULL
+      || strcmp (entry->event_name, event_name) != 0)
+    {
+      return NULL;
+    }
+  if (attr_name == NULL || entry->attr_name == NULL)
+    {
+      return (attr_name == entry->attr_name ? entry : NULL);
+    }
+  return (strcmp (entry->attr_name, attr_name) == 0 ? entry : NULL);
+}
+
+/* hashes the keys and puts each in its slot */
+static int
+lwes_event_type_db_index_build
+  (struct lwes_event_type_db_index *index,
+   const struct lwes_event_type_db_entry *keys,
+   LWES_U_INT_32 number_of_keys)
+{
+  struct lwes_perfect_hash_key *hash_keys;
+  LWES_U_INT_32 *slots;
+  LWES_U_INT_32 i;
+
+  hash_keys = (struct lwes_perfect_hash_key *)
+    malloc (sizeof (struct lwes_perfect_hash_key) * (number_of_keys + 1));
+  slots = (LWES_U_INT_32 *) malloc (sizeof (LWES_U_INT_32)
+                                    * (number_of_keys + 1));
+  index->hash = NULL;
+  index->slots = NULL;
+  if (hash_keys != NULL && slots != NULL)
+    {
+      for (i = 0; i < number_of_keys; i++)
+        {
+          hash_keys[i].event_name = keys[i].event_name;
+          hash_keys[i].attr_name  = keys[i].attr_name;
+        }
+      index->hash = lwes_perfect_hash_create (hash_keys, number_of_keys,
+                                              slots);
+    }
+  if (index->hash != NULL)
+    {
+      index->slots = (struct lwes_event_type_db_entry *)
+        calloc ((size_t) index->hash->mask + 1,
+                sizeof (struct lwes_event_type_db_entry));
+    }
+  if (index->slots != NULL)
+    {
+      for (i = 0; i < number_of_keys; i++)
+        {
+          index->slots[slots[i]] = keys[i];
+        }
+    }
+
+  free (hash_keys);
+  free (slots);
+  if (index->slots == NULL)
+    {
+      lwes_perfect_hash_destroy (index->hash);
+      return -3;
+    }
+  return 0;
+}
+
+/* the one copy of a name, which is the db's own copy the first time it is
+   seen, or NULL if it could not be remembered */
+static LWES_SHORT_STRING
+lwes_event_type_db_intern_name
+  (struct lwes_hash *names,
+   LWES_SHORT_STRING name)
+{
+  LWES_SHORT_STRING interned;
+  unsigned int hash_value = lwes_hash (name);
+
+  interned = (LWES_SHORT_STRING) lwes_hash_get (names, name);
+  if (interned == NULL)
+    {
+      if (lwes_hash_put_with_hash (names, name, hash_value, name) != NULL)
+        {
+          return NULL;
+        }
+      interned = name;
+    }
+  return interned;
+}
+
+/* the names belong to the db's hashes, so they are removed rather than
+   freed before the hash of them is destroyed */
+static void
+lwes_event_type_db_forget_names
+  (struct lwes_hash *names)
+{
+  struct lwes_hash_enumeration e;
+  LWES_SHORT_STRING name;
+
+  if (lwes_hash_keys (names, &e))
+    {
+      while (lwes_hash_enumeration_has_more_elements (&e))
+        {
+          name = lwes_hash_enumeration_next_element (&e);
+          lwes_hash_remove (names, name);
+        }
+    }
+  lwes_hash_destroy (names);
+}
+
+/* drops the index, before the db is changed or destroyed */
+static void
+lwes_event_type_db_thaw
+  (struct lwes_event_type_db *db)
+{
+  if (db->index != NULL)
+    {
+      lwes_event_type_db_forget_names (db->index->names);
+      lwes_perfect_hash_destroy (db->index->hash);
+      free (db->index->slots);
+      free (db->index);
+      db->index = NULL;
+    }
+}
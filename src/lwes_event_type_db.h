@@ -64,6 +64,9 @@ struct lwes_event_field_db_attribute
   LWES_BYTE type;
 };
 
+/* perfect hash index over the (event, attribute) pairs of a frozen db */
+struct lwes_event_type_db_index;
+
 /*! \struct lwes_event_type_db lwes_event_type_db.h
  *  \brief The data base itself
  */
@@ -74,6 +77,11 @@ struct lwes_event_type_db
   /*! holds a hash of event descriptions by the event name
       for events which are described in the esf file */
   struct lwes_hash *events;
+  /*! read only index of events, NULL unless the db is frozen */
+  struct lwes_event_type_db_index *index;
+  /*! whether events created against the db share its copies of names,
+      set with lwes_event_type_db_share_names */
+  LWES_BOOLEAN share_names;
 };
 
 /*! \brief Creates the memory for the event_type_db.
@@ -90,6 +98,75 @@ struct lwes_event_type_db *
 lwes_event_type_db_create
   (const char *filename);
 
+/*! \brief Creates the memory for the event_type_db from an esf in memory.
+ *
+ *  Parses the esf description from the buffer instead of a file, the
+ *  buffer is only read and need not be NUL terminated.  Like
+ *  lwes_event_type_db_create this may be called from several threads at
+ *  once, as each parse has its own scanner.
+ *
+ *  \param[in] buffer the esf description
+ *  \param[in] length the number of bytes in the buffer
+ *
+ *  \see lwes_event_type_db_destroy
+ *
+ *  \return the newly created db on success, NULL on failure
+ */
+struct lwes_event_type_db *
+lwes_event_type_db_create_from_buffer
+  (const char *buffer,
+   size_t length);
+
+/*! \brief Build the lookup index of the event_type_db.
+ *
+ *  Builds a perfect hash over every (event, attribute) pair of the db,
+ *  with the MetaEventInfo attributes folded into each event, so that
+ *  lwes_event_type_db_lookup_attr and the check functions find anything
+ *  in a single probe.  The index is never written to once built, so any
+ *  number of threads may look things up in a frozen db without locking.
+ *
+ *  lwes_event_type_db_create freezes the db after parsing the esf file.
+ *  Adding events or attributes to a frozen db drops the index, it may be
+ *  frozen again afterwards.  If freezing fails the db is still usable,
+ *  just not frozen.
+ *
+ *  \param[in] db the db to freeze
+ *
+ *  \return 0 on success, a negative number on failure
+ */
+int
+lwes_event_type_db_freeze
+  (struct lwes_event_type_db *db);
+
+/*! \brief Let events share the db's copies of event and attribute names.
+ *
+ *  By default every event copies its event and attribute names, so an
+ *  event may still be serialized or printed after its db is destroyed.
+ *  Once this is called, events created against a frozen db use the db's
+ *  one copy of each name it knows instead, which saves an allocation and
+ *  a copy per attribute, but such events must then not be used after the
+ *  db is destroyed (destroying them is still fine).
+ *
+ *  \param[in] db the db whose names events may share
+ *
+ *  \see lwes_event_type_db_intern
+ *
+ *  \return 0 on success, a negative number on failure
+ */
+int
+lwes_event_type_db_share_names
+  (struct lwes_event_type_db *db);
+
+/*! \brief Check whether the event_type_db is frozen.
+ *
+ *  \param[in] db the db to check
+ *
+ *  \return 1 if the db has a lookup index, 0 if it does not
+ */
+int
+lwes_event_type_db_is_frozen
+  (struct lwes_event_type_db *db);
+
 /*! \brief Cleanup the memory for the event_type_db.
  *
  *  This frees the memory created by lwes_event_type_db_create.
@@ -181,6 +258,59 @@ lwes_event_type_db_lookup_attr
    LWES_CONST_SHORT_STRING attr_name,
    LWES_CONST_SHORT_STRING event_name);
 
+/*! \brief Look up an attribute along with the db's copy of its name
+ *
+ *  Like lwes_event_type_db_lookup_attr, and for a frozen db also gives
+ *  where the attribute is declared in its event.  If the db shares its
+ *  names it gives the one copy of the attribute name which every lookup
+ *  of that name gets back, and the lwes_hash of it, so events built
+ *  against the db share their attribute names instead of each keeping a
+ *  copy.
+ *
+ *  \param[in] db the db to look in
+ *  \param[in] attr_name the attribute name to look for
+ *  \param[in] event_name the event name to look in
+ *  \param[out] interned_name if not NULL, set to the db's copy of the name,
+ *               or NULL if the db is not frozen, does not share its names
+ *               or has no such attribute
+ *  \param[out] name_hash if not NULL and the name was interned, set to
+ *               lwes_hash of the name
+ *  \param[out] position if not NULL, set to where the attribute is declared
+ *              in the event, counting from 0, with the meta attributes the
+ *              event does not declare itself following its own, whether
+ *              or not the db shares its names, or -1 if the db is not
+ *              frozen or has no such attribute
+ *
+ *  \return the attribute if it is in the event in the db,
+ *          NULL otherwise
+ */
+const struct lwes_event_field_db_attribute*
+lwes_event_type_db_lookup_interned_attr
+  (struct lwes_event_type_db *db,
+   LWES_CONST_SHORT_STRING attr_name,
+   LWES_CONST_SHORT_STRING event_name,
+   LWES_CONST_SHORT_STRING *interned_name,
+   unsigned int *name_hash,
+   int *position);
+
+/*! \brief The db's copy of an event or attribute name
+ *
+ *  A frozen db keeps each name it knows once, and hands it out once
+ *  lwes_event_type_db_share_names has been called.  The copy is valid for
+ *  as long as the db is, and is the same pointer for every caller, so
+ *  interned names may be compared by address.
+ *
+ *  \param[in] db the db to look in
+ *  \param[in] name the name to look for
+ *
+ *  \return the db's copy of the name, or NULL if the db is not frozen,
+ *          does not share its names or does not know the name
+ */
+LWES_CONST_SHORT_STRING
+lwes_event_type_db_intern
+  (struct lwes_event_type_db *db,
+   LWES_CONST_SHORT_STRING name);
+
 /*! \brief Check for an attribute in an event in the database
  *
  *  \param[in] db the db to check
@@ -0,0 +1,330 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#include "lwes_event_type_db_reloader.h"
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <sys/stat.h>
+#include <time.h>
+
+/*
+ * Retiring a db works like a minimal RCU.  A reader bumps the reader count
+ * of the current epoch's parity and then checks that the epoch did not
+ * move, so once a writer has flipped the epoch no new reader can count
+ * itself in the old parity.  The writer publishes the new db, flips the
+ * epoch and waits for the old parity's count to drain, after which no one
+ * can hold the old db.  All of these accesses are sequentially consistent,
+ * which is what makes the reader's check and the writer's wait agree.
+ * Reloads are serialized by the lock, so only one epoch is ever draining.
+ */
+
+/* how long a reload sleeps while waiting for readers of the old db */
+#define LWES_RELOADER_DRAIN_NSEC 100000
+
+/* the longest the watcher thread sleeps before checking running again */
+#define LWES_RELOADER_WAKE_MSEC 10
+
+/*************************************************************************
+  PRIVATE API prototypes, shouldn't be called by a user of the library.
+ *************************************************************************/
+static int
+lwes_event_type_db_reloader_update
+  (struct lwes_event_type_db_reloader *reloader,
+   int force);
+
+static void *
+lwes_event_type_db_reloader_watcher
+  (void *arg);
+
+static LWES_INT_64
+lwes_event_type_db_reloader_mtime_nsec
+  (const struct stat *st);
+
+/*************************************************************************
+  PUBLIC API
+ *************************************************************************/
+struct lwes_event_type_db_reloader *
+lwes_event_type_db_reloader_create
+  (const char *filename,
+   unsigned int poll_msec)
+{
+  struct lwes_event_type_db_reloader *reloader;
+  struct stat st;
+
+  if (filename == NULL || stat (filename, &st) != 0)
+    {
+      return NULL;
+    }
+
+  reloader = (struct lwes_event_type_db_reloader *)
+    malloc (sizeof (struct lwes_event_type_db_reloader));
+  if (reloader == NULL)
+    {
+      return NULL;
+    }
+
+  reloader->esf_filename[0] = '\0';
+  strncat (reloader->esf_filename, filename, FILENAME_MAX - 1);
+  reloader->db = lwes_event_type_db_create (reloader->esf_filename);
+  if (reloader->db == NULL)
+    {
+      free (reloader);
+      return NULL;
+    }
+  reloader->epoch = 0;
+  reloader->readers[0] = 0;
+  reloader->readers[1] = 0;
+  reloader->mtime = (LWES_INT_64) st.st_mtime;
+  reloader->mtime_nsec = lwes_event_type_db_reloader_mtime_nsec (&st);
+  reloader->size = (LWES_INT_64) st.st_size;
+  reloader->inode = (LWES_INT_64) st.st_ino;
+  reloader->reloads = 0;
+  reloader->failures = 0;
+  reloader->last_error = 0;
+  reloader->poll_msec = poll_msec;
+  reloader->running = 1;
+
+  if (pthread_mutex_init (&(reloader->lock), NULL) != 0)
+    {
+      lwes_event_type_db_destroy (reloader->db);
+      free (reloader);
+      return NULL;
+    }
+
+  if (poll_msec > 0
+      && pthread_create (&(reloader->thread), NULL,
+                         lwes_event_type_db_reloader_watcher,
+                         reloader) != 0)
+    {
+      pthread_mutex_destroy (&(reloader->lock));
+      lwes_event_type_db_destroy (reloader->db);
+      free (reloader);
+      return NULL;
+    }
+
+  return reloader;
+}
+
+struct lwes_event_type_db *
+lwes_event_type_db_reloader_acquire
+  (struct lwes_event_type_db_reloader *reloader,
+   int *token)
+{
+  unsigned int epoch;
+
+  do
+    {
+      epoch = __atomic_load_n (&(reloader->epoch), __ATOMIC_SEQ_CST);
+      __atomic_fetch_add (&(reloader->readers[epoch & 1]), 1,
+                          __ATOMIC_SEQ_CST);
+      if (__atomic_load_n (&(reloader->epoch), __ATOMIC_SEQ_CST) == epoch)
+        {
+          break;
+        }
+      /* a reload flipped the epoch under us, count in the new one */
+      __atomic_fetch_sub (&(reloader->readers[epoch & 1]), 1,
+                          __ATOMIC_SEQ_CST);
+    }
+  while (1);
+
+  *token = (int) (epoch & 1);
+  return __atomic_load_n (&(reloader->db), __ATOMIC_SEQ_CST);
+}
+
+void
+lwes_event_type_db_reloader_release
+  (struct lwes_event_type_db_reloader *reloader,
+   int token)
+{
+  __atomic_fetch_sub (&(reloader->readers[token & 1]), 1, __ATOMIC_SEQ_CST);
+}
+
+int
+lwes_event_type_db_reloader_check
+  (struct lwes_event_type_db_reloader *reloader)
+{
+  return lwes_event_type_db_reloader_update (reloader, 0);
+}
+
+int
+lwes_event_type_db_reloader_reload
+  (struct lwes_event_type_db_reloader *reloader)
+{
+  return lwes_event_type_db_reloader_update (reloader, 1);
+}
+
+LWES_U_INT_64
+lwes_event_type_db_reloader_get_reload_count
+  (struct lwes_event_type_db_reloader *reloader)
+{
+  return __atomic_load_n (&(reloader->reloads), __ATOMIC_RELAXED);
+}
+
+LWES_U_INT_64
+lwes_event_type_db_reloader_get_failure_count
+  (struct lwes_event_type_db_reloader *reloader)
+{
+  return __atomic_load_n (&(reloader->failures), __ATOMIC_RELAXED);
+}
+
+int
+lwes_event_type_db_reloader_get_last_error
+  (struct lwes_event_type_db_reloader *reloader)
+{
+  return __atomic_load_n (&(reloader->last_error), __ATOMIC_RELAXED);
+}
+
+int
+lwes_event_type_db_reloader_destroy
+  (struct lwes_event_type_db_reloader *reloader)
+{
+  int ret = 0;
+
+  if (reloader == NULL)
+    {
+      return 0;
+    }
+
+  if (reloader->poll_msec > 0)
+    {
+      __atomic_store_n (&(reloader->running), 0, __ATOMIC_RELEASE);
+      if (pthread_join (reloader->thread, NULL) != 0)
+        {
+          ret = -1;
+        }
+    }
+  pthread_mutex_destroy (&(reloader->lock));
+  lwes_event_type_db_destroy (reloader->db);
+  free (reloader);
+
+  return ret;
+}
+
+/*************************************************************************
+  PRIVATE API
+ *************************************************************************/
+
+/* parses the esf off to the side, publishes it and retires the old db */
+static int
+lwes_event_type_db_reloader_update
+  (struct lwes_event_type_db_reloader *reloader,
+   int force)
+{
+  struct lwes_event_type_db *db;
+  struct lwes_event_type_db *old;
+  struct timespec drain = { 0, LWES_RELOADER_DRAIN_NSEC };
+  struct stat st;
+  unsigned int epoch;
+
+  pthread_mutex_lock (&(reloader->lock));
+
+  if (stat (reloader->esf_filename, &st) != 0)
+    {
+      /* a missing file is one failure, not one per check */
+      if (reloader->last_error != -1)
+        {
+          __atomic_fetch_add (&(reloader->failures), 1, __ATOMIC_RELAXED);
+          __atomic_store_n (&(reloader->last_error), -1, __ATOMIC_RELAXED);
+        }
+      pthread_mutex_unlock (&(reloader->lock));
+      return -1;
+    }
+
+  /* a new version replaced by rename has a new inode, one written in place
+     has a new modification time or size, and the nanoseconds of the time
+     catch one written within the same second */
+  if (! force
+      && reloader->last_error != -1
+      && reloader->mtime == (LWES_INT_64) st.st_mtime
+      && reloader->mtime_nsec == lwes_event_type_db_reloader_mtime_nsec (&st)
+      && reloader->size == (LWES_INT_64) st.st_size
+      && reloader->inode == (LWES_INT_64) st.st_ino)
+    {
+      pthread_mutex_unlock (&(reloader->lock));
+      return 0;
+    }
+
+  /* remembered even if the parse fails, so a broken version is not
+     parsed again on every check */
+  reloader->mtime = (LWES_INT_64) st.st_mtime;
+  reloader->mtime_nsec = lwes_event_type_db_reloader_mtime_nsec (&st);
+  reloader->size = (LWES_INT_64) st.st_size;
+  reloader->inode = (LWES_INT_64) st.st_ino;
+
+  db = lwes_event_type_db_create (reloader->esf_filename);
+  if (db == NULL)
+    {
+      __atomic_fetch_add (&(reloader->failures), 1, __ATOMIC_RELAXED);
+      __atomic_store_n (&(reloader->last_error), -2, __ATOMIC_RELAXED);
+      pthread_mutex_unlock (&(reloader->lock));
+      return -2;
+    }
+
+  old = reloader->db;
+  __atomic_store_n (&(reloader->db), db, __ATOMIC_SEQ_CST);
+  epoch = __atomic_fetch_add (&(reloader->epoch), 1, __ATOMIC_SEQ_CST);
+  while (__atomic_load_n (&(reloader->readers[epoch & 1]), __ATOMIC_SEQ_CST)
+         != 0)
+    {
+      nanosleep (&drain, NULL);
+    }
+  lwes_event_type_db_destroy (old);
+
+  __atomic_fetch_add (&(reloader->reloads), 1, __ATOMIC_RELAXED);
+  __atomic_store_n (&(reloader->last_error), 0, __ATOMIC_RELAXED);
+  pthread_mutex_unlock (&(reloader->lock));
+  return 1;
+}
+
+static void *
+lwes_event_type_db_reloader_watcher
+  (void *arg)
+{
+  struct lwes_event_type_db_reloader *reloader =
+    (struct lwes_event_type_db_reloader *) arg;
+  struct timespec wake;
+  unsigned int slept = 0;
+  unsigned int step;
+
+  while (__atomic_load_n (&(reloader->running), __ATOMIC_ACQUIRE))
+    {
+      step = reloader->poll_msec - slept;
+      if (step > LWES_RELOADER_WAKE_MSEC)
+        {
+          step = LWES_RELOADER_WAKE_MSEC;
+        }
+      wake.tv_sec = 0;
+      wake.tv_nsec = (long) step * 1000000L;
+      nanosleep (&wake, NULL);
+      slept += step;
+      if (slept >= reloader->poll_msec)
+        {
+          slept = 0;
+          lwes_event_type_db_reloader_update (reloader, 0);
+        }
+    }
+  return NULL;
+}
+
+static LWES_INT_64
+lwes_event_type_db_reloader_mtime_nsec
+  (const struct stat *st)
+{
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+  return (LWES_INT_64) st->st_mtim.tv_nsec;
+#else
+  (void) st;
+  return 0;
+#endif
+}
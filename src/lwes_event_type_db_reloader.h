@@ -0,0 +1,175 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#ifndef __LWES_EVENT_TYPE_DB_RELOADER_H
+#define __LWES_EVENT_TYPE_DB_RELOADER_H
+
+#include "lwes_types.h"
+#include "lwes_event_type_db.h"
+
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! \file lwes_event_type_db_reloader.h
+ *  \brief Functions for an event type db which follows changes to its esf
+ *
+ *  Readers acquire the current db, validate events against it, and release
+ *  it.  When the esf file changes the new version is parsed and published,
+ *  and the old one is destroyed once every reader which acquired it has
+ *  released it.  Acquiring and releasing take no locks.
+ *
+ *  Events created with an acquired db keep a pointer to it, so attributes
+ *  must be set on them before the db is released.  Serializing an event
+ *  does not use its db.
+ */
+
+/*! \struct lwes_event_type_db_reloader lwes_event_type_db_reloader.h
+ *  \brief A reloadable event type db
+ */
+struct lwes_event_type_db_reloader
+{
+  /*! the esf file which is watched */
+  char esf_filename[FILENAME_MAX];
+  /*! the published db */
+  struct lwes_event_type_db *db;
+  /*! bumped each time a db is published, its low bit picks the reader
+      count new readers use */
+  unsigned int epoch;
+  /*! readers holding a db, by the epoch they acquired it in */
+  unsigned int readers[2];
+  /*! serializes reloads */
+  pthread_mutex_t lock;
+  /*! modification time, size and inode of the esf when it was last read,
+      the nanoseconds of the time are 0 where stat lacks them */
+  LWES_INT_64 mtime;
+  LWES_INT_64 mtime_nsec;
+  LWES_INT_64 size;
+  LWES_INT_64 inode;
+  /*! count of new versions published */
+  LWES_U_INT_64 reloads;
+  /*! count of reloads which failed, the published db is kept */
+  LWES_U_INT_64 failures;
+  /*! why the last reload failed, 0 if it did not */
+  int last_error;
+  /*! milliseconds between checks of the esf, 0 for no watcher thread */
+  unsigned int poll_msec;
+  /*! boolean, cleared to stop the watcher thread */
+  int running;
+  /*! the watcher thread */
+  pthread_t thread;
+};
+
+/*! \brief Create a reloadable event type db
+ *
+ *  \param[in] filename  the path to the file containing the esf description
+ *  \param[in] poll_msec how often a watcher thread checks the esf for
+ *                       changes, 0 to only check when
+ *                       lwes_event_type_db_reloader_check is called
+ *
+ *  \see lwes_event_type_db_reloader_destroy
+ *
+ *  \return the newly created reloader, NULL if the esf could not be parsed
+ */
+struct lwes_event_type_db_reloader *
+lwes_event_type_db_reloader_create
+  (const char *filename,
+   unsigned int poll_msec);
+
+/*! \brief Acquire the current db
+ *
+ *  May be called from any thread, the db stays valid until it is released
+ *  with the token, even if a new version is published in the meantime.
+ *
+ *  \param[in]  reloader the reloader to read from
+ *  \param[out] token    to pass to lwes_event_type_db_reloader_release
+ *
+ *  \return the current db
+ */
+struct lwes_event_type_db *
+lwes_event_type_db_reloader_acquire
+  (struct lwes_event_type_db_reloader *reloader,
+   int *token);
+
+/*! \brief Release a db acquired with lwes_event_type_db_reloader_acquire
+ *
+ *  \param[in] reloader the reloader the db was acquired from
+ *  \param[in] token    the token returned by the acquire
+ */
+void
+lwes_event_type_db_reloader_release
+  (struct lwes_event_type_db_reloader *reloader,
+   int token);
+
+/*! \brief Reload the esf if it has changed since it was last read
+ *
+ *  Parses the new version in the calling thread, publishes it, and waits
+ *  for the readers of the old version before destroying it.
+ *
+ *  \param[in] reloader the reloader to check
+ *
+ *  \return 1 if a new version was published, 0 if the esf has not changed,
+ *          -1 if the esf could not be read, -2 if it could not be parsed
+ */
+int
+lwes_event_type_db_reloader_check
+  (struct lwes_event_type_db_reloader *reloader);
+
+/*! \brief Reload the esf whether or not it has changed
+ *
+ *  \param[in] reloader the reloader to reload
+ *
+ *  \return 1 if a new version was published, -1 if the esf could not be
+ *          read, -2 if it could not be parsed
+ */
+int
+lwes_event_type_db_reloader_reload
+  (struct lwes_event_type_db_reloader *reloader);
+
+/*! \brief Get the number of new versions published */
+LWES_U_INT_64
+lwes_event_type_db_reloader_get_reload_count
+  (struct lwes_event_type_db_reloader *reloader);
+
+/*! \brief Get the number of reloads which failed */
+LWES_U_INT_64
+lwes_event_type_db_reloader_get_failure_count
+  (struct lwes_event_type_db_reloader *reloader);
+
+/*! \brief Get why the last reload failed
+ *
+ *  \return 0 if the last reload succeeded, otherwise its negative return
+ */
+int
+lwes_event_type_db_reloader_get_last_error
+  (struct lwes_event_type_db_reloader *reloader);
+
+/*! \brief Destroy a reloadable event type db
+ *
+ *  Stops the watcher thread and destroys the current db, no db acquired
+ *  from the reloader may still be in use.
+ *
+ *  \param[in] reloader the reloader to destroy
+ *
+ *  \return 0 on success, a negative number on failure
+ */
+int
+lwes_event_type_db_reloader_destroy
+  (struct lwes_event_type_db_reloader *reloader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LWES_EVENT_TYPE_DB_RELOADER_H */
@@ -0,0 +1,393 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#include "lwes_event_view.h"
+#include "lwes_marshall_functions.h"
+
+#include <string.h>
+
+/*************************************************************************
+  PRIVATE API prototypes, shouldn't be called by a user of the library.
+ *************************************************************************/
+static size_t
+lwes_event_view_wire_size
+  (LWES_TYPE type);
+
+static int
+lwes_event_view_value_length
+  (LWES_TYPE type,
+   LWES_BYTE_P bytes,
+   size_t num_bytes,
+   size_t offset,
+   size_t *length);
+
+static int
+lwes_event_view_find
+  (struct lwes_event_view *view,
+   LWES_CONST_SHORT_STRING name,
+   LWES_TYPE type,
+   size_t *offset);
+
+/*************************************************************************
+  PUBLIC API
+ *************************************************************************/
+int
+lwes_event_view_from_bytes
+  (struct lwes_event_view *view,
+   LWES_BYTE_P bytes,
+   size_t num_bytes,
+   size_t offset)
+{
+  struct lwes_event_view_attribute *attr;
+  size_t    tmpOffset = offset;
+  LWES_BYTE name_length;
+  LWES_BYTE type;
+
+  if (   view == NULL
+      || bytes == NULL
+      || num_bytes == 0
+      || offset >= num_bytes)
+    {
+      return -1;
+    }
+
+  view->bytes                = bytes;
+  view->num_bytes            = num_bytes;
+  view->number_of_attributes = 0;
+
+  /* the event name and number of attributes */
+  if (!unmarshall_BYTE (&name_length, bytes, num_bytes, &tmpOffset)
+      || num_bytes - tmpOffset < name_length)
+    {
+      return -2;
+    }
+  view->name        = (const LWES_CHAR *)(bytes + tmpOffset);
+  view->name_length = name_length;
+  tmpOffset += name_length;
+  if (!unmarshall_U_INT_16 (&(view->expected_attributes),
+                            bytes, num_bytes, &tmpOffset))
+    {
+      return -2;
+    }
+
+  /* then name, type and value of each attribute, up to the end */
+  while (tmpOffset != num_bytes)
+    {
+      if (view->number_of_attributes == LWES_EVENT_VIEW_MAX_ATTRIBUTES)
+        {
+          return -3;
+        }
+      attr = &(view->attributes[view->number_of_attributes]);
+
+      if (!unmarshall_BYTE (&name_length, bytes, num_bytes, &tmpOffset)
+          || num_bytes - tmpOffset < name_length)
+        {
+          return -2;
+        }
+      attr->name        = (const LWES_CHAR *)(bytes + tmpOffset);
+      attr->name_length = name_length;
+      tmpOffset += name_length;
+
+      if (!unmarshall_BYTE (&type, bytes, num_bytes, &tmpOffset)
+          || lwes_event_view_value_length (type, bytes, num_bytes, tmpOffset,
+                                           &(attr->length)) < 0)
+        {
+          return -2;
+        }
+      attr->type   = (LWES_TYPE)type;
+      attr->offset = tmpOffset;
+      tmpOffset += attr->length;
+
+      view->number_of_attributes++;
+    }
+
+  return (int)(tmpOffset - offset);
+}
+
+int
+lwes_event_view_get_name
+  (struct lwes_event_view *view,
+   const LWES_CHAR **name,
+   size_t *length)
+{
+  if (view == NULL || name == NULL || length == NULL)
+    {
+      return -1;
+    }
+  *name   = view->name;
+  *length = view->name_length;
+  return 0;
+}
+
+int
+lwes_event_view_get_number_of_attributes
+  (struct lwes_event_view *view,
+   LWES_U_INT_16 *number)
+{
+  if (view == NULL || number == NULL)
+    {
+      return -1;
+    }
+  *number = (LWES_U_INT_16)view->number_of_attributes;
+  return 0;
+}
+
+const struct lwes_event_view_attribute *
+lwes_event_view_get_attribute
+  (struct lwes_event_view *view,
+   LWES_CONST_SHORT_STRING name)
+{
+  const struct lwes_event_view_attribute *attr;
+  size_t name_length;
+  int i;
+
+  if (view == NULL || name == NULL)
+    {
+      return NULL;
+    }
+
+  /* the last one wins, like lwes_event_from_bytes */
+  name_length = strlen (name);
+  for (i = view->number_of_attributes - 1; i >= 0; --i)
+    {
+      attr = &(view->attributes[i]);
+      if (attr->name_length == name_length
+          && memcmp (attr->name, name, name_length) == 0)
+        {
+          return attr;
+        }
+    }
+  return NULL;
+}
+
+#define LWES_EVENT_VIEW_GET(TYPE)                                     \
+int                                                                   \
+lwes_event_view_get_##TYPE                                            \
+  (struct lwes_event_view *view,                                      \
+   LWES_CONST_SHORT_STRING name,                                      \
+   LWES_##TYPE *value)                                                \
+{                                                                     \
+  size_t offset;                                                      \
+  if (value == NULL                                                   \
+      || lwes_event_view_find (view, name, LWES_TYPE_##TYPE,          \
+                               &offset) < 0)                          \
+    {                                                                 \
+      return -1;                                                      \
+    }                                                                 \
+  memset (value, 0, sizeof (LWES_##TYPE));                            \
+  unmarshall_##TYPE (value, view->bytes, view->num_bytes, &offset);   \
+  return 0;                                                           \
+}
+
+LWES_EVENT_VIEW_GET(U_INT_16)
+LWES_EVENT_VIEW_GET(INT_16)
+LWES_EVENT_VIEW_GET(U_INT_32)
+LWES_EVENT_VIEW_GET(INT_32)
+LWES_EVENT_VIEW_GET(U_INT_64)
+LWES_EVENT_VIEW_GET(INT_64)
+LWES_EVENT_VIEW_GET(BOOLEAN)
+LWES_EVENT_VIEW_GET(IP_ADDR)
+LWES_EVENT_VIEW_GET(BYTE)
+LWES_EVENT_VIEW_GET(FLOAT)
+LWES_EVENT_VIEW_GET(DOUBLE)
+
+int
+lwes_event_view_get_STRING
+  (struct lwes_event_view *view,
+   LWES_CONST_SHORT_STRING name,
+   const LWES_CHAR **value,
+   size_t *length)
+{
+  size_t offset;
+  LWES_U_INT_16 string_length;
+
+  if (value == NULL || length == NULL
+      || lwes_event_view_find (view, name, LWES_TYPE_STRING, &offset) < 0)
+    {
+      return -1;
+    }
+  unmarshall_U_INT_16 (&string_length, view->bytes, view->num_bytes, &offset);
+  *value  = (const LWES_CHAR *)(view->bytes + offset);
+  *length = string_length;
+  return 0;
+}
+
+int
+lwes_event_view_keys
+  (struct lwes_event_view *view,
+   struct lwes_event_view_enumeration *enumeration)
+{
+  if (view == NULL || enumeration == NULL)
+    {
+      return 0;
+    }
+  enumeration->view  = view;
+  enumeration->index = 0;
+  return 1;
+}
+
+const struct lwes_event_view_attribute *
+lwes_event_view_enumeration_next_element
+  (struct lwes_event_view_enumeration *enumeration)
+{
+  if (enumeration == NULL
+      || enumeration->index >= enumeration->view->number_of_attributes)
+    {
+      return NULL;
+    }
+  return &(enumeration->view->attributes[enumeration->index++]);
+}
+
+/*************************************************************************
+  PRIVATE API
+ *************************************************************************/
+/* the number of bytes a value of a fixed size type takes when serialized,
+ * which for BOOLEAN differs from the in memory size */
+static size_t
+lwes_event_view_wire_size
+  (LWES_TYPE type)
+{
+  switch (type)
+    {
+      case LWES_TYPE_BOOLEAN:
+      case LWES_TYPE_BYTE:
+        return 1;
+      case LWES_TYPE_U_INT_16:
+      case LWES_TYPE_INT_16:
+        return 2;
+      case LWES_TYPE_U_INT_32:
+      case LWES_TYPE_INT_32:
+      case LWES_TYPE_IP_ADDR:
+      case LWES_TYPE_FLOAT:
+        return 4;
+      case LWES_TYPE_U_INT_64:
+      case LWES_TYPE_INT_64:
+      case LWES_TYPE_DOUBLE:
+        return 8;
+      default:
+        return 0;
+    }
+}
+
+/* work out how many bytes the value of the given type at offset takes,
+ * returning -1 if it is malformed or runs past the end */
+static int
+lwes_event_view_value_length
+  (LWES_TYPE type,
+   LWES_BYTE_P bytes,
+   size_t num_bytes,
+   size_t offset,
+   size_t *length)
+{
+  size_t start = offset;
+  size_t size;
+  LWES_U_INT_16 count;
+  LWES_U_INT_16 present;
+  LWES_U_INT_16 string_length;
+  LWES_BYTE_P bitvec = NULL;
+  LWES_TYPE base;
+  int i;
+
+  if (type == LWES_TYPE_STRING)
+    {
+      if (!unmarshall_U_INT_16 (&string_length, bytes, num_bytes, &offset))
+        {
+          return -1;
+        }
+      offset += string_length;
+    }
+  else if (lwes_type_is_array (type))
+    {
+      base = lwes_array_type_to_base (type);
+      if (!unmarshall_U_INT_16 (&count, bytes, num_bytes, &offset))
+        {
+          return -1;
+        }
+      present = count;
+      if (lwes_type_is_nullable_array (type))
+        {
+          /* the length is repeated, then a bit set for the non-NULL ones */
+          size = (count + 7) >> 3;
+          if (!unmarshall_U_INT_16 (&present, bytes, num_bytes, &offset)
+              || num_bytes - offset < size)
+            {
+              return -1;
+            }
+          bitvec = bytes + offset;
+          offset += size;
+          present = 0;
+          for (i = 0; i < count; ++i)
+            {
+              present += (bitvec[i >> 3] >> (i & 0x07)) & 1;
+            }
+        }
+      if (base == LWES_TYPE_STRING)
+        {
+          for (i = 0; i < present; ++i)
+            {
+              if (!unmarshall_U_INT_16 (&string_length,
+                                        bytes, num_bytes, &offset))
+                {
+                  return -1;
+                }
+              offset += string_length;
+              if (offset > num_bytes)
+                {
+                  return -1;
+                }
+            }
+        }
+      else
+        {
+          size = lwes_event_view_wire_size (base);
+          if (size == 0)
+            {
+              return -1;
+            }
+          offset += size * present;
+        }
+    }
+  else
+    {
+      size = lwes_event_view_wire_size (type);
+      if (size == 0)
+        {
+          return -1;
+        }
+      offset += size;
+    }
+
+  if (offset > num_bytes)
+    {
+      return -1;
+    }
+  *length = offset - start;
+  return 0;
+}
+
+static int
+lwes_event_view_find
+  (struct lwes_event_view *view,
+   LWES_CONST_SHORT_STRING name,
+   LWES_TYPE type,
+   size_t *offset)
+{
+  const struct lwes_event_view_attribute *attr =
+    lwes_event_view_get_attribute (view, name);
+
+  if (attr == NULL || attr->type != type)
+    {
+      return -1;
+    }
+  *offset = attr->offset;
+  return 0;
+}
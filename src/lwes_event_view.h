@@ -0,0 +1,321 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#ifndef __LWES_EVENT_VIEW_H
+#define __LWES_EVENT_VIEW_H
+
+#include "lwes_types.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! \file lwes_event_view.h
+ *  \brief Functions for reading attributes straight out of serialized events
+ *
+ *  A view records where each attribute of a serialized event is in a
+ *  single pass over the bytes, without allocating or copying anything,
+ *  so reading a few attributes of a large event costs little more than
+ *  finding them.  The view refers into the caller's buffer and is only
+ *  valid as long as that buffer is unchanged.
+ */
+
+/*! Most attributes a view can hold, events with more are rejected */
+#define LWES_EVENT_VIEW_MAX_ATTRIBUTES 512
+
+/*! \struct lwes_event_view_attribute lwes_event_view.h
+ *  \brief Where an attribute is in the serialized event
+ */
+struct lwes_event_view_attribute
+{
+  /*! Name of the attribute, NOT null terminated */
+  const LWES_CHAR *name;
+  /*! Number of bytes in name */
+  size_t           name_length;
+  /*! Type of the attribute */
+  LWES_TYPE        type;
+  /*! Offset of the serialized value in the bytes */
+  size_t           offset;
+  /*! Number of bytes of the serialized value */
+  size_t           length;
+};
+
+/*! \struct lwes_event_view lwes_event_view.h
+ *  \brief A read only view of a serialized event
+ */
+struct lwes_event_view
+{
+  /*! The serialized event */
+  LWES_BYTE_P                      bytes;
+  /*! Number of bytes in the serialized event */
+  size_t                           num_bytes;
+  /*! Name of the event, NOT null terminated */
+  const LWES_CHAR                 *name;
+  /*! Number of bytes in name */
+  size_t                           name_length;
+  /*! Number of attributes the event says it has */
+  LWES_U_INT_16                    expected_attributes;
+  /*! Number of attributes actually found */
+  int                              number_of_attributes;
+  /*! The attributes, in the order they were serialized */
+  struct lwes_event_view_attribute attributes[LWES_EVENT_VIEW_MAX_ATTRIBUTES];
+};
+
+/*! \struct lwes_event_view_enumeration lwes_event_view.h
+ *  \brief Keeps track of an enumeration over the attributes of a view
+ */
+struct lwes_event_view_enumeration
+{
+  struct lwes_event_view *view;
+  int                     index;
+};
+
+/*! \brief Index a serialized event
+ *
+ *  Like lwes_event_from_bytes_lax, the attribute count in the event is
+ *  not enforced, it is available as expected_attributes.
+ *
+ *  \param[out] view the view to fill in
+ *  \param[in] bytes the serialized event, which must outlive the view
+ *  \param[in] num_bytes the number of bytes in the serialized event
+ *  \param[in] offset the offset in bytes the event starts at
+ *
+ *  \return the number of bytes read on success, -1 on bad arguments,
+ *          -2 if the event is malformed or truncated and -3 if it has
+ *          more than LWES_EVENT_VIEW_MAX_ATTRIBUTES attributes
+ */
+int
+lwes_event_view_from_bytes
+  (struct lwes_event_view *view,
+   LWES_BYTE_P bytes,
+   size_t num_bytes,
+   size_t offset);
+
+/*! \brief Get the name of the event
+ *
+ *  \param[in] view the view of the event
+ *  \param[out] name points at the name in the serialized event, it is
+ *              NOT null terminated
+ *  \param[out] length the number of bytes in the name
+ *
+ *  \return 0 on success, a negative number on failure
+ */
+int
+lwes_event_view_get_name
+  (struct lwes_event_view *view,
+   const LWES_CHAR **name,
+   size_t *length);
+
+/*! \brief Get the number of attributes in the event
+ *
+ *  \param[in] view the view of the event
+ *  \param[out] number the number of attributes found
+ *
+ *  \return 0 on success, a negative number on failure
+ */
+int
+lwes_event_view_get_number_of_attributes
+  (struct lwes_event_view *view,
+   LWES_U_INT_16 *number);
+
+/*! \brief Find an attribute of the event
+ *
+ *  If the attribute was serialized more than once, the last one is
+ *  found, as when deserializing into an event.
+ *
+ *  \param[in] view the view of the event
+ *  \param[in] name the name of the attribute
+ *
+ *  \return the attribute, or NULL if there is no attribute of that name
+ */
+const struct lwes_event_view_attribute *
+lwes_event_view_get_attribute
+  (struct lwes_event_view *view,
+   LWES_CONST_SHORT_STRING name);
+
+/*! \brief Get an LWES_U_INT_16 attribute from the event
+ *
+ *  \param[in] view the view of the event
+ *  \param[in] name the name of the attribute
+ *  \param[out] value the value of the attribute
+ *
+ *  \return 0 on success, a negative number if the attribute is not
+ *          there or has another type
+ */
+int
+lwes_event_view_get_U_INT_16
+  (struct lwes_event_view *view,
+   LWES_CONST_SHORT_STRING name,
+   LWES_U_INT_16 *value);
+
+/*! \brief Get an LWES_INT_16 attribute from the event
+ *
+ *  \see lwes_event_view_get_U_INT_16
+ */
+int
+lwes_event_view_get_INT_16
+  (struct lwes_event_view *view,
+   LWES_CONST_SHORT_STRING name,
+   LWES_INT_16 *value);
+
+/*! \brief Get an LWES_U_INT_32 attribute from the event
+ *
+ *  \see lwes_event_view_get_U_INT_16
+ */
+int
+lwes_event_view_get_U_INT_32
+  (struct lwes_event_view *view,
+   LWES_CONST_SHORT_STRING name,
+   LWES_U_INT_32 *value);
+
+/*! \brief Get an LWES_INT_32 attribute from the event
+ *
+ *  \see lwes_event_view_get_U_INT_16
+ */
+int
+lwes_event_view_get_INT_32
+  (struct lwes_event_view *view,
+   LWES_CONST_SHORT_STRING name,
+   LWES_INT_32 *value);
+
+/*! \brief Get an LWES_U_INT_64 attribute from the event
+ *
+ *  \see lwes_event_view_get_U_INT_16
+ */
+int
+lwes_event_view_get_U_INT_64
+  (struct lwes_event_view *view,
+   LWES_CONST_SHORT_STRING name,
+   LWES_U_INT_64 *value);
+
+/*! \brief Get an LWES_INT_64 attribute from the event
+ *
+ *  \see lwes_event_view_get_U_INT_16
+ */
+int
+lwes_event_view_get_INT_64
+  (struct lwes_event_view *view,
+   LWES_CONST_SHORT_STRING name,
+   LWES_INT_64 *value);
+
+/*! \brief Get an LWES_BOOLEAN attribute from the event
+ *
+ *  \see lwes_event_view_get_U_INT_16
+ */
+int
+lwes_event_view_get_BOOLEAN
+  (struct lwes_event_view *view,
+   LWES_CONST_SHORT_STRING name,
+   LWES_BOOLEAN *value);
+
+/*! \brief Get an LWES_IP_ADDR attribute from the event
+ *
+ *  \see lwes_event_view_get_U_INT_16
+ */
+int
+lwes_event_view_get_IP_ADDR
+  (struct lwes_event_view *view,
+   LWES_CONST_SHORT_STRING name,
+   LWES_IP_ADDR *value);
+
+/*! \brief Get an LWES_BYTE attribute from the event
+ *
+ *  \see lwes_event_view_get_U_INT_16
+ */
+int
+lwes_event_view_get_BYTE
+  (struct lwes_event_view *view,
+   LWES_CONST_SHORT_STRING name,
+   LWES_BYTE *value);
+
+/*! \brief Get an LWES_FLOAT attribute from the event
+ *
+ *  \see lwes_event_view_get_U_INT_16
+ */
+int
+lwes_event_view_get_FLOAT
+  (struct lwes_event_view *view,
+   LWES_CONST_SHORT_STRING name,
+   LWES_FLOAT *value);
+
+/*! \brief Get an LWES_DOUBLE attribute from the event
+ *
+ *  \see lwes_event_view_get_U_INT_16
+ */
+int
+lwes_event_view_get_DOUBLE
+  (struct lwes_event_view *view,
+   LWES_CONST_SHORT_STRING name,
+   LWES_DOUBLE *value);
+
+/*! \brief Get a string attribute from the event without copying it
+ *
+ *  \param[in] view the view of the event
+ *  \param[in] name the name of the attribute
+ *  \param[out] value points at the string in the serialized event, it
+ *              is NOT null terminated
+ *  \param[out] length the number of bytes in the string
+ *
+ *  \return 0 on success, a negative number if the attribute is not
+ *          there or has another type
+ */
+int
+lwes_event_view_get_STRING
+  (struct lwes_event_view *view,
+   LWES_CONST_SHORT_STRING name,
+   const LWES_CHAR **value,
+   size_t *length);
+
+/*! \brief Start an enumeration over the attributes of the view
+ *
+ *  The pattern for enumerating is as follows
+ *
+ *  struct lwes_event_view_enumeration e;
+ *
+ *  if (lwes_event_view_keys (view, &e))
+ *    {
+ *      const struct lwes_event_view_attribute *attr;
+ *      while ((attr = lwes_event_view_enumeration_next_element (&e)))
+ *        {
+ *          // use attr->name, attr->name_length and attr->type
+ *        }
+ *    }
+ *
+ *  Attributes are enumerated in the order they were serialized.
+ *
+ *  \param[in] view the view to enumerate over
+ *  \param[in] enumeration keeps track of the enumeration
+ *
+ *  \return 1 if the enumeration was started, 0 on bad arguments
+ */
+int
+lwes_event_view_keys
+  (struct lwes_event_view *view,
+   struct lwes_event_view_enumeration *enumeration);
+
+/*! \brief Get the next attribute of an enumeration
+ *
+ *  \param[in] enumeration the enumeration started by lwes_event_view_keys
+ *
+ *  \return the next attribute, or NULL when there are no more
+ */
+const struct lwes_event_view_attribute *
+lwes_event_view_enumeration_next_element
+  (struct lwes_event_view_enumeration *enumeration);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LWES_EVENT_VIEW_H */
@@ -14,17 +14,45 @@
 
 #include <string.h>
 
+/* values of index slots which do not point at an element */
+#define LWES_HASH_EMPTY   -1
+#define LWES_HASH_REMOVED -2
+
+/* smallest index, and the number of elements an index of a given size
+ * may refer to, keeping it at most three quarters full so probes stay
+ * short and always find an empty slot */
+#define LWES_HASH_MIN_INDEX_SIZE 8
+#define LWES_HASH_CAPACITY(index_size) ((index_size) - (index_size) / 4)
+
 /*************************************************************************
   PRIVATE API Prototypes, shouldn't be called outside of this file
  *************************************************************************/
 int
-lwes_hash
-  (const char *key);
-
-int
 lwes_hash_init
   (struct lwes_hash *hash, int bins);
 
+static void *
+lwes_hash_alloc
+  (struct lwes_hash *hash,
+   size_t size);
+
+static void
+lwes_hash_free
+  (struct lwes_hash *hash,
+   void *ptr);
+
+static int
+lwes_hash_find
+  (struct lwes_hash *hash,
+   const char *key,
+   unsigned int hash_value,
+   int *slot);
+
+static int
+lwes_hash_rebuild
+  (struct lwes_hash *hash,
+   int index_size);
+
 /*************************************************************************
   PUBLIC API
  *************************************************************************/
@@ -32,7 +60,7 @@ struct lwes_hash *
 lwes_hash_create
   (void)
 {
-  return lwes_hash_create_with_bins (100);
+  return lwes_hash_create_with_bins (LWES_HASH_DEFAULT_SIZE);
 }
 
 struct lwes_hash *
@@ -43,6 +71,7 @@ lwes_hash_create_with_bins
     (struct lwes_hash *) malloc (sizeof (struct lwes_hash));
   if ( hash != NULL )
     {
+      hash->arena = NULL;
       if ( lwes_hash_init (hash, total) == -3 )
         {
           free (hash);
@@ -52,17 +81,44 @@ lwes_hash_create_with_bins
   return hash;
 }
 
+struct lwes_hash *
+lwes_hash_create_in_arena
+  (struct lwes_arena *arena,
+   int total)
+{
+  struct lwes_hash *hash;
+
+  hash = (struct lwes_hash *) lwes_arena_alloc (arena, sizeof (struct lwes_hash));
+  if ( hash != NULL )
+    {
+      hash->arena = arena;
+      if ( lwes_hash_init (hash, total) == -3 )
+        {
+          hash = NULL;
+        }
+    }
+  return hash;
+}
+
 int
 lwes_hash_destroy
   (struct lwes_hash* hash)
 {
   int ret = -1;
+
+  /* everything belongs to the arena */
+  if ( hash->arena != NULL )
+    {
+      return 0;
+    }
+
   /* force all entries to have been removed
    * TODO: This is a possible memory leak if callers don't check return values
    */
   if ( hash->assigned_entries == 0 )
     {
-      free (hash->bins);
+      lwes_hash_free (hash, hash->elements);
+      lwes_hash_free (hash, hash->index);
       free (hash);
       ret = 0;
     }
@@ -83,82 +139,98 @@ lwes_hash_size
   return hash->assigned_entries;
 }
 
+int
+lwes_hash_rehash
+  (struct lwes_hash* hash)
+{
+  if ( hash == NULL )
+    {
+      return -1;
+    }
+  if ( hash->elements == NULL )
+    {
+      return 0;
+    }
+  return lwes_hash_rebuild (hash, hash->index_size);
+}
+
 void *
 lwes_hash_put
   (struct lwes_hash* hash,
    char *key,
    void *value)
 {
-  int index;
-  int found_it = 0;
-  struct lwes_hash_element *bin = NULL;
-  struct lwes_hash_element *new_element = NULL;
-  void *old_value = NULL;
-
   if ( key == NULL || hash == NULL )
     {
       return value;
     }
 
-  new_element =
-    (struct lwes_hash_element *) malloc (sizeof (struct lwes_hash_element));
-  if ( new_element == NULL )
+  return lwes_hash_put_with_hash (hash, key, lwes_hash (key), value);
+}
+
+void *
+lwes_hash_put_with_hash
+  (struct lwes_hash* hash,
+   char *key,
+   unsigned int hash_value,
+   void *value)
+{
+  struct lwes_hash_element *element;
+  int position;
+  int slot;
+  int index_size;
+  void *old_value;
+
+  if ( key == NULL || hash == NULL )
     {
       return value;
     }
-  new_element->key   = key;
-  new_element->value = value;
-  new_element->next  = NULL;
 
-  index = lwes_hash(key)%hash->total_bins;
+  /* replace the value of an existing key, keeping the original key */
+  position = lwes_hash_find (hash, key, hash_value, &slot);
+  if ( position >= 0 )
+    {
+      old_value = hash->elements[position].value;
+      hash->elements[position].value = value;
+      return old_value;
+    }
 
-  if ( hash->bins[index] == NULL )
+  if ( hash->elements == NULL )
     {
-      hash->bins[index] = (void *)new_element;
+      /* the elements are only allocated once something is put */
+      hash->elements =
+        (struct lwes_hash_element *)
+          lwes_hash_alloc (hash, sizeof (struct lwes_hash_element)
+                                   * LWES_HASH_CAPACITY (hash->index_size));
+      if ( hash->elements == NULL )
+        {
+          return value;
+        }
     }
-  else
+  else if ( hash->used_elements == LWES_HASH_CAPACITY (hash->index_size) )
     {
-      bin = (struct lwes_hash_element *)hash->bins[index];
-
-      if (strcmp (bin->key, key) == 0 )
+      /* double unless there are enough removed elements to reclaim */
+      index_size = hash->index_size;
+      if ( 2 * (hash->assigned_entries + 1) > LWES_HASH_CAPACITY (index_size) )
         {
-          found_it = 1;
-          old_value = bin->value;
-          bin->value = value;
+          index_size *= 2;
         }
-      else
+      if ( lwes_hash_rebuild (hash, index_size) < 0 )
         {
-          while ( bin->next != NULL )
-            {
-              if ( strcmp (bin->key,key) == 0 )
-                {
-                  found_it = 1;
-                  old_value = bin->value;
-                  bin->value = value;
-                  break;
-                }
-              else
-                {
-                  bin = bin->next;
-                }
-            }
-          if (! found_it)
-            {
-              bin->next = new_element;
-            }
+          return value;
         }
+      lwes_hash_find (hash, key, hash_value, &slot);
     }
 
-  if (found_it)
-    {
-      free (new_element);
-    }
-  else
-    {
-      hash->assigned_entries++;
-    }
+  position = hash->used_elements++;
+  element  = &(hash->elements[position]);
+  element->key   = key;
+  element->value = value;
+  element->hash  = hash_value;
+  hash->index[slot] = position;
+  hash->assigned_entries++;
 
-  return old_value;
+  return NULL;
 }
 
 void *
@@ -166,23 +238,21 @@ lwes_hash_get
   (struct lwes_hash* hash,
    const char *key)
 {
-  int index;
-  struct lwes_hash_element *bin      = NULL;
-  struct lwes_hash_element *searcher = NULL;
-
-  index = lwes_hash (key) % hash->total_bins;
-  bin = hash->bins[index];
-  if ( bin == NULL )
-    return NULL;
-  searcher=bin;
-  while ( searcher != NULL && strcmp (searcher->key, key) != 0 )
+  int position;
+  int slot;
+
+  if ( key == NULL )
+    {
+      return NULL;
+    }
+
+  position = lwes_hash_find (hash, key, lwes_hash (key), &slot);
+  if ( position < 0 )
     {
-      searcher = searcher->next;
+      return NULL;
     }
-  if ( searcher == NULL )
-    return NULL;
 
-  return searcher->value;
+  return hash->elements[position].value;
 }
 
 void *
@@ -190,75 +260,54 @@ lwes_hash_remove
   (struct lwes_hash* hash,
    const char *key)
 {
-  int index;
+  int position;
+  int slot;
+  int i;
   void *return_value;
-  struct lwes_hash_element *head     = NULL;
-  struct lwes_hash_element *searcher = NULL;
-  struct lwes_hash_element *prev     = NULL;
 
   if ( key == NULL )
     {
       return NULL;
     }
-  index = lwes_hash (key) % hash->total_bins;
-  head = (struct lwes_hash_element *)hash->bins[index];
-  if ( head == NULL )
+
+  position = lwes_hash_find (hash, key, lwes_hash (key), &slot);
+  /* it's not in the table, so don't do anything, return NULL; */
+  if ( position < 0 )
     {
       return NULL;
     }
-  searcher=head;
-  prev=head;
-  while ( searcher != NULL && strcmp (searcher->key,key) != 0 )
-    {
-      prev     = searcher;
-      searcher = searcher->next;
-    }
-  /* it's not in the list, so don't do anything, return NULL; */
-  if ( searcher == NULL )
-    return NULL;
 
-  /* else, set the previous next equal to the searcher next */
-  if ( searcher == head )
-    {
-      hash->bins[index] = (void *)searcher->next;
-    }
-  else
+  /* elements never move here, so an enumeration which removes what it
+   * was just given carries on from the right place */
+  return_value = hash->elements[position].value;
+  hash->elements[position].key   = NULL;
+  hash->elements[position].value = NULL;
+  hash->index[slot] = LWES_HASH_REMOVED;
+  hash->assigned_entries--;
+
+  /* once empty, start again from the beginning for free */
+  if ( hash->assigned_entries == 0 )
     {
-      prev->next = searcher->next;
+      hash->used_elements = 0;
+      for ( i = 0; i < hash->index_size; i++ )
+        {
+          hash->index[i] = LWES_HASH_EMPTY;
+        }
     }
-  searcher->next = NULL;
-  return_value = searcher->value;
-  free (searcher);
 
-  hash->assigned_entries--;
   return return_value;
 }
 
 int lwes_hash_contains_key(struct lwes_hash* hash, const char *key)
 {
-  int index;
-  struct lwes_hash_element *bin      = NULL;
-  struct lwes_hash_element *searcher = NULL;
-
-  index = lwes_hash (key) % hash->total_bins;
-  bin = hash->bins[index];
-
-  if ( bin == NULL )
-    return 0;
-
-  searcher=bin;
-
-  while ( searcher != NULL && strcmp (searcher->key,key) != 0 )
-    {
-      searcher = searcher->next;
-    }
+  int slot;
 
-  if ( searcher == NULL )
+  if ( key == NULL )
     {
       return 0;
     }
 
-  return 1;
+  return ( lwes_hash_find (hash, key, lwes_hash (key), &slot) >= 0 );
 }
 
 int
@@ -275,10 +324,6 @@ lwes_hash_keys
   enumeration->elements_given = 0;
   enumeration->size_at_start = lwes_hash_size (hash);
   enumeration->enum_hash = hash;
-  /* set the current to the first entry of the first list */
-  enumeration->current   =
-    (struct lwes_hash_element *)
-       enumeration->enum_hash->bins[enumeration->index];
 
   return 1;
 }
@@ -296,43 +341,40 @@ char *
 lwes_hash_enumeration_next_element
   (struct lwes_hash_enumeration *enumeration)
 {
-  struct lwes_hash_element *prev;
+  struct lwes_hash *hash = enumeration->enum_hash;
 
-  /* if the current value pointed at is null (this will most often happen
-   * the first time this is called, or the next value in this list is null,
-   * increment the index and check again.
-   */
-  while ( enumeration->current == NULL )
-  {
-    enumeration->index++;
-    /* takes care of the case where we ask beyond the end */
-    if ( enumeration->index >= enumeration->enum_hash->total_bins )
+  /* skip over removed elements, returning NULL at the end */
+  while ( enumeration->index < hash->used_elements )
     {
-      return NULL;
+      struct lwes_hash_element *element =
+        &(hash->elements[enumeration->index++]);
+      if ( element->key != NULL )
+        {
+          enumeration->elements_given++;
+          return element->key;
+        }
     }
-    enumeration->current = enumeration->enum_hash->bins[enumeration->index];
-  }
-
-  prev = enumeration->current;
-  enumeration->current = enumeration->current->next;
-  enumeration->elements_given++;
-  return prev->key;
+  return NULL;
 }
 
-/*************************************************************************
-  PRIVATE API, shouldn't be called by a user of the library.
- *************************************************************************/
-int
+/* 32 bit FNV-1a */
+unsigned int
 lwes_hash
   (const char *key)
 {
-  int sum = 0;
+  unsigned int hash_value = 2166136261U;
   int i;
   for ( i = 0; key[i] != '\0'; i++ )
-    sum += ((int)key[i])*((int)key[i]);
-  return sum;
+    {
+      hash_value ^= (unsigned char)key[i];
+      hash_value *= 16777619U;
+    }
+  return hash_value;
 }
 
+/*************************************************************************
+  PRIVATE API, shouldn't be called by a user of the library.
+ *************************************************************************/
 int
 lwes_hash_init
   (struct lwes_hash *hash,
@@ -340,18 +382,144 @@ lwes_hash_init
 {
   int i;
   int ret = -3;
-  hash->total_bins       = total;
+
+  hash->index_size = LWES_HASH_MIN_INDEX_SIZE;
+  while ( LWES_HASH_CAPACITY (hash->index_size) < total )
+    {
+      hash->index_size *= 2;
+    }
+  hash->elements         = NULL;
+  hash->used_elements    = 0;
   hash->assigned_entries = 0;
-  hash->bins             =
-    (void **)malloc(sizeof(void *) * hash->total_bins);
-  if ( hash->bins != NULL )
+  hash->index            =
+    (int *)lwes_hash_alloc (hash, sizeof (int) * hash->index_size);
+  if ( hash->index != NULL )
     {
-      for ( i = 0; i < hash->total_bins; i++)
+      for ( i = 0; i < hash->index_size; i++)
       {
-        hash->bins[i] = NULL;
+        hash->index[i] = LWES_HASH_EMPTY;
       }
       ret = 0;
     }
   return ret;
 }
 
+static void *
+lwes_hash_alloc
+  (struct lwes_hash *hash,
+   size_t size)
+{
+  if ( hash->arena != NULL )
+    {
+      return lwes_arena_alloc (hash->arena, size);
+    }
+  return malloc (size);
+}
+
+static void
+lwes_hash_free
+  (struct lwes_hash *hash,
+   void *ptr)
+{
+  if ( hash->arena == NULL && ptr != NULL )
+    {
+      free (ptr);
+    }
+}
+
+/* return the position of key in the elements, or -1 if it is not there.
+ * slot is set to the index slot referring to it, or if not found the
+ * slot a new element for key should go in */
+static int
+lwes_hash_find
+  (struct lwes_hash *hash,
+   const char *key,
+   unsigned int hash_value,
+   int *slot)
+{
+  int mask      = hash->index_size - 1;
+  int i         = (int)(hash_value & (unsigned int)mask);
+  int free_slot = -1;
+
+  for (;;)
+    {
+      int position = hash->index[i];
+      if ( position == LWES_HASH_EMPTY )
+        {
+          *slot = (free_slot >= 0) ? free_slot : i;
+          return -1;
+        }
+      if ( position == LWES_HASH_REMOVED )
+        {
+          if ( free_slot < 0 )
+            {
+              free_slot = i;
+            }
+        }
+      else if ( hash->elements[position].hash == hash_value
+                && ( hash->elements[position].key == key
+                     || strcmp (hash->elements[position].key, key) == 0 ) )
+        {
+          *slot = i;
+          return position;
+        }
+      i = (i + 1) & mask;
+    }
+}
+
+/* move the remaining elements, in order, into new arrays for an index of
+ * the given size */
+static int
+lwes_hash_rebuild
+  (struct lwes_hash *hash,
+   int index_size)
+{
+  struct lwes_hash_element *elements;
+  int *index;
+  int mask = index_size - 1;
+  int used = 0;
+  int i;
+
+  index = (int *)lwes_hash_alloc (hash, sizeof (int) * index_size);
+  if ( index == NULL )
+    {
+      return -3;
+    }
+  elements =
+    (struct lwes_hash_element *)
+      lwes_hash_alloc (hash, sizeof (struct lwes_hash_element)
+                               * LWES_HASH_CAPACITY (index_size));
+  if ( elements == NULL )
+    {
+      lwes_hash_free (hash, index);
+      return -3;
+    }
+
+  for ( i = 0; i < index_size; i++ )
+    {
+      index[i] = LWES_HASH_EMPTY;
+    }
+
+  for ( i = 0; i < hash->used_elements; i++ )
+    {
+      if ( hash->elements[i].key != NULL )
+        {
+          int s = (int)(hash->elements[i].hash & (unsigned int)mask);
+          while ( index[s] != LWES_HASH_EMPTY )
+            {
+              s = (s + 1) & mask;
+            }
+          elements[used] = hash->elements[i];
+          index[s] = used++;
+        }
+    }
+
+  lwes_hash_free (hash, hash->elements);
+  lwes_hash_free (hash, hash->index);
+  hash->elements      = elements;
+  hash->index         = index;
+  hash->index_size    = index_size;
+  hash->used_elements = used;
+
+  return 0;
+}
@@ -16,6 +16,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+#include "lwes_arena.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -24,22 +26,39 @@ extern "C" {
  *  \brief Functions for dealing with the hash which is in the event
  */
 
+/*! Number of entries a hash made by lwes_hash_create holds before growing */
+#define LWES_HASH_DEFAULT_SIZE 24
+
 /*! \struct lwes_hash lwes_hash.h
  *  \brief Structure containing a hashtable, used to store key value
  *         pairs in the event.  This is opaque in case of future extension.
+ *
+ *  Entries live in a dense array in insertion order, which is also the
+ *  order they are enumerated in.  They are found through an open
+ *  addressing index, a power of two sized array of positions in the
+ *  dense array probed linearly, so lookups mostly compare cached hash
+ *  values rather than strings.  Both arrays double when full.
  */
 struct lwes_hash
 {
-  void **bins;
-  int total_bins;
+  /* entries in insertion order, removed ones have a NULL key */
+  struct lwes_hash_element *elements;
+  /* number of positions of elements in use, including removed ones */
+  int used_elements;
+  /* open addressing index into elements, index_size slots */
+  int *index;
+  /* number of slots in index, always a power of two */
+  int index_size;
   int assigned_entries;
+  /* if not NULL, where the arrays are allocated from */
+  struct lwes_arena *arena;
 };
 
 struct lwes_hash_element
 {
   char * key;
   void * value;
-  struct lwes_hash_element *next;
+  unsigned int hash;
 };
 
 /*! \struct lwes_hash_enumeration lwes_hash.h
@@ -53,7 +72,6 @@ struct lwes_hash_enumeration
   int size_at_start;  /* in case we are using this enumeration to remove all the
                          elements in the hash */
   struct lwes_hash *enum_hash;
-  struct lwes_hash_element *current;
 };
 
 /*! \brief Create the memory for a hashtable
@@ -67,10 +85,30 @@ struct lwes_hash *
 lwes_hash_create
   (void);
 
+/*! \brief Create the memory for a hashtable of a given size
+ *
+ *  \param[in] total_bins the number of entries to make room for, the
+ *             hash grows beyond this as needed
+ *  \return a newly allocated hash or NULL if an error occured
+ */
 struct lwes_hash *
 lwes_hash_create_with_bins
   (int total_bins);
 
+/*! \brief Create a hashtable whose memory comes from an arena
+ *
+ *  The hash and its elements are freed along with the arena, so there
+ *  is no need to call lwes_hash_destroy.
+ *
+ *  \param[in] arena the arena to allocate from
+ *  \param[in] total_bins the number of entries to make room for
+ *  \return a newly allocated hash or NULL if an error occured
+ */
+struct lwes_hash *
+lwes_hash_create_in_arena
+  (struct lwes_arena *arena,
+   int total_bins);
+
 int
 lwes_hash_destroy
   (struct lwes_hash* hash);
@@ -83,6 +121,10 @@ int
 lwes_hash_size
   (struct lwes_hash* hash);
 
+/*! \brief Rebuild the index and drop the space of removed entries
+ *
+ *  \return 0 on success, -3 if memory could not be allocated
+ */
 int
 lwes_hash_rehash
   (struct lwes_hash* hash);
@@ -93,6 +135,25 @@ lwes_hash_put
    char *key,
    void *value);
 
+/*! \brief Put a key whose hash value is already known
+ *
+ *  Like lwes_hash_put, for keys such as the names an event type db keeps,
+ *  which are hashed once rather than on every put.
+ *
+ *  \param[in] hash the hash to put into
+ *  \param[in] key the key, which the hash keeps
+ *  \param[in] hash_value lwes_hash of the key
+ *  \param[in] value the value
+ *  \return the old value if the key was there, NULL if it was not, value
+ *          itself on failure
+ */
+void *
+lwes_hash_put_with_hash
+  (struct lwes_hash* hash,
+   char *key,
+   unsigned int hash_value,
+   void *value);
+
 void *
 lwes_hash_get
   (struct lwes_hash* hash,
@@ -121,6 +182,15 @@ char *
 lwes_hash_enumeration_next_element
   (struct lwes_hash_enumeration *enumeration);
 
+/*! \brief The hash value a key is stored under
+ *
+ *  \param[in] key the key to hash
+ *  \return the hash value of the key
+ */
+unsigned int
+lwes_hash
+  (const char *key);
+
 #ifdef __cplusplus
 }
 #endif
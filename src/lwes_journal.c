@@ -0,0 +1,498 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#include "lwes_journal.h"
+#include "lwes_marshall_functions.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* the most bytes one name can add to a footer */
+#define LWES_JOURNAL_MAX_NAME_ENTRY (1 + 255 + 4)
+
+/* the most names a footer can list */
+#define LWES_JOURNAL_MAX_NAMES 65535
+
+/* how many sequence numbers are tried for a file name before giving up */
+#define LWES_JOURNAL_OPEN_ATTEMPTS 1000
+
+/* the count of records with one name in the block being filled, the
+   entry is its own key so one allocation covers both */
+struct lwes_journal_name
+{
+  LWES_U_INT_32 count;
+  char          name[1];
+};
+
+/*************************************************************************
+  PRIVATE API prototypes, shouldn't be called by a user of the library.
+ *************************************************************************/
+static void
+lwes_journal_clear_block
+  (struct lwes_journal *journal);
+
+static int
+lwes_journal_open_file
+  (struct lwes_journal *journal);
+
+static void
+lwes_journal_close_file
+  (struct lwes_journal *journal);
+
+static int
+lwes_journal_rotation_due
+  (struct lwes_journal *journal,
+   LWES_INT_64 now);
+
+static int
+lwes_journal_write_fully
+  (int fd,
+   const LWES_BYTE *bytes,
+   size_t length);
+
+static int
+lwes_journal_write_block
+  (struct lwes_journal *journal);
+
+/*************************************************************************
+  PUBLIC API
+ *************************************************************************/
+struct lwes_journal *
+lwes_journal_create
+  (const char *prefix,
+   size_t block_size,
+   size_t max_file_size,
+   unsigned int max_file_seconds)
+{
+  struct lwes_journal *journal;
+  size_t min_block_size = LWES_JOURNAL_BLOCK_HEADER_SIZE
+                          + LWES_JOURNAL_RECORD_HEADER_SIZE + MAX_MSG_SIZE
+                          + LWES_JOURNAL_FOOTER_SIZE
+                          + LWES_JOURNAL_MAX_NAME_ENTRY;
+
+  if (prefix == NULL || prefix[0] == '\0' || block_size > 0x7fffffff)
+    {
+      return NULL;
+    }
+  if (block_size == 0)
+    {
+      block_size = LWES_JOURNAL_DEFAULT_BLOCK_SIZE;
+    }
+  if (block_size < min_block_size)
+    {
+      block_size = min_block_size;
+    }
+
+  journal = (struct lwes_journal *) malloc (sizeof (struct lwes_journal));
+  if (journal == NULL)
+    {
+      return NULL;
+    }
+
+  journal->block = (LWES_BYTE_P) malloc (block_size);
+  journal->names = lwes_hash_create ();
+  if (journal->block == NULL || journal->names == NULL)
+    {
+      if (journal->names != NULL)
+        {
+          lwes_hash_destroy (journal->names);
+        }
+      free (journal->block);
+      free (journal);
+      return NULL;
+    }
+
+  journal->prefix[0] = '\0';
+  strncat (journal->prefix, prefix, FILENAME_MAX - 1);
+  journal->path[0] = '\0';
+  journal->fd = -1;
+  journal->block_size = block_size;
+  journal->max_file_size = max_file_size;
+  journal->max_file_seconds = max_file_seconds;
+  journal->file_size = 0;
+  journal->file_start = 0;
+  journal->file_sequence = 0;
+  journal->files = 0;
+  journal->blocks = 0;
+  journal->events = 0;
+  journal->bytes = 0;
+  journal->dropped = 0;
+  lwes_journal_clear_block (journal);
+
+  return journal;
+}
+
+int
+lwes_journal_write
+  (struct lwes_journal *journal,
+   LWES_BYTE_P bytes,
+   size_t length,
+   LWES_INT_64 receipt_time,
+   LWES_IP_ADDR sender_ip,
+   LWES_U_INT_16 sender_port)
+{
+  struct lwes_journal_name *entry;
+  char name[256];
+  size_t name_length;
+  size_t needed;
+  size_t offset;
+  int ret = 0;
+
+  if (journal == NULL || bytes == NULL || length == 0
+      || length > MAX_MSG_SIZE)
+    {
+      return -1;
+    }
+
+  /* every event starts with its name as a short string */
+  name_length = bytes[0];
+  if (name_length == 0 || length < 1 + name_length)
+    {
+      return -1;
+    }
+  memcpy (name, bytes + 1, name_length);
+  name[name_length] = '\0';
+
+  if (lwes_journal_rotation_due (journal, receipt_time))
+    {
+      ret = lwes_journal_rotate (journal);
+    }
+
+  /* a full block is written before the event goes into a new one */
+  entry = (struct lwes_journal_name *) lwes_hash_get (journal->names, name);
+  needed = LWES_JOURNAL_RECORD_HEADER_SIZE + length
+           + (entry == NULL ? 1 + name_length + 4 : 0);
+  if (journal->block_used + journal->footer_size + needed
+        > journal->block_size
+      || (entry == NULL
+          && lwes_hash_size (journal->names) >= LWES_JOURNAL_MAX_NAMES))
+    {
+      if (lwes_journal_write_block (journal) < 0)
+        {
+          ret = -2;
+        }
+      entry = NULL;
+    }
+
+  if (entry == NULL)
+    {
+      entry = (struct lwes_journal_name *)
+        malloc (sizeof (struct lwes_journal_name) + name_length);
+      if (entry == NULL)
+        {
+          return -3;
+        }
+      entry->count = 0;
+      memcpy (entry->name, name, name_length + 1);
+      if (lwes_hash_put (journal->names, entry->name, entry) == entry)
+        {
+          free (entry);
+          return -3;
+        }
+      journal->footer_size += 1 + name_length + 4;
+    }
+  entry->count++;
+
+  offset = journal->block_used;
+  marshall_U_INT_16 ((LWES_U_INT_16) length, journal->block,
+                     journal->block_size, &offset);
+  marshall_INT_64 (receipt_time, journal->block,
+                   journal->block_size, &offset);
+  marshall_U_INT_32 (ntohl (sender_ip.s_addr), journal->block,
+                     journal->block_size, &offset);
+  marshall_U_INT_16 (sender_port, journal->block,
+                     journal->block_size, &offset);
+  memcpy (journal->block + offset, bytes, length);
+  journal->block_used = offset + length;
+
+  if (journal->block_records == 0 || receipt_time < journal->block_first)
+    {
+      journal->block_first = receipt_time;
+    }
+  if (journal->block_records == 0 || receipt_time > journal->block_last)
+    {
+      journal->block_last = receipt_time;
+    }
+  journal->block_records++;
+
+  return ret;
+}
+
+int
+lwes_journal_tick
+  (struct lwes_journal *journal,
+   LWES_INT_64 now)
+{
+  if (journal == NULL)
+    {
+      return -1;
+    }
+
+  if (lwes_journal_rotation_due (journal, now))
+    {
+      return lwes_journal_rotate (journal);
+    }
+
+  return lwes_journal_write_block (journal);
+}
+
+int
+lwes_journal_rotate
+  (struct lwes_journal *journal)
+{
+  int ret;
+
+  if (journal == NULL)
+    {
+      return -1;
+    }
+
+  ret = lwes_journal_write_block (journal);
+  lwes_journal_close_file (journal);
+
+  return ret;
+}
+
+int
+lwes_journal_destroy
+  (struct lwes_journal *journal)
+{
+  int ret;
+
+  if (journal == NULL)
+    {
+      return -1;
+    }
+
+  ret = lwes_journal_rotate (journal);
+  lwes_journal_clear_block (journal);
+  lwes_hash_destroy (journal->names);
+  free (journal->block);
+  free (journal);
+
+  return ret;
+}
+
+/*************************************************************************
+  PRIVATE API
+ *************************************************************************/
+static void
+lwes_journal_clear_block
+  (struct lwes_journal *journal)
+{
+  struct lwes_hash_enumeration e;
+  char *name;
+
+  if (lwes_hash_keys (journal->names, &e))
+    {
+      while (lwes_hash_enumeration_has_more_elements (&e))
+        {
+          name = lwes_hash_enumeration_next_element (&e);
+          free (lwes_hash_remove (journal->names, name));
+        }
+    }
+
+  journal->block_used = LWES_JOURNAL_BLOCK_HEADER_SIZE;
+  journal->footer_size = LWES_JOURNAL_FOOTER_SIZE;
+  journal->block_records = 0;
+  journal->block_first = 0;
+  journal->block_last = 0;
+}
+
+static int
+lwes_journal_open_file
+  (struct lwes_journal *journal)
+{
+  char stamp[32];
+  time_t seconds = (time_t) (journal->block_first / 1000000000LL);
+  struct tm tm;
+  int attempt;
+
+  if (gmtime_r (&seconds, &tm) == NULL
+      || strftime (stamp, sizeof (stamp), "%Y%m%d%H%M%S", &tm) == 0)
+    {
+      return -1;
+    }
+
+  /* files are never appended to, so a name already taken is skipped */
+  for (attempt = 0; attempt < LWES_JOURNAL_OPEN_ATTEMPTS; ++attempt)
+    {
+      if (snprintf (journal->path, sizeof (journal->path), "%s.%s.%u.lwj",
+                    journal->prefix, stamp, journal->file_sequence++)
+            >= (int) sizeof (journal->path))
+        {
+          break;
+        }
+      journal->fd = open (journal->path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+      if (journal->fd >= 0)
+        {
+          journal->file_size = 0;
+          journal->file_start = journal->block_first;
+          journal->files++;
+          return 0;
+        }
+      if (errno != EEXIST)
+        {
+          break;
+        }
+    }
+
+  journal->path[0] = '\0';
+  return -1;
+}
+
+static void
+lwes_journal_close_file
+  (struct lwes_journal *journal)
+{
+  if (journal->fd >= 0)
+    {
+      close (journal->fd);
+      journal->fd = -1;
+      journal->path[0] = '\0';
+    }
+}
+
+/* whether the events of the current file, or of the block which will
+   start the next one, go back further than a file may */
+static int
+lwes_journal_rotation_due
+  (struct lwes_journal *journal,
+   LWES_INT_64 now)
+{
+  LWES_INT_64 start;
+
+  if (journal->max_file_seconds == 0)
+    {
+      return 0;
+    }
+  if (journal->fd >= 0)
+    {
+      start = journal->file_start;
+    }
+  else if (journal->block_records > 0)
+    {
+      start = journal->block_first;
+    }
+  else
+    {
+      return 0;
+    }
+
+  return now - start
+           >= (LWES_INT_64) journal->max_file_seconds * 1000000000LL;
+}
+
+static int
+lwes_journal_write_fully
+  (int fd,
+   const LWES_BYTE *bytes,
+   size_t length)
+{
+  ssize_t n;
+
+  while (length > 0)
+    {
+      n = write (fd, bytes, length);
+      if (n < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+          return -1;
+        }
+      bytes += n;
+      length -= (size_t) n;
+    }
+
+  return 0;
+}
+
+/* finishes the block with its header and footer, and writes it with a
+   single write, in a new file if the current one would grow too large */
+static int
+lwes_journal_write_block
+  (struct lwes_journal *journal)
+{
+  struct lwes_hash_enumeration e;
+  struct lwes_journal_name *entry;
+  LWES_U_INT_32 footer = (LWES_U_INT_32) journal->block_used;
+  size_t length = journal->block_used + journal->footer_size;
+  size_t offset = 0;
+  int ret = 0;
+
+  if (journal->block_records == 0)
+    {
+      return 0;
+    }
+
+  memcpy (journal->block, LWES_JOURNAL_MAGIC, 4);
+  offset = 4;
+  marshall_U_INT_32 ((LWES_U_INT_32) length, journal->block,
+                     journal->block_size, &offset);
+  marshall_U_INT_32 (journal->block_records, journal->block,
+                     journal->block_size, &offset);
+  marshall_U_INT_32 (footer, journal->block, journal->block_size, &offset);
+
+  offset = footer;
+  marshall_INT_64 (journal->block_first, journal->block,
+                   journal->block_size, &offset);
+  marshall_INT_64 (journal->block_last, journal->block,
+                   journal->block_size, &offset);
+  marshall_U_INT_16 ((LWES_U_INT_16) lwes_hash_size (journal->names),
+                     journal->block, journal->block_size, &offset);
+  if (lwes_hash_keys (journal->names, &e))
+    {
+      while (lwes_hash_enumeration_has_more_elements (&e))
+        {
+          entry = (struct lwes_journal_name *)
+            lwes_hash_get (journal->names,
+                           lwes_hash_enumeration_next_element (&e));
+          marshall_SHORT_STRING (entry->name, journal->block,
+                                 journal->block_size, &offset);
+          marshall_U_INT_32 (entry->count, journal->block,
+                             journal->block_size, &offset);
+        }
+    }
+
+  if (journal->fd >= 0 && journal->max_file_size > 0
+      && journal->file_size > 0
+      && journal->file_size + length > journal->max_file_size)
+    {
+      lwes_journal_close_file (journal);
+    }
+
+  if ((journal->fd < 0 && lwes_journal_open_file (journal) < 0)
+      || lwes_journal_write_fully (journal->fd, journal->block, length) < 0)
+    {
+      /* the next block starts a new file rather than follow a partial
+         one, which a reader could not get past */
+      lwes_journal_close_file (journal);
+      journal->dropped += journal->block_records;
+      ret = -2;
+    }
+  else
+    {
+      journal->file_size += length;
+      journal->blocks++;
+      journal->events += journal->block_records;
+      journal->bytes += length;
+    }
+
+  lwes_journal_clear_block (journal);
+
+  return ret;
+}
@@ -0,0 +1,219 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#ifndef __LWES_JOURNAL_H
+#define __LWES_JOURNAL_H
+
+#include "lwes_types.h"
+#include "lwes_hash.h"
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! \file lwes_journal.h
+ *  \brief Functions for appending serialized events to binary journals
+ *
+ *  A journal is a series of files, each a series of blocks.  Events are
+ *  buffered into a block in memory, and the whole block is written with
+ *  a single write once it is full, so the disk sees large sequential
+ *  writes.  All integers are big endian, as on the wire.
+ *
+ *  A block is
+ *    - a header
+ *      - 4 bytes of LWES_JOURNAL_MAGIC
+ *      - a 32 bit length of the whole block, header and footer included
+ *      - a 32 bit number of records
+ *      - a 32 bit offset of the footer from the start of the block
+ *    - the records, each
+ *      - a 16 bit length of the serialized event
+ *      - a 64 bit receipt time, as nanoseconds since epoch
+ *      - the 32 bit ip address and 16 bit port of the sender
+ *      - the serialized event
+ *    - a footer, indexing the block
+ *      - the 64 bit earliest and latest receipt times of its records
+ *      - a 16 bit number of event names
+ *      - for each name a short string, and a 32 bit count of its records
+ *
+ *  so a reader can go from block to block by their lengths, and use the
+ *  footers to skip the blocks it is not interested in.
+ *
+ *  A new file is started when the current one would grow beyond its
+ *  maximum size, or has been open for longer than its maximum time.
+ *  Files are named after the journal's prefix, the UTC time of the
+ *  first event in them, and a sequence number, for example
+ *  prefix.20081031235959.0.lwj
+ */
+
+/*! The first bytes of every block */
+#define LWES_JOURNAL_MAGIC "LWJB"
+
+/*! Number of bytes in a block's header */
+#define LWES_JOURNAL_BLOCK_HEADER_SIZE 16
+
+/*! Number of bytes before the serialized event in a record */
+#define LWES_JOURNAL_RECORD_HEADER_SIZE 16
+
+/*! Number of bytes in a footer before the names */
+#define LWES_JOURNAL_FOOTER_SIZE 18
+
+/*! Block size used when 0 is passed to lwes_journal_create */
+#define LWES_JOURNAL_DEFAULT_BLOCK_SIZE (1024 * 1024)
+
+/*! \struct lwes_journal lwes_journal.h
+ *  \brief A journal being written
+ */
+struct lwes_journal
+{
+  /*! the start of the name of every file */
+  char prefix[FILENAME_MAX];
+  /*! the name of the file being written, empty if none is open */
+  char path[FILENAME_MAX];
+  /*! the file being written, -1 if none is open */
+  int fd;
+  /*! the block being filled */
+  LWES_BYTE_P block;
+  /*! the most bytes a block may take, footer included */
+  size_t block_size;
+  /*! bytes of the block used by its header and records */
+  size_t block_used;
+  /*! bytes the block's footer will take */
+  size_t footer_size;
+  /*! number of records in the block */
+  LWES_U_INT_32 block_records;
+  /*! earliest and latest receipt times in the block */
+  LWES_INT_64 block_first;
+  LWES_INT_64 block_last;
+  /*! count of records in the block for each event name */
+  struct lwes_hash *names;
+  /*! a file is not written beyond this many bytes, 0 for no limit */
+  size_t max_file_size;
+  /*! a file is not written to after this many seconds, 0 for no limit */
+  unsigned int max_file_seconds;
+  /*! bytes written to the current file */
+  size_t file_size;
+  /*! receipt time of the first event of the current file */
+  LWES_INT_64 file_start;
+  /*! sequence number of the next file */
+  unsigned int file_sequence;
+  /*! number of files started */
+  LWES_U_INT_64 files;
+  /*! number of blocks written */
+  LWES_U_INT_64 blocks;
+  /*! number of events written */
+  LWES_U_INT_64 events;
+  /*! number of bytes written */
+  LWES_U_INT_64 bytes;
+  /*! number of events lost because a block could not be written */
+  LWES_U_INT_64 dropped;
+};
+
+/*! \brief Create a journal
+ *
+ *  No file is created until the first block is written.
+ *
+ *  \param[in] prefix           the path each file name starts with
+ *  \param[in] block_size       the most bytes a block takes, 0 for
+ *                              LWES_JOURNAL_DEFAULT_BLOCK_SIZE, it is
+ *                              raised if needed to hold any event
+ *  \param[in] max_file_size    start a new file rather than grow one
+ *                              beyond this many bytes, 0 for no limit
+ *  \param[in] max_file_seconds start a new file once events are received
+ *                              this many seconds after the first one in
+ *                              the current file, 0 for no limit
+ *
+ *  \see lwes_journal_destroy
+ *
+ *  \return the newly created journal, NULL on failure
+ */
+struct lwes_journal *
+lwes_journal_create
+  (const char *prefix,
+   size_t block_size,
+   size_t max_file_size,
+   unsigned int max_file_seconds);
+
+/*! \brief Append a serialized event to a journal
+ *
+ *  The bytes are copied, typically after the header fields were added
+ *  with lwes_listener_add_header_fields, and may be reused on return.
+ *  The block they went into may only be written by a later call.
+ *
+ *  \param[in] journal      the journal to append to
+ *  \param[in] bytes        the serialized event
+ *  \param[in] length       the number of bytes of the serialized event
+ *  \param[in] receipt_time when the event was received, as nanoseconds
+ *                          since epoch
+ *  \param[in] sender_ip    the address the event was sent from
+ *  \param[in] sender_port  the port the event was sent from
+ *
+ *  \return 0 on success, -1 for a bad argument, -2 if a full block could
+ *          not be written, in which case its events are dropped but this
+ *          one is kept, -3 if memory could not be allocated
+ */
+int
+lwes_journal_write
+  (struct lwes_journal *journal,
+   LWES_BYTE_P bytes,
+   size_t length,
+   LWES_INT_64 receipt_time,
+   LWES_IP_ADDR sender_ip,
+   LWES_U_INT_16 sender_port);
+
+/*! \brief Write out the partial block, and start a new file if it is due
+ *
+ *  Meant to be called periodically, so that events received while
+ *  traffic is light are not kept in memory indefinitely, and files are
+ *  rotated on time even when no events arrive.
+ *
+ *  \param[in] journal the journal to write
+ *  \param[in] now     the current time, as nanoseconds since epoch
+ *
+ *  \return 0 on success, -1 for a bad argument, -2 if the block could not
+ *          be written
+ */
+int
+lwes_journal_tick
+  (struct lwes_journal *journal,
+   LWES_INT_64 now);
+
+/*! \brief Write out the partial block and close the current file
+ *
+ *  The next block is written to a new file.
+ *
+ *  \param[in] journal the journal to rotate
+ *
+ *  \return 0 on success, -1 for a bad argument, -2 if the block could not
+ *          be written
+ */
+int
+lwes_journal_rotate
+  (struct lwes_journal *journal);
+
+/*! \brief Write out the partial block and destroy a journal
+ *
+ *  \param[in] journal the journal to destroy
+ *
+ *  \return 0 on success, -1 for a bad argument, -2 if the block could not
+ *          be written, the journal is destroyed either way
+ */
+int
+lwes_journal_destroy
+  (struct lwes_journal *journal);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LWES_JOURNAL_H */
@@ -0,0 +1,384 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#include "lwes_journal_reader.h"
+#include "lwes_marshall_functions.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* number of blocks the index first has room for, it doubles as needed */
+#define LWES_JOURNAL_READER_INITIAL_BLOCKS 64
+
+/*************************************************************************
+  PRIVATE API prototypes, shouldn't be called by a user of the library.
+ *************************************************************************/
+static int
+lwes_journal_reader_index
+  (struct lwes_journal_reader *reader);
+
+static int
+lwes_journal_reader_find_block
+  (struct lwes_journal_reader *reader,
+   size_t offset);
+
+static void
+lwes_journal_reader_prefetch
+  (struct lwes_journal_reader *reader,
+   int block);
+
+/*************************************************************************
+  PUBLIC API
+ *************************************************************************/
+struct lwes_journal_reader *
+lwes_journal_reader_open
+  (const char *path)
+{
+  struct lwes_journal_reader *reader;
+  struct stat st;
+  void *map = NULL;
+  int fd;
+
+  if (path == NULL)
+    {
+      return NULL;
+    }
+
+  fd = open (path, O_RDONLY);
+  if (fd < 0)
+    {
+      return NULL;
+    }
+  if (fstat (fd, &st) != 0)
+    {
+      close (fd);
+      return NULL;
+    }
+  /* the mapping keeps the file open, so the descriptor is not needed */
+  if (st.st_size > 0)
+    {
+      map = mmap (NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+  close (fd);
+  if (map == MAP_FAILED)
+    {
+      return NULL;
+    }
+
+  reader = (struct lwes_journal_reader *)
+    malloc (sizeof (struct lwes_journal_reader));
+  if (reader == NULL)
+    {
+      if (map != NULL)
+        {
+          munmap (map, (size_t) st.st_size);
+        }
+      return NULL;
+    }
+  reader->map = (LWES_BYTE_P) map;
+  reader->size = (size_t) st.st_size;
+  reader->valid_size = 0;
+  reader->blocks = NULL;
+  reader->number_of_blocks = 0;
+
+  if (map != NULL)
+    {
+      /* indexing hops from one block header to the next, so reading
+         ahead would pull in every page of records it skips */
+      madvise (map, reader->size, MADV_RANDOM);
+      if (lwes_journal_reader_index (reader) < 0)
+        {
+          lwes_journal_reader_close (reader);
+          return NULL;
+        }
+      /* records are read front to back, so the kernel can read ahead
+         and drop the pages behind */
+      madvise (map, reader->size, MADV_SEQUENTIAL);
+    }
+
+  return reader;
+}
+
+int
+lwes_journal_reader_close
+  (struct lwes_journal_reader *reader)
+{
+  int ret = 0;
+
+  if (reader == NULL)
+    {
+      return -1;
+    }
+
+  if (reader->map != NULL && munmap (reader->map, reader->size) != 0)
+    {
+      ret = -2;
+    }
+  free (reader->blocks);
+  free (reader);
+
+  return ret;
+}
+
+int
+lwes_journal_cursor_init
+  (struct lwes_journal_reader *reader,
+   struct lwes_journal_cursor *cursor,
+   size_t begin,
+   size_t end)
+{
+  if (reader == NULL || cursor == NULL || begin > end)
+    {
+      return -1;
+    }
+
+  cursor->reader = reader;
+  cursor->first_block = lwes_journal_reader_find_block (reader, begin);
+  cursor->end_block = lwes_journal_reader_find_block (reader, end);
+  cursor->block = cursor->first_block;
+  cursor->offset = 0;
+  if (cursor->block < cursor->end_block)
+    {
+      cursor->offset = reader->blocks[cursor->block].offset
+                       + LWES_JOURNAL_BLOCK_HEADER_SIZE;
+      lwes_journal_reader_prefetch (reader, cursor->block + 1);
+    }
+
+  return 0;
+}
+
+int
+lwes_journal_cursor_seek
+  (struct lwes_journal_cursor *cursor,
+   LWES_INT_64 receipt_time)
+{
+  struct lwes_journal_reader *reader;
+  struct lwes_journal_record record;
+  size_t offset;
+  int block;
+  int ret;
+
+  if (cursor == NULL || cursor->reader == NULL)
+    {
+      return -1;
+    }
+  reader = cursor->reader;
+
+  /* whole blocks are skipped using the index */
+  for (block = cursor->first_block;
+       block < cursor->end_block
+         && reader->blocks[block].last < receipt_time;
+       ++block)
+    {
+    }
+  cursor->block = block;
+  if (block >= cursor->end_block)
+    {
+      return 0;
+    }
+  cursor->offset = reader->blocks[block].offset
+                   + LWES_JOURNAL_BLOCK_HEADER_SIZE;
+  lwes_journal_reader_prefetch (reader, block + 1);
+
+  /* then the records of the block the time falls in */
+  while (1)
+    {
+      block = cursor->block;
+      offset = cursor->offset;
+      ret = lwes_journal_cursor_next (cursor, &record);
+      if (ret <= 0)
+        {
+          return ret;
+        }
+      if (record.receipt_time >= receipt_time)
+        {
+          cursor->block = block;
+          cursor->offset = offset;
+          return 0;
+        }
+    }
+}
+
+int
+lwes_journal_cursor_next
+  (struct lwes_journal_cursor *cursor,
+   struct lwes_journal_record *record)
+{
+  struct lwes_journal_reader *reader;
+  struct lwes_journal_block_index *block;
+  LWES_U_INT_16 length;
+  LWES_U_INT_32 ip;
+
+  if (cursor == NULL || cursor->reader == NULL || record == NULL)
+    {
+      return -1;
+    }
+  reader = cursor->reader;
+
+  while (cursor->block < cursor->end_block)
+    {
+      block = &(reader->blocks[cursor->block]);
+      if (cursor->offset < block->footer)
+        {
+          /* a record may not run into the footer */
+          if (! unmarshall_U_INT_16 (&length, reader->map, block->footer,
+                                     &(cursor->offset))
+              || ! unmarshall_INT_64 (&(record->receipt_time), reader->map,
+                                      block->footer, &(cursor->offset))
+              || ! unmarshall_U_INT_32 (&ip, reader->map, block->footer,
+                                        &(cursor->offset))
+              || ! unmarshall_U_INT_16 (&(record->sender_port), reader->map,
+                                        block->footer, &(cursor->offset))
+              || cursor->offset + length > block->footer)
+            {
+              return -2;
+            }
+          record->sender_ip.s_addr = htonl (ip);
+          record->bytes = reader->map + cursor->offset;
+          record->length = length;
+          cursor->offset += length;
+
+          /* the next record's header is likely in the next cache line */
+          __builtin_prefetch (reader->map + cursor->offset);
+          return 1;
+        }
+
+      cursor->block++;
+      if (cursor->block < cursor->end_block)
+        {
+          cursor->offset = reader->blocks[cursor->block].offset
+                           + LWES_JOURNAL_BLOCK_HEADER_SIZE;
+          lwes_journal_reader_prefetch (reader, cursor->block + 1);
+        }
+    }
+
+  return 0;
+}
+
+/*************************************************************************
+  PRIVATE API
+ *************************************************************************/
+
+/* walks the headers of the blocks, reading the time range of each from
+   its footer, stopping at the first one which is not whole */
+static int
+lwes_journal_reader_index
+  (struct lwes_journal_reader *reader)
+{
+  struct lwes_journal_block_index *blocks;
+  struct lwes_journal_block_index *index;
+  int capacity = 0;
+  size_t offset = 0;
+  size_t position;
+  LWES_U_INT_32 length;
+  LWES_U_INT_32 footer;
+
+  while (offset + LWES_JOURNAL_BLOCK_HEADER_SIZE <= reader->size
+         && memcmp (reader->map + offset, LWES_JOURNAL_MAGIC, 4) == 0)
+    {
+      position = offset + 4;
+      unmarshall_U_INT_32 (&length, reader->map, reader->size, &position);
+      if (length < LWES_JOURNAL_BLOCK_HEADER_SIZE + LWES_JOURNAL_FOOTER_SIZE
+          || length > reader->size - offset)
+        {
+          break;
+        }
+
+      if (reader->number_of_blocks == capacity)
+        {
+          capacity = (capacity == 0 ? LWES_JOURNAL_READER_INITIAL_BLOCKS
+                                    : capacity * 2);
+          blocks = (struct lwes_journal_block_index *)
+            realloc (reader->blocks,
+                     sizeof (struct lwes_journal_block_index) * capacity);
+          if (blocks == NULL)
+            {
+              return -3;
+            }
+          reader->blocks = blocks;
+        }
+      index = &(reader->blocks[reader->number_of_blocks]);
+
+      unmarshall_U_INT_32 (&(index->records), reader->map, reader->size,
+                           &position);
+      unmarshall_U_INT_32 (&footer, reader->map, reader->size, &position);
+      if (footer < LWES_JOURNAL_BLOCK_HEADER_SIZE
+          || footer > length - LWES_JOURNAL_FOOTER_SIZE)
+        {
+          break;
+        }
+      index->offset = offset;
+      index->footer = offset + footer;
+      position = index->footer;
+      unmarshall_INT_64 (&(index->first), reader->map, reader->size,
+                         &position);
+      unmarshall_INT_64 (&(index->last), reader->map, reader->size,
+                         &position);
+
+      reader->number_of_blocks++;
+      offset += length;
+    }
+  reader->valid_size = offset;
+
+  return 0;
+}
+
+/* the first block starting at or after offset */
+static int
+lwes_journal_reader_find_block
+  (struct lwes_journal_reader *reader,
+   size_t offset)
+{
+  int low = 0;
+  int high = reader->number_of_blocks;
+  int middle;
+
+  while (low < high)
+    {
+      middle = low + (high - low) / 2;
+      if (reader->blocks[middle].offset < offset)
+        {
+          low = middle + 1;
+        }
+      else
+        {
+          high = middle;
+        }
+    }
+
+  return low;
+}
+
+/* asks for a block to be read in while the one before it is scanned */
+static void
+lwes_journal_reader_prefetch
+  (struct lwes_journal_reader *reader,
+   int block)
+{
+  size_t page = (size_t) sysconf (_SC_PAGESIZE);
+  size_t begin;
+  size_t end;
+
+  if (block >= reader->number_of_blocks)
+    {
+      return;
+    }
+
+  begin = reader->blocks[block].offset & ~(page - 1);
+  end = (block + 1 < reader->number_of_blocks
+           ? reader->blocks[block + 1].offset
+           : reader->valid_size);
+  madvise (reader->map + begin, end - begin, MADV_WILLNEED);
+}
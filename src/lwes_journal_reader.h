@@ -0,0 +1,188 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#ifndef __LWES_JOURNAL_READER_H
+#define __LWES_JOURNAL_READER_H
+
+#include "lwes_types.h"
+#include "lwes_journal.h"
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! \file lwes_journal_reader.h
+ *  \brief Functions for reading the files of a journal
+ *
+ *  A file written by lwes_journal is mapped into memory and its records
+ *  are returned as pointers into the mapping, so nothing is copied and
+ *  the bytes can be handed straight to lwes_event_from_bytes or an
+ *  lwes_event_view.  When the file is opened the block headers and
+ *  footers are read into an index, one entry per block, which is used
+ *  to seek to a receipt time without reading the records before it.
+ *
+ *  The reader does not change once opened, so several threads may each
+ *  scan a disjoint range of the file with their own cursor, for example
+ *  by splitting the file size into equal byte ranges.
+ */
+
+/*! \struct lwes_journal_block_index lwes_journal_reader.h
+ *  \brief Where a block is in the file, and what its footer says
+ */
+struct lwes_journal_block_index
+{
+  /*! offset of the block in the file */
+  size_t offset;
+  /*! offset of the block's footer, where its records end */
+  size_t footer;
+  /*! number of records in the block */
+  LWES_U_INT_32 records;
+  /*! earliest and latest receipt times of the records */
+  LWES_INT_64 first;
+  LWES_INT_64 last;
+};
+
+/*! \struct lwes_journal_reader lwes_journal_reader.h
+ *  \brief An open journal file
+ */
+struct lwes_journal_reader
+{
+  /*! the file, mapped read only, NULL if it is empty */
+  LWES_BYTE_P map;
+  /*! number of bytes in the file */
+  size_t size;
+  /*! number of bytes of whole blocks at the start of the file, a block
+      being written or cut short is left out */
+  size_t valid_size;
+  /*! the blocks, in the order they are in the file */
+  struct lwes_journal_block_index *blocks;
+  /*! number of blocks */
+  int number_of_blocks;
+};
+
+/*! \struct lwes_journal_record lwes_journal_reader.h
+ *  \brief A record of a journal file
+ */
+struct lwes_journal_record
+{
+  /*! the serialized event, in the reader's mapping, which must not be
+      written to */
+  LWES_BYTE_P bytes;
+  /*! number of bytes of the serialized event */
+  size_t length;
+  /*! when the event was received, as nanoseconds since epoch */
+  LWES_INT_64 receipt_time;
+  /*! the address the event was sent from */
+  LWES_IP_ADDR sender_ip;
+  /*! the port the event was sent from */
+  LWES_U_INT_16 sender_port;
+};
+
+/*! \struct lwes_journal_cursor lwes_journal_reader.h
+ *  \brief A position in a range of blocks of a journal file
+ */
+struct lwes_journal_cursor
+{
+  /*! the reader being scanned */
+  struct lwes_journal_reader *reader;
+  /*! the first block of the range */
+  int first_block;
+  /*! the block being read */
+  int block;
+  /*! the first block past the range */
+  int end_block;
+  /*! the offset of the next record in the file */
+  size_t offset;
+};
+
+/*! \brief Open a journal file for reading
+ *
+ *  \param[in] path the file to open
+ *
+ *  \see lwes_journal_reader_close
+ *
+ *  \return the newly opened reader, NULL if the file could not be read
+ */
+struct lwes_journal_reader *
+lwes_journal_reader_open
+  (const char *path);
+
+/*! \brief Close a journal file
+ *
+ *  Unmaps the file, so no record read from it may be used afterwards.
+ *
+ *  \param[in] reader the reader to close
+ *
+ *  \return 0 on success, a negative number on failure
+ */
+int
+lwes_journal_reader_close
+  (struct lwes_journal_reader *reader);
+
+/*! \brief Start a cursor on the blocks which start in a range of bytes
+ *
+ *  Ranges which do not overlap cover different blocks, so a file can be
+ *  split between threads by dividing its size, whatever the blocks' sizes.
+ *
+ *  \param[in] reader the reader to scan
+ *  \param[out] cursor the cursor to start
+ *  \param[in] begin the first byte of the range
+ *  \param[in] end the byte past the range, the reader's size for the rest
+ *                 of the file
+ *
+ *  \return 0 on success, -1 for a bad argument
+ */
+int
+lwes_journal_cursor_init
+  (struct lwes_journal_reader *reader,
+   struct lwes_journal_cursor *cursor,
+   size_t begin,
+   size_t end);
+
+/*! \brief Move a cursor to the first record received at or after a time
+ *
+ *  The search starts from the beginning of the cursor's range, so a
+ *  cursor can be moved backwards as well as forwards.  Blocks whose records were all received earlier are skipped using the
+ *  index, so only the records of the block the time falls in are read.
+ *  The records of a block are expected to be in the order they were
+ *  received, which is how lwes_journal writes them.
+ *
+ *  \param[in] cursor the cursor to move
+ *  \param[in] receipt_time the time, as nanoseconds since epoch
+ *
+ *  \return 0 on success, -1 for a bad argument, -2 if a record is malformed
+ */
+int
+lwes_journal_cursor_seek
+  (struct lwes_journal_cursor *cursor,
+   LWES_INT_64 receipt_time);
+
+/*! \brief Get the next record from a cursor
+ *
+ *  \param[in] cursor the cursor to read from
+ *  \param[out] record set to the record
+ *
+ *  \return 1 if a record was read, 0 at the end of the cursor's range,
+ *          -1 for a bad argument, -2 if a record is malformed
+ */
+int
+lwes_journal_cursor_next
+  (struct lwes_journal_cursor *cursor,
+   struct lwes_journal_record *record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LWES_JOURNAL_READER_H */
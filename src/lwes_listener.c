@@ -15,6 +15,30 @@
 #include "lwes_time_functions.h"
 #include "lwes_marshall_functions.h"
 
+/*************************************************************************
+  PRIVATE API prototypes, shouldn't be called by a user of the library.
+ *************************************************************************/
+static int
+lwes_listener_recv_batch_common
+  (struct lwes_listener *listener,
+   struct lwes_listener_packet **packets,
+   unsigned int max,
+   LWES_BOOLEAN use_timeout,
+   unsigned int timeout_ms);
+
+static LWES_INT_64
+lwes_listener_kernel_receipt_time
+  (struct lwes_listener *listener,
+   unsigned int index);
+
+static int
+lwes_listener_update_kernel_filter
+  (struct lwes_listener *listener);
+
+/*************************************************************************
+  PUBLIC API
+ *************************************************************************/
+
 struct lwes_listener *
 lwes_listener_create
   (LWES_SHORT_STRING address,
@@ -40,6 +64,16 @@ lwes_listener_create
       return NULL;
     }
 
+  listener->batch_buffer = NULL;
+  listener->batch = NULL;
+  listener->batch_capacity = 0;
+  listener->batch_head = 0;
+  listener->receipt_time_nanos = FALSE;
+  listener->subscriptions = NULL;
+  listener->subscription_prefixes = 0;
+  listener->filtered = 0;
+  listener->kernel_filter = FALSE;
+
   listener->dtmp =
     (struct lwes_event_deserialize_tmp *)
       malloc (sizeof (struct lwes_event_deserialize_tmp));
@@ -75,11 +109,24 @@ lwes_listener_add_header_fields
    size_t *len)
 {
   /* grab some information from the packet and add it to the event */
-  LWES_INT_64 receipt_time = currentTimeMillisLongLong();
+  LWES_INT_64 receipt_time = lwes_listener_kernel_receipt_time (listener, 0);
   LWES_IP_ADDR sender_ip = listener->connection.sender_ip_addr.sin_addr;
   LWES_U_INT_16 sender_port =
     ntohs(listener->connection.sender_ip_addr.sin_port);
 
+  if (listener->receipt_time_nanos)
+    {
+      if (receipt_time == 0)
+        {
+          receipt_time = currentTimeNanosLongLong ();
+        }
+      return lwes_event_add_headers_nanos (bytes, max, len,
+                                           receipt_time,
+                                           sender_ip, sender_port);
+    }
+
+  receipt_time = (receipt_time == 0 ? currentTimeMillisLongLong ()
+                                    : receipt_time / 1000000);
   return lwes_event_add_headers (bytes, max, len,
                                  receipt_time, sender_ip, sender_port);
 }
@@ -126,6 +173,193 @@ lwes_listener_event_has_name
   return memcmp ((const unsigned char *)&(bytes[1]), name, strlen (name));
 }
 
+int
+lwes_listener_subscribe
+  (struct lwes_listener *listener,
+   LWES_CONST_SHORT_STRING pattern)
+{
+  const char *star;
+  size_t len;
+  char *key;
+
+  if (listener == NULL || pattern == NULL)
+    {
+      return -1;
+    }
+
+  len = strlen (pattern);
+  if (len == 0 || len > SHORT_STRING_MAX)
+    {
+      return -1;
+    }
+
+  /* a '*' is only allowed to end a scope, as in "Click::*" */
+  star = strchr (pattern, '*');
+  if (star != NULL
+      && (star != pattern + len - 1 || len < 4
+          || pattern[len - 2] != ':' || pattern[len - 3] != ':'))
+    {
+      return -1;
+    }
+
+  if (listener->subscriptions == NULL)
+    {
+      listener->subscriptions = lwes_hash_create ();
+      if (listener->subscriptions == NULL)
+        {
+          return -3;
+        }
+    }
+  else if (lwes_hash_contains_key (listener->subscriptions, pattern))
+    {
+      return 0;
+    }
+
+  key = (char *) malloc (len + 1);
+  if (key == NULL)
+    {
+      return -3;
+    }
+  memcpy (key, pattern, len + 1);
+
+  /* the hash only holds the keys, so the key doubles as the value */
+  if (lwes_hash_put (listener->subscriptions, key, key) != NULL)
+    {
+      free (key);
+      return -3;
+    }
+  if (star != NULL)
+    {
+      listener->subscription_prefixes++;
+    }
+
+  return lwes_listener_update_kernel_filter (listener);
+}
+
+int
+lwes_listener_clear_subscriptions
+  (struct lwes_listener *listener)
+{
+  struct lwes_hash_enumeration e;
+  char *key;
+
+  if (listener == NULL)
+    {
+      return -1;
+    }
+
+  if (listener->subscriptions != NULL)
+    {
+      if (lwes_hash_keys (listener->subscriptions, &e))
+        {
+          while (lwes_hash_enumeration_has_more_elements (&e))
+            {
+              key = lwes_hash_enumeration_next_element (&e);
+              lwes_hash_remove (listener->subscriptions, key);
+              free (key);
+            }
+        }
+      lwes_hash_destroy (listener->subscriptions);
+      listener->subscriptions = NULL;
+    }
+  listener->subscription_prefixes = 0;
+
+  return lwes_listener_update_kernel_filter (listener);
+}
+
+int
+lwes_listener_set_kernel_filter
+  (struct lwes_listener *listener,
+   LWES_BOOLEAN enable)
+{
+  if (listener == NULL)
+    {
+      return -1;
+    }
+
+  if (! enable)
+    {
+      listener->kernel_filter = FALSE;
+      return lwes_net_set_name_filter (&(listener->connection), NULL, 0);
+    }
+
+  listener->kernel_filter = TRUE;
+  return lwes_listener_update_kernel_filter (listener);
+}
+
+int
+lwes_listener_is_subscribed
+  (struct lwes_listener *listener,
+   LWES_BYTE_P bytes,
+   size_t len)
+{
+  /* room for the name, a '*' replacing the character after a "::" at its
+     very end, and the terminator */
+  char name[SHORT_STRING_MAX + 2];
+  size_t name_len;
+  size_t i;
+
+  if (listener == NULL || bytes == NULL)
+    {
+      return -1;
+    }
+
+  if (listener->subscriptions == NULL)
+    {
+      return 1;
+    }
+
+  if (len < 2)
+    {
+      return -1;
+    }
+
+  /* first byte is the length, the name follows */
+  name_len = (LWES_BYTE)bytes[0];
+  if (name_len == 0 || len < 1 + name_len)
+    {
+      return -1;
+    }
+  memcpy (name, &(bytes[1]), name_len);
+  name[name_len] = '\0';
+
+  if (lwes_hash_contains_key (listener->subscriptions, name))
+    {
+      return 1;
+    }
+
+  /* try each enclosing scope as "Scope::*", working from the innermost
+     out so the name can be truncated in place */
+  if (listener->subscription_prefixes > 0)
+    {
+      for (i = name_len - 1; i > 0; i--)
+        {
+          if (name[i - 1] == ':' && name[i] == ':')
+            {
+              name[i + 1] = '*';
+              name[i + 2] = '\0';
+              if (lwes_hash_contains_key (listener->subscriptions, name))
+                {
+                  return 1;
+                }
+            }
+        }
+    }
+
+  return 0;
+}
+
+LWES_U_INT_64
+lwes_listener_get_filtered_count
+  (struct lwes_listener *listener)
+{
+  if (listener == NULL)
+    {
+      return 0;
+    }
+
+  return listener->filtered;
+}
 
 /* FIXME: Make private in next major release of lwes */
 int
@@ -193,14 +427,21 @@ lwes_listener_recv_bytes
 {
   int n = 0;
 
-  if ((n = lwes_net_recv_bytes (&(listener->connection),
-                                bytes,
-                                max)) < 0 )
+  for (;;)
     {
-      return -2;
-    }
+      if ((n = lwes_net_recv_bytes (&(listener->connection),
+                                    bytes,
+                                    max)) < 0 )
+        {
+          return -2;
+        }
 
-  return n;
+      if (lwes_listener_is_subscribed (listener, bytes, (size_t)n) > 0)
+        {
+          return n;
+        }
+      listener->filtered++;
+    }
 }
 
 int
@@ -211,18 +452,156 @@ lwes_listener_recv_bytes_by
    unsigned int timeout_ms)
 {
   int n = 0;
+  LWES_INT_64 deadline = 0;
+  LWES_INT_64 now;
 
-  if ((n = lwes_net_recv_bytes_by (&(listener->connection),
-                                   bytes,
-                                   max,
-                                   timeout_ms)) < 0 )
+  /* the clock is only needed if packets may be dropped */
+  if (listener->subscriptions != NULL)
     {
-      return -2;
+      deadline = currentTimeMillisLongLong () + timeout_ms;
     }
 
-  return n;
+  for (;;)
+    {
+      if ((n = lwes_net_recv_bytes_by (&(listener->connection),
+                                       bytes,
+                                       max,
+                                       timeout_ms)) < 0 )
+        {
+          return -2;
+        }
+
+      if (lwes_listener_is_subscribed (listener, bytes, (size_t)n) > 0)
+        {
+          return n;
+        }
+      listener->filtered++;
+
+      /* keep waiting for whatever is left of the timeout */
+      now = currentTimeMillisLongLong ();
+      if (now >= deadline)
+        {
+          return -2;
+        }
+      timeout_ms = (unsigned int)(deadline - now);
+    }
+}
+
+int
+lwes_listener_set_batch_size
+  (struct lwes_listener *listener,
+   unsigned int ring_size)
+{
+  LWES_BYTE_P buffer = NULL;
+  struct lwes_listener_packet *batch = NULL;
+  unsigned int i;
+
+  if (listener == NULL)
+    {
+      return -1;
+    }
+
+  if (ring_size > 0)
+    {
+      buffer = (LWES_BYTE_P) malloc ((size_t)ring_size * MAX_MSG_SIZE);
+      batch = (struct lwes_listener_packet *)
+        malloc (sizeof (struct lwes_listener_packet) * ring_size);
+      if (buffer == NULL || batch == NULL)
+        {
+          free (buffer);
+          free (batch);
+          return -2;
+        }
+      for (i = 0; i < ring_size; i++)
+        {
+          batch[i].bytes = buffer + (size_t)i * MAX_MSG_SIZE;
+          batch[i].length = 0;
+          batch[i].receipt_time = 0;
+          batch[i].receipt_time_nanos = 0;
+        }
+    }
+
+  free (listener->batch_buffer);
+  free (listener->batch);
+  listener->batch_buffer = buffer;
+  listener->batch = batch;
+  listener->batch_capacity = ring_size;
+  listener->batch_head = 0;
+
+  return 0;
+}
+
+int
+lwes_listener_recv_batch
+  (struct lwes_listener *listener,
+   struct lwes_listener_packet **packets,
+   unsigned int max)
+{
+  return lwes_listener_recv_batch_common (listener, packets, max, FALSE, 0);
+}
+
+int
+lwes_listener_recv_batch_by
+  (struct lwes_listener *listener,
+   struct lwes_listener_packet **packets,
+   unsigned int max,
+   unsigned int timeout_ms)
+{
+  return lwes_listener_recv_batch_common (listener, packets, max,
+                                          TRUE, timeout_ms);
+}
+
+int
+lwes_listener_packet_add_header_fields
+  (struct lwes_listener_packet *packet)
+{
+  if (packet == NULL)
+    {
+      return -1;
+    }
+
+  if (packet->receipt_time_nanos != 0)
+    {
+      return lwes_event_add_headers_nanos (packet->bytes, MAX_MSG_SIZE,
+                                           &(packet->length),
+                                           packet->receipt_time_nanos,
+                                           packet->sender.sin_addr,
+                                           ntohs (packet->sender.sin_port));
+    }
+
+  return lwes_event_add_headers (packet->bytes, MAX_MSG_SIZE,
+                                 &(packet->length),
+                                 packet->receipt_time,
+                                 packet->sender.sin_addr,
+                                 ntohs (packet->sender.sin_port));
+}
+
+int
+lwes_listener_set_kernel_timestamps
+  (struct lwes_listener *listener,
+   LWES_BOOLEAN enable)
+{
+  if (listener == NULL)
+    {
+      return -1;
+    }
+
+  return lwes_net_set_timestamps (&(listener->connection), enable);
 }
 
+int
+lwes_listener_set_receipt_time_nanos
+  (struct lwes_listener *listener,
+   LWES_BOOLEAN enable)
+{
+  if (listener == NULL)
+    {
+      return -1;
+    }
+
+  listener->receipt_time_nanos = enable;
+  return 0;
+}
 
 int
 lwes_listener_destroy
@@ -234,6 +613,7 @@ lwes_listener_destroy
 
   if ( listener != NULL )
     {
+      lwes_listener_clear_subscriptions (listener);
       if ( listener->buffer != NULL )
         {
           free (listener->buffer);
@@ -242,8 +622,215 @@ lwes_listener_destroy
         {
           free (listener->dtmp);
         }
+      free (listener->batch_buffer);
+      free (listener->batch);
       free (listener);
     }
 
   return ret;
 }
+
+/*************************************************************************
+  PRIVATE API
+ *************************************************************************/
+static int
+lwes_listener_recv_batch_common
+  (struct lwes_listener *listener,
+   struct lwes_listener_packet **packets,
+   unsigned int max,
+   LWES_BOOLEAN use_timeout,
+   unsigned int timeout_ms)
+{
+  LWES_BYTE_P bufs[LWES_NET_MAX_BATCH];
+  size_t lens[LWES_NET_MAX_BATCH];
+  struct sockaddr_in senders[LWES_NET_MAX_BATCH];
+  struct lwes_listener_packet *first;
+  LWES_BYTE_P swap;
+  LWES_INT_64 receipt_time;
+  LWES_INT_64 now = 0;
+  LWES_INT_64 deadline = 0;
+  LWES_INT_64 now_ms;
+  unsigned int kept;
+  unsigned int i;
+  int n;
+
+  if (listener == NULL || packets == NULL || max == 0)
+    {
+      return -1;
+    }
+
+  if (listener->batch_capacity == 0
+      && lwes_listener_set_batch_size (listener,
+                                       LWES_LISTENER_DEFAULT_BATCH_SIZE) < 0)
+    {
+      return -1;
+    }
+
+  /* packets handed back are always consecutive, so wrap early rather than
+     split a batch across the end of the ring */
+  if (listener->batch_head >= listener->batch_capacity)
+    {
+      listener->batch_head = 0;
+    }
+  if (max > listener->batch_capacity - listener->batch_head)
+    {
+      max = listener->batch_capacity - listener->batch_head;
+    }
+  if (max > LWES_NET_MAX_BATCH)
+    {
+      max = LWES_NET_MAX_BATCH;
+    }
+
+  first = &(listener->batch[listener->batch_head]);
+  for (i = 0; i < max; i++)
+    {
+      bufs[i] = first[i].bytes;
+    }
+
+  if (use_timeout && listener->subscriptions != NULL)
+    {
+      deadline = currentTimeMillisLongLong () + timeout_ms;
+    }
+
+  do
+    {
+      if (use_timeout)
+        {
+          n = lwes_net_recv_bytes_batch_by (&(listener->connection),
+                                            bufs, MAX_MSG_SIZE, lens, senders,
+                                            max, timeout_ms);
+        }
+      else
+        {
+          n = lwes_net_recv_bytes_batch (&(listener->connection),
+                                         bufs, MAX_MSG_SIZE, lens, senders,
+                                         max);
+        }
+      if (n <= 0)
+        {
+          return -2;
+        }
+
+      kept = 0;
+      for (i = 0; i < (unsigned int)n; i++)
+        {
+          if (lwes_listener_is_subscribed (listener, first[i].bytes,
+                                           lens[i]) <= 0)
+            {
+              listener->filtered++;
+              continue;
+            }
+
+          /* without a kernel timestamp, everything in the batch was sitting
+             in the socket buffer by the time the receive returned, so one
+             reading of the clock serves them all */
+          receipt_time = lwes_listener_kernel_receipt_time (listener, i);
+          if (receipt_time == 0)
+            {
+              if (now == 0)
+                {
+                  now = (listener->receipt_time_nanos
+                           ? currentTimeNanosLongLong ()
+                           : currentTimeMillisLongLong () * 1000000);
+                }
+              receipt_time = now;
+            }
+
+          /* close the gaps left by dropped packets by swapping buffers */
+          if (kept != i)
+            {
+              swap = first[kept].bytes;
+              first[kept].bytes = first[i].bytes;
+              first[i].bytes = swap;
+            }
+          first[kept].length = lens[i];
+          first[kept].sender = senders[i];
+          first[kept].receipt_time = receipt_time / 1000000;
+          first[kept].receipt_time_nanos =
+            (listener->receipt_time_nanos ? receipt_time : 0);
+          kept++;
+        }
+
+      /* everything was dropped, keep waiting for whatever is left of the
+         timeout */
+      if (kept == 0 && use_timeout)
+        {
+          now_ms = currentTimeMillisLongLong ();
+          if (now_ms >= deadline)
+            {
+              return -2;
+            }
+          timeout_ms = (unsigned int)(deadline - now_ms);
+        }
+    }
+  while (kept == 0);
+
+  n = (int)kept;
+  listener->batch_head += (unsigned int)n;
+  *packets = first;
+
+  return n;
+}
+
+/* the kernel's timestamp for the datagram at index in the last receive, as
+   nanoseconds since epoch, or 0 if there is not one */
+static LWES_INT_64
+lwes_listener_kernel_receipt_time
+  (struct lwes_listener *listener,
+   unsigned int index)
+{
+  struct timespec *t;
+
+  if (listener->connection.receipt_times == NULL)
+    {
+      return 0;
+    }
+  t = &(listener->connection.receipt_times[index]);
+  return ((LWES_INT_64)t->tv_sec) * ((LWES_INT_64)1000000000)
+         + (LWES_INT_64)t->tv_nsec;
+}
+
+/* recompile the kernel filter from the subscriptions, if enabled, turning
+   it off on failure so nothing wanted gets dropped */
+static int
+lwes_listener_update_kernel_filter
+  (struct lwes_listener *listener)
+{
+  struct lwes_hash_enumeration e;
+  const char **names = NULL;
+  unsigned int count = 0;
+  int ret = -3;
+
+  if (! listener->kernel_filter)
+    {
+      return 0;
+    }
+
+  if (listener->subscriptions != NULL)
+    {
+      names = (const char **)
+        malloc (sizeof (const char *)
+                * lwes_hash_size (listener->subscriptions));
+      if (names != NULL && lwes_hash_keys (listener->subscriptions, &e))
+        {
+          while (lwes_hash_enumeration_has_more_elements (&e))
+            {
+              names[count++] = lwes_hash_enumeration_next_element (&e);
+            }
+        }
+    }
+
+  if (listener->subscriptions == NULL || names != NULL)
+    {
+      ret = lwes_net_set_name_filter (&(listener->connection), names, count);
+      free (names);
+    }
+
+  if (ret < 0)
+    {
+      listener->kernel_filter = FALSE;
+      lwes_net_set_name_filter (&(listener->connection), NULL, 0);
+    }
+
+  return ret;
+}
@@ -16,6 +16,7 @@
 #include "lwes_types.h"
 #include "lwes_net_functions.h"
 #include "lwes_event.h"
+#include "lwes_hash.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -36,8 +37,49 @@ struct lwes_listener
   struct lwes_event_deserialize_tmp *dtmp;
   /*! this is a temporary buffer for the packet from the socket */
   LWES_BYTE_P buffer;
+  /*! ring of MAX_MSG_SIZE buffers used by lwes_listener_recv_batch */
+  LWES_BYTE_P batch_buffer;
+  /*! one packet description for each buffer in the ring */
+  struct lwes_listener_packet *batch;
+  /*! number of buffers in the ring */
+  unsigned int batch_capacity;
+  /*! next buffer in the ring to receive into */
+  unsigned int batch_head;
+  /*! whether to add ReceiptTimeNanos along with the other header fields */
+  LWES_BOOLEAN receipt_time_nanos;
+  /*! event names and name prefixes to receive, NULL to receive everything */
+  struct lwes_hash *subscriptions;
+  /*! number of the subscriptions which are prefixes */
+  unsigned int subscription_prefixes;
+  /*! number of packets dropped for not matching the subscriptions */
+  LWES_U_INT_64 filtered;
+  /*! whether the subscriptions are also checked by a kernel socket filter */
+  LWES_BOOLEAN kernel_filter;
 };
 
+/*! \struct lwes_listener_packet lwes_listener.h
+ *  \brief A datagram received by lwes_listener_recv_batch
+ */
+struct lwes_listener_packet
+{
+  /*! the serialized event, with room for MAX_MSG_SIZE bytes */
+  LWES_BYTE_P bytes;
+  /*! the number of bytes of the serialized event */
+  size_t length;
+  /*! the address the event was sent from */
+  struct sockaddr_in sender;
+  /*! the time the event was received, as milliseconds since epoch */
+  LWES_INT_64 receipt_time;
+  /*! the time the event was received, as nanoseconds since epoch, only set
+      if enabled with lwes_listener_set_receipt_time_nanos */
+  LWES_INT_64 receipt_time_nanos;
+};
+
+/*! \brief Number of buffers allocated by lwes_listener_recv_batch when a
+ *  ring size has not been set with lwes_listener_set_batch_size
+ */
+#define LWES_LISTENER_DEFAULT_BATCH_SIZE 64
+
 /*! \brief Create a Listener
  *
  *  \param[in] address The multicast ip address as a dotted quad string
@@ -62,6 +104,11 @@ lwes_listener_create
  *    - SenderIP    - the ip address of the sender of the event
  *    - SenderPort  - the port of the sender of the event
  *    - ReceiptTime - a timestamp of receipt time, as milliseconds since epoch
+ *  and, if enabled with lwes_listener_set_receipt_time_nanos,
+ *    - ReceiptTimeNanos - the receipt time as nanoseconds since epoch
+ *
+ *  The receipt time is the kernel's if enabled with
+ *  lwes_listener_set_kernel_timestamps, otherwise the current time.
  *
  *  This should be called immediately after one of
  *    - lwes_listener_recv
@@ -108,6 +155,91 @@ lwes_listener_event_has_name
    size_t len,
    LWES_CONST_SHORT_STRING name);
 
+/*! \brief Only receive events with a given name or name prefix
+ *
+ *  Once a listener has any subscriptions, each packet it receives has its
+ *  name compared against them straight after the receive, and packets which
+ *  do not match are dropped before header fields are added or anything is
+ *  deserialized.  This applies to all the lwes_listener_recv functions,
+ *  which keep waiting for a matching packet, and the number dropped is
+ *  available from lwes_listener_get_filtered_count.
+ *
+ *  A pattern is either an exact event name, or a scope ending in "::*",
+ *  such as "Click::*", which matches every event whose name starts with
+ *  "Click::".  Subscribing to the same pattern twice has no further effect.
+ *
+ *  \param[in] listener the listener to configure
+ *  \param[in] pattern  the event name or prefix to receive
+ *
+ *  \see lwes_listener_clear_subscriptions
+ *
+ *  \return 0 on success, -1 for a bad argument or pattern, -3 if memory
+ *          could not be allocated
+ */
+int
+lwes_listener_subscribe
+  (struct lwes_listener *listener,
+   LWES_CONST_SHORT_STRING pattern);
+
+/*! \brief Remove all subscriptions, so every event is received again
+ *
+ *  \param[in] listener the listener to configure
+ *
+ *  \return 0 on success, a negative number on failure
+ */
+int
+lwes_listener_clear_subscriptions
+  (struct lwes_listener *listener);
+
+/*! \brief Have the kernel drop events which do not match the subscriptions
+ *
+ *  Once enabled, the subscriptions are also compiled into a socket filter
+ *  with lwes_net_set_name_filter, and kept up to date as they change, so
+ *  unwanted events are dropped before they are copied out of the kernel.
+ *  Those are not counted by lwes_listener_get_filtered_count.  If the
+ *  filter can not be updated it is removed and kernel filtering turned
+ *  off, the subscriptions are still checked as each packet is received.
+ *
+ *  \param[in] listener the listener to configure
+ *  \param[in] enable TRUE to filter in the kernel, FALSE not to
+ *
+ *  \return 0 on success, a negative number on failure, including when the
+ *          platform does not support socket filters
+ */
+int
+lwes_listener_set_kernel_filter
+  (struct lwes_listener *listener,
+   LWES_BOOLEAN enable);
+
+/*! \brief Determine if a serialized event matches a listener's subscriptions
+ *
+ *  Only the name at the start of the bytes is looked at, so this is cheap
+ *  enough to call on every packet.
+ *
+ *  \param[in] listener the listener with the subscriptions
+ *  \param[in] bytes    the serialized event
+ *  \param[in] len      the size of the serialized event
+ *
+ *  \return 1 if the event matches or there are no subscriptions, 0 if it
+ *          does not match, -1 if the name can not be read
+ */
+int
+lwes_listener_is_subscribed
+  (struct lwes_listener *listener,
+   LWES_BYTE_P bytes,
+   size_t len);
+
+/*! \brief Get the number of packets dropped by the subscriptions
+ *
+ *  \param[in] listener the listener
+ *
+ *  \return the number of packets which have not matched the listener's
+ *          subscriptions since it was created
+ */
+LWES_U_INT_64
+lwes_listener_get_filtered_count
+  (struct lwes_listener *listener);
+
 /*! \brief This adds headers and deserializes the event
  *
  * This is actually a private function, which will be removed next major
@@ -189,6 +321,115 @@ lwes_listener_recv_bytes_by
    size_t max,
    unsigned int timeout_ms);
 
+/*! \brief Set the number of buffers in the listener's receive ring
+ *
+ *  Packets returned from lwes_listener_recv_batch stay valid until this
+ *  many more packets have been received, so they may be handed off and
+ *  processed while the next batch is read.  Changing the size invalidates
+ *  any packets already returned.
+ *
+ *  \param[in] listener  the listener to configure
+ *  \param[in] ring_size the number of MAX_MSG_SIZE buffers in the ring, 0
+ *                       frees the ring
+ *
+ *  \return 0 on success, a negative number on failure
+ */
+int
+lwes_listener_set_batch_size
+  (struct lwes_listener *listener,
+   unsigned int ring_size);
+
+/*! \brief Receive several events' bytes from the listener in a blocking
+ *  manner
+ *
+ *  Blocks until at least one packet arrives, then returns it along with any
+ *  others already waiting, using a single recvmmsg(2) where available.  The
+ *  packets are consecutive entries in the listener's ring, each with its own
+ *  sender address and receipt time, so header fields can be added with
+ *  lwes_listener_packet_add_header_fields and the bytes deserialized with
+ *  lwes_event_from_bytes without further system calls.  Packets which do
+ *  not match the listener's subscriptions are dropped, so they never take up
+ *  a place in the ring.
+ *
+ *  \param[in] listener the listener to receive the bytes from
+ *  \param[out] packets set to the first of the packets received
+ *  \param[in] max the maximum number of packets to receive
+ *
+ *  \return the number of packets received on success, a negative number on
+ *          failure
+ */
+int
+lwes_listener_recv_batch
+  (struct lwes_listener *listener,
+   struct lwes_listener_packet **packets,
+   unsigned int max);
+
+/*! \brief Receive several events' bytes from the listener with a timeout
+ *
+ *  As lwes_listener_recv_batch, but waits at most timeout_ms for the first
+ *  packet.
+ *
+ *  \param[in] listener the listener to receive the bytes from
+ *  \param[out] packets set to the first of the packets received
+ *  \param[in] max the maximum number of packets to receive
+ *  \param[in] timeout_ms the maximum amount of time to wait for a packet
+ *
+ *  \return the number of packets received on success, a negative number on
+ *          failure
+ */
+int
+lwes_listener_recv_batch_by
+  (struct lwes_listener *listener,
+   struct lwes_listener_packet **packets,
+   unsigned int max,
+   unsigned int timeout_ms);
+
+/*! \brief Add the header fields to a packet from lwes_listener_recv_batch
+ *
+ *  This is the equivalent of lwes_listener_add_header_fields, but uses the
+ *  sender and receipt time recorded with the packet.
+ *
+ *  \param[in,out] packet the packet to add the attributes to
+ *
+ *  \return 0 upon success, a negative number upon failure
+ */
+int
+lwes_listener_packet_add_header_fields
+  (struct lwes_listener_packet *packet);
+
+/*! \brief Use the kernel's receive time of each event as its ReceiptTime
+ *
+ *  Enables SO_TIMESTAMPNS on the listener's socket, so the receipt time
+ *  added by lwes_listener_add_header_fields and recorded by
+ *  lwes_listener_recv_batch is when the packet arrived, not when it was
+ *  read, and the clock need not be read for every packet.
+ *
+ *  \param[in] listener the listener to configure
+ *  \param[in] enable TRUE to use kernel timestamps, FALSE to read the clock
+ *
+ *  \return 0 on success, a negative number on failure, including when the
+ *          platform does not support kernel timestamps
+ */
+int
+lwes_listener_set_kernel_timestamps
+  (struct lwes_listener *listener,
+   LWES_BOOLEAN enable);
+
+/*! \brief Add a ReceiptTimeNanos header field to received events
+ *
+ *  ReceiptTimeNanos holds the receipt time as nanoseconds since epoch,
+ *  most useful along with lwes_listener_set_kernel_timestamps.
+ *
+ *  \param[in] listener the listener to configure
+ *  \param[in] enable TRUE to add ReceiptTimeNanos, FALSE not to
+ *
+ *  \return 0 on success, a negative number on failure
+ */
+int
+lwes_listener_set_receipt_time_nanos
+  (struct lwes_listener *listener,
+   LWES_BOOLEAN enable);
+
 /*! \brief Destroy a Listener
  *
  * \param[in] listener The listener to destroy by freeing all of it's used
@@ -0,0 +1,247 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#include "lwes_listener_group.h"
+
+#include <sched.h>
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+/* how long a worker waits for packets before checking if it should exit */
+#define LWES_LISTENER_GROUP_POLL_MS 100
+
+/*************************************************************************
+  PRIVATE API prototypes, shouldn't be called by a user of the library.
+ *************************************************************************/
+static void *
+lwes_listener_group_worker_main
+  (void *arg);
+
+static void
+lwes_listener_group_stop
+  (struct lwes_listener_group *group);
+
+/*************************************************************************
+  PUBLIC API
+ *************************************************************************/
+struct lwes_listener_group *
+lwes_listener_group_create
+  (LWES_SHORT_STRING address,
+   LWES_SHORT_STRING iface,
+   LWES_U_INT_32 port,
+   unsigned int num_workers,
+   LWES_BOOLEAN pin_workers,
+   lwes_listener_group_callback callback,
+   void *data)
+{
+  return lwes_listener_group_create_with_db (address, iface, port, NULL,
+                                             num_workers, pin_workers,
+                                             callback, data);
+}
+
+struct lwes_listener_group *
+lwes_listener_group_create_with_db
+  (LWES_SHORT_STRING address,
+   LWES_SHORT_STRING iface,
+   LWES_U_INT_32 port,
+   struct lwes_event_type_db *db,
+   unsigned int num_workers,
+   LWES_BOOLEAN pin_workers,
+   lwes_listener_group_callback callback,
+   void *data)
+{
+  struct lwes_listener_group *group;
+  struct lwes_listener_group_worker *worker;
+  long num_cpus = sysconf (_SC_NPROCESSORS_ONLN);
+  unsigned int i;
+
+  if (callback == NULL)
+    {
+      return NULL;
+    }
+  if (num_cpus < 1)
+    {
+      num_cpus = 1;
+    }
+  if (num_workers == 0)
+    {
+      num_workers = (unsigned int)num_cpus;
+    }
+
+  group =
+    (struct lwes_listener_group *) malloc (sizeof (struct lwes_listener_group));
+  if (group == NULL)
+    {
+      return NULL;
+    }
+  group->workers = (struct lwes_listener_group_worker *)
+    malloc (sizeof (struct lwes_listener_group_worker) * num_workers);
+  if (group->workers == NULL)
+    {
+      free (group);
+      return NULL;
+    }
+  group->num_workers = num_workers;
+  group->callback = callback;
+  group->data = data;
+  group->running = 1;
+
+  for (i = 0; i < num_workers; i++)
+    {
+      worker = &(group->workers[i]);
+      worker->group = group;
+      worker->index = i;
+      worker->started = 0;
+      worker->received = 0;
+      worker->errors = 0;
+      worker->listener = NULL;
+      worker->event = NULL;
+    }
+
+  /* bind every socket before any thread starts, so a failure to share the
+     port is reported here rather than half way through */
+  for (i = 0; i < num_workers; i++)
+    {
+      worker = &(group->workers[i]);
+      worker->listener = lwes_listener_create (address, iface, port);
+      worker->event = lwes_event_create_no_name (db);
+      if (worker->listener == NULL
+          || worker->event == NULL
+          || (lwes_net_is_multicast (&(worker->listener->connection))
+              && num_workers > 1))
+        {
+          lwes_listener_group_destroy (group);
+          return NULL;
+        }
+    }
+
+  for (i = 0; i < num_workers; i++)
+    {
+      worker = &(group->workers[i]);
+      if (pthread_create (&(worker->thread), NULL,
+                          lwes_listener_group_worker_main, worker) != 0)
+        {
+          lwes_listener_group_destroy (group);
+          return NULL;
+        }
+      worker->started = 1;
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+      if (pin_workers)
+        {
+          cpu_set_t cpus;
+          CPU_ZERO (&cpus);
+          CPU_SET (i % (unsigned int)num_cpus, &cpus);
+          /* pinning is only a hint, carry on unpinned if it fails */
+          (void) pthread_setaffinity_np (worker->thread, sizeof (cpus), &cpus);
+        }
+#else
+      (void) pin_workers;
+#endif
+    }
+
+  return group;
+}
+
+int
+lwes_listener_group_destroy
+  (struct lwes_listener_group *group)
+{
+  unsigned int i;
+  int ret = 0;
+
+  if (group == NULL)
+    {
+      return -1;
+    }
+
+  lwes_listener_group_stop (group);
+
+  for (i = 0; i < group->num_workers; i++)
+    {
+      if (group->workers[i].listener != NULL
+          && lwes_listener_destroy (group->workers[i].listener) < 0)
+        {
+          ret = -2;
+        }
+      if (group->workers[i].event != NULL)
+        {
+          lwes_event_destroy (group->workers[i].event);
+        }
+    }
+  free (group->workers);
+  free (group);
+
+  return ret;
+}
+
+/*************************************************************************
+  PRIVATE API
+ *************************************************************************/
+static void
+lwes_listener_group_stop
+  (struct lwes_listener_group *group)
+{
+  unsigned int i;
+
+  __atomic_store_n (&(group->running), 0, __ATOMIC_RELEASE);
+  for (i = 0; i < group->num_workers; i++)
+    {
+      if (group->workers[i].started)
+        {
+          pthread_join (group->workers[i].thread, NULL);
+          group->workers[i].started = 0;
+        }
+    }
+}
+
+static void *
+lwes_listener_group_worker_main
+  (void *arg)
+{
+  struct lwes_listener_group_worker *worker =
+    (struct lwes_listener_group_worker *)arg;
+  struct lwes_listener_group *group = worker->group;
+  struct lwes_listener *listener = worker->listener;
+  struct lwes_listener_packet *packets;
+  struct lwes_event *event = worker->event;
+  int n;
+  int i;
+
+  while (__atomic_load_n (&(group->running), __ATOMIC_ACQUIRE))
+    {
+      n = lwes_listener_recv_batch_by (listener, &packets,
+                                       LWES_NET_MAX_BATCH,
+                                       LWES_LISTENER_GROUP_POLL_MS);
+      for (i = 0; i < n; i++)
+        {
+          /* clearing keeps the event's storage for the next packet */
+          lwes_event_clear (event);
+          if (lwes_listener_packet_add_header_fields (&(packets[i])) < 0
+              || lwes_event_from_bytes (event,
+                                        packets[i].bytes,
+                                        packets[i].length,
+                                        0,
+                                        listener->dtmp) < 0)
+            {
+              __atomic_fetch_add (&(worker->errors), 1, __ATOMIC_RELAXED);
+            }
+          else
+            {
+              __atomic_fetch_add (&(worker->received), 1, __ATOMIC_RELAXED);
+              group->callback (event, worker->index, group->data);
+            }
+        }
+    }
+
+  return NULL;
+}
@@ -0,0 +1,174 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#ifndef __LWES_LISTENER_GROUP_H
+#define __LWES_LISTENER_GROUP_H
+
+#include "lwes_types.h"
+#include "lwes_listener.h"
+#include "lwes_event.h"
+
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! \file lwes_listener_group.h
+ *  \brief Functions for listening to LWES events on several threads
+ */
+
+/*! \brief Called by a worker thread for each event it receives
+ *
+ *  \param[in] event  The decoded event, including the ReceiptTime, SenderIP
+ *                    and SenderPort headers.  Each worker reuses one event,
+ *                    which is cleared and refilled once the callback
+ *                    returns, so it must not be kept or destroyed.
+ *  \param[in] worker The index of the worker which received the event
+ *  \param[in] data   The data passed to lwes_listener_group_create
+ */
+typedef void (*lwes_listener_group_callback)
+  (struct lwes_event *event,
+   unsigned int worker,
+   void *data);
+
+/*! \struct lwes_listener_group_worker lwes_listener_group.h
+ *  \brief One socket and the thread reading from it
+ */
+struct lwes_listener_group_worker
+{
+  /*! the group this worker belongs to */
+  struct lwes_listener_group *group;
+  /*! index of this worker in the group */
+  unsigned int index;
+  /*! this worker's socket, buffers and deserialization space */
+  struct lwes_listener *listener;
+  /*! the event every packet is decoded into, created once with the
+      group's db so decoding does not allocate once it is warm */
+  struct lwes_event *event;
+  /*! the worker thread */
+  pthread_t thread;
+  /*! boolean, TRUE once the thread has been started */
+  int started;
+  /*! count of events passed to the callback */
+  LWES_INT_64 received;
+  /*! count of packets which could not be decoded */
+  LWES_INT_64 errors;
+};
+
+/*! \struct lwes_listener_group lwes_listener_group.h
+ *  \brief Listens for LWES events with one socket and thread per core
+ *
+ *  All the sockets are bound to the same port with SO_REUSEPORT so the
+ *  kernel spreads incoming packets across them by sender.
+ */
+struct lwes_listener_group
+{
+  /*! the workers, one per socket */
+  struct lwes_listener_group_worker *workers;
+  /*! number of workers */
+  unsigned int num_workers;
+  /*! called with every event received */
+  lwes_listener_group_callback callback;
+  /*! passed through to the callback */
+  void *data;
+  /*! boolean, cleared to ask the workers to exit */
+  int running;
+};
+
+/*! \brief Create a Listener group and start its workers
+ *
+ *  This is only useful for unicast addresses, with multicast every socket
+ *  would receive its own copy of each packet, so multicast groups are
+ *  limited to a single worker.
+ *
+ *  \param[in] address     The ip address as a dotted quad string of the
+ *                         channel to listen on.
+ *  \param[in] iface       The dotted quad ip address of the interface to
+ *                         receive messages on, can be NULL to use default.
+ *  \param[in] port        The port of the channel to listen on.
+ *  \param[in] num_workers The number of sockets and threads, 0 for one per
+ *                         online cpu.
+ *  \param[in] pin_workers Set to 1 to pin worker i to cpu i (modulo the
+ *                         number of cpus) where the platform allows it.
+ *  \param[in] callback    Called from the worker threads with each event.
+ *  \param[in] data        Passed through to the callback.
+ *
+ *  \see lwes_listener_group_destroy
+ *
+ *  \return A newly created listener group, use lwes_listener_group_destroy
+ *  to stop and free it, NULL on failure
+ */
+struct lwes_listener_group *
+lwes_listener_group_create
+  (LWES_SHORT_STRING address,
+   LWES_SHORT_STRING iface,
+   LWES_U_INT_32 port,
+   unsigned int num_workers,
+   LWES_BOOLEAN pin_workers,
+   lwes_listener_group_callback callback,
+   void *data);
+
+/*! \brief Create a Listener group which validates events against a db
+ *
+ *  As lwes_listener_group_create, but each worker's event is created with
+ *  db, so packets which do not match it are counted as errors rather than
+ *  passed to the callback.
+ *
+ *  \param[in] address     The ip address as a dotted quad string of the
+ *                         channel to listen on.
+ *  \param[in] iface       The dotted quad ip address of the interface to
+ *                         receive messages on, can be NULL to use default.
+ *  \param[in] port        The port of the channel to listen on.
+ *  \param[in] db          The event type db to validate against, can be
+ *                         NULL, and must outlive the group.
+ *  \param[in] num_workers The number of sockets and threads, 0 for one per
+ *                         online cpu.
+ *  \param[in] pin_workers Set to 1 to pin worker i to cpu i (modulo the
+ *                         number of cpus) where the platform allows it.
+ *  \param[in] callback    Called from the worker threads with each event.
+ *  \param[in] data        Passed through to the callback.
+ *
+ *  \see lwes_listener_group_destroy
+ *
+ *  \return A newly created listener group, use lwes_listener_group_destroy
+ *  to stop and free it, NULL on failure
+ */
+struct lwes_listener_group *
+lwes_listener_group_create_with_db
+  (LWES_SHORT_STRING address,
+   LWES_SHORT_STRING iface,
+   LWES_U_INT_32 port,
+   struct lwes_event_type_db *db,
+   unsigned int num_workers,
+   LWES_BOOLEAN pin_workers,
+   lwes_listener_group_callback callback,
+   void *data);
+
+/*! \brief Stop the workers and destroy a Listener group
+ *
+ *  Waits for every worker to finish its current packet.  Events still in
+ *  the socket buffers are discarded.
+ *
+ * \param[in] group The listener group to destroy
+ *
+ * \return 0 on success, negative number on failure
+ */
+int
+lwes_listener_group_destroy
+  (struct lwes_listener_group *group);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LWES_LISTENER_GROUP_H */
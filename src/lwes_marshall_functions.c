@@ -593,6 +593,209 @@ void bitvec_set
   bitvec[byte] = val ? temp | ormask : temp & andmask;
 }
 
+/* Fixed width array elements are converted between host order and the
+ * big endian order of the wire in bulk.  The conversion is the same swap
+ * in both directions, and a copy on a big endian host.  On x86 the SSE2
+ * or AVX2 kernels are picked at runtime, the scalar ones handle the tail
+ * and everything else. */
+
+typedef void (*lwes_swap_function)
+  (LWES_BYTE *dst, const LWES_BYTE *src, size_t count);
+
+struct lwes_swap_kernels
+{
+  const char        *name;
+  lwes_swap_function swap_16;
+  lwes_swap_function swap_32;
+  lwes_swap_function swap_64;
+};
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define LWES_SWAP(bits, v) (v)
+#else
+#define LWES_SWAP(bits, v) __builtin_bswap##bits (v)
+#endif
+
+#define LWES_SWAP_SCALAR(bits)                                  \
+static void                                                     \
+lwes_swap_##bits##_scalar                                       \
+  (LWES_BYTE *dst, const LWES_BYTE *src, size_t count)          \
+{                                                               \
+  uint##bits##_t v;                                             \
+  size_t i;                                                     \
+  for (i = 0; i < count; ++i)                                   \
+    {                                                           \
+      memcpy (&v, src + i * sizeof (v), sizeof (v));            \
+      v = LWES_SWAP(bits, v);                                   \
+      memcpy (dst + i * sizeof (v), &v, sizeof (v));            \
+    }                                                           \
+}
+
+LWES_SWAP_SCALAR(16)
+LWES_SWAP_SCALAR(32)
+LWES_SWAP_SCALAR(64)
+
+static const struct lwes_swap_kernels lwes_swap_scalar =
+  { "scalar", lwes_swap_16_scalar, lwes_swap_32_scalar, lwes_swap_64_scalar };
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+    && ! (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define LWES_SWAP_X86 1
+#include <immintrin.h>
+
+/* swaps the bytes of each 16 bit lane */
+#define LWES_SWAP_SSE2_16(v) \
+  _mm_or_si128 (_mm_slli_epi16 ((v), 8), _mm_srli_epi16 ((v), 8))
+
+__attribute__((target("sse2")))
+static void
+lwes_swap_16_sse2
+  (LWES_BYTE *dst, const LWES_BYTE *src, size_t count)
+{
+  size_t i = 0;
+  __m128i v;
+
+  for (; i + 8 <= count; i += 8)
+    {
+      v = _mm_loadu_si128 ((const __m128i *)(src + i * 2));
+      _mm_storeu_si128 ((__m128i *)(dst + i * 2), LWES_SWAP_SSE2_16 (v));
+    }
+  lwes_swap_16_scalar (dst + i * 2, src + i * 2, count - i);
+}
+
+/* SSE2 has no byte shuffle, so the 16 bit halves are swapped first */
+__attribute__((target("sse2")))
+static void
+lwes_swap_32_sse2
+  (LWES_BYTE *dst, const LWES_BYTE *src, size_t count)
+{
+  size_t i = 0;
+  __m128i v;
+
+  for (; i + 4 <= count; i += 4)
+    {
+      v = _mm_loadu_si128 ((const __m128i *)(src + i * 4));
+      v = _mm_shufflelo_epi16 (v, _MM_SHUFFLE (2, 3, 0, 1));
+      v = _mm_shufflehi_epi16 (v, _MM_SHUFFLE (2, 3, 0, 1));
+      _mm_storeu_si128 ((__m128i *)(dst + i * 4), LWES_SWAP_SSE2_16 (v));
+    }
+  lwes_swap_32_scalar (dst + i * 4, src + i * 4, count - i);
+}
+
+__attribute__((target("sse2")))
+static void
+lwes_swap_64_sse2
+  (LWES_BYTE *dst, const LWES_BYTE *src, size_t count)
+{
+  size_t i = 0;
+  __m128i v;
+
+  for (; i + 2 <= count; i += 2)
+    {
+      v = _mm_loadu_si128 ((const __m128i *)(src + i * 8));
+      v = _mm_shufflelo_epi16 (v, _MM_SHUFFLE (0, 1, 2, 3));
+      v = _mm_shufflehi_epi16 (v, _MM_SHUFFLE (0, 1, 2, 3));
+      _mm_storeu_si128 ((__m128i *)(dst + i * 8), LWES_SWAP_SSE2_16 (v));
+    }
+  lwes_swap_64_scalar (dst + i * 8, src + i * 8, count - i);
+}
+
+/* the shuffle reverses each element within its 128 bit lane */
+#define LWES_SWAP_AVX2(bits, width, ...)                                \
+__attribute__((target("avx2")))                                        \
+static void                                                             \
+lwes_swap_##bits##_avx2                                                 \
+  (LWES_BYTE *dst, const LWES_BYTE *src, size_t count)                  \
+{                                                                       \
+  const __m256i mask = _mm256_setr_epi8 (__VA_ARGS__, __VA_ARGS__);     \
+  size_t i = 0;                                                         \
+  __m256i v;                                                            \
+  for (; i + 32 / width <= count; i += 32 / width)                      \
+    {                                                                   \
+      v = _mm256_loadu_si256 ((const __m256i *)(src + i * width));      \
+      _mm256_storeu_si256 ((__m256i *)(dst + i * width),                \
+                           _mm256_shuffle_epi8 (v, mask));              \
+    }                                                                   \
+  lwes_swap_##bits##_scalar (dst + i * width, src + i * width,          \
+                             count - i);                                \
+}
+
+LWES_SWAP_AVX2(16, 2, 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14)
+LWES_SWAP_AVX2(32, 4, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12)
+LWES_SWAP_AVX2(64, 8, 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8)
+
+static const struct lwes_swap_kernels lwes_swap_sse2 =
+  { "sse2", lwes_swap_16_sse2, lwes_swap_32_sse2, lwes_swap_64_sse2 };
+
+static const struct lwes_swap_kernels lwes_swap_avx2 =
+  { "avx2", lwes_swap_16_avx2, lwes_swap_32_avx2, lwes_swap_64_avx2 };
+#endif
+
+/* the best kernels this cpu has, picked on first use */
+static const struct lwes_swap_kernels *
+lwes_swap_select
+  (void)
+{
+  static const struct lwes_swap_kernels *selected = NULL;
+  const struct lwes_swap_kernels *kernels;
+
+  kernels = __atomic_load_n (&selected, __ATOMIC_ACQUIRE);
+  if (kernels == NULL)
+    {
+      kernels = &lwes_swap_scalar;
+#ifdef LWES_SWAP_X86
+      __builtin_cpu_init ();
+      if (__builtin_cpu_supports ("avx2"))
+        {
+          kernels = &lwes_swap_avx2;
+        }
+      else if (__builtin_cpu_supports ("sse2"))
+        {
+          kernels = &lwes_swap_sse2;
+        }
+#endif
+      __atomic_store_n (&selected, kernels, __ATOMIC_RELEASE);
+    }
+  return kernels;
+}
+
+/* the size of an array element on the wire if it can be converted in
+   bulk, 0 if it goes through the scalar marshall functions */
+static int
+lwes_swap_width
+  (LWES_BYTE baseType)
+{
+  switch (baseType) {
+    case LWES_TYPE_BYTE:     return 1;
+    case LWES_TYPE_U_INT_16:
+    case LWES_TYPE_INT_16:   return 2;
+    case LWES_TYPE_U_INT_32:
+    case LWES_TYPE_INT_32:
+    case LWES_TYPE_FLOAT:    return 4;
+    case LWES_TYPE_U_INT_64:
+    case LWES_TYPE_INT_64:
+    case LWES_TYPE_DOUBLE:   return 8;
+    default:                 return 0;
+  }
+}
+
+static void
+lwes_swap_copy
+  (int width,
+   LWES_BYTE *dst,
+   const LWES_BYTE *src,
+   size_t count)
+{
+  const struct lwes_swap_kernels *kernels = lwes_swap_select ();
+
+  switch (width) {
+    case 2:  kernels->swap_16 (dst, src, count); break;
+    case 4:  kernels->swap_32 (dst, src, count); break;
+    case 8:  kernels->swap_64 (dst, src, count); break;
+    default: memcpy (dst, src, count * width); break;
+  }
+}
+
 
 int
 marshall_array_attribute
@@ -601,7 +804,7 @@ marshall_array_attribute
    size_t          length,
    size_t*         offset)
 {
-  int i, delta, w, used=0;
+  int i, delta, w, width, used=0;
   LWES_BYTE type, baseType;
   LWES_BOOLEAN nullable;
   char* array;
@@ -656,6 +859,16 @@ marshall_array_attribute
             }
         }
     }
+  else if ((width = lwes_swap_width(baseType)) > 0)
+    {
+      w = width * attr->array_len;
+      if (bytes == NULL || *offset > length || w > (int)(length - *offset))
+        { return 0; }
+      lwes_swap_copy(width, bytes + *offset, (LWES_BYTE*)array,
+                     attr->array_len);
+      *offset += w;
+      used += w;
+    }
   else
     {
       for (i=0; i<attr->array_len; ++i)
@@ -669,6 +882,161 @@ marshall_array_attribute
   return used;
 }
 
+/* big endian stores of the unchecked marshall functions */
+#define LWES_PUT_16(p, v)                                 \
+  do {                                                    \
+    (p)[0] = (LWES_BYTE) (((v) >>  8) & 0xffU);           \
+    (p)[1] = (LWES_BYTE) (((v) >>  0) & 0xffU);           \
+  } while (0)
+
+#define LWES_PUT_32(p, v)                                 \
+  do {                                                    \
+    (p)[0] = (LWES_BYTE) (((v) >> 24) & 0xffU);           \
+    (p)[1] = (LWES_BYTE) (((v) >> 16) & 0xffU);           \
+    (p)[2] = (LWES_BYTE) (((v) >>  8) & 0xffU);           \
+    (p)[3] = (LWES_BYTE) (((v) >>  0) & 0xffU);           \
+  } while (0)
+
+#define LWES_PUT_64(p, v)                                 \
+  do {                                                    \
+    LWES_PUT_32 ((p), (LWES_U_INT_32)((v) >> 32));        \
+    LWES_PUT_32 ((p) + 4, (LWES_U_INT_32)(v));            \
+  } while (0)
+
+void
+marshall_SHORT_STRING_unchecked
+  (LWES_CONST_SHORT_STRING aString,
+   LWES_BYTE_P     bytes,
+   size_t*         offset)
+{
+  size_t str_length = strlen (aString);
+
+  bytes[(*offset)] = (LWES_BYTE) str_length;
+  memcpy (bytes + (*offset) + 1, aString, str_length);
+  (*offset) += str_length + 1;
+}
+
+void
+marshall_value_unchecked
+  (LWES_BYTE       type,
+   const void*     value,
+   LWES_BYTE_P     bytes,
+   size_t*         offset)
+{
+  LWES_BYTE_P p = bytes + (*offset);
+  LWES_U_INT_32 u32;
+  LWES_U_INT_64 u64;
+  size_t str_length;
+
+  switch (type)
+    {
+      case LWES_TYPE_BYTE:
+        p[0] = *(const LWES_BYTE *)value;
+        (*offset) += 1;
+        break;
+      case LWES_TYPE_BOOLEAN:
+        p[0] = (LWES_BYTE) *(const LWES_BOOLEAN *)value;
+        (*offset) += 1;
+        break;
+      case LWES_TYPE_U_INT_16:
+      case LWES_TYPE_INT_16:
+        LWES_PUT_16 (p, *(const LWES_U_INT_16 *)value);
+        (*offset) += 2;
+        break;
+      case LWES_TYPE_U_INT_32:
+      case LWES_TYPE_INT_32:
+      case LWES_TYPE_FLOAT:
+        memcpy (&u32, value, sizeof (u32));
+        LWES_PUT_32 (p, u32);
+        (*offset) += 4;
+        break;
+      case LWES_TYPE_U_INT_64:
+      case LWES_TYPE_INT_64:
+      case LWES_TYPE_DOUBLE:
+        memcpy (&u64, value, sizeof (u64));
+        LWES_PUT_64 (p, u64);
+        (*offset) += 8;
+        break;
+      case LWES_TYPE_IP_ADDR:
+        /* stored in network order, but written least significant first */
+        u32 = htonl (((const LWES_IP_ADDR *)value)->s_addr);
+        p[3] = (LWES_BYTE) ((u32 >> 24) & 0xffU);
+        p[2] = (LWES_BYTE) ((u32 >> 16) & 0xffU);
+        p[1] = (LWES_BYTE) ((u32 >>  8) & 0xffU);
+        p[0] = (LWES_BYTE) ((u32 >>  0) & 0xffU);
+        (*offset) += 4;
+        break;
+      case LWES_TYPE_STRING:
+        str_length = strlen ((const char *)value);
+        LWES_PUT_16 (p, str_length);
+        memcpy (p + 2, value, str_length);
+        (*offset) += str_length + 2;
+        break;
+      default:
+        break;
+    }
+}
+
+void
+marshall_array_attribute_unchecked
+  (struct lwes_event_attribute* attr,
+   LWES_BYTE_P     bytes,
+   size_t*         offset)
+{
+  LWES_BYTE baseType = lwes_array_type_to_base (attr->type);
+  LWES_BYTE *bitvec;
+  void **data;
+  int delta;
+  int width;
+  int i;
+
+  LWES_PUT_16 (bytes + (*offset), attr->array_len);
+  (*offset) += 2;
+
+  if (lwes_type_is_nullable_array (attr->type))
+    {
+      /* the length again, then a bit for each element which is set */
+      LWES_PUT_16 (bytes + (*offset), attr->array_len);
+      (*offset) += 2;
+      bitvec = bytes + (*offset);
+      memset (bitvec, 0, bitvec_byte_size (attr->array_len));
+      (*offset) += bitvec_byte_size (attr->array_len);
+      data = (void **)attr->value;
+      for (i = 0; i < attr->array_len; ++i)
+        {
+          if (data[i] != NULL)
+            {
+              bitvec_set (bitvec, i, 1);
+              marshall_value_unchecked (baseType, data[i], bytes, offset);
+            }
+        }
+    }
+  else if (baseType == LWES_TYPE_STRING)
+    {
+      data = (void **)attr->value;
+      for (i = 0; i < attr->array_len; ++i)
+        {
+          marshall_value_unchecked (baseType, data[i], bytes, offset);
+        }
+    }
+  else if ((width = lwes_swap_width (baseType)) > 0)
+    {
+      lwes_swap_copy (width, bytes + (*offset), (LWES_BYTE *)attr->value,
+                      attr->array_len);
+      (*offset) += (size_t)width * attr->array_len;
+    }
+  else
+    {
+      delta = lwes_type_to_size (baseType);
+      for (i = 0; i < attr->array_len; ++i)
+        {
+          marshall_value_unchecked (baseType,
+                                    (char *)attr->value + i * delta,
+                                    bytes, offset);
+        }
+    }
+}
+
 int
 calculate_array_byte_size
   (LWES_BYTE       type,
@@ -736,9 +1104,22 @@ unmarshall_array_attribute
    size_t          length,
    size_t*         offset)
 {
-  int i, r, delta, alloc_size;
+  return unmarshall_array_attribute_in_arena (attr, bytes, length, offset,
+                                              NULL);
+}
+
+int
+unmarshall_array_attribute_in_arena
+  (struct lwes_event_attribute* attr,
+   LWES_BYTE_P        bytes,
+   size_t             length,
+   size_t*            offset,
+   struct lwes_arena* arena)
+{
+  int i, r, delta, width, alloc_size;
   int used = 0;
   int left = 0;
+  int count = 0;
   LWES_BYTE baseType;
   LWES_BYTE *bitvec = NULL;
   LWES_BYTE **pointers = NULL;
@@ -760,7 +1141,8 @@ unmarshall_array_attribute
       return 0;
     }
   used += r;
-  attr->value = (void*)malloc(alloc_size);
+  attr->value = (arena != NULL) ? lwes_arena_alloc(arena, alloc_size)
+                                : (void*)malloc(alloc_size);
   if (!attr->value)
     {
       return 0;
@@ -794,6 +1176,41 @@ unmarshall_array_attribute
       data = ((LWES_BYTE*)attr->value);
       left = alloc_size;
     }
+
+  /* the elements which are present are packed together both on the wire
+     and in the value, so fixed width ones are converted in one go */
+  width = lwes_swap_width(baseType);
+  if (width > 0)
+    {
+      for (i=0; i<attr->array_len; ++i)
+        {
+          if (bitvec && !bitvec_get(bitvec, i))
+            {
+              pointers[i] = NULL;
+            }
+          else
+            {
+              if (pointers)
+                {
+                  pointers[i] = data + count * width;
+                }
+              count++;
+            }
+        }
+      if (*offset > length || count * width > (int)(length - *offset))
+        {
+          if (arena == NULL)
+            {
+              free(attr->value);
+            }
+          attr->value = NULL;
+          return 0;
+        }
+      lwes_swap_copy(width, data, bytes + *offset, count);
+      *offset += count * width;
+      return used + count * width;
+    }
+
   for (i=0; i<attr->array_len; ++i)
     {
       if (bitvec && !bitvec_get(bitvec, i))
@@ -822,7 +1239,10 @@ unmarshall_array_attribute
             }
           if (!r)
             {
-              free(attr->value);
+              if (arena == NULL)
+                {
+                  free(attr->value);
+                }
               attr->value = NULL;
               return 0;
             }
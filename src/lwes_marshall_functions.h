@@ -733,6 +733,32 @@ marshall_array_attribute
    size_t          length,
    size_t*         offset);
 
+/* The unchecked marshall functions write the same bytes as the checked
+ * ones above, and advance the offset past them, but check neither the
+ * space left nor the value.  They are for callers which have already made
+ * sure everything fits and only hold values the checked functions accept,
+ * as lwes_event_to_bytes does with the serialized size of an event. */
+
+void
+marshall_SHORT_STRING_unchecked
+  (LWES_CONST_SHORT_STRING aString,
+   LWES_BYTE_P     bytes,
+   size_t*         offset);
+
+/* value points at the value, or is the string itself for LWES_TYPE_STRING */
+void
+marshall_value_unchecked
+  (LWES_BYTE       type,
+   const void*     value,
+   LWES_BYTE_P     bytes,
+   size_t*         offset);
+
+void
+marshall_array_attribute_unchecked
+  (struct lwes_event_attribute* attr,
+   LWES_BYTE_P     bytes,
+   size_t*         offset);
+
 int
 unmarshall_array_attribute
   (struct lwes_event_attribute* attr,
@@ -740,6 +766,19 @@ unmarshall_array_attribute
    size_t          length,
    size_t*         offset);
 
+/*! \brief Unmarshall an array attribute, allocating its value from an arena
+ *
+ * As unmarshall_array_attribute, but attr->value comes from the given
+ * arena (or malloc if it is NULL) and must not be freed on its own.
+ */
+int
+unmarshall_array_attribute_in_arena
+  (struct lwes_event_attribute* attr,
+   LWES_BYTE_P        bytes,
+   size_t             length,
+   size_t*            offset,
+   struct lwes_arena* arena);
+
 
 #ifdef __cplusplus
 }
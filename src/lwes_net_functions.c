@@ -16,6 +16,51 @@
 #ifdef HAVE_CONFIG_H
 # include "config.h"
 #endif
+#ifdef HAVE_LINUX_FILTER_H
+# include <linux/filter.h>
+#endif
+
+#if defined(HAVE_LINUX_FILTER_H) && defined(SO_ATTACH_FILTER)
+/* a socket filter on a UDP socket sees the UDP header before the payload */
+#define LWES_NET_FILTER_PAYLOAD_OFFSET 8
+#endif
+
+/* PRIVATE API prototypes */
+static int
+lwes_net_recv_batch_flags
+  (struct lwes_net_connection *conn,
+   LWES_BYTE_P *bytes,
+   size_t len,
+   size_t *lens,
+   struct sockaddr_in *senders,
+   unsigned int count,
+   int flags);
+
+static int
+lwes_net_recvmsg
+  (struct lwes_net_connection *conn,
+   LWES_BYTE_P bytes,
+   size_t len,
+   int flags,
+   struct sockaddr_in *sender,
+   socklen_t *sender_size,
+   struct timespec *receipt_time);
+
+#ifdef SO_TIMESTAMPNS
+static void
+lwes_net_get_timestamp
+  (struct msghdr *msg,
+   struct timespec *receipt_time);
+#endif
+
+#if defined(HAVE_LINUX_FILTER_H) && defined(SO_ATTACH_FILTER)
+static int
+lwes_net_compile_name_filter
+  (const char *const *names,
+   unsigned int count,
+   struct sock_filter *program,
+   unsigned int max);
+#endif
 
 int
 lwes_net_open
@@ -32,6 +77,8 @@ lwes_net_open
     {
       return -1;
     }
+  conn->receipt_times = NULL;
+
   /* validate the arguments */
   if (inet_aton (address, &validated_address) == 0)
     {
@@ -118,6 +165,9 @@ lwes_net_close
       return -1;
     }
 
+  free (conn->receipt_times);
+  conn->receipt_times = NULL;
+
   /* check has_joined first, as we also "join" a unicast channel, so may
      need to do cleanup here someday */
   if ( conn->has_joined )
@@ -270,6 +320,65 @@ lwes_net_send_bytes
   return size;
 }
 
+int
+lwes_net_send_bytes_batch
+  (struct lwes_net_connection *conn,
+   LWES_BYTE_P *bytes,
+   size_t *lens,
+   unsigned int count)
+{
+#ifdef HAVE_SENDMMSG
+  struct mmsghdr msgs[LWES_NET_MAX_BATCH];
+  struct iovec iovs[LWES_NET_MAX_BATCH];
+  int ret;
+#endif
+  unsigned int i;
+
+  if (conn == NULL || bytes == NULL || lens == NULL)
+    {
+      return -1;
+    }
+
+  if (count > LWES_NET_MAX_BATCH)
+    {
+      count = LWES_NET_MAX_BATCH;
+    }
+
+#ifdef HAVE_SENDMMSG
+  memset (msgs, 0, sizeof (struct mmsghdr) * count);
+  for (i = 0; i < count; i++)
+    {
+      iovs[i].iov_base = bytes[i];
+      iovs[i].iov_len  = lens[i];
+      msgs[i].msg_hdr.msg_name    = &(conn->ip_addr);
+      msgs[i].msg_hdr.msg_namelen = sizeof (conn->ip_addr);
+      msgs[i].msg_hdr.msg_iov     = &(iovs[i]);
+      msgs[i].msg_hdr.msg_iovlen  = 1;
+    }
+
+  ret = sendmmsg (conn->socketfd, msgs, count, 0);
+  if (ret >= 0)
+    {
+      return ret;
+    }
+  if (errno != ENOSYS)
+    {
+      return -2;
+    }
+  /* kernel is older than the C library, fall through to sendto */
+#endif
+
+  for (i = 0; i < count; i++)
+    {
+      if (lwes_net_send_bytes (conn, bytes[i], lens[i]) < 0)
+        {
+          return (i == 0 ? -2 : (int)i);
+        }
+    }
+
+  return (int)count;
+}
+
 int
 lwes_net_sendto_bytes
   (struct lwes_net_connection *conn,
@@ -412,12 +521,10 @@ lwes_net_recv_bytes
       return ret;
     }
 
-  ret = recvfrom (conn->socketfd,
-                  bytes,
-                  len,
-                  flags,
-                  (struct sockaddr *)&(conn->sender_ip_addr),
-                  (socklen_t *)&(conn->sender_ip_socket_size));
+  ret = lwes_net_recvmsg (conn, bytes, len, flags,
+                          &(conn->sender_ip_addr),
+                          &(conn->sender_ip_socket_size),
+                          conn->receipt_times);
   return ret;
 }
 
@@ -456,11 +563,481 @@ lwes_net_recv_bytes_by
       return -2;
     }
 
-  ret = recvfrom (conn->socketfd,
-                  bytes,
-                  len,
-                  flags,
-                  (struct sockaddr *)&(conn->sender_ip_addr),
-                  (socklen_t *)&(conn->sender_ip_socket_size));
+  ret = lwes_net_recvmsg (conn, bytes, len, flags,
+                          &(conn->sender_ip_addr),
+                          &(conn->sender_ip_socket_size),
+                          conn->receipt_times);
+  return ret;
+}
+
+int
+lwes_net_recv_bytes_batch
+  (struct lwes_net_connection *conn,
+   LWES_BYTE_P *bytes,
+   size_t len,
+   size_t *lens,
+   struct sockaddr_in *senders,
+   unsigned int count)
+{
+  int ret = 0;
+
+  if (conn == NULL || bytes == NULL || lens == NULL || senders == NULL)
+    {
+      return -1;
+    }
+
+  if ((ret = lwes_net_recv_bind (conn)) < 0)
+    {
+      return ret;
+    }
+
+  return lwes_net_recv_batch_flags (conn, bytes, len, lens, senders,
+                                    count, 0);
+}
+
+int
+lwes_net_recv_bytes_batch_by
+  (struct lwes_net_connection *conn,
+   LWES_BYTE_P *bytes,
+   size_t len,
+   size_t *lens,
+   struct sockaddr_in *senders,
+   unsigned int count,
+   unsigned int timeout_ms)
+{
+  int ret = 0;
+  struct timeval timeout;
+  fd_set read_sel;
+
+  if (conn == NULL || bytes == NULL || lens == NULL || senders == NULL)
+    {
+      return -1;
+    }
+
+  if ((ret = lwes_net_recv_bind (conn)) < 0)
+    {
+      return ret;
+    }
+
+  timeout.tv_sec=timeout_ms/1000;
+  timeout.tv_usec=(timeout_ms%1000)*1000;
+
+  FD_ZERO(&read_sel);
+  FD_SET(conn->socketfd, &read_sel);
+
+  ret = select (conn->socketfd+1, &read_sel, NULL, NULL, &timeout);
+  if (ret <= 0)
+    {
+      return -2;
+    }
+
+  return lwes_net_recv_batch_flags (conn, bytes, len, lens, senders,
+                                    count, MSG_DONTWAIT);
+}
+
+int
+lwes_net_set_timestamps
+  (struct lwes_net_connection *conn,
+   int enable)
+{
+#ifdef SO_TIMESTAMPNS
+  int on = (enable ? 1 : 0);
+  int ret = 0;
+
+  if (conn == NULL)
+    {
+      return -1;
+    }
+
+  if (on && conn->receipt_times == NULL)
+    {
+      conn->receipt_times = (struct timespec *)
+        calloc (LWES_NET_MAX_BATCH, sizeof (struct timespec));
+      if (conn->receipt_times == NULL)
+        {
+          return -3;
+        }
+    }
+
+  if (setsockopt (conn->socketfd, SOL_SOCKET, SO_TIMESTAMPNS,
+                  (void*)&on, sizeof (on)) < 0 && on)
+    {
+      on = 0;
+      ret = -2;
+    }
+
+  if (!on)
+    {
+      free (conn->receipt_times);
+      conn->receipt_times = NULL;
+    }
+
   return ret;
+#else
+  (void)enable;
+  return (conn == NULL ? -1 : -2);
+#endif
 }
+
+int
+lwes_net_set_name_filter
+  (struct lwes_net_connection *conn,
+   const char *const *names,
+   unsigned int count)
+{
+#if defined(HAVE_LINUX_FILTER_H) && defined(SO_ATTACH_FILTER)
+  struct sock_fprog fprog;
+  struct sock_filter *program;
+  int unused = 0;
+  int n;
+
+  if (conn == NULL || (names == NULL && count > 0))
+    {
+      return -1;
+    }
+
+  if (count == 0)
+    {
+      /* nothing attached is fine too */
+      if (setsockopt (conn->socketfd, SOL_SOCKET, SO_DETACH_FILTER,
+                      (void*)&unused, sizeof (unused)) < 0
+          && errno != ENOENT)
+        {
+          return -2;
+        }
+      return 0;
+    }
+
+  program = (struct sock_filter *)
+    malloc (sizeof (struct sock_filter) * BPF_MAXINSNS);
+  if (program == NULL)
+    {
+      return -3;
+    }
+
+  n = lwes_net_compile_name_filter (names, count, program, BPF_MAXINSNS);
+  if (n < 0)
+    {
+      free (program);
+      return n;
+    }
+
+  fprog.len    = (unsigned short)n;
+  fprog.filter = program;
+  n = setsockopt (conn->socketfd, SOL_SOCKET, SO_ATTACH_FILTER,
+                  (void*)&fprog, sizeof (fprog));
+  free (program);
+
+  return (n < 0 ? -2 : 0);
+#else
+  (void)names;
+  (void)count;
+  return (conn == NULL ? -1 : -2);
+#endif
+}
+
+/* PRIVATE API */
+
+/* Receive up to count datagrams, the first receive uses the given flags
+   and any after that never block */
+static int
+lwes_net_recv_batch_flags
+  (struct lwes_net_connection *conn,
+   LWES_BYTE_P *bytes,
+   size_t len,
+   size_t *lens,
+   struct sockaddr_in *senders,
+   unsigned int count,
+   int flags)
+{
+#ifdef HAVE_RECVMMSG
+  struct mmsghdr msgs[LWES_NET_MAX_BATCH];
+  struct iovec iovs[LWES_NET_MAX_BATCH];
+#ifdef SO_TIMESTAMPNS
+  union {
+    char buf[CMSG_SPACE (sizeof (struct timespec))];
+    struct cmsghdr align;
+  } controls[LWES_NET_MAX_BATCH];
+#endif
+#endif
+  socklen_t sender_size;
+  unsigned int i;
+  int ret;
+
+  if (count == 0)
+    {
+      return 0;
+    }
+  if (count > LWES_NET_MAX_BATCH)
+    {
+      count = LWES_NET_MAX_BATCH;
+    }
+
+#ifdef HAVE_RECVMMSG
+  memset (msgs, 0, sizeof (struct mmsghdr) * count);
+  for (i = 0; i < count; i++)
+    {
+      iovs[i].iov_base = bytes[i];
+      iovs[i].iov_len  = len;
+      msgs[i].msg_hdr.msg_name    = &(senders[i]);
+      msgs[i].msg_hdr.msg_namelen = sizeof (struct sockaddr_in);
+      msgs[i].msg_hdr.msg_iov     = &(iovs[i]);
+      msgs[i].msg_hdr.msg_iovlen  = 1;
+#ifdef SO_TIMESTAMPNS
+      if (conn->receipt_times != NULL)
+        {
+          msgs[i].msg_hdr.msg_control    = controls[i].buf;
+          msgs[i].msg_hdr.msg_controllen = sizeof (controls[i].buf);
+        }
+#endif
+    }
+
+  ret = recvmmsg (conn->socketfd, msgs, count,
+                  (flags == 0 ? MSG_WAITFORONE : flags), NULL);
+  if (ret > 0)
+    {
+      for (i = 0; i < (unsigned int)ret; i++)
+        {
+          lens[i] = msgs[i].msg_len;
+#ifdef SO_TIMESTAMPNS
+          if (conn->receipt_times != NULL)
+            {
+              lwes_net_get_timestamp (&(msgs[i].msg_hdr),
+                                      &(conn->receipt_times[i]));
+            }
+#endif
+        }
+      conn->sender_ip_addr = senders[ret-1];
+      return ret;
+    }
+  if (ret == 0 || errno != ENOSYS)
+    {
+      return (ret == 0 ? 0 : -3);
+    }
+  /* kernel is older than the C library, fall through to recvfrom */
+#endif
+
+  for (i = 0; i < count; i++)
+    {
+      sender_size = sizeof (struct sockaddr_in);
+      ret = lwes_net_recvmsg (conn,
+                              bytes[i],
+                              len,
+                              (i == 0 ? flags : MSG_DONTWAIT),
+                              &(senders[i]),
+                              &sender_size,
+                              (conn->receipt_times == NULL
+                                 ? NULL : &(conn->receipt_times[i])));
+      if (ret < 0)
+        {
+          break;
+        }
+      lens[i] = (size_t)ret;
+      conn->sender_ip_addr = senders[i];
+    }
+
+  return (i == 0 ? -3 : (int)i);
+}
+
+/* Receive a single datagram, along with the kernel's timestamp for it if
+   receipt_time is not NULL */
+static int
+lwes_net_recvmsg
+  (struct lwes_net_connection *conn,
+   LWES_BYTE_P bytes,
+   size_t len,
+   int flags,
+   struct sockaddr_in *sender,
+   socklen_t *sender_size,
+   struct timespec *receipt_time)
+{
+#ifdef SO_TIMESTAMPNS
+  struct msghdr msg;
+  struct iovec iov;
+  union {
+    char buf[CMSG_SPACE (sizeof (struct timespec))];
+    struct cmsghdr align;
+  } control;
+  int ret;
+
+  if (receipt_time != NULL)
+    {
+      iov.iov_base = bytes;
+      iov.iov_len  = len;
+      memset (&msg, 0, sizeof (msg));
+      msg.msg_name       = sender;
+      msg.msg_namelen    = *sender_size;
+      msg.msg_iov        = &iov;
+      msg.msg_iovlen     = 1;
+      msg.msg_control    = control.buf;
+      msg.msg_controllen = sizeof (control.buf);
+
+      ret = recvmsg (conn->socketfd, &msg, flags);
+      if (ret >= 0)
+        {
+          *sender_size = msg.msg_namelen;
+          lwes_net_get_timestamp (&msg, receipt_time);
+        }
+      return ret;
+    }
+#else
+  (void)receipt_time;
+#endif
+
+  return recvfrom (conn->socketfd,
+                   bytes,
+                   len,
+                   flags,
+                   (struct sockaddr *)sender,
+                   sender_size);
+}
+
+#ifdef SO_TIMESTAMPNS
+/* Pull the SCM_TIMESTAMPNS control message out of a received message,
+   zeroing receipt_time if there is not one */
+static void
+lwes_net_get_timestamp
+  (struct msghdr *msg,
+   struct timespec *receipt_time)
+{
+  struct cmsghdr *cmsg;
+
+  receipt_time->tv_sec  = 0;
+  receipt_time->tv_nsec = 0;
+  for (cmsg = CMSG_FIRSTHDR (msg);
+       cmsg != NULL;
+       cmsg = CMSG_NXTHDR (msg, cmsg))
+    {
+      if (cmsg->cmsg_level == SOL_SOCKET
+          && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+        {
+          memcpy (receipt_time, CMSG_DATA (cmsg), sizeof (struct timespec));
+        }
+    }
+}
+#endif
+
+#if defined(HAVE_LINUX_FILTER_H) && defined(SO_ATTACH_FILTER)
+/* Write a program accepting datagrams whose event name is one of names,
+   returning the number of instructions, or -1 for a bad name and -4 if the
+   program would be longer than max.
+
+   Each name gets a block which compares the length and then the name four
+   bytes at a time, jumping to the next block on the first difference, so
+   every jump stays within the 255 instructions a conditional jump can
+   skip however many names there are. */
+static int
+lwes_net_compile_name_filter
+  (const char *const *names,
+   unsigned int count,
+   struct sock_filter *program,
+   unsigned int max)
+{
+  const unsigned int name_offset = LWES_NET_FILTER_PAYLOAD_OFFSET + 1;
+  const unsigned char *name;
+  struct sock_filter *block;
+  unsigned int length;
+  unsigned int compares;
+  unsigned int size;
+  unsigned int width;
+  unsigned int value;
+  unsigned int n = 0;
+  unsigned int i;
+  unsigned int j;
+  unsigned int k;
+  int prefix;
+
+  /* compiling the prologue and the final reject */
+  if (max < 5)
+    {
+      return -4;
+    }
+
+  /* anything too short to hold a name is dropped */
+  program[n++] = (struct sock_filter)
+    BPF_STMT (BPF_LD | BPF_W | BPF_LEN, 0);
+  program[n++] = (struct sock_filter)
+    BPF_JUMP (BPF_JMP | BPF_JGE | BPF_K, name_offset + 1, 1, 0);
+  program[n++] = (struct sock_filter)
+    BPF_STMT (BPF_RET | BPF_K, 0);
+
+  /* keep the length of the name in X */
+  program[n++] = (struct sock_filter)
+    BPF_STMT (BPF_LD | BPF_B | BPF_ABS, LWES_NET_FILTER_PAYLOAD_OFFSET);
+  program[n++] = (struct sock_filter)
+    BPF_STMT (BPF_MISC | BPF_TAX, 0);
+
+  for (i = 0; i < count; i++)
+    {
+      if (names[i] == NULL)
+        {
+          return -1;
+        }
+      name   = (const unsigned char *)names[i];
+      length = (unsigned int)strlen (names[i]);
+
+      /* a trailing "::*" only matches the start of a longer name, so the
+         scope's own "X::" is not let through */
+      prefix = (length >= 4 && strcmp (names[i] + length - 3, "::*") == 0);
+      if (prefix)
+        {
+          length--;
+        }
+      if (length == 0 || length > SHORT_STRING_MAX)
+        {
+          return -1;
+        }
+
+      /* whole words, then a halfword and/or a byte for what is left */
+      compares = length / 4 + (length % 4) / 2 + (length % 2);
+      size     = 2 + 2 * compares + 1;
+      /* room for the final reject */
+      if (n + size + 1 > max)
+        {
+          return -4;
+        }
+
+      block = &(program[n]);
+      block[0] = (struct sock_filter)
+        BPF_STMT (BPF_MISC | BPF_TXA, 0);
+      block[1] = (struct sock_filter)
+        BPF_JUMP (BPF_JMP | (prefix ? BPF_JGT : BPF_JEQ) | BPF_K,
+                  length, 0, size - 2);
+      for (j = 0, k = 2; j < length; j += width, k += 2)
+        {
+          width = (length - j >= 4 ? 4 : (length - j >= 2 ? 2 : 1));
+          value = 0;
+          switch (width)
+            {
+              case 4:
+                value = ((unsigned int)name[j] << 24)
+                        | ((unsigned int)name[j + 1] << 16)
+                        | ((unsigned int)name[j + 2] << 8)
+                        | (unsigned int)name[j + 3];
+                break;
+              case 2:
+                value = ((unsigned int)name[j] << 8)
+                        | (unsigned int)name[j + 1];
+                break;
+              default:
+                value = name[j];
+                break;
+            }
+          block[k] = (struct sock_filter)
+            BPF_STMT (BPF_LD | BPF_ABS
+                      | (width == 4 ? BPF_W : (width == 2 ? BPF_H : BPF_B)),
+                      name_offset + j);
+          block[k + 1] = (struct sock_filter)
+            BPF_JUMP (BPF_JMP | BPF_JEQ | BPF_K, value, 0, size - k - 2);
+        }
+      block[k] = (struct sock_filter)
+        BPF_STMT (BPF_RET | BPF_K, 0xffffffff);
+      n += size;
+    }
+
+  program[n++] = (struct sock_filter)
+    BPF_STMT (BPF_RET | BPF_K, 0);
+
+  return (int)n;
+}
+#endif
@@ -34,6 +34,11 @@ extern "C" {
  *  \brief Functions for dealing with multicast channels
  */
 
+/*! \brief The most datagrams lwes_net_send_bytes_batch will send, or
+ *  lwes_net_recv_bytes_batch will receive, in one call
+ */
+#define LWES_NET_MAX_BATCH 64
+
 /*! \struct lwes_net_connection lwes_net_functions.h
  *  \brief   IP Multicast Channel object
  */
@@ -63,6 +68,11 @@ struct lwes_net_connection
 
   /*! boolean, will be TRUE if we have bound to the given address */
   int has_bound;
+
+  /*! kernel receive times of the datagrams last received, one for each
+      datagram of a batch, NULL unless enabled by lwes_net_set_timestamps.
+      A time of zero means the kernel did not supply one. */
+  struct timespec *receipt_times;
 };
 
 /*! \brief Open a lwes network connection
@@ -170,6 +180,29 @@ lwes_net_send_bytes
    LWES_BYTE_P bytes,
    size_t len);
 
+/*! \brief Send several datagrams to the multicast channel
+ *
+ *  Each of the count buffers in bytes is sent as its own datagram.  Where
+ *  the platform supports sendmmsg(2) all of them are handed to the kernel
+ *  with a single system call, otherwise this falls back to one sendto(2)
+ *  per datagram.
+ *
+ *  \param[in] conn the multicast channel to send bytes to
+ *  \param[in] bytes an array of count buffers to send out on the channel
+ *  \param[in] lens an array of count lengths, one for each buffer
+ *  \param[in] count the number of datagrams to send
+ *
+ *  \return the number of datagrams sent on success, which may be less than
+ *  count if the kernel stopped part way (or count was larger than
+ *  LWES_NET_MAX_BATCH), -1 on bad arguments and -2 if nothing could be sent
+ */
+int
+lwes_net_send_bytes_batch
+  (struct lwes_net_connection *conn,
+   LWES_BYTE_P *bytes,
+   size_t *lens,
+   unsigned int count);
+
 /*! \brief Send bytes to a different multicast channel
  *
  *  This can be used to send bytes out over an alternate channel, this will
@@ -245,6 +278,106 @@ lwes_net_recv_bytes_by
    size_t len,
    unsigned int timeout_ms);
 
+/*! \brief Receive several datagrams from the multicast channel in blocking
+ *  mode
+ *
+ *  Blocks until at least one datagram arrives, then returns it along with
+ *  any others already queued on the socket, up to count.  Where the platform
+ *  supports recvmmsg(2) this is a single system call.  The sender of the
+ *  last datagram is also stored in the connection, as lwes_net_recv_bytes
+ *  would.  This calls lwes_net_recv_bind internally.
+ *
+ *  \param[in] conn the multicast channel to receive bytes from
+ *  \param[out] bytes an array of count byte arrays to fill out
+ *  \param[in] len the size of each of the byte arrays
+ *  \param[out] lens the number of bytes received into each byte array
+ *  \param[out] senders the address each datagram was sent from
+ *  \param[in] count the most datagrams to receive, capped at
+ *                   LWES_NET_MAX_BATCH
+ *
+ *  \return the number of datagrams received on success, a negative number on
+ *          failure
+ */
+int
+lwes_net_recv_bytes_batch
+  (struct lwes_net_connection *conn,
+   LWES_BYTE_P *bytes,
+   size_t len,
+   size_t *lens,
+   struct sockaddr_in *senders,
+   unsigned int count);
+
+/*! \brief Receive several datagrams from the multicast channel with a
+ *  timeout
+ *
+ *  As lwes_net_recv_bytes_batch, but waits at most timeout_ms for the first
+ *  datagram to arrive.
+ *
+ *  \param[in] conn the multicast channel to receive bytes from
+ *  \param[out] bytes an array of count byte arrays to fill out
+ *  \param[in] len the size of each of the byte arrays
+ *  \param[out] lens the number of bytes received into each byte array
+ *  \param[out] senders the address each datagram was sent from
+ *  \param[in] count the most datagrams to receive, capped at
+ *                   LWES_NET_MAX_BATCH
+ *  \param[in] timeout_ms the maximum time to block on this call
+ *
+ *  \return the number of datagrams received on success, a negative number on
+ *          failure
+ */
+int
+lwes_net_recv_bytes_batch_by
+  (struct lwes_net_connection *conn,
+   LWES_BYTE_P *bytes,
+   size_t len,
+   size_t *lens,
+   struct sockaddr_in *senders,
+   unsigned int count,
+   unsigned int timeout_ms);
+
+/*! \brief Have the kernel timestamp datagrams as they arrive
+ *
+ *  Uses SO_TIMESTAMPNS where available.  Once enabled, each receive
+ *  records when the kernel received each datagram in conn->receipt_times,
+ *  which is a more accurate receipt time than reading the clock after
+ *  the receive returns, and saves doing so.
+ *
+ *  \param[in] conn the multicast channel to timestamp
+ *  \param[in] enable non-zero to turn timestamps on, 0 to turn them off
+ *
+ *  \return 0 on success, -1 on bad arguments, -2 if the platform does not
+ *          support it and -3 if memory could not be allocated
+ */
+int
+lwes_net_set_timestamps
+  (struct lwes_net_connection *conn,
+   int enable);
+
+/*! \brief Have the kernel drop datagrams for events without given names
+ *
+ *  Compiles the names into a classic BPF program which checks the name at
+ *  the start of each datagram, and attaches it to the socket with
+ *  SO_ATTACH_FILTER, so unwanted events are never copied to user space
+ *  nor wake up the receiver.  A name ending in "::*", such as "Click::*",
+ *  matches every event whose name starts with, and is longer than, the
+ *  part before the '*'.
+ *  Passing no names removes the filter.
+ *
+ *  \param[in] conn the multicast channel to filter
+ *  \param[in] names the event names to receive
+ *  \param[in] count the number of names, 0 to receive everything
+ *
+ *  \return 0 on success, -1 on bad arguments, -2 if the platform does not
+ *          support socket filters or the filter could not be attached, -3
+ *          if memory could not be allocated and -4 if the names do not fit
+ *          in a single filter program
+ */
+int
+lwes_net_set_name_filter
+  (struct lwes_net_connection *conn,
+   const char *const *names,
+   unsigned int count);
+
 #ifdef __cplusplus
 }
 #endif
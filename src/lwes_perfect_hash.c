@@ -0,0 +1,301 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#include "lwes_perfect_hash.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*************************************************************************
+  PRIVATE API prototypes, shouldn't be called by a user of the library.
+ *************************************************************************/
+static LWES_U_INT_64
+lwes_perfect_hash_hash
+  (LWES_U_INT_64 seed,
+   LWES_CONST_SHORT_STRING event_name,
+   LWES_CONST_SHORT_STRING attr_name);
+
+static LWES_U_INT_32
+lwes_perfect_hash_displace
+  (LWES_U_INT_32 mask,
+   LWES_U_INT_64 hash,
+   LWES_U_INT_32 displacement);
+
+static int
+lwes_perfect_hash_place
+  (LWES_U_INT_32 *displacements,
+   LWES_U_INT_32 number_of_buckets,
+   LWES_U_INT_32 mask,
+   const LWES_U_INT_64 *hashes,
+   LWES_U_INT_32 number_of_keys,
+   LWES_U_INT_32 *slots);
+
+/*************************************************************************
+  PUBLIC API
+ *************************************************************************/
+struct lwes_perfect_hash *
+lwes_perfect_hash_create
+  (const struct lwes_perfect_hash_key *keys,
+   LWES_U_INT_32 number_of_keys,
+   LWES_U_INT_32 *slots)
+{
+  struct lwes_perfect_hash *hash;
+  LWES_U_INT_32 *displacements;
+  LWES_U_INT_64 *hashes;
+  LWES_U_INT_32 number_of_slots = 2;
+  LWES_U_INT_32 i;
+  int ret;
+
+  if (keys == NULL || slots == NULL)
+    {
+      return NULL;
+    }
+
+  while (number_of_slots < 2 * number_of_keys)
+    {
+      number_of_slots *= 2;
+    }
+
+  hash = (struct lwes_perfect_hash *)
+    malloc (sizeof (struct lwes_perfect_hash));
+  hashes = (LWES_U_INT_64 *) malloc (sizeof (LWES_U_INT_64)
+                                     * (number_of_keys + 1));
+  displacements = (LWES_U_INT_32 *)
+    malloc (sizeof (LWES_U_INT_32) * (number_of_keys / 2 + 1));
+  if (hash == NULL || hashes == NULL || displacements == NULL)
+    {
+      free (hash);
+      free (hashes);
+      free (displacements);
+      return NULL;
+    }
+  hash->number_of_buckets = number_of_keys / 2 + 1;
+  hash->displacements = displacements;
+
+  hash->seed = 0;
+  hash->mask = number_of_slots - 1;
+  for (;;)
+    {
+      for (i = 0; i < number_of_keys; i++)
+        {
+          hashes[i] = lwes_perfect_hash_hash (hash->seed,
+                                              keys[i].event_name,
+                                              keys[i].attr_name);
+        }
+      ret = lwes_perfect_hash_place (displacements, hash->number_of_buckets,
+                                     hash->mask, hashes, number_of_keys,
+                                     slots);
+      if (ret <= 0)
+        {
+          break;
+        }
+      /* every 8 seeds the table doubles, so this always ends */
+      hash->seed++;
+      if (hash->seed % 8 == 0)
+        {
+          if (number_of_slots >= (1U << 30))
+            {
+              ret = -1;
+              break;
+            }
+          number_of_slots *= 2;
+          hash->mask = number_of_slots - 1;
+        }
+    }
+
+  free (hashes);
+  if (ret < 0)
+    {
+      lwes_perfect_hash_destroy (hash);
+      return NULL;
+    }
+  return hash;
+}
+
+LWES_U_INT_32
+lwes_perfect_hash_slot
+  (const struct lwes_perfect_hash *hash,
+   LWES_CONST_SHORT_STRING event_name,
+   LWES_CONST_SHORT_STRING attr_name)
+{
+  LWES_U_INT_64 h = lwes_perfect_hash_hash (hash->seed, event_name,
+                                            attr_name);
+
+  return lwes_perfect_hash_displace
+           (hash->mask, h,
+            hash->displacements[(h >> 32) % hash->number_of_buckets]);
+}
+
+void
+lwes_perfect_hash_destroy
+  (struct lwes_perfect_hash *hash)
+{
+  if (hash != NULL)
+    {
+      free ((LWES_U_INT_32 *) hash->displacements);
+      free (hash);
+    }
+}
+
+/*************************************************************************
+  PRIVATE API
+ *************************************************************************/
+
+/* 64 bit FNV-1a of the event name and the attribute name, separated by a
+   byte which tells the event entry apart from an attribute named "",
+   followed by a finalizer so that every bit depends on the seed */
+static LWES_U_INT_64
+lwes_perfect_hash_hash
+  (LWES_U_INT_64 seed,
+   LWES_CONST_SHORT_STRING event_name,
+   LWES_CONST_SHORT_STRING attr_name)
+{
+  LWES_U_INT_64 hash = 14695981039346656037ULL ^ seed;
+  const unsigned char *p = (const unsigned char *)event_name;
+
+  while (*p != '\0')
+    {
+      hash ^= *p++;
+      hash *= 1099511628211ULL;
+    }
+  hash ^= (attr_name == NULL ? 0xff : 0x00);
+  hash *= 1099511628211ULL;
+  if (attr_name != NULL)
+    {
+      p = (const unsigned char *)attr_name;
+      while (*p != '\0')
+        {
+          hash ^= *p++;
+          hash *= 1099511628211ULL;
+        }
+    }
+
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+/* the step is odd, so a bucket's displacements visit every slot */
+static LWES_U_INT_32
+lwes_perfect_hash_displace
+  (LWES_U_INT_32 mask,
+   LWES_U_INT_64 hash,
+   LWES_U_INT_32 displacement)
+{
+  LWES_U_INT_32 start = (LWES_U_INT_32)hash;
+  LWES_U_INT_32 step  = ((LWES_U_INT_32)(hash >> 40)) | 1;
+
+  return (start + displacement * step) & mask;
+}
+
+/* places the largest buckets first, returns 0 once every bucket has a
+   displacement, 1 if one could not be placed with these hashes and -1 if
+   memory ran out */
+static int
+lwes_perfect_hash_place
+  (LWES_U_INT_32 *displacements,
+   LWES_U_INT_32 number_of_buckets,
+   LWES_U_INT_32 mask,
+   const LWES_U_INT_64 *hashes,
+   LWES_U_INT_32 number_of_keys,
+   LWES_U_INT_32 *slots)
+{
+  LWES_U_INT_32 *order;
+  LWES_U_INT_32 *starts;
+  unsigned char *taken;
+  LWES_U_INT_32 largest = 0;
+  LWES_U_INT_32 size;
+  LWES_U_INT_32 bucket;
+  LWES_U_INT_32 first;
+  LWES_U_INT_32 d;
+  LWES_U_INT_32 i;
+  LWES_U_INT_32 j;
+  LWES_U_INT_32 k;
+  int placed = 1;
+
+  order  = (LWES_U_INT_32 *) malloc (sizeof (LWES_U_INT_32)
+                                     * (number_of_keys + 1));
+  starts = (LWES_U_INT_32 *) calloc (number_of_buckets + 1,
+                                     sizeof (LWES_U_INT_32));
+  taken  = (unsigned char *) calloc ((size_t) mask + 1, 1);
+  if (order == NULL || starts == NULL || taken == NULL)
+    {
+      free (order);
+      free (starts);
+      free (taken);
+      return -1;
+    }
+
+  /* empty buckets keep a displacement of 0 */
+  memset (displacements, 0, sizeof (LWES_U_INT_32) * number_of_buckets);
+
+  /* group the keys by bucket */
+  for (i = 0; i < number_of_keys; i++)
+    {
+      starts[(hashes[i] >> 32) % number_of_buckets + 1]++;
+    }
+  for (bucket = 0; bucket < number_of_buckets; bucket++)
+    {
+      if (starts[bucket + 1] > largest)
+        {
+          largest = starts[bucket + 1];
+        }
+      starts[bucket + 1] += starts[bucket];
+    }
+  for (i = 0; i < number_of_keys; i++)
+    {
+      bucket = (hashes[i] >> 32) % number_of_buckets;
+      order[starts[bucket]++] = i;
+    }
+  /* starts[b] is now the end of bucket b, and the start of b + 1 */
+
+  for (size = largest; placed && size > 0; size--)
+    {
+      for (bucket = 0; placed && bucket < number_of_buckets; bucket++)
+        {
+          first = (bucket == 0 ? 0 : starts[bucket - 1]);
+          if (starts[bucket] - first != size)
+            {
+              continue;
+            }
+          placed = 0;
+          for (d = 0; ! placed && d <= mask; d++)
+            {
+              placed = 1;
+              for (j = 0; placed && j < size; j++)
+                {
+                  i = order[first + j];
+                  slots[i] = lwes_perfect_hash_displace (mask, hashes[i], d);
+                  placed = ! taken[slots[i]];
+                  for (k = 0; placed && k < j; k++)
+                    {
+                      placed = (slots[order[first + k]] != slots[i]);
+                    }
+                }
+              if (placed)
+                {
+                  displacements[bucket] = d;
+                  for (j = 0; j < size; j++)
+                    {
+                      taken[slots[order[first + j]]] = 1;
+                    }
+                }
+            }
+        }
+    }
+
+  free (order);
+  free (starts);
+  free (taken);
+  return (placed ? 0 : 1);
+}
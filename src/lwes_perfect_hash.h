@@ -0,0 +1,105 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#ifndef __LWES_PERFECT_HASH_H
+#define __LWES_PERFECT_HASH_H
+
+#include "lwes_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! \file lwes_perfect_hash.h
+ *  \brief Perfect hashes of event and attribute names
+ *
+ *  A hash and displace perfect hash: each key hashes to a bucket, and the
+ *  displacement of the bucket moves all of its keys into empty slots of a
+ *  power of two sized table.  Building one takes time roughly linear in
+ *  the number of keys, and the table has two to four slots per key.
+ */
+
+/*! \struct lwes_perfect_hash_key lwes_perfect_hash.h
+ *  \brief A key of a perfect hash, an event name or an attribute of one
+ */
+struct lwes_perfect_hash_key
+{
+  /*! name of the event */
+  LWES_CONST_SHORT_STRING event_name;
+  /*! name of the attribute, NULL for the event itself */
+  LWES_CONST_SHORT_STRING attr_name;
+};
+
+/*! \struct lwes_perfect_hash lwes_perfect_hash.h
+ *  \brief What it takes to find the slot of a key
+ *
+ *  This may be written out as a constant, as lwes-esf-compile does, and
+ *  used with lwes_perfect_hash_slot without having been created.
+ */
+struct lwes_perfect_hash
+{
+  /*! seed of the hash which every key could be placed with */
+  LWES_U_INT_64        seed;
+  /*! number of buckets, each with a displacement */
+  LWES_U_INT_32        number_of_buckets;
+  /*! number of slots minus one, the number of slots is a power of two */
+  LWES_U_INT_32        mask;
+  /*! displacement of each bucket */
+  const LWES_U_INT_32 *displacements;
+};
+
+/*! \brief Create a perfect hash of the keys
+ *
+ *  \param[in]  keys           the keys, which must all be different
+ *  \param[in]  number_of_keys the number of keys
+ *  \param[out] slots          the slot of each key, number_of_keys long
+ *
+ *  \see lwes_perfect_hash_destroy
+ *
+ *  \return the perfect hash, NULL if memory ran out
+ */
+struct lwes_perfect_hash *
+lwes_perfect_hash_create
+  (const struct lwes_perfect_hash_key *keys,
+   LWES_U_INT_32 number_of_keys,
+   LWES_U_INT_32 *slots);
+
+/*! \brief Find the slot of a key
+ *
+ *  A key which was not hashed is given the slot of one which was, so the
+ *  caller compares it with what it keeps in the slot.
+ *
+ *  \param[in] hash       the perfect hash
+ *  \param[in] event_name the name of the event
+ *  \param[in] attr_name  the name of the attribute, NULL for the event
+ *
+ *  \return the slot, at most hash->mask
+ */
+LWES_U_INT_32
+lwes_perfect_hash_slot
+  (const struct lwes_perfect_hash *hash,
+   LWES_CONST_SHORT_STRING event_name,
+   LWES_CONST_SHORT_STRING attr_name);
+
+/*! \brief Destroy a perfect hash made by lwes_perfect_hash_create
+ *
+ *  \param[in] hash the perfect hash to destroy, may be NULL
+ */
+void
+lwes_perfect_hash_destroy
+  (struct lwes_perfect_hash *hash);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LWES_PERFECT_HASH_H */
@@ -40,6 +40,16 @@ LWES_INT_64 currentTimeMillisLongLong(void)
                              (LWES_INT_64)(t.tv_usec/1000));
 }
 
+LWES_INT_64 currentTimeNanosLongLong(void)
+{
+  struct timespec t;
+
+  clock_gettime (CLOCK_REALTIME, &t);
+
+  return (((LWES_INT_64)t.tv_sec)*((LWES_INT_64)1000000000)) +
+                             (LWES_INT_64)t.tv_nsec;
+}
+
 void convertUnixLongLongTimeToTimeval(LWES_INT_64 timestamp, struct timeval *t)
 {
   t->tv_sec = (long)(timestamp/1000);
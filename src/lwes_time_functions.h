@@ -39,6 +39,14 @@ LWES_INT_64
 currentTimeMillisLongLong
   (void);
 
+/*! \brief Get time in nanoseconds
+ *
+ * \return the time since epoch in nanoseconds
+ */
+LWES_INT_64
+currentTimeNanosLongLong
+  (void);
+
 /*! \brief Convert to timeval
  *
  * Converting an LWES_INT_64 to a struct timeval.
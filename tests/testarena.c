@@ -0,0 +1,324 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#if HAVE_CONFIG_H
+  #include <config.h>
+#endif
+
+#include <stdlib.h>
+
+/* wrap malloc to cause test memory problems */
+void *my_malloc (size_t size);
+
+static size_t null_at = 0;
+static size_t malloc_count = 0;
+
+void *my_malloc (size_t size)
+{
+  void *ret = NULL;
+  malloc_count++;
+  if ( malloc_count != null_at )
+    {
+      ret = malloc (size);
+    }
+  return ret;
+}
+
+#define malloc my_malloc
+
+#include "lwes_arena.c"
+
+#undef malloc
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include <arpa/inet.h>
+
+#include "lwes_event.h"
+
+#define NUM_ATTRS 30
+#define BENCH_ITERATIONS 20000
+
+static void
+test_arena (void)
+{
+  struct lwes_arena *arena;
+  struct lwes_arena_mark mark;
+  char *a, *b, *c, *big;
+
+  /* malloc failures in create */
+  malloc_count = 0;
+  null_at = 1;
+  assert (lwes_arena_create (0) == NULL);
+  malloc_count = 0;
+  null_at = 2;
+  assert (lwes_arena_create (0) == NULL);
+  null_at = 0;
+
+  assert (lwes_arena_alloc (NULL, 10) == NULL);
+  lwes_arena_destroy (NULL);
+
+  arena = lwes_arena_create (256);
+  assert (arena != NULL);
+  assert (arena->block_size == 256);
+
+  /* allocations are aligned and do not overlap */
+  a = lwes_arena_alloc (arena, 1);
+  b = lwes_arena_alloc (arena, 3);
+  assert (a != NULL && b != NULL);
+  assert (((uintptr_t)a % LWES_ARENA_ALIGN) == 0);
+  assert (((uintptr_t)b % LWES_ARENA_ALIGN) == 0);
+  assert (b - a == LWES_ARENA_ALIGN);
+
+  /* rewinding hands the same memory out again */
+  lwes_arena_mark (arena, &mark);
+  c = lwes_arena_alloc (arena, 100);
+  lwes_arena_rewind (arena, &mark);
+  assert (lwes_arena_alloc (arena, 100) == c);
+
+  /* a request bigger than a block gets its own */
+  big = lwes_arena_alloc (arena, 1000);
+  assert (big != NULL);
+  assert (arena->current->size >= 1000);
+  memset (big, 0, 1000);
+
+  /* blocks are kept over a rewind, so no more mallocs are needed */
+  lwes_arena_rewind (arena, &mark);
+  malloc_count = 0;
+  assert (lwes_arena_alloc (arena, 100) == c);
+  assert (lwes_arena_alloc (arena, 1000) == big);
+  assert (malloc_count == 0);
+
+  /* a new block is needed when growing fails */
+  malloc_count = 0;
+  null_at = 1;
+  assert (lwes_arena_alloc (arena, 5000) == NULL);
+  null_at = 0;
+
+  /* rewinding everything, then trimming, leaves only the first block */
+  lwes_arena_rewind (arena, NULL);
+  assert (arena->current == arena->first);
+  assert (arena->first->used == 0);
+  assert (arena->first->next != NULL);
+  lwes_arena_trim (arena);
+  assert (arena->first->next == NULL);
+  assert (lwes_arena_alloc (arena, 1) == a);
+
+  lwes_arena_destroy (arena);
+}
+
+/* give an event NUM_ATTRS attributes of mixed types */
+static void
+fill_event (struct lwes_event *event, int i)
+{
+  char name[20];
+  int j;
+  LWES_U_INT_16 arr[4] = { 1, 2, 3, 4 };
+
+  for (j = 0; j < NUM_ATTRS - 1; ++j)
+    {
+      snprintf (name, sizeof (name), "attr%d", j);
+      switch (j % 4)
+        {
+          case 0:
+            assert (lwes_event_set_INT_32 (event, name, i + j) > 0);
+            break;
+          case 1:
+            assert (lwes_event_set_U_INT_64 (event, name, i * j) > 0);
+            break;
+          case 2:
+            assert (lwes_event_set_STRING (event, name, "some string value") > 0);
+            break;
+          default:
+            assert (lwes_event_set_BOOLEAN (event, name, j & 1) > 0);
+            break;
+        }
+    }
+  assert (lwes_event_set_U_INT_16_ARRAY (event, "array", 4, arr)
+          == NUM_ATTRS);
+}
+
+static void
+test_event_in_arena (void)
+{
+  struct lwes_event *event;
+  struct lwes_event *reference;
+  struct lwes_event_deserialize_tmp dtmp;
+  LWES_BYTE bytes[2048];
+  LWES_BYTE ref_bytes[2048];
+  LWES_SHORT_STRING name;
+  LWES_LONG_STRING str;
+  LWES_INT_32 i32;
+  LWES_U_INT_16 num;
+  LWES_U_INT_16 *arr;
+  int len, ref_len, i;
+
+  /* malloc failures while creating the arena */
+  malloc_count = 0;
+  null_at = 1;
+  assert (lwes_event_create_in_arena (NULL, "Foo", 0) == NULL);
+  malloc_count = 0;
+  null_at = 2;
+  assert (lwes_event_create_in_arena (NULL, "Foo", 0) == NULL);
+  /* and when the first block is too small for the event */
+  malloc_count = 0;
+  null_at = 3;
+  assert (lwes_event_create_in_arena (NULL, "Foo", 16) == NULL);
+  null_at = 0;
+
+  /* an arena event serializes just like a malloc one */
+  reference = lwes_event_create (NULL, "Bench::Event");
+  event = lwes_event_create_in_arena (NULL, "Bench::Event", 0);
+  assert (reference != NULL && event != NULL);
+  fill_event (reference, 7);
+  fill_event (event, 7);
+  ref_len = lwes_event_to_bytes (reference, ref_bytes, sizeof (ref_bytes), 0);
+  len = lwes_event_to_bytes (event, bytes, sizeof (bytes), 0);
+  assert (ref_len > 0);
+  assert (len == ref_len);
+  assert (memcmp (bytes, ref_bytes, len) == 0);
+
+  /* replacing attributes works, with the old value left in the arena */
+  assert (lwes_event_set_INT_32 (event, "attr0", -5) == NUM_ATTRS);
+  assert (lwes_event_set_STRING (event, "attr0", "now a string") == NUM_ATTRS);
+  assert (lwes_event_get_STRING (event, "attr0", &str) == 0);
+  assert (strcmp (str, "now a string") == 0);
+  assert (lwes_event_destroy (event) == 0);
+
+  /* decoding into a cleared arena event does not allocate */
+  event = lwes_event_create_in_arena (NULL, NULL, 0);
+  assert (event != NULL);
+  for (i = 0; i < 3; ++i)
+    {
+      malloc_count = 0;
+      assert (lwes_event_clear (event) == 0);
+      assert (lwes_event_from_bytes (event, ref_bytes, ref_len, 0, &dtmp)
+              == ref_len);
+      if (i > 0)
+        {
+          assert (malloc_count == 0);
+        }
+      assert (lwes_event_get_name (event, &name) == 0);
+      assert (strcmp (name, "Bench::Event") == 0);
+      assert (lwes_event_get_number_of_attributes (event, &num) == 0);
+      assert (num == NUM_ATTRS);
+      assert (lwes_event_get_INT_32 (event, "attr4", &i32) == 0);
+      assert (i32 == 11);
+      assert (lwes_event_get_U_INT_16_ARRAY (event, "array", &num, &arr) == 0);
+      assert (num == 4 && arr[3] == 4);
+    }
+
+  /* failing to decode leaves nothing to free separately */
+  assert (lwes_event_clear (event) == 0);
+  assert (lwes_event_from_bytes (event, ref_bytes, ref_len - 1, 0, &dtmp) < 0);
+
+  /* reset gives the memory back, and the event is still usable */
+  assert (lwes_event_reset (event) == 0);
+  assert (event->arena->first->next == NULL);
+  assert (lwes_event_get_number_of_attributes (event, &num) == 0);
+  assert (num == 0);
+  assert (lwes_event_from_bytes (event, ref_bytes, ref_len, 0, &dtmp)
+          == ref_len);
+  assert (lwes_event_destroy (event) == 0);
+  assert (lwes_event_destroy (reference) == 0);
+}
+
+static double
+elapsed_usec (struct timeval *start)
+{
+  struct timeval now;
+  gettimeofday (&now, NULL);
+  return (now.tv_sec - start->tv_sec) * 1000000.0
+           + (now.tv_usec - start->tv_usec);
+}
+
+/* not a pass/fail test, just numbers for comparing the two paths */
+static void
+benchmark_event_allocation (void)
+{
+  struct lwes_event *event;
+  struct lwes_event_deserialize_tmp dtmp;
+  struct timeval start;
+  LWES_BYTE bytes[2048];
+  int len, i;
+  double malloc_build, arena_build;
+  double malloc_decode, clear_decode, arena_decode;
+
+  gettimeofday (&start, NULL);
+  for (i = 0; i < BENCH_ITERATIONS; ++i)
+    {
+      event = lwes_event_create (NULL, "Bench::Event");
+      fill_event (event, i);
+      len = lwes_event_to_bytes (event, bytes, sizeof (bytes), 0);
+      lwes_event_destroy (event);
+    }
+  malloc_build = elapsed_usec (&start);
+
+  gettimeofday (&start, NULL);
+  for (i = 0; i < BENCH_ITERATIONS; ++i)
+    {
+      event = lwes_event_create_in_arena (NULL, "Bench::Event", 0);
+      fill_event (event, i);
+      len = lwes_event_to_bytes (event, bytes, sizeof (bytes), 0);
+      lwes_event_destroy (event);
+    }
+  arena_build = elapsed_usec (&start);
+  assert (len > 0);
+
+  gettimeofday (&start, NULL);
+  for (i = 0; i < BENCH_ITERATIONS; ++i)
+    {
+      event = lwes_event_create_no_name (NULL);
+      assert (lwes_event_from_bytes (event, bytes, len, 0, &dtmp) == len);
+      lwes_event_destroy (event);
+    }
+  malloc_decode = elapsed_usec (&start);
+
+  event = lwes_event_create_no_name (NULL);
+  gettimeofday (&start, NULL);
+  for (i = 0; i < BENCH_ITERATIONS; ++i)
+    {
+      lwes_event_clear (event);
+      assert (lwes_event_from_bytes (event, bytes, len, 0, &dtmp) == len);
+    }
+  clear_decode = elapsed_usec (&start);
+  lwes_event_destroy (event);
+
+  event = lwes_event_create_in_arena (NULL, NULL, 0);
+  gettimeofday (&start, NULL);
+  for (i = 0; i < BENCH_ITERATIONS; ++i)
+    {
+      lwes_event_clear (event);
+      assert (lwes_event_from_bytes (event, bytes, len, 0, &dtmp) == len);
+    }
+  arena_decode = elapsed_usec (&start);
+  lwes_event_destroy (event);
+
+  printf ("%d events of %d attributes, usec per event\n",
+          BENCH_ITERATIONS, NUM_ATTRS);
+  printf ("  build+serialize  malloc %6.2f  arena %6.2f\n",
+          malloc_build / BENCH_ITERATIONS, arena_build / BENCH_ITERATIONS);
+  printf ("  decode           malloc %6.2f  cleared %6.2f  arena %6.2f\n",
+          malloc_decode / BENCH_ITERATIONS, clear_decode / BENCH_ITERATIONS,
+          arena_decode / BENCH_ITERATIONS);
+}
+
+int main (void)
+{
+  test_arena ();
+  test_event_in_arena ();
+  benchmark_event_allocation ();
+  return 0;
+}
@@ -0,0 +1,419 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#include <assert.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lwes_async_emitter.h"
+#include "lwes_listener.h"
+
+const int   mcast_port      = 12355;
+const char *mcast_ip        = "224.0.0.254";
+const char *mcast_iface     = 0;
+
+LWES_SHORT_STRING eventname = (LWES_SHORT_STRING)"TypeChecker";
+LWES_SHORT_STRING key       = (LWES_SHORT_STRING)"anInt32";
+
+#define NUM_THREADS 4
+#define NUM_PER_THREAD 250
+
+struct producer_args
+{
+  struct lwes_async_emitter *async;
+  int emitted;
+  int failed;
+};
+
+static void *producer (void *arg)
+{
+  struct producer_args *args = (struct producer_args *)arg;
+  struct lwes_event *event;
+  int i;
+
+  event = lwes_event_create (NULL, eventname);
+  assert (event != NULL);
+  for (i = 0; i < NUM_PER_THREAD; i++)
+    {
+      assert (lwes_event_set_INT_32 (event, key, i) == 1);
+      if (lwes_async_emitter_emit (args->async, event) == 0)
+        {
+          args->emitted++;
+        }
+      else
+        {
+          args->failed++;
+        }
+    }
+  lwes_event_destroy (event);
+
+  return NULL;
+}
+
+/* run NUM_THREADS producers against the emitter, returning the number of
+   successful emits */
+static int run_producers (struct lwes_async_emitter *async)
+{
+  pthread_t threads[NUM_THREADS];
+  struct producer_args args[NUM_THREADS];
+  int emitted = 0;
+  int i;
+
+  for (i = 0; i < NUM_THREADS; i++)
+    {
+      args[i].async = async;
+      args[i].emitted = 0;
+      args[i].failed = 0;
+      assert (pthread_create (&threads[i], NULL, producer, &args[i]) == 0);
+    }
+  for (i = 0; i < NUM_THREADS; i++)
+    {
+      assert (pthread_join (threads[i], NULL) == 0);
+      assert (args[i].emitted + args[i].failed == NUM_PER_THREAD);
+      emitted += args[i].emitted;
+    }
+
+  return emitted;
+}
+
+/* wait up to 5 seconds for the sender thread to account for every event */
+static void wait_for_sender (struct lwes_async_emitter *async)
+{
+  int i;
+
+  for (i = 0; i < 5000; i++)
+    {
+      if (__atomic_load_n (&(async->sent), __ATOMIC_SEQ_CST)
+          + __atomic_load_n (&(async->dropped), __ATOMIC_SEQ_CST)
+          >= __atomic_load_n (&(async->enqueued), __ATOMIC_SEQ_CST)
+          && async->dequeue_pos == async->enqueue_pos)
+        {
+          return;
+        }
+      usleep (1000);
+    }
+  assert (0);
+}
+
+static void test_multiple_producers (void)
+{
+  struct lwes_async_emitter *async;
+  struct lwes_listener *listener;
+  LWES_BYTE bytes[MAX_MSG_SIZE];
+  int received = 0;
+
+  listener = lwes_listener_create ((char *) mcast_ip,
+                                   (char *) mcast_iface,
+                                   (int) mcast_port);
+  assert (listener != NULL);
+  /* recv first, so we are listening */
+  assert (lwes_listener_recv_bytes_by (listener, bytes,
+                                       MAX_MSG_SIZE, 10) < 0);
+
+  async = lwes_async_emitter_create ((char *) mcast_ip,
+                                     (char *) mcast_iface,
+                                     (int) mcast_port,
+                                     0, 60, 4096, 0, LWES_ASYNC_BLOCK);
+  assert (async != NULL);
+  assert (async->mask == 4095);
+  assert (async->slot_size == MAX_MSG_SIZE);
+
+  /* nothing is lost when producers wait for room */
+  assert (run_producers (async) == NUM_THREADS * NUM_PER_THREAD);
+  wait_for_sender (async);
+  assert (async->enqueued == NUM_THREADS * NUM_PER_THREAD);
+  assert (async->sent == NUM_THREADS * NUM_PER_THREAD);
+  assert (async->dropped == 0);
+
+  while (lwes_listener_recv_bytes_by (listener, bytes,
+                                      MAX_MSG_SIZE, 100) > 0)
+    {
+      assert (lwes_listener_event_has_name (bytes, MAX_MSG_SIZE,
+                                            eventname) == 0);
+      received++;
+    }
+  /* loopback multicast can still lose a few if the socket buffer fills */
+  assert (received > 0);
+
+  assert (lwes_async_emitter_destroy (async) == 0);
+  lwes_listener_destroy (listener);
+}
+
+static void test_overflow_policies (void)
+{
+  struct lwes_async_emitter *async;
+  int emitted;
+
+  /* with a tiny queue, DROP_NEWEST turns some emits away */
+  async = lwes_async_emitter_create ((char *) mcast_ip,
+                                     (char *) mcast_iface,
+                                     (int) mcast_port,
+                                     0, 60, 2, 0, LWES_ASYNC_DROP_NEWEST);
+  assert (async != NULL);
+  emitted = run_producers (async);
+  wait_for_sender (async);
+  assert (async->enqueued == emitted);
+  assert (async->dropped == NUM_THREADS * NUM_PER_THREAD - emitted);
+  assert (async->sent == async->enqueued);
+  assert (lwes_async_emitter_destroy (async) == 0);
+
+  /* DROP_OLDEST always accepts, but some queued events are discarded */
+  async = lwes_async_emitter_create ((char *) mcast_ip,
+                                     (char *) mcast_iface,
+                                     (int) mcast_port,
+                                     0, 60, 2, 0, LWES_ASYNC_DROP_OLDEST);
+  assert (async != NULL);
+  assert (run_producers (async) == NUM_THREADS * NUM_PER_THREAD);
+  wait_for_sender (async);
+  assert (async->enqueued == NUM_THREADS * NUM_PER_THREAD);
+  assert (async->sent + async->dropped == async->enqueued);
+  assert (lwes_async_emitter_destroy (async) == 0);
+
+  /* BLOCK never drops */
+  async = lwes_async_emitter_create ((char *) mcast_ip,
+                                     (char *) mcast_iface,
+                                     (int) mcast_port,
+                                     0, 60, 2, 0, LWES_ASYNC_BLOCK);
+  assert (async != NULL);
+  assert (run_producers (async) == NUM_THREADS * NUM_PER_THREAD);
+  wait_for_sender (async);
+  assert (async->dropped == 0);
+  assert (async->sent == NUM_THREADS * NUM_PER_THREAD);
+  assert (lwes_async_emitter_destroy (async) == 0);
+}
+
+static int hold = 0;
+static int held = 0;
+
+/* a heartbeat callback which keeps the sender thread in the middle of a
+   batch for as long as hold is set */
+static void hold_sender (struct lwes_event *heartbeat, void *data)
+{
+  (void)heartbeat;
+  (void)data;
+  __atomic_store_n (&held, 1, __ATOMIC_SEQ_CST);
+  while (__atomic_load_n (&hold, __ATOMIC_SEQ_CST))
+    {
+      usleep (1000);
+    }
+}
+
+static int overflow_done = 0;
+
+static void *emit_overflow (void *arg)
+{
+  struct lwes_async_emitter *async = (struct lwes_async_emitter *)arg;
+  struct lwes_event *event;
+
+  event = lwes_event_create (NULL, eventname);
+  assert (event != NULL);
+  assert (lwes_async_emitter_emit (async, event) == 0);
+  lwes_event_destroy (event);
+  __atomic_store_n (&overflow_done, 1, __ATOMIC_SEQ_CST);
+
+  return NULL;
+}
+
+/* DROP_OLDEST drops one event per overflowing emit, and none while the
+   event it would drop is in the batch the sender is sending */
+static void test_drop_oldest (void)
+{
+  struct lwes_async_emitter *async;
+  struct lwes_event *event;
+  pthread_t thread;
+  int i;
+
+  /* a frequency of 0 calls the heartbeat callback after every event */
+  async = lwes_async_emitter_create ((char *) mcast_ip,
+                                     (char *) mcast_iface,
+                                     (int) mcast_port,
+                                     1, 0, 4, 0, LWES_ASYNC_DROP_OLDEST);
+  assert (async != NULL);
+  async->emitter->heartbeat_callback = hold_sender;
+  event = lwes_event_create (NULL, eventname);
+  assert (event != NULL);
+
+  /* the sender takes position 0 and is held, 1 to 3 fill the queue */
+  __atomic_store_n (&hold, 1, __ATOMIC_SEQ_CST);
+  assert (lwes_async_emitter_emit (async, event) == 0);
+  while (! __atomic_load_n (&held, __ATOMIC_SEQ_CST))
+    {
+      usleep (1000);
+    }
+  for (i = 1; i < 4; i++)
+    {
+      assert (lwes_async_emitter_emit (async, event) == 0);
+    }
+  assert (async->dropped == 0);
+
+  /* position 4 needs the slot the sender holds, so the emit waits */
+  assert (pthread_create (&thread, NULL, emit_overflow, async) == 0);
+  for (i = 0; i < 1000 && __atomic_load_n (&(async->producers_waiting),
+                                            __ATOMIC_SEQ_CST) == 0; i++)
+    {
+      usleep (1000);
+    }
+  usleep (20000);
+  assert (__atomic_load_n (&(async->dropped), __ATOMIC_SEQ_CST) == 0);
+  assert (! __atomic_load_n (&overflow_done, __ATOMIC_SEQ_CST));
+  assert (async->producers_waiting == 1);
+
+  /* let the sender release its batch, then keep it from taking the next
+     one: it stops on the mutex to wake the waiting producer */
+  pthread_mutex_lock (&(async->mutex));
+  __atomic_store_n (&hold, 0, __ATOMIC_SEQ_CST);
+  while (__atomic_load_n (&(async->slots[0].sequence), __ATOMIC_SEQ_CST)
+         != 4)
+    {
+      usleep (1000);
+    }
+  assert (lwes_async_emitter_emit (async, event) == 0);
+  assert (async->dropped == 0);
+  for (i = 1; i <= 3; i++)
+    {
+      assert (lwes_async_emitter_emit (async, event) == 0);
+      assert (async->dropped == i);
+      assert (async->dequeue_pos == (size_t)(1 + i));
+    }
+  pthread_mutex_unlock (&(async->mutex));
+
+  assert (pthread_join (thread, NULL) == 0);
+  lwes_event_destroy (event);
+  wait_for_sender (async);
+  assert (async->enqueued == 9);
+  assert (async->sent + async->dropped == async->enqueued);
+  assert (lwes_async_emitter_destroy (async) == 0);
+}
+
+static void test_heartbeat_counters (void)
+{
+  struct lwes_async_emitter *async;
+  struct lwes_listener *listener;
+  struct lwes_event *event;
+  LWES_INT_64 value;
+  int found = 0;
+  int i;
+
+  listener = lwes_listener_create ((char *) mcast_ip,
+                                   (char *) mcast_iface,
+                                   (int) mcast_port);
+  assert (listener != NULL);
+  event = lwes_event_create_no_name (NULL);
+  assert (event != NULL);
+  /* recv first, so we are listening */
+  assert (lwes_listener_recv_by (listener, event, 10) < 0);
+  lwes_event_destroy (event);
+
+  /* a frequency of 0 sends a heartbeat after every event */
+  async = lwes_async_emitter_create ((char *) mcast_ip,
+                                     (char *) mcast_iface,
+                                     (int) mcast_port,
+                                     1, 0, 16, 1024, LWES_ASYNC_DROP_NEWEST);
+  assert (async != NULL);
+  event = lwes_event_create (NULL, eventname);
+  assert (event != NULL);
+  assert (lwes_async_emitter_emit (async, event) == 0);
+  lwes_event_destroy (event);
+  wait_for_sender (async);
+
+  for (i = 0; i < 3 && !found; i++)
+    {
+      event = lwes_event_create_no_name (NULL);
+      assert (event != NULL);
+      assert (lwes_listener_recv_by (listener, event, 1000) > 0);
+      if (strcmp (event->eventName, "System::Heartbeat") == 0)
+        {
+          assert (lwes_event_get_INT_64 (event,
+                                         (LWES_SHORT_STRING)"enqueued",
+                                         &value) == 0);
+          assert (value == 1);
+          assert (lwes_event_get_INT_64 (event,
+                                         (LWES_SHORT_STRING)"dropped",
+                                         &value) == 0);
+          assert (value == 0);
+          assert (lwes_event_get_INT_64 (event,
+                                         (LWES_SHORT_STRING)"sent",
+                                         &value) == 0);
+          found = 1;
+        }
+      lwes_event_destroy (event);
+    }
+  assert (found);
+
+  assert (lwes_async_emitter_destroy (async) == 0);
+  lwes_listener_destroy (listener);
+}
+
+static void test_failures (void)
+{
+  struct lwes_async_emitter *async;
+  struct lwes_event *event;
+  struct lwes_event *big;
+  LWES_INT_32 i;
+
+  assert (lwes_async_emitter_create ((char *) "not an address",
+                                     (char *) mcast_iface,
+                                     (int) mcast_port,
+                                     0, 60, 16, 0, LWES_ASYNC_BLOCK)
+          == NULL);
+
+  async = lwes_async_emitter_create ((char *) mcast_ip,
+                                     (char *) mcast_iface,
+                                     (int) mcast_port,
+                                     0, 60, 16, 64, LWES_ASYNC_BLOCK);
+  assert (async != NULL);
+
+  assert (lwes_async_emitter_emit (NULL, NULL) == -1);
+  assert (lwes_async_emitter_emit (async, NULL) == -1);
+
+  /* no name, can't serialize */
+  event = lwes_event_create_no_name (NULL);
+  assert (event != NULL);
+  assert (lwes_async_emitter_emit (async, event) == -1);
+  lwes_event_destroy (event);
+
+  /* too big for the 64 byte slots */
+  big = lwes_event_create (NULL, eventname);
+  assert (big != NULL);
+  for (i = 0; i < 10; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof (name), "attr%d", (int)i);
+      assert (lwes_event_set_INT_32 (big, (LWES_SHORT_STRING)name, i) == i + 1);
+    }
+  assert (lwes_async_emitter_emit (async, big) == -1);
+  lwes_event_destroy (big);
+
+  /* the failed slots are skipped and the queue keeps working */
+  event = lwes_event_create (NULL, eventname);
+  assert (event != NULL);
+  assert (lwes_async_emitter_emit (async, event) == 0);
+  lwes_event_destroy (event);
+  wait_for_sender (async);
+  assert (async->enqueued == 1);
+  assert (async->sent == 1);
+
+  assert (lwes_async_emitter_destroy (async) == 0);
+  assert (lwes_async_emitter_destroy (NULL) == -1);
+}
+
+int main (void)
+{
+  test_multiple_producers ();
+  test_overflow_policies ();
+  test_drop_oldest ();
+  test_heartbeat_counters ();
+  test_failures ();
+
+  return 0;
+}
@@ -15,6 +15,7 @@
 #include <sys/wait.h>
 #include <unistd.h>
 #include <netdb.h>
+#include <string.h>
 
 #include "lwes_net_functions.h"
 #include "lwes_marshall_functions.h"
@@ -99,6 +100,21 @@ my_lwes_net_send_bytes
   return -1;
 }
 
+static int lwes_net_send_bytes_batch_error = 0;
+static int
+my_lwes_net_send_bytes_batch
+  (struct lwes_net_connection *conn,
+   LWES_BYTE_P *bytes,
+   size_t *lens,
+   unsigned int count)
+{
+  if (lwes_net_send_bytes_batch_error == 0)
+    {
+      return lwes_net_send_bytes_batch (conn, bytes, lens, count);
+    }
+  return -2;
+}
+
 static int lwes_net_sendto_bytes_error = 0;
 static int
 my_lwes_net_sendto_bytes
@@ -169,6 +185,7 @@ my_lwes_event_add_headers
 #define lwes_net_set_ttl my_lwes_net_set_ttl
 #define lwes_net_sendto_bytes my_lwes_net_sendto_bytes
 #define lwes_net_send_bytes my_lwes_net_send_bytes
+#define lwes_net_send_bytes_batch my_lwes_net_send_bytes_batch
 #define lwes_net_recv_bytes my_lwes_net_recv_bytes
 #define lwes_event_to_bytes my_lwes_event_to_bytes
 #define lwes_event_add_headers my_lwes_event_add_headers
@@ -182,6 +199,7 @@ my_lwes_event_add_headers
 #undef lwes_net_set_ttl
 #undef lwes_net_sendto_bytes
 #undef lwes_net_send_bytes
+#undef lwes_net_send_bytes_batch
 #undef lwes_net_recv_bytes
 #undef lwes_event_to_bytes
 #undef lwes_event_add_headers
@@ -558,6 +576,644 @@ static void test_event_name_peek (void)
   }
 }
 
+static void batch_recv
+  (struct lwes_listener *listener, const char *name, LWES_INT_32 expected)
+{
+  struct lwes_event *event;
+  LWES_INT_32 value;
+
+  event = lwes_event_create_no_name (NULL);
+  assert (event != NULL);
+  assert (lwes_listener_recv_by (listener, event, 1000) > 0);
+  assert (strcmp (event->eventName, name) == 0);
+  if (expected >= 0)
+    {
+      assert (lwes_event_get_INT_32 (event, key07, &value) == 0);
+      assert (value == expected);
+    }
+  lwes_event_destroy (event);
+}
+
+static void test_emit_batch (void)
+{
+  struct lwes_listener *listener;
+  struct lwes_emitter *emitter;
+  struct lwes_event *events[5];
+  struct lwes_event *skipped[3];
+  struct lwes_event *event;
+  LWES_BYTE bytes[MAX_MSG_SIZE];
+  LWES_BYTE_P bufs[1];
+  size_t lens[1];
+  char big[40000];
+  LWES_INT_64 count;
+  int size;
+  int i;
+
+  emitter = lwes_emitter_create ((char *) mcast_ip,
+                                 (char *) mcast_iface,
+                                 (int) mcast_port,
+                                 1,
+                                 60);
+  assert (emitter != NULL);
+
+  listener = lwes_listener_create ((char *) mcast_ip,
+                                   (char *) mcast_iface,
+                                   (int) mcast_port);
+  assert (listener != NULL);
+
+  for (i = 0; i < 5; i++)
+    {
+      events[i] = lwes_event_create (NULL, eventname);
+      assert (events[i] != NULL);
+      assert (lwes_event_set_INT_32 (events[i], key07, i) == 1);
+    }
+
+  /* recv first, so we are listening */
+  event = lwes_event_create_no_name (NULL);
+  assert (event != NULL);
+  assert (lwes_listener_recv_by (listener, event, 10) != 0);
+  lwes_event_destroy (event);
+
+  /* accumulate, nothing goes out until the batch is full */
+  assert (lwes_emitter_set_batch_size (emitter, 4) == 0);
+  assert (emitter->batch_capacity == 4);
+  count = emitter->count;
+  for (i = 0; i < 3; i++)
+    {
+      assert (lwes_emitter_emit (emitter, events[i]) == 0);
+    }
+  assert (emitter->batch_count == 3);
+  assert (emitter->count == count + 3);
+  assert (lwes_listener_recv_bytes_by (listener, bytes,
+                                       MAX_MSG_SIZE, 10) < 0);
+  assert (lwes_emitter_emit (emitter, events[3]) == 0);
+  assert (emitter->batch_count == 0);
+  for (i = 0; i < 4; i++)
+    {
+      batch_recv (listener, (char *)eventname, i);
+    }
+
+  /* an explicit flush sends a partial batch */
+  assert (lwes_emitter_emit (emitter, events[4]) == 0);
+  assert (lwes_emitter_flush (emitter) == 1);
+  batch_recv (listener, (char *)eventname, 4);
+  assert (lwes_emitter_flush (emitter) == 0);
+
+  /* turning accumulation off sends immediately again */
+  assert (lwes_emitter_set_batch_size (emitter, 0) == 0);
+  assert (emitter->batch_capacity == 0);
+  assert (lwes_emitter_emit (emitter, events[0]) == 0);
+  batch_recv (listener, (char *)eventname, 0);
+
+  /* a whole batch at once, each event counted towards the heartbeat */
+  count = emitter->count;
+  assert (lwes_emitter_emit_batch (emitter, events, 5) == 5);
+  assert (emitter->count == count + 5);
+  assert (emitter->batch_accumulate == FALSE);
+  assert (emitter->batch_count == 0);
+  for (i = 0; i < 5; i++)
+    {
+      batch_recv (listener, (char *)eventname, i);
+    }
+
+  /* a heartbeat due part way through a batch goes out in order */
+  time_future = 120;
+  assert (lwes_emitter_emit_batch (emitter, events, 2) == 2);
+  time_future = 0;
+  batch_recv (listener, (char *)eventname, 0);
+  batch_recv (listener, "System::Heartbeat", -1);
+  batch_recv (listener, (char *)eventname, 1);
+
+  /* an event too big to serialize is skipped, the rest still go out */
+  for (i = 0; i < (int)sizeof (big) - 1; i++)
+    {
+      big[i] = 'x';
+    }
+  big[sizeof (big) - 1] = '\0';
+  event = lwes_event_create (NULL, eventname);
+  assert (event != NULL);
+  assert (lwes_event_set_STRING (event, "big1", big) == 1);
+  assert (lwes_event_set_STRING (event, "big2", big) == 2);
+  skipped[0] = events[0];
+  skipped[1] = event;
+  skipped[2] = events[1];
+  assert (lwes_emitter_emit_batch (emitter, skipped, 3) == 2);
+  batch_recv (listener, (char *)eventname, 0);
+  batch_recv (listener, (char *)eventname, 1);
+  lwes_event_destroy (event);
+
+  /* bytes and serialized events keep their place behind pending events */
+  time_future = 0;
+  assert (lwes_emitter_set_batch_size (emitter, 4) == 0);
+  size = lwes_event_to_bytes (events[1], bytes, MAX_MSG_SIZE, 0);
+  assert (size > 0);
+  assert (lwes_emitter_emit (emitter, events[0]) == 0);
+  assert (lwes_emitter_emit_bytes (emitter, bytes, size) == size);
+  assert (emitter->batch_count == 2);
+  assert (lwes_emitter_emit (emitter, events[2]) == 0);
+  assert (lwes_emitter_flush (emitter) == 3);
+  for (i = 0; i < 3; i++)
+    {
+      batch_recv (listener, (char *)eventname, i);
+    }
+  assert (lwes_emitter_emit (emitter, events[0]) == 0);
+  bufs[0] = bytes;
+  lens[0] = (size_t)size;
+  assert (lwes_emitter_emit_serialized (emitter, bufs, lens, 1) == 1);
+  assert (emitter->batch_count == 0);
+  batch_recv (listener, (char *)eventname, 0);
+  batch_recv (listener, (char *)eventname, 1);
+  assert (lwes_emitter_set_batch_size (emitter, 0) == 0);
+
+  for (i = 0; i < 5; i++)
+    {
+      lwes_event_destroy (events[i]);
+    }
+  lwes_listener_destroy (listener);
+  lwes_emitter_destroy (emitter);
+}
+
+static void test_recv_batch (void)
+{
+  struct lwes_listener *listener;
+  struct lwes_emitter *emitter;
+  struct lwes_event *events[5];
+  struct lwes_event *event;
+  struct lwes_listener_packet *packets;
+  LWES_INT_32 value;
+  LWES_INT_64 receipt_time;
+  int n;
+  int got;
+  int i;
+
+  emitter = lwes_emitter_create ((char *) mcast_ip,
+                                 (char *) mcast_iface,
+                                 (int) mcast_port,
+                                 0,
+                                 60);
+  assert (emitter != NULL);
+
+  listener = lwes_listener_create ((char *) mcast_ip,
+                                   (char *) mcast_iface,
+                                   (int) mcast_port);
+  assert (listener != NULL);
+
+  for (i = 0; i < 5; i++)
+    {
+      events[i] = lwes_event_create (NULL, eventname);
+      assert (events[i] != NULL);
+      assert (lwes_event_set_INT_32 (events[i], key07, i) == 1);
+    }
+
+  /* recv first, so we are listening, the ring is created on first use */
+  assert (listener->batch_capacity == 0);
+  assert (lwes_listener_recv_batch_by (listener, &packets, 8, 10) == -2);
+  assert (listener->batch_capacity == LWES_LISTENER_DEFAULT_BATCH_SIZE);
+
+  /* a ring of 3 means the 5 events need at least 2 receives */
+  assert (lwes_listener_set_batch_size (listener, 3) == 0);
+  assert (lwes_emitter_emit_batch (emitter, events, 5) == 5);
+  for (got = 0; got < 5; got += n)
+    {
+      n = lwes_listener_recv_batch_by (listener, &packets, 8, 1000);
+      assert (n > 0 && n <= 3);
+      assert (packets >= listener->batch
+              && packets + n <= listener->batch + 3);
+      for (i = 0; i < n; i++)
+        {
+          assert (lwes_listener_event_has_name (packets[i].bytes,
+                                                packets[i].length,
+                                                eventname) == 0);
+          assert (packets[i].receipt_time > 0);
+          assert (lwes_listener_packet_add_header_fields (&packets[i]) == 0);
+
+          event = lwes_event_create_no_name (NULL);
+          assert (event != NULL);
+          assert (lwes_event_from_bytes (event, packets[i].bytes,
+                                         packets[i].length, 0,
+                                         listener->dtmp) > 0);
+          assert (lwes_event_get_INT_32 (event, key07, &value) == 0);
+          assert (value == got + i);
+          assert (lwes_event_get_INT_64 (event,
+                                         (LWES_SHORT_STRING)"ReceiptTime",
+                                         &receipt_time) == 0);
+          assert (receipt_time == packets[i].receipt_time);
+          lwes_event_destroy (event);
+        }
+    }
+
+  /* the blocking version returns as soon as something is there */
+  assert (lwes_emitter_emit (emitter, events[0]) == 0);
+  assert (lwes_listener_recv_batch (listener, &packets, 8) == 1);
+
+  /* argument failures */
+  assert (lwes_listener_recv_batch (NULL, &packets, 8) == -1);
+  assert (lwes_listener_recv_batch (listener, NULL, 8) == -1);
+  assert (lwes_listener_recv_batch (listener, &packets, 0) == -1);
+  assert (lwes_listener_set_batch_size (NULL, 3) == -1);
+  assert (lwes_listener_packet_add_header_fields (NULL) == -1);
+
+  /* malloc failure for the ring leaves the old one in place */
+  malloc_count = 0;
+  null_at      = 1;
+  assert (lwes_listener_set_batch_size (listener, 4) == -2);
+  null_at      = 0;
+  assert (listener->batch_capacity == 3);
+  assert (lwes_listener_set_batch_size (listener, 0) == 0);
+  assert (listener->batch == NULL);
+
+  for (i = 0; i < 5; i++)
+    {
+      lwes_event_destroy (events[i]);
+    }
+  lwes_listener_destroy (listener);
+  lwes_emitter_destroy (emitter);
+}
+
+static void test_receipt_time_nanos (void)
+{
+  struct lwes_listener *listener;
+  struct lwes_emitter *emitter;
+  struct lwes_event *event;
+  struct lwes_event *received;
+  struct lwes_listener_packet *packets;
+  LWES_INT_64 before;
+  LWES_INT_64 after;
+  LWES_INT_64 receipt_time;
+  LWES_INT_64 receipt_time_nanos;
+  int ret;
+
+  emitter = lwes_emitter_create ((char *) mcast_ip,
+                                 (char *) mcast_iface,
+                                 (int) mcast_port,
+                                 0,
+                                 60);
+  assert (emitter != NULL);
+
+  listener = lwes_listener_create ((char *) mcast_ip,
+                                   (char *) mcast_iface,
+                                   (int) mcast_port);
+  assert (listener != NULL);
+
+  event = lwes_event_create (NULL, eventname);
+  assert (event != NULL);
+  assert (lwes_event_set_INT_32 (event, key07, 7) == 1);
+
+  assert (lwes_listener_set_kernel_timestamps (NULL, TRUE) == -1);
+  assert (lwes_listener_set_receipt_time_nanos (NULL, TRUE) == -1);
+  ret = lwes_listener_set_kernel_timestamps (listener, TRUE);
+  assert (ret == 0 || ret == -2);
+  assert (lwes_listener_set_receipt_time_nanos (listener, TRUE) == 0);
+
+  /* single receive, ReceiptTimeNanos is the same instant as ReceiptTime */
+  received = lwes_event_create_no_name (NULL);
+  assert (received != NULL);
+  before = currentTimeMillisLongLong ();
+  assert (lwes_emitter_emit (emitter, event) == 0);
+  assert (lwes_listener_recv_by (listener, received, 1000) > 0);
+  after = currentTimeMillisLongLong ();
+  assert (lwes_event_get_INT_64 (received,
+                                 (LWES_SHORT_STRING)"ReceiptTime",
+                                 &receipt_time) == 0);
+  assert (lwes_event_get_INT_64 (received,
+                                 (LWES_SHORT_STRING)"ReceiptTimeNanos",
+                                 &receipt_time_nanos) == 0);
+  assert (receipt_time >= before && receipt_time <= after);
+  assert (receipt_time_nanos / 1000000 == receipt_time);
+  lwes_event_destroy (received);
+
+  /* batch receive carries the nanosecond time in the packet */
+  assert (lwes_emitter_emit (emitter, event) == 0);
+  assert (lwes_listener_recv_batch_by (listener, &packets, 8, 1000) == 1);
+  assert (packets[0].receipt_time_nanos / 1000000
+          == packets[0].receipt_time);
+  assert (lwes_listener_packet_add_header_fields (&packets[0]) == 0);
+  received = lwes_event_create_no_name (NULL);
+  assert (received != NULL);
+  assert (lwes_event_from_bytes (received, packets[0].bytes,
+                                 packets[0].length, 0,
+                                 listener->dtmp) > 0);
+  assert (lwes_event_get_INT_64 (received,
+                                 (LWES_SHORT_STRING)"ReceiptTimeNanos",
+                                 &receipt_time_nanos) == 0);
+  assert (receipt_time_nanos == packets[0].receipt_time_nanos);
+  lwes_event_destroy (received);
+
+  /* without the flag only the millisecond header is added */
+  assert (lwes_listener_set_receipt_time_nanos (listener, FALSE) == 0);
+  received = lwes_event_create_no_name (NULL);
+  assert (received != NULL);
+  assert (lwes_emitter_emit (emitter, event) == 0);
+  assert (lwes_listener_recv_by (listener, received, 1000) > 0);
+  assert (lwes_event_get_INT_64 (received,
+                                 (LWES_SHORT_STRING)"ReceiptTime",
+                                 &receipt_time) == 0);
+  assert (lwes_event_get_INT_64 (received,
+                                 (LWES_SHORT_STRING)"ReceiptTimeNanos",
+                                 &receipt_time_nanos) != 0);
+  lwes_event_destroy (received);
+
+  assert (lwes_listener_set_kernel_timestamps (listener, FALSE) == 0);
+
+  lwes_event_destroy (event);
+  lwes_listener_destroy (listener);
+  lwes_emitter_destroy (emitter);
+}
+
+static void test_subscriptions (void)
+{
+  struct lwes_listener *listener;
+  struct lwes_emitter *emitter;
+  struct lwes_event *events[5];
+  struct lwes_event *received;
+  struct lwes_listener_packet *packets;
+  LWES_BYTE bytes[32];
+  LWES_INT_32 value;
+  int i;
+
+  emitter = lwes_emitter_create ((char *) mcast_ip,
+                                 (char *) mcast_iface,
+                                 (int) mcast_port,
+                                 0,
+                                 60);
+  assert (emitter != NULL);
+
+  listener = lwes_listener_create ((char *) mcast_ip,
+                                   (char *) mcast_iface,
+                                   (int) mcast_port);
+  assert (listener != NULL);
+
+  /* bad patterns */
+  assert (lwes_listener_subscribe (NULL, "Click::*") == -1);
+  assert (lwes_listener_subscribe (listener, NULL) == -1);
+  assert (lwes_listener_subscribe (listener, "") == -1);
+  assert (lwes_listener_subscribe (listener, "Click*") == -1);
+  assert (lwes_listener_subscribe (listener, "Click::*::View") == -1);
+  assert (lwes_listener_subscribe (listener, "::*") == -1);
+  assert (listener->subscriptions == NULL);
+
+  /* with no subscriptions everything matches */
+  bytes[0] = 5;
+  memcpy (&(bytes[1]), "Other", 5);
+  assert (lwes_listener_is_subscribed (listener, bytes, 6) == 1);
+
+  assert (lwes_listener_subscribe (listener, (char *) eventname) == 0);
+  assert (lwes_listener_subscribe (listener, "Click::*") == 0);
+  assert (lwes_listener_subscribe (listener, "Click::*") == 0);
+  assert (listener->subscription_prefixes == 1);
+
+  /* matching on the raw bytes */
+  assert (lwes_listener_is_subscribed (NULL, bytes, 6) == -1);
+  assert (lwes_listener_is_subscribed (listener, NULL, 6) == -1);
+  assert (lwes_listener_is_subscribed (listener, bytes, 5) == -1);
+  assert (lwes_listener_is_subscribed (listener, bytes, 6) == 0);
+  bytes[0] = 10;
+  memcpy (&(bytes[1]), "Click::Buy", 10);
+  assert (lwes_listener_is_subscribed (listener, bytes, 11) == 1);
+  bytes[0] = 17;
+  memcpy (&(bytes[1]), "Click::Deep::View", 17);
+  assert (lwes_listener_is_subscribed (listener, bytes, 18) == 1);
+  bytes[0] = 9;
+  memcpy (&(bytes[1]), "Click:Buy", 9);
+  assert (lwes_listener_is_subscribed (listener, bytes, 10) == 0);
+  bytes[0] = 9;
+  memcpy (&(bytes[1]), "Clicks::A", 9);
+  assert (lwes_listener_is_subscribed (listener, bytes, 10) == 0);
+
+  events[0] = lwes_event_create (NULL, (LWES_SHORT_STRING)"Other");
+  events[1] = lwes_event_create (NULL, (LWES_SHORT_STRING)"Click::Buy");
+  events[2] = lwes_event_create (NULL, (LWES_SHORT_STRING)"Clicks");
+  events[3] = lwes_event_create (NULL, eventname);
+  events[4] = lwes_event_create (NULL, (LWES_SHORT_STRING)"Other::Click");
+  for (i = 0; i < 5; i++)
+    {
+      assert (events[i] != NULL);
+      assert (lwes_event_set_INT_32 (events[i], key07, i) == 1);
+    }
+
+  /* only events 1 and 3 come through, the rest are counted */
+  assert (lwes_emitter_emit_batch (emitter, events, 5) == 5);
+  received = lwes_event_create_no_name (NULL);
+  assert (received != NULL);
+  assert (lwes_listener_recv_by (listener, received, 1000) > 0);
+  assert (lwes_event_get_INT_32 (received, key07, &value) == 0);
+  assert (value == 1);
+  lwes_event_clear (received);
+  assert (lwes_listener_recv_by (listener, received, 1000) > 0);
+  assert (lwes_event_get_INT_32 (received, key07, &value) == 0);
+  assert (value == 3);
+  assert (lwes_listener_recv_by (listener, received, 10) < 0);
+  assert (lwes_listener_get_filtered_count (listener) == 3);
+  assert (lwes_listener_get_filtered_count (NULL) == 0);
+
+  /* batches are compacted so the matches are consecutive */
+  assert (lwes_emitter_emit_batch (emitter, events, 5) == 5);
+  assert (lwes_listener_recv_batch_by (listener, &packets, 8, 1000) == 2);
+  assert (lwes_listener_event_has_name (packets[0].bytes, packets[0].length,
+                                        "Click::Buy") == 0);
+  assert (lwes_listener_event_has_name (packets[1].bytes, packets[1].length,
+                                        eventname) == 0);
+  assert (lwes_listener_recv_batch_by (listener, &packets, 8, 10) == -2);
+  assert (lwes_listener_get_filtered_count (listener) == 6);
+
+  /* clearing lets everything through again */
+  assert (lwes_listener_clear_subscriptions (NULL) == -1);
+  assert (lwes_listener_clear_subscriptions (listener) == 0);
+  assert (listener->subscriptions == NULL);
+  assert (lwes_emitter_emit (emitter, events[0]) == 0);
+  lwes_event_clear (received);
+  assert (lwes_listener_recv_by (listener, received, 1000) > 0);
+  assert (lwes_event_get_INT_32 (received, key07, &value) == 0);
+  assert (value == 0);
+
+  /* subscriptions are freed with the listener */
+  assert (lwes_listener_subscribe (listener, "Click::*") == 0);
+
+  lwes_event_destroy (received);
+  for (i = 0; i < 5; i++)
+    {
+      lwes_event_destroy (events[i]);
+    }
+  lwes_listener_destroy (listener);
+  lwes_emitter_destroy (emitter);
+}
+
+static void test_kernel_filter (void)
+{
+  struct lwes_listener *listener;
+  struct lwes_emitter *emitter;
+  struct lwes_event *events[3];
+  struct lwes_event *received;
+  LWES_INT_32 value;
+  int ret;
+  int i;
+
+  emitter = lwes_emitter_create ((char *) mcast_ip,
+                                 (char *) mcast_iface,
+                                 (int) mcast_port,
+                                 0,
+                                 60);
+  assert (emitter != NULL);
+
+  listener = lwes_listener_create ((char *) mcast_ip,
+                                   (char *) mcast_iface,
+                                   (int) mcast_port);
+  assert (listener != NULL);
+
+  events[0] = lwes_event_create (NULL, (LWES_SHORT_STRING)"Other");
+  events[1] = lwes_event_create (NULL, (LWES_SHORT_STRING)"Click::Buy");
+  events[2] = lwes_event_create (NULL, eventname);
+  for (i = 0; i < 3; i++)
+    {
+      assert (events[i] != NULL);
+      assert (lwes_event_set_INT_32 (events[i], key07, i) == 1);
+    }
+
+  assert (lwes_listener_set_kernel_filter (NULL, TRUE) == -1);
+  assert (lwes_listener_subscribe (listener, "Click::*") == 0);
+  ret = lwes_listener_set_kernel_filter (listener, TRUE);
+  if (ret == -2)
+    {
+      /* no socket filters here */
+      assert (listener->kernel_filter == FALSE);
+    }
+  else
+    {
+      assert (ret == 0);
+      assert (lwes_listener_subscribe (listener, (char *) eventname) == 0);
+
+      /* the kernel drops Other, so the listener never sees it */
+      assert (lwes_emitter_emit_batch (emitter, events, 3) == 3);
+      received = lwes_event_create_no_name (NULL);
+      assert (received != NULL);
+      for (i = 1; i < 3; i++)
+        {
+          lwes_event_clear (received);
+          assert (lwes_listener_recv_by (listener, received, 1000) > 0);
+          assert (lwes_event_get_INT_32 (received, key07, &value) == 0);
+          assert (value == i);
+        }
+      assert (lwes_listener_recv_by (listener, received, 10) < 0);
+      assert (lwes_listener_get_filtered_count (listener) == 0);
+
+      /* clearing the subscriptions removes the filter */
+      assert (lwes_listener_clear_subscriptions (listener) == 0);
+      assert (lwes_emitter_emit (emitter, events[0]) == 0);
+      lwes_event_clear (received);
+      assert (lwes_listener_recv_by (listener, received, 1000) > 0);
+      assert (lwes_event_get_INT_32 (received, key07, &value) == 0);
+      assert (value == 0);
+
+      /* and a failed update turns kernel filtering off */
+      malloc_count = 0;
+      null_at      = 2;
+      assert (lwes_listener_subscribe (listener, "Click::*") == -3);
+      null_at      = 0;
+      assert (listener->kernel_filter == FALSE);
+      lwes_event_destroy (received);
+    }
+
+  assert (lwes_listener_set_kernel_filter (listener, FALSE) == ret);
+
+  for (i = 0; i < 3; i++)
+    {
+      lwes_event_destroy (events[i]);
+    }
+  lwes_listener_destroy (listener);
+  lwes_emitter_destroy (emitter);
+}
+
+static void test_emitto_cache (void)
+{
+  struct lwes_listener *listener;
+  struct lwes_emitter *emitter;
+  struct lwes_event *event;
+  struct lwes_emitter_connection_cache *cache;
+  int other_port = mcast_port + 3;
+  int third_port = mcast_port + 4;
+
+  emitter = lwes_emitter_create ((char *) mcast_ip,
+                                 (char *) mcast_iface,
+                                 (int) mcast_port,
+                                 0,
+                                 60);
+  assert (emitter != NULL);
+
+  listener = lwes_listener_create ((char *) mcast_ip,
+                                   (char *) mcast_iface,
+                                   (int) mcast_port);
+  assert (listener != NULL);
+
+  event = lwes_event_create (NULL, eventname);
+  assert (event != NULL);
+  assert (lwes_event_set_INT_32 (event, key07, 7) == 1);
+
+  /* recv first, so we are listening */
+  {
+    LWES_BYTE bytes[MAX_MSG_SIZE];
+    assert (lwes_listener_recv_bytes_by (listener, bytes,
+                                         MAX_MSG_SIZE, 10) < 0);
+  }
+
+  assert (lwes_emitter_set_emitto_cache_size (NULL, 2) == -1);
+  assert (lwes_emitter_set_emitto_cache_size (emitter, 2) == 0);
+  cache = emitter->emitto_cache;
+  assert (cache != NULL);
+
+  /* the second send reuses the connection opened by the first */
+  assert (lwes_emitter_emitto ((char *) mcast_ip, (char *) mcast_iface,
+                               mcast_port, emitter, event) == 0);
+  assert (lwes_emitter_emitto ((char *) mcast_ip, (char *) mcast_iface,
+                               mcast_port, emitter, event) == 0);
+  assert (cache->misses == 1 && cache->hits == 1 && cache->size == 1);
+  batch_recv (listener, (char *)eventname, 7);
+  batch_recv (listener, (char *)eventname, 7);
+
+  /* a third channel pushes out the least recently used */
+  assert (lwes_emitter_emitto ((char *) mcast_ip, (char *) mcast_iface,
+                               other_port, emitter, event) == 0);
+  assert (lwes_emitter_emitto ((char *) mcast_ip, (char *) mcast_iface,
+                               third_port, emitter, event) == 0);
+  assert (cache->misses == 3 && cache->evictions == 1 && cache->size == 2);
+  assert (lwes_emitter_emitto ((char *) mcast_ip, (char *) mcast_iface,
+                               mcast_port, emitter, event) == 0);
+  assert (cache->misses == 4 && cache->evictions == 2 && cache->size == 2);
+  batch_recv (listener, (char *)eventname, 7);
+
+  /* shrinking closes connections */
+  assert (lwes_emitter_set_emitto_cache_size (emitter, 1) == 0);
+  assert (cache->size == 1);
+  assert (lwes_emitter_emitto ((char *) mcast_ip, (char *) mcast_iface,
+                               mcast_port, emitter, event) == 0);
+  assert (cache->hits == 2);
+  batch_recv (listener, (char *)eventname, 7);
+
+  /* failures to open or send don't leave anything in the cache */
+  lwes_net_open_error = 1;
+  assert (lwes_emitter_emitto ((char *) mcast_ip, (char *) mcast_iface,
+                               other_port, emitter, event) == -2);
+  lwes_net_open_error = 0;
+  assert (cache->size == 1);
+  lwes_net_send_bytes_error = 1;
+  assert (lwes_emitter_emitto ((char *) mcast_ip, (char *) mcast_iface,
+                               mcast_port, emitter, event) == -2);
+  lwes_net_send_bytes_error = 0;
+  assert (cache->size == 0 && cache->head == NULL && cache->tail == NULL);
+
+  assert (lwes_emitter_set_emitto_cache_size (emitter, 0) == 0);
+  assert (emitter->emitto_cache == NULL);
+
+  /* leave one open for destroy to clean up */
+  assert (lwes_emitter_set_emitto_cache_size (emitter, 4) == 0);
+  assert (lwes_emitter_emitto ((char *) mcast_ip, (char *) mcast_iface,
+                               mcast_port, emitter, event) == 0);
+  batch_recv (listener, (char *)eventname, 7);
+
+  lwes_event_destroy (event);
+  lwes_listener_destroy (listener);
+  lwes_emitter_destroy (emitter);
+}
+
 static void test_emitter_failures (void)
 {
   /* open failures */
@@ -617,6 +1273,54 @@ static void test_emitter_failures (void)
     lwes_emitter_destroy (emitter);
   }
 
+  /* Test batch failures */
+  {
+    struct lwes_emitter *emitter;
+    struct lwes_event *event;
+    struct lwes_event *events[2];
+
+    emitter = lwes_emitter_create ((char *) mcast_ip,
+                                   (char *) mcast_iface,
+                                   (int) mcast_port, 0, 60);
+    assert (emitter != NULL);
+    event  = lwes_event_create (NULL, eventname);
+    assert ( event != NULL );
+    events[0] = event;
+    events[1] = event;
+
+    assert (lwes_emitter_set_batch_size (NULL, 4) == -1);
+    assert (lwes_emitter_flush (NULL) == -1);
+    assert (lwes_emitter_emit_batch (NULL, events, 2) == -1);
+    assert (lwes_emitter_emit_batch (emitter, NULL, 2) == -1);
+
+    /* malloc failure for the batch slots */
+    malloc_count = 0;
+    null_at      = 1;
+    assert (lwes_emitter_set_batch_size (emitter, 4) == -2);
+    assert (emitter->batch_accumulate == FALSE);
+    malloc_count = 0;
+    null_at      = 1;
+    assert (lwes_emitter_emit_batch (emitter, events, 2) == -2);
+    null_at      = 0;
+
+    assert (lwes_emitter_set_batch_size (emitter, 2) == 0);
+
+    lwes_event_to_bytes_error = 1;
+    assert (lwes_emitter_emit (emitter, event) == -1);
+    assert (lwes_emitter_emit_batch (emitter, events, 2) == 0);
+    lwes_event_to_bytes_error = 0;
+
+    lwes_net_send_bytes_batch_error = 1;
+    assert (lwes_emitter_emit (emitter, event) == 0);
+    assert (lwes_emitter_emit (emitter, event) == -2);
+    assert (emitter->batch_count == 0);
+    assert (lwes_emitter_emit_batch (emitter, events, 1) == -2);
+    lwes_net_send_bytes_batch_error = 0;
+
+    lwes_event_destroy (event);
+    lwes_emitter_destroy (emitter);
+  }
+
   /* Test emitto failures */
   {
     struct lwes_emitter *emitter;
@@ -1087,6 +1791,12 @@ int main (void)
   test_event_name_peek ();
   test_listener_failures ();
   test_emitter_failures ();
+  test_emit_batch ();
+  test_recv_batch ();
+  test_receipt_time_nanos ();
+  test_subscriptions ();
+  test_kernel_filter ();
+  test_emitto_cache ();
 
   test_emit ();
   test_emitto ();
@@ -0,0 +1,228 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "lwes_event.h"
+#include "lwes_event_type_db.h"
+
+/* generated from testeventtypedb.esf with lwes-esf-compile -p test */
+#include "testesfcompile_schema.h"
+
+/* generated from 2500 events without attributes and one with 1500 */
+#include "testesfcompile_large.h"
+
+static const char esffile[] = "testeventtypedb.esf";
+
+static void
+test_indices (void)
+{
+  int i;
+  int j;
+
+  assert (test_NUMBER_OF_EVENTS == 3);
+  assert (test_event_index ("MetaEventInfo") == test_EVENT_MetaEventInfo);
+  assert (test_event_index ("TypeChecker") == test_EVENT_TypeChecker);
+  assert (test_event_index ("Empty") == test_EVENT_Empty);
+  assert (test_event_index ("Missing") == -1);
+  assert (test_event_index ("") == -1);
+  assert (test_event_index (NULL) == -1);
+
+  /* every name hashes back to its own index */
+  for (i = 0; i < test_NUMBER_OF_EVENTS; i++)
+    {
+      assert (test_event_index (test_events[i].name) == i);
+      for (j = 0; j < test_events[i].number_of_attributes; j++)
+        {
+          assert (test_attribute_index
+                    (i, test_events[i].attributes[j].name) == j);
+        }
+    }
+
+  assert (test_attribute_index (test_EVENT_TypeChecker, "aString")
+          == test_TypeChecker_ATTR_aString);
+  assert (test_attribute_index (test_EVENT_TypeChecker, "string_null_array")
+          == test_TypeChecker_ATTR_string_null_array);
+  assert (test_attribute_index (test_EVENT_TypeChecker, "astring") == -1);
+  assert (test_attribute_index (test_EVENT_TypeChecker, NULL) == -1);
+  assert (test_attribute_index (-1, "aString") == -1);
+  assert (test_attribute_index (test_NUMBER_OF_EVENTS, "aString") == -1);
+
+  /* the meta attributes are part of every event */
+  assert (test_TypeChecker_NUMBER_OF_ATTRIBUTES == 21);
+  assert (test_Empty_NUMBER_OF_ATTRIBUTES == 5);
+  assert (test_attribute_index (test_EVENT_Empty, "SenderIP")
+          == test_Empty_ATTR_SenderIP);
+  assert (test_attribute_index (test_EVENT_TypeChecker, "ReceiptTime")
+          == test_TypeChecker_ATTR_ReceiptTime);
+}
+
+static void
+test_types (void)
+{
+  const struct test_attribute *attributes =
+    test_events[test_EVENT_TypeChecker].attributes;
+
+  assert (attributes[test_TypeChecker_ATTR_aUInt64].type
+          == LWES_TYPE_U_INT_64);
+  assert (attributes[test_TypeChecker_ATTR_uint16_array].type
+          == LWES_TYPE_U_INT_16_ARRAY);
+  assert (attributes[test_TypeChecker_ATTR_string_array].array_size == 10);
+  assert (attributes[test_TypeChecker_ATTR_uint16_null_array].type
+          == LWES_TYPE_N_U_INT_16_ARRAY);
+  assert (attributes[test_TypeChecker_ATTR_uint16_null_array].flags
+          & ATTRIBUTE_NULLABLE);
+
+  assert (test_check_attribute (test_EVENT_TypeChecker, "aFloat",
+                                LWES_TYPE_FLOAT) == 0);
+  assert (test_check_attribute (test_EVENT_TypeChecker, "aFloat",
+                                LWES_TYPE_DOUBLE) == -2);
+  assert (test_check_attribute (test_EVENT_TypeChecker, "aFlot",
+                                LWES_TYPE_FLOAT) == -1);
+  assert (test_check_attribute (test_EVENT_Empty, "SiteID",
+                                LWES_TYPE_U_INT_16) == 0);
+}
+
+/* the generated setters must serialize exactly as a checked event does */
+static void
+test_setters (void)
+{
+  struct lwes_event_type_db *db;
+  struct lwes_event *checked;
+  struct lwes_event *compiled;
+  LWES_BYTE checked_bytes[2048];
+  LWES_BYTE compiled_bytes[2048];
+  int checked_size;
+  int compiled_size;
+  LWES_IP_ADDR ip;
+  LWES_U_INT_16 u16s[3] = { 1, 2, 3 };
+  char a[] = "a";
+  char bc[] = "bc";
+  char d[] = "d";
+  LWES_STRING strings[2] = { a, bc };
+  LWES_U_INT_16 one = 1;
+  LWES_U_INT_16 *n_u16s[3] = { &one, NULL, &one };
+  LWES_STRING n_strings[2] = { NULL, d };
+  LWES_LONG_STRING string;
+  LWES_U_INT_64 u64;
+  LWES_BOOLEAN boolean;
+  LWES_U_INT_16 length;
+  LWES_U_INT_16 *u16_array;
+  LWES_U_INT_16 **n_u16_array;
+  LWES_STRING *n_string_array;
+
+  ip.s_addr = inet_addr ("127.0.0.1");
+
+  db = lwes_event_type_db_create (esffile);
+  assert (db != NULL);
+
+  checked = lwes_event_create (db, "TypeChecker");
+  assert (checked != NULL);
+  assert (lwes_event_set_STRING (checked, "aString", "hello") > 0);
+  assert (lwes_event_set_IP_ADDR (checked, "anIPAddress", ip) > 0);
+  assert (lwes_event_set_U_INT_64 (checked, "aUInt64", 12345678901ULL) > 0);
+  assert (lwes_event_set_DOUBLE (checked, "aDouble", 0.5) > 0);
+  assert (lwes_event_set_U_INT_16_ARRAY (checked, "uint16_array",
+                                         3, u16s) > 0);
+  assert (lwes_event_set_STRING_ARRAY (checked, "string_array",
+                                       2, strings) > 0);
+  assert (lwes_event_set_N_U_INT_16_ARRAY (checked, "uint16_null_array",
+                                           3, n_u16s) > 0);
+  assert (lwes_event_set_N_STRING_ARRAY (checked, "string_null_array",
+                                         2, n_strings) > 0);
+  assert (lwes_event_set_U_INT_16 (checked, "SiteID", 7) > 0);
+
+  compiled = test_TypeChecker_create ();
+  assert (compiled != NULL);
+  assert (test_TypeChecker_set_aString (compiled, "hello") > 0);
+  assert (test_TypeChecker_set_anIPAddress (compiled, ip) > 0);
+  assert (test_TypeChecker_set_aUInt64 (compiled, 12345678901ULL) > 0);
+  assert (test_TypeChecker_set_aDouble (compiled, 0.5) > 0);
+  assert (test_TypeChecker_set_uint16_array (compiled, 3, u16s) > 0);
+  assert (test_TypeChecker_set_string_array (compiled, 2, strings) > 0);
+  assert (test_TypeChecker_set_uint16_null_array (compiled, 3, n_u16s) > 0);
+  assert (test_TypeChecker_set_string_null_array (compiled, 2,
+                                                  n_strings) > 0);
+  assert (test_TypeChecker_set_SiteID (compiled, 7) > 0);
+
+  checked_size = lwes_event_to_bytes (checked, checked_bytes,
+                                      sizeof (checked_bytes), 0);
+  compiled_size = lwes_event_to_bytes (compiled, compiled_bytes,
+                                       sizeof (compiled_bytes), 0);
+  assert (checked_size > 0);
+  assert (checked_size == compiled_size);
+  assert (memcmp (checked_bytes, compiled_bytes, checked_size) == 0);
+
+  /* and the getters read back what was set */
+  assert (test_TypeChecker_get_aString (compiled, &string) == 0);
+  assert (strcmp (string, "hello") == 0);
+  assert (test_TypeChecker_get_aUInt64 (compiled, &u64) == 0);
+  assert (u64 == 12345678901ULL);
+  assert (test_TypeChecker_get_uint16_array (compiled, &length,
+                                             &u16_array) == 0);
+  assert (length == 3 && u16_array[2] == 3);
+  assert (test_TypeChecker_get_uint16_null_array (compiled, &length,
+                                                  &n_u16_array) == 0);
+  assert (length == 3 && n_u16_array[1] == NULL && *n_u16_array[2] == 1);
+  assert (test_TypeChecker_get_string_null_array (compiled, &length,
+                                                  &n_string_array) == 0);
+  assert (length == 2 && n_string_array[0] == NULL);
+  assert (strcmp (n_string_array[1], "d") == 0);
+  assert (test_TypeChecker_get_aBoolean (compiled, &boolean) != 0);
+
+  assert (lwes_event_destroy (checked) == 0);
+  assert (lwes_event_destroy (compiled) == 0);
+  lwes_event_type_db_destroy (db);
+}
+
+/* thousands of names still hash, into tables of two to four slots each */
+static void
+test_large (void)
+{
+  const struct large_event *wide = &(large_events[large_EVENT_Wide]);
+  char name[32];
+  int i;
+
+  assert (large_NUMBER_OF_EVENTS == 2501);
+  for (i = 0; i < large_NUMBER_OF_EVENTS; i++)
+    {
+      assert (large_event_index (large_events[i].name) == i);
+    }
+  assert (large_event_index ("Event2500") == -1);
+  assert (large_event_index ("Wide") == large_EVENT_Wide);
+
+  assert (large_Wide_NUMBER_OF_ATTRIBUTES == 1500);
+  for (i = 0; i < 1500; i++)
+    {
+      snprintf (name, sizeof (name), "attr%d", i);
+      assert (strcmp (wide->attributes[large_attribute_index
+                                         (large_EVENT_Wide, name)].name,
+                      name) == 0);
+    }
+  assert (large_attribute_index (large_EVENT_Wide, "attr1500") == -1);
+  assert (large_attribute_index (large_EVENT_Event0, "attr0") == -1);
+  assert (wide->hash.mask + 1 <= 4 * 1500);
+}
+
+int
+main (void)
+{
+  test_indices ();
+  test_types ();
+  test_setters ();
+  test_large ();
+
+  return 0;
+}
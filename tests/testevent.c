@@ -118,52 +118,52 @@ my_marshall_U_INT_16
 #undef marshall_U_INT_16
 
 static LWES_BYTE ref_bytes_no_db[207] = {
-  0x0b,0x54,0x79,0x70,0x65,0x43,0x68,0x65,0x63,0x6b,0x65,0x72,0x00,0x0c,0x0b,
-  0x61,0x6e,0x49,0x50,0x41,0x64,0x64,0x72,0x65,0x73,0x73,0x06,0x64,0x00,0x00,
-  0xe0,0x07,0x61,0x55,0x49,0x6e,0x74,0x33,0x32,0x03,0xff,0xff,0xff,0xff,0x08,
-  0x61,0x42,0x6f,0x6f,0x6c,0x65,0x61,0x6e,0x05,0x00,0x01,0x31,0x07,0x61,0x6e,
-  0x49,0x6e,0x74,0x31,0x36,0x02,0xff,0xff,0x07,0x61,0x53,0x74,0x72,0x69,0x6e,
-  0x67,0x05,0x00,0x13,0x68,0x74,0x74,0x70,0x3a,0x2f,0x2f,0x77,0x77,0x77,0x2e,
-  0x74,0x65,0x73,0x74,0x2e,0x63,0x6f,0x6d,0x07,0x61,0x6e,0x49,0x6e,0x74,0x36,
-  0x34,0x07,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0x07,0x61,0x6e,0x49,0x6e,
-  0x74,0x33,0x32,0x04,0xff,0xff,0xff,0xff,0x07,0x61,0x55,0x49,0x6e,0x74,0x31,
-  0x36,0x01,0xff,0xff,0x0d,0x61,0x6e,0x6f,0x74,0x68,0x65,0x72,0x55,0x49,0x6e,
-  0x74,0x31,0x36,0x01,0xff,0xff,0x08,0x53,0x65,0x6e,0x64,0x65,0x72,0x49,0x50,
-  0x06,0x01,0x00,0x00,0x7f,0x07,0x61,0x55,0x49,0x6e,0x74,0x36,0x34,0x08,0xff,
-  0xff,0xff,0xff,0xff,0xff,0xff,0xff,0x0b,0x61,0x4d,0x65,0x74,0x61,0x53,0x74,
-  0x72,0x69,0x6e,0x67,0x05,0x00,0x05,0x68,0x65,0x6c,0x6c,0x6f};
+  0x0b,0x54,0x79,0x70,0x65,0x43,0x68,0x65,0x63,0x6b,0x65,0x72,0x00,0x0c,0x07,
+  0x61,0x53,0x74,0x72,0x69,0x6e,0x67,0x05,0x00,0x13,0x68,0x74,0x74,0x70,0x3a,
+  0x2f,0x2f,0x77,0x77,0x77,0x2e,0x74,0x65,0x73,0x74,0x2e,0x63,0x6f,0x6d,0x08,
+  0x61,0x42,0x6f,0x6f,0x6c,0x65,0x61,0x6e,0x05,0x00,0x01,0x31,0x0b,0x61,0x6e,
+  0x49,0x50,0x41,0x64,0x64,0x72,0x65,0x73,0x73,0x06,0x64,0x00,0x00,0xe0,0x07,
+  0x61,0x55,0x49,0x6e,0x74,0x31,0x36,0x01,0xff,0xff,0x0d,0x61,0x6e,0x6f,0x74,
+  0x68,0x65,0x72,0x55,0x49,0x6e,0x74,0x31,0x36,0x01,0xff,0xff,0x07,0x61,0x6e,
+  0x49,0x6e,0x74,0x31,0x36,0x02,0xff,0xff,0x07,0x61,0x55,0x49,0x6e,0x74,0x33,
+  0x32,0x03,0xff,0xff,0xff,0xff,0x07,0x61,0x6e,0x49,0x6e,0x74,0x33,0x32,0x04,
+  0xff,0xff,0xff,0xff,0x07,0x61,0x55,0x49,0x6e,0x74,0x36,0x34,0x08,0xff,0xff,
+  0xff,0xff,0xff,0xff,0xff,0xff,0x07,0x61,0x6e,0x49,0x6e,0x74,0x36,0x34,0x07,
+  0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0x0b,0x61,0x4d,0x65,0x74,0x61,0x53,
+  0x74,0x72,0x69,0x6e,0x67,0x05,0x00,0x05,0x68,0x65,0x6c,0x6c,0x6f,0x08,0x53,
+  0x65,0x6e,0x64,0x65,0x72,0x49,0x50,0x06,0x01,0x00,0x00,0x7f};
 
 static LWES_BYTE ref_bytes_encoding_no_db[214] = {
   0x0b,0x54,0x79,0x70,0x65,0x43,0x68,0x65,0x63,0x6b,0x65,0x72,0x00,0x0d,0x03,
-  0x65,0x6e,0x63,0x02,0x00,0x01,0x0b,0x61,0x6e,0x49,0x50,0x41,0x64,0x64,0x72,
-  0x65,0x73,0x73,0x06,0x64,0x00,0x00,0xe0,0x07,0x61,0x55,0x49,0x6e,0x74,0x33,
-  0x32,0x03,0xff,0xff,0xff,0xff,0x08,0x61,0x42,0x6f,0x6f,0x6c,0x65,0x61,0x6e,
-  0x05,0x00,0x01,0x31,0x07,0x61,0x6e,0x49,0x6e,0x74,0x31,0x36,0x02,0xff,0xff,
-  0x07,0x61,0x53,0x74,0x72,0x69,0x6e,0x67,0x05,0x00,0x13,0x68,0x74,0x74,0x70,
-  0x3a,0x2f,0x2f,0x77,0x77,0x77,0x2e,0x74,0x65,0x73,0x74,0x2e,0x63,0x6f,0x6d,
-  0x07,0x61,0x6e,0x49,0x6e,0x74,0x36,0x34,0x07,0xff,0xff,0xff,0xff,0xff,0xff,
-  0xff,0xff,0x07,0x61,0x6e,0x49,0x6e,0x74,0x33,0x32,0x04,0xff,0xff,0xff,0xff,
-  0x07,0x61,0x55,0x49,0x6e,0x74,0x31,0x36,0x01,0xff,0xff,0x0d,0x61,0x6e,0x6f,
-  0x74,0x68,0x65,0x72,0x55,0x49,0x6e,0x74,0x31,0x36,0x01,0xff,0xff,0x08,0x53,
-  0x65,0x6e,0x64,0x65,0x72,0x49,0x50,0x06,0x01,0x00,0x00,0x7f,0x07,0x61,0x55,
-  0x49,0x6e,0x74,0x36,0x34,0x08,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0x0b,
-  0x61,0x4d,0x65,0x74,0x61,0x53,0x74,0x72,0x69,0x6e,0x67,0x05,0x00,0x05,0x68,
-  0x65,0x6c,0x6c,0x6f};
+  0x65,0x6e,0x63,0x02,0x00,0x01,0x07,0x61,0x53,0x74,0x72,0x69,0x6e,0x67,0x05,
+  0x00,0x13,0x68,0x74,0x74,0x70,0x3a,0x2f,0x2f,0x77,0x77,0x77,0x2e,0x74,0x65,
+  0x73,0x74,0x2e,0x63,0x6f,0x6d,0x08,0x61,0x42,0x6f,0x6f,0x6c,0x65,0x61,0x6e,
+  0x05,0x00,0x01,0x31,0x0b,0x61,0x6e,0x49,0x50,0x41,0x64,0x64,0x72,0x65,0x73,
+  0x73,0x06,0x64,0x00,0x00,0xe0,0x07,0x61,0x55,0x49,0x6e,0x74,0x31,0x36,0x01,
+  0xff,0xff,0x0d,0x61,0x6e,0x6f,0x74,0x68,0x65,0x72,0x55,0x49,0x6e,0x74,0x31,
+  0x36,0x01,0xff,0xff,0x07,0x61,0x6e,0x49,0x6e,0x74,0x31,0x36,0x02,0xff,0xff,
+  0x07,0x61,0x55,0x49,0x6e,0x74,0x33,0x32,0x03,0xff,0xff,0xff,0xff,0x07,0x61,
+  0x6e,0x49,0x6e,0x74,0x33,0x32,0x04,0xff,0xff,0xff,0xff,0x07,0x61,0x55,0x49,
+  0x6e,0x74,0x36,0x34,0x08,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0x07,0x61,
+  0x6e,0x49,0x6e,0x74,0x36,0x34,0x07,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,
+  0x0b,0x61,0x4d,0x65,0x74,0x61,0x53,0x74,0x72,0x69,0x6e,0x67,0x05,0x00,0x05,
+  0x68,0x65,0x6c,0x6c,0x6f,0x08,0x53,0x65,0x6e,0x64,0x65,0x72,0x49,0x50,0x06,
+  0x01,0x00,0x00,0x7f};
 
 static LWES_BYTE ref_bytes_db[188] = {
-  0x0b,0x54,0x79,0x70,0x65,0x43,0x68,0x65,0x63,0x6b,0x65,0x72,0x00,0x0b,0x0b,
-  0x61,0x6e,0x49,0x50,0x41,0x64,0x64,0x72,0x65,0x73,0x73,0x06,0x64,0x00,0x00,
-  0xe0,0x07,0x61,0x55,0x49,0x6e,0x74,0x33,0x32,0x03,0xff,0xff,0xff,0xff,0x08,
-  0x61,0x42,0x6f,0x6f,0x6c,0x65,0x61,0x6e,0x09,0x01,0x07,0x61,0x6e,0x49,0x6e,
-  0x74,0x31,0x36,0x02,0xff,0xff,0x07,0x61,0x53,0x74,0x72,0x69,0x6e,0x67,0x05,
-  0x00,0x13,0x68,0x74,0x74,0x70,0x3a,0x2f,0x2f,0x77,0x77,0x77,0x2e,0x74,0x65,
-  0x73,0x74,0x2e,0x63,0x6f,0x6d,0x07,0x61,0x6e,0x49,0x6e,0x74,0x36,0x34,0x07,
-  0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0x07,0x61,0x6e,0x49,0x6e,0x74,0x33,
-  0x32,0x04,0xff,0xff,0xff,0xff,0x07,0x61,0x55,0x49,0x6e,0x74,0x31,0x36,0x01,
-  0xff,0xff,0x08,0x53,0x65,0x6e,0x64,0x65,0x72,0x49,0x50,0x06,0x01,0x00,0x00,
-  0x7f,0x07,0x61,0x55,0x49,0x6e,0x74,0x36,0x34,0x08,0xff,0xff,0xff,0xff,0xff,
-  0xff,0xff,0xff,0x0b,0x61,0x4d,0x65,0x74,0x61,0x53,0x74,0x72,0x69,0x6e,0x67,
-  0x05,0x00,0x05,0x68,0x65,0x6c,0x6c,0x6f};
+  0x0b,0x54,0x79,0x70,0x65,0x43,0x68,0x65,0x63,0x6b,0x65,0x72,0x00,0x0b,0x07,
+  0x61,0x53,0x74,0x72,0x69,0x6e,0x67,0x05,0x00,0x13,0x68,0x74,0x74,0x70,0x3a,
+  0x2f,0x2f,0x77,0x77,0x77,0x2e,0x74,0x65,0x73,0x74,0x2e,0x63,0x6f,0x6d,0x08,
+  0x61,0x42,0x6f,0x6f,0x6c,0x65,0x61,0x6e,0x09,0x01,0x0b,0x61,0x6e,0x49,0x50,
+  0x41,0x64,0x64,0x72,0x65,0x73,0x73,0x06,0x64,0x00,0x00,0xe0,0x07,0x61,0x55,
+  0x49,0x6e,0x74,0x31,0x36,0x01,0xff,0xff,0x07,0x61,0x6e,0x49,0x6e,0x74,0x31,
+  0x36,0x02,0xff,0xff,0x07,0x61,0x55,0x49,0x6e,0x74,0x33,0x32,0x03,0xff,0xff,
+  0xff,0xff,0x07,0x61,0x6e,0x49,0x6e,0x74,0x33,0x32,0x04,0xff,0xff,0xff,0xff,
+  0x07,0x61,0x55,0x49,0x6e,0x74,0x36,0x34,0x08,0xff,0xff,0xff,0xff,0xff,0xff,
+  0xff,0xff,0x07,0x61,0x6e,0x49,0x6e,0x74,0x36,0x34,0x07,0xff,0xff,0xff,0xff,
+  0xff,0xff,0xff,0xff,0x0b,0x61,0x4d,0x65,0x74,0x61,0x53,0x74,0x72,0x69,0x6e,
+  0x67,0x05,0x00,0x05,0x68,0x65,0x6c,0x6c,0x6f,0x08,0x53,0x65,0x6e,0x64,0x65,
+  0x72,0x49,0x50,0x06,0x01,0x00,0x00,0x7f};
 
 
 static LWES_BYTE array_event_bytes[] = {
@@ -188,17 +188,17 @@ static char array_event_string[] =
   "ArrayTestEvent[13]\n"
   "{\n"
   "\tend = \"This is the end field.\";\n"
-  "\te_id = -6772852554325794715;\n"
+  "\tstringNAr = [ \"a\", , \"bb\", , \"ccc\", , \"dddd\",  ];\n"
   "\tuint16NAr = [ 1, 2, , 3, , 5, , 7, , , , 11, , 13 ];\n"
   "\tstringAr = [ \"won\", \"too\", \"Free\", \"for\" ];\n"
-  "\tstart = \"This is the start field.\";\n"
+  "\tuint16Ar = [ 1, 2, 3, 5, 7, 11, 13 ];\n"
   "\tdub = 3.141593;\n"
-  "\tstringNAr = [ \"a\", , \"bb\", , \"ccc\", , \"dddd\",  ];\n"
+  "\tfloating = 602000017271895229464576.000000;\n"
   "\tbite = 42;\n"
+  "\tstart = \"This is the start field.\";\n"
   "\tx_svc_versions = \"gateway/11.117.0\";\n"
-  "\tuint16Ar = [ 1, 2, 3, 5, 7, 11, 13 ];\n"
-  "\tfloating = 602000017271895229464576.000000;\n"
   "\tx_app_name = \"gateway\";\n"
+  "\te_id = -6772852554325794715;\n"
   "\te_version = 90136;\n"
   "}\n"
 ;
@@ -249,31 +249,31 @@ static LWES_BYTE java_serialized_bytes[] = {
 static char java_event_string[] =
   "Test[25]\n"
   "{\n"
+  "\tenc = 1;\n"
   "\tTestStringArray = [ \"foo\", \"bar\", \"baz\" ];\n"
   "\tfloat_array = [ 0.100000, 0.200000, 0.300000, 0.400000 ];\n"
   "\tTestBool = false;\n"
-  "\tTestInt64Array = [ 12322, 32451345, 1312323 ];\n"
-  "\tTestInt16 = 20;\n"
+  "\tTestInt32 = 14000;\n"
   "\tTestDouble = 0.123123;\n"
-  "\tTestInt32Array = [ 123, 45422, 34333 ];\n"
-  "\tenc = 1;\n"
-  "\tTestUInt16Array = [ 123, 45422, 34333 ];\n"
-  "\tbyte = 20;\n"
   "\tTestInt64 = 3234;\n"
-  "\tTestString = \"foo\";\n"
-  "\tTestInt32 = 14000;\n"
   "\tTestUInt16 = 10;\n"
-  "\tTestUInt64Array = [ 12322, 32451345, 1312323 ];\n"
-  "\tTestUInt32Array = [ 12322, 32451345, 1312323 ];\n"
-  "\tTestIPAddressArray = [ 129.168.1.1, 129.168.1.2, 129.168.1.3, 129.168.1.4 ];\n"
-  "\tTestInt16Array = [ 10, 23, 23, 43 ];\n"
   "\tTestFloat = 0.122300;\n"
-  "\tbyte_array = [ 10, 13, 43, 43, 200 ];\n"
-  "\tTestUInt64 = 12312323;\n"
+  "\tTestUInt32Array = [ 12322, 32451345, 1312323 ];\n"
+  "\tTestInt32Array = [ 123, 45422, 34333 ];\n"
   "\tTestIPAddress = 127.0.0.1;\n"
   "\tTestUInt32 = 232343;\n"
+  "\tTestInt64Array = [ 12322, 32451345, 1312323 ];\n"
+  "\tbyte_array = [ 10, 13, 43, 43, 200 ];\n"
+  "\tTestString = \"foo\";\n"
+  "\tTestUInt64Array = [ 12322, 32451345, 1312323 ];\n"
+  "\tTestUInt16Array = [ 123, 45422, 34333 ];\n"
   "\tdouble = [ 123.232002, 123.123245, 43.334431 ];\n"
   "\tBoolArray = [ true, false, false, true ];\n"
+  "\tTestInt16Array = [ 10, 23, 23, 43 ];\n"
+  "\tbyte = 20;\n"
+  "\tTestUInt64 = 12312323;\n"
+  "\tTestIPAddressArray = [ 129.168.1.1, 129.168.1.2, 129.168.1.3, 129.168.1.4 ];\n"
+  "\tTestInt16 = 20;\n"
   "}\n"
 ;
 
@@ -1330,10 +1330,12 @@ test_serialize_errors (void)
   /* failures at marshalling encoding */
   {
     assert ((event = lwes_event_create_with_encoding (NULL, name, 1)) != NULL);
-    /* test all three branches of conditional */
-    assert (lwes_event_to_bytes (event, bytes, 5, 0) == -2);
-    assert (lwes_event_to_bytes (event, bytes, 8, 0) == -2);
-    assert (lwes_event_to_bytes (event, bytes, 10, 0) == -2);
+    /* an event which does not fit is refused before anything is written */
+    memset (bytes, 0, sizeof (bytes));
+    assert (lwes_event_to_bytes (event, bytes, 5, 0) == -21);
+    assert (bytes[0] == 0);
+    assert (lwes_event_to_bytes (event, bytes, 8, 0) == -21);
+    assert (lwes_event_to_bytes (event, bytes, 10, 0) == -21);
     /* test nulls at various states */
     lwes_hash_get_type_error = 1;
     assert (lwes_event_to_bytes (event, bytes, 15, 0) == -3);
@@ -1349,7 +1351,7 @@ test_serialize_errors (void)
     assert ((event = lwes_event_create (NULL, name)) != NULL);
     assert (lwes_event_set_BOOLEAN (event, key02, value02) ==  1);
     /* 2 bytes for name plus 2 bytes for num attrs, then fail */
-    assert (lwes_event_to_bytes (event, bytes, 4, 0) == -5);
+    assert (lwes_event_to_bytes (event, bytes, 4, 0) == -21);
     lwes_event_destroy (event);
   }
 
@@ -1359,7 +1361,7 @@ test_serialize_errors (void)
     assert (lwes_event_set_BOOLEAN (event, key02, value02) ==  1);
     /* 2 bytes for name plus 2 bytes for num attrs plus 9 bytes for
        attribute name, then fail */
-    assert (lwes_event_to_bytes (event, bytes, 13, 0) == -6);
+    assert (lwes_event_to_bytes (event, bytes, 13, 0) == -21);
     lwes_event_destroy (event);
   }
 
@@ -1369,7 +1371,7 @@ test_serialize_errors (void)
     assert (lwes_event_set_U_INT_16 (event, key04, value04) ==  1);
     /* 2 bytes for name plus 2 bytes for num attrs plus 8 bytes for
        attribute name, plus 1 byte for attribute type then fail */
-    assert (lwes_event_to_bytes (event, bytes, 13, 0) == -7);
+    assert (lwes_event_to_bytes (event, bytes, 13, 0) == -21);
     lwes_event_destroy (event);
   }
 
@@ -1379,7 +1381,7 @@ test_serialize_errors (void)
     assert (lwes_event_set_INT_16 (event, key06, value06) ==  1);
     /* 2 bytes for name plus 2 bytes for num attrs plus 8 bytes for
        attribute name, plus 1 byte for attribute type then fail */
-    assert (lwes_event_to_bytes (event, bytes, 13, 0) == -8);
+    assert (lwes_event_to_bytes (event, bytes, 13, 0) == -21);
     lwes_event_destroy (event);
   }
 
@@ -1389,7 +1391,7 @@ test_serialize_errors (void)
     assert (lwes_event_set_U_INT_32 (event, key07, value07) ==  1);
     /* 2 bytes for name plus 2 bytes for num attrs plus 8 bytes for
        attribute name, plus 1 byte for attribute type then fail */
-    assert (lwes_event_to_bytes (event, bytes, 13, 0) == -9);
+    assert (lwes_event_to_bytes (event, bytes, 13, 0) == -21);
     lwes_event_destroy (event);
   }
 
@@ -1399,7 +1401,7 @@ test_serialize_errors (void)
     assert (lwes_event_set_INT_32 (event, key08, value08) ==  1);
     /* 2 bytes for name plus 2 bytes for num attrs plus 8 bytes for
        attribute name, plus 1 byte for attribute type then fail */
-    assert (lwes_event_to_bytes (event, bytes, 13, 0) == -10);
+    assert (lwes_event_to_bytes (event, bytes, 13, 0) == -21);
     lwes_event_destroy (event);
   }
 
@@ -1409,7 +1411,7 @@ test_serialize_errors (void)
     assert (lwes_event_set_U_INT_64 (event, key09, value09) ==  1);
     /* 2 bytes for name plus 2 bytes for num attrs plus 8 bytes for
        attribute name, plus 1 byte for attribute type then fail */
-    assert (lwes_event_to_bytes (event, bytes, 13, 0) == -11);
+    assert (lwes_event_to_bytes (event, bytes, 13, 0) == -21);
     lwes_event_destroy (event);
   }
 
@@ -1419,7 +1421,7 @@ test_serialize_errors (void)
     assert (lwes_event_set_INT_64 (event, key10, value10) ==  1);
     /* 2 bytes for name plus 2 bytes for num attrs plus 8 bytes for
        attribute name, plus 1 byte for attribute type then fail */
-    assert (lwes_event_to_bytes (event, bytes, 13, 0) == -12);
+    assert (lwes_event_to_bytes (event, bytes, 13, 0) == -21);
     lwes_event_destroy (event);
   }
 
@@ -1429,7 +1431,7 @@ test_serialize_errors (void)
     assert (lwes_event_set_BOOLEAN (event, key02, value02) ==  1);
     /* 2 bytes for name plus 2 bytes for num attrs plus 9 bytes for
        attribute name, plus 1 byte for attribute type, then fail */
-    assert (lwes_event_to_bytes (event, bytes, 14, 0) == -13);
+    assert (lwes_event_to_bytes (event, bytes, 14, 0) == -21);
     lwes_event_destroy (event);
   }
 
@@ -1439,7 +1441,7 @@ test_serialize_errors (void)
     assert (lwes_event_set_IP_ADDR (event, key12, value12) == 1);
     /* 2 bytes for name plus 2 bytes for num attrs plus 9 bytes for
        attribute name, plus 1 byte for attribute type, then fail */
-    assert (lwes_event_to_bytes (event, bytes, 14, 0) == -14);
+    assert (lwes_event_to_bytes (event, bytes, 14, 0) == -21);
     lwes_event_destroy (event);
   }
 
@@ -1449,21 +1451,21 @@ test_serialize_errors (void)
     assert (lwes_event_set_STRING (event, key11, value11) == 1);
     /* 2 bytes for name plus 2 bytes for num attrs plus 12 bytes for
        attribute name, plus 1 byte for attribute type, then fail */
-    assert (lwes_event_to_bytes (event, bytes, 17, 0) == -15);
+    assert (lwes_event_to_bytes (event, bytes, 17, 0) == -21);
     lwes_event_destroy (event);
   }
 
   /* failure at marshalling number of attributes */
   {
     assert ((event = lwes_event_create (NULL, name)) != NULL);
-    assert (lwes_event_to_bytes (event, bytes, 3, 0) == -16);
+    assert (lwes_event_to_bytes (event, bytes, 3, 0) == -21);
     lwes_event_destroy (event);
   }
 
   /* failure at marshalling event name */
   {
     assert ((event = lwes_event_create (NULL, name)) != NULL);
-    assert (lwes_event_to_bytes (event, bytes, 1, 0) == -17);
+    assert (lwes_event_to_bytes (event, bytes, 1, 0) == -21);
     lwes_event_destroy (event);
   }
 }
@@ -2143,6 +2145,536 @@ test_add_headers ()
   lwes_event_destroy (event);
 }
 
+static void
+test_clear_and_reset (void)
+{
+  struct lwes_event *event;
+  struct lwes_event_enumeration e;
+  struct lwes_event_deserialize_tmp dtmp;
+  LWES_CONST_SHORT_STRING key;
+  LWES_TYPE type;
+  LWES_SHORT_STRING name;
+  LWES_LONG_STRING str;
+  LWES_U_INT_16 u16;
+  LWES_INT_32 i32;
+  LWES_U_INT_16 num;
+  LWES_BYTE bytes[500];
+  size_t before;
+  int ret, i;
+
+  assert (lwes_event_clear (NULL) == -1);
+  assert (lwes_event_reset (NULL) == -1);
+
+  event = lwes_event_create (NULL, "Foo");
+  assert (event != NULL);
+  assert (lwes_event_set_U_INT_16 (event, "a", 5) == 1);
+  assert (lwes_event_set_STRING (event, "b", "short") == 2);
+
+  /* a cleared event looks freshly created */
+  assert (lwes_event_clear (event) == 0);
+  assert (lwes_event_get_name (event, &name) == 0);
+  assert (name == NULL);
+  assert (lwes_event_get_number_of_attributes (event, &num) == 0);
+  assert (num == 0);
+  assert (lwes_event_get_U_INT_16 (event, "a", &u16) == -1);
+  assert (lwes_event_get_STRING (event, "b", &str) == -1);
+  assert (lwes_event_keys (event, &e));
+  assert (lwes_event_enumeration_next_element (&e, &key, &type) == 0);
+
+  /* refilling with the same shape does not allocate */
+  before = malloc_count;
+  assert (lwes_event_set_name (event, "Bar") == 0);
+  assert (lwes_event_set_U_INT_16 (event, "a", 6) == 1);
+  assert (lwes_event_set_STRING (event, "b", "tiny") == 2);
+  assert (malloc_count == before);
+  assert (lwes_event_get_U_INT_16 (event, "a", &u16) == 0);
+  assert (u16 == 6);
+  assert (lwes_event_get_STRING (event, "b", &str) == 0);
+  assert (strcmp (str, "tiny") == 0);
+
+  /* only set attributes are serialized */
+  assert (lwes_event_clear (event) == 0);
+  assert (lwes_event_set_name (event, "Longer Name") == 0);
+  assert (lwes_event_set_INT_32 (event, "a", -7) == 1);
+  assert (lwes_event_set_STRING (event, "c", "a longer string") == 2);
+  assert (lwes_event_get_INT_32 (event, "a", &i32) == 0);
+  assert (i32 == -7);
+  assert (lwes_event_get_STRING (event, "b", &str) == -1);
+  ret = lwes_event_to_bytes (event, bytes, sizeof (bytes), 0);
+  assert (ret == 1+11 + 2 + 1+1+1+4 + 1+1+1+2+15);
+
+  /* clearing twice is harmless, and an unnamed event can be cleared */
+  assert (lwes_event_clear (event) == 0);
+  assert (lwes_event_clear (event) == 0);
+
+  /* repeatedly decoding into one event only allocates the first time */
+  for (i = 0; i < 3; ++i)
+    {
+      before = malloc_count;
+      assert (lwes_event_clear (event) == 0);
+      ret = lwes_event_from_bytes (event, ref_bytes_no_db,
+                                   sizeof (ref_bytes_no_db), 0, &dtmp);
+      assert (ret == (int)sizeof (ref_bytes_no_db));
+      if (i > 0)
+        {
+          assert (malloc_count == before);
+        }
+    }
+  assert (lwes_event_to_bytes (event, bytes, sizeof (bytes), 0)
+          == (int)sizeof (ref_bytes_no_db));
+
+  /* arrays are reallocated, but still decode correctly */
+  for (i = 0; i < 3; ++i)
+    {
+      assert (lwes_event_clear (event) == 0);
+      ret = lwes_event_from_bytes (event, array_event_bytes,
+                                   sizeof (array_event_bytes), 0, &dtmp);
+      assert (ret == (int)sizeof (array_event_bytes));
+    }
+
+  /* reset releases everything but leaves a usable event */
+  assert (lwes_event_reset (event) == 0);
+  assert (event->spare_name == NULL);
+  assert (event->number_of_spares == 0);
+  assert (lwes_event_get_number_of_attributes (event, &num) == 0);
+  assert (num == 0);
+  assert (lwes_event_keys (event, &e));
+  assert (lwes_event_enumeration_next_element (&e, &key, &type) == 0);
+  ret = lwes_event_from_bytes (event, ref_bytes_no_db,
+                               sizeof (ref_bytes_no_db), 0, &dtmp);
+  assert (ret == (int)sizeof (ref_bytes_no_db));
+
+  assert (lwes_event_destroy (event) == 0);
+}
+
+/* the tracked size is exactly what serialization writes */
+static void
+check_serialized_size (struct lwes_event *event)
+{
+  LWES_BYTE bytes[MAX_MSG_SIZE];
+  size_t size = lwes_event_serialized_size (event);
+
+  assert (size < sizeof (bytes) - 1);
+  assert (lwes_event_to_bytes (event, bytes, sizeof (bytes), 0) == (int)size);
+  assert (lwes_event_to_bytes (event, bytes, size + 1, 1) == (int)size);
+  memset (bytes, 0xff, sizeof (bytes));
+  assert (lwes_event_to_bytes (event, bytes, size, 1) == -21);
+  assert (bytes[1] == 0xff);
+}
+
+static void
+test_serialized_size (void)
+{
+  struct lwes_event *event;
+  struct lwes_event *copy;
+  struct lwes_event_deserialize_tmp dtmp;
+  LWES_BYTE bytes[MAX_MSG_SIZE];
+  LWES_U_INT_16 u16s[3] = { 1, 2, 3 };
+  LWES_INT_32 i32 = 32;
+  LWES_INT_32 *n_i32s[4] = { NULL, NULL, NULL, NULL };
+  char one[] = "one";
+  char three[] = "three";
+  LWES_SHORT_STRING strs[2] = { one, three };
+  LWES_SHORT_STRING n_strs[3] = { NULL, three, NULL };
+  int ret;
+
+  assert (lwes_event_serialized_size (NULL) == 0);
+
+  event = lwes_event_create (NULL, "Sized");
+  assert (event != NULL);
+  assert (lwes_event_serialized_size (event) == 1+5 + 2);
+  check_serialized_size (event);
+
+  assert (lwes_event_set_U_INT_16 (event, "u16", 1) == 1);
+  assert (lwes_event_set_BOOLEAN (event, "bool", TRUE) == 2);
+  assert (lwes_event_set_IP_ADDR (event, "ip", value12) == 3);
+  assert (lwes_event_set_DOUBLE (event, "double", 1.5) == 4);
+  assert (lwes_event_set_STRING (event, "str", "medium") == 5);
+  check_serialized_size (event);
+
+  /* replaced in place, by a longer value, and by a different type */
+  assert (lwes_event_set_STRING (event, "str", "tiny") == 5);
+  check_serialized_size (event);
+  assert (lwes_event_set_STRING (event, "str", "much much longer") == 5);
+  check_serialized_size (event);
+  assert (lwes_event_set_INT_64 (event, "u16", -1) == 5);
+  check_serialized_size (event);
+
+  /* arrays, with elements missing from the nullable ones */
+  assert (lwes_event_set_U_INT_16_ARRAY (event, "u16s", 3, u16s) == 6);
+  assert (lwes_event_set_STRING_ARRAY (event, "strs", 2, strs) == 7);
+  n_i32s[2] = &i32;
+  assert (lwes_event_set_N_INT_32_ARRAY (event, "n_i32s", 4, n_i32s) == 8);
+  assert (lwes_event_set_N_STRING_ARRAY (event, "n_strs", 3, n_strs) == 9);
+  check_serialized_size (event);
+  assert (lwes_event_set_STRING_ARRAY (event, "strs", 1, strs) == 9);
+  check_serialized_size (event);
+
+  /* a deserialized event has the same size */
+  copy = lwes_event_create_no_name (NULL);
+  assert (copy != NULL);
+  ret = lwes_event_to_bytes (event, bytes, sizeof (bytes), 0);
+  assert (lwes_event_from_bytes (copy, bytes, ret, 0, &dtmp) == ret);
+  assert (lwes_event_serialized_size (copy) == (size_t)ret);
+  check_serialized_size (copy);
+
+  /* and so does one refilled from the spares left by a clear */
+  assert (lwes_event_clear (copy) == 0);
+  assert (lwes_event_serialized_size (copy) == 1 + 2);
+  assert (lwes_event_set_name (copy, "Sized") == 0);
+  assert (lwes_event_set_STRING (copy, "str", "tiny") == 1);
+  assert (lwes_event_set_U_INT_16 (copy, "u16s", 2) == 2);
+  check_serialized_size (copy);
+  assert (lwes_event_reset (copy) == 0);
+  assert (lwes_event_serialized_size (copy) == 1 + 2);
+  assert (lwes_event_destroy (copy) == 0);
+
+  assert (lwes_event_clear (event) == 0);
+  assert (lwes_event_serialized_size (event) == 1 + 2);
+  assert (lwes_event_destroy (event) == 0);
+
+  /* events in an arena are sized the same way */
+  event = lwes_event_create_in_arena (NULL, "Sized", 1024);
+  assert (event != NULL);
+  assert (lwes_event_set_STRING (event, "str", "medium") == 1);
+  assert (lwes_event_set_U_INT_16_ARRAY (event, "u16s", 3, u16s) == 2);
+  check_serialized_size (event);
+  assert (lwes_event_clear (event) == 0);
+  assert (lwes_event_serialized_size (event) == 1 + 2);
+  assert (lwes_event_destroy (event) == 0);
+}
+
+/* the setters refuse what could not be serialized, so anything they
+   accept serializes */
+static void
+test_unmarshallable_values (void)
+{
+  struct lwes_event *event;
+  struct lwes_event *copy;
+  struct lwes_event_deserialize_tmp dtmp;
+  LWES_BYTE bytes[MAX_MSG_SIZE];
+  char name[SHORT_STRING_MAX + 2];
+  char *value;
+  LWES_SHORT_STRING strings[2];
+  LWES_SHORT_STRING got;
+  int size;
+
+  value = (char *) malloc (LONG_STRING_MAX + 2);
+  assert (value != NULL);
+
+  /* names are 1 to SHORT_STRING_MAX characters */
+  memset (name, 'n', sizeof (name) - 1);
+  name[sizeof (name) - 1] = '\0';
+  assert (lwes_event_create (NULL, name) == NULL);
+  assert (lwes_event_create (NULL, "") == NULL);
+  name[SHORT_STRING_MAX] = '\0';
+  event = lwes_event_create (NULL, name);
+  assert (event != NULL);
+
+  name[SHORT_STRING_MAX] = 'n';
+  assert (lwes_event_set_INT_32 (event, name, 1) == -1);
+  assert (lwes_event_set_INT_32 (event, "", 1) == -1);
+  assert (lwes_event_set_STRING_ARRAY (event, name, 0, strings) == -1);
+  assert (lwes_event_set_N_STRING_ARRAY (event, name, 0, strings) == -1);
+  name[SHORT_STRING_MAX] = '\0';
+  assert (lwes_event_set_INT_32 (event, name, 1) == 1);
+
+  /* strings are at most LONG_STRING_MAX characters, and only nullable
+     arrays may hold NULL */
+  memset (value, 'v', LONG_STRING_MAX + 1);
+  value[LONG_STRING_MAX + 1] = '\0';
+  assert (lwes_event_set_STRING (event, "s", value) == -1);
+  strings[0] = (LWES_SHORT_STRING) "a";
+  strings[1] = value;
+  assert (lwes_event_set_STRING_ARRAY (event, "sa", 2, strings) == -1);
+  assert (lwes_event_set_N_STRING_ARRAY (event, "sa", 2, strings) == -1);
+  strings[1] = NULL;
+  assert (lwes_event_set_STRING_ARRAY (event, "sa", 2, strings) == -1);
+  assert (lwes_event_set_N_STRING_ARRAY (event, "sa", 2, strings) == 2);
+  assert (event->number_of_attributes == 2);
+
+  /* the longest name still round trips */
+  size = lwes_event_to_bytes (event, bytes, sizeof (bytes), 0);
+  assert (size > 0 && (size_t)size == lwes_event_serialized_size (event));
+  copy = lwes_event_create_no_name (NULL);
+  assert (copy != NULL);
+  assert (lwes_event_from_bytes (copy, bytes, size, 0, &dtmp) == size);
+  assert (lwes_event_get_name (copy, &got) == 0);
+  assert (strcmp (got, name) == 0);
+  assert (lwes_event_to_bytes (copy, bytes, sizeof (bytes), 0) == size);
+
+  assert (lwes_event_destroy (copy) == 0);
+  assert (lwes_event_destroy (event) == 0);
+  free (value);
+}
+
+/* events built against a frozen db share the db's copy of their names */
+static void
+test_interned_names (void)
+{
+  struct lwes_event_type_db *db;
+  struct lwes_event *event1;
+  struct lwes_event *event2;
+  struct lwes_event_deserialize_tmp dtmp;
+  LWES_BYTE bytes[MAX_MSG_SIZE];
+  LWES_SHORT_STRING name1;
+  LWES_SHORT_STRING name2;
+  LWES_CONST_SHORT_STRING interned;
+  LWES_U_INT_16 u16;
+  size_t before;
+  int size;
+  int i;
+
+  db = lwes_event_type_db_create ((char*)esffile);
+  assert (db != NULL);
+  assert (lwes_event_type_db_is_frozen (db));
+  assert (lwes_event_type_db_share_names (db) == 0);
+
+  /* the names are not copied, so only the value and attribute are */
+  event1 = lwes_event_create (db, eventname);
+  assert (event1 != NULL);
+  before = malloc_count;
+  assert (lwes_event_set_U_INT_16 (event1, key04, value04) == 1);
+  assert (malloc_count == before + 2);
+  assert (lwes_event_set_STRING (event1, key01, value01) == 2);
+  assert (lwes_event_set_U_INT_16 (event1, "SiteID", 3) == 3);
+
+  event2 = lwes_event_create (db, eventname);
+  assert (event2 != NULL);
+  assert (lwes_event_set_U_INT_16 (event2, key04, 6) == 1);
+
+  assert (lwes_event_get_name (event1, &name1) == 0);
+  assert (lwes_event_get_name (event2, &name2) == 0);
+  assert (name1 == name2);
+  assert (name1 == lwes_event_type_db_intern (db, eventname));
+  interned = lwes_event_type_db_intern (db, key04);
+  assert (interned != NULL);
+  assert (((struct lwes_event_attribute *)
+            lwes_hash_get (event1->attributes, interned))->name_interned);
+  assert (((struct lwes_event_attribute *)
+            lwes_hash_get (event2->attributes, interned))->name_interned);
+
+  /* replacing an attribute keeps the shared name */
+  u16 = 7;
+  assert (lwes_event_set_U_INT_16_ARRAY (event2, "uint16_array", 1, &u16)
+          == 2);
+  assert (lwes_event_set_U_INT_16_ARRAY (event2, "uint16_array", 1, &u16)
+          == 2);
+  assert (((struct lwes_event_attribute *)
+            lwes_hash_get (event2->attributes, "uint16_array"))->name_interned);
+  assert (lwes_event_set_U_INT_16_ARRAY (event2, key04, 1, &u16) < 0);
+
+  /* serialization is unchanged, and so is a round trip */
+  size = lwes_event_to_bytes (event1, bytes, sizeof (bytes), 0);
+  assert (size > 0);
+  assert ((size_t)size == lwes_event_serialized_size (event1));
+  assert (lwes_event_destroy (event2) == 0);
+  event2 = lwes_event_create_no_name (db);
+  assert (event2 != NULL);
+  assert (lwes_event_from_bytes (event2, bytes, size, 0, &dtmp) == size);
+  assert (lwes_event_get_name (event2, &name2) == 0);
+  assert (name1 == name2);
+  assert (lwes_event_get_U_INT_16 (event2, "SiteID", &u16) == 0);
+  assert (u16 == 3);
+
+  /* clearing and refilling with the same shape still does not allocate */
+  for (i = 0; i < 3; ++i)
+    {
+      before = malloc_count;
+      assert (lwes_event_clear (event2) == 0);
+      assert (lwes_event_from_bytes (event2, bytes, size, 0, &dtmp) == size);
+      if (i > 0)
+        {
+          assert (malloc_count == before);
+        }
+    }
+
+  /* a name the db does not know is still copied, and kept for reuse */
+  assert (lwes_event_clear (event2) == 0);
+  assert (lwes_event_set_name (event2, "NotInTheDb") == 0);
+  assert (! event2->name_interned);
+  assert (lwes_event_clear (event2) == 0);
+  assert (lwes_event_set_name (event2, eventname) == 0);
+  assert (event2->name_interned);
+  assert (event2->spare_name != NULL);
+
+  assert (lwes_event_reset (event1) == 0);
+  assert (lwes_event_destroy (event1) == 0);
+  assert (lwes_event_destroy (event2) == 0);
+  lwes_event_type_db_destroy (db);
+}
+
+/* by default events copy their names, so they outlive their db */
+static void
+test_names_outlive_db (void)
+{
+  struct lwes_event_type_db *db;
+  struct lwes_event *event;
+  LWES_BYTE bytes1[MAX_MSG_SIZE];
+  LWES_BYTE bytes2[MAX_MSG_SIZE];
+  int size1;
+  int size2;
+
+  db = lwes_event_type_db_create ((char*)esffile);
+  assert (db != NULL);
+  event = lwes_event_create (db, eventname);
+  assert (event != NULL);
+  assert (! event->name_interned);
+  assert (lwes_event_set_U_INT_16 (event, key04, value04) == 1);
+  assert (lwes_event_set_STRING (event, key01, value01) == 2);
+  assert (! ((struct lwes_event_attribute *)
+              lwes_hash_get (event->attributes, key04))->name_interned);
+  size1 = lwes_event_to_bytes (event, bytes1, sizeof (bytes1), 0);
+  assert (size1 > 0);
+
+  lwes_event_type_db_destroy (db);
+  size2 = lwes_event_to_bytes (event, bytes2, sizeof (bytes2), 0);
+  assert (size2 == size1);
+  assert (memcmp (bytes1, bytes2, size1) == 0);
+  assert (lwes_event_destroy (event) == 0);
+}
+
+/* serializes an event, returning its size */
+static int
+event_bytes (struct lwes_event *event, LWES_BYTE *bytes, size_t num_bytes)
+{
+  int size = lwes_event_to_bytes (event, bytes, num_bytes, 0);
+  assert (size > 0);
+  assert ((size_t)size == lwes_event_serialized_size (event));
+  return size;
+}
+
+/* equal events serialize to the same bytes however they were built */
+static void
+test_serialize_order (void)
+{
+  struct lwes_event_type_db *db;
+  struct lwes_event *event1;
+  struct lwes_event *event2;
+  struct lwes_event_deserialize_tmp dtmp;
+  LWES_BYTE bytes1[MAX_MSG_SIZE];
+  LWES_BYTE bytes2[MAX_MSG_SIZE];
+  LWES_U_INT_16 u16s[3] = { 1, 2, 3 };
+  LWES_INT_32 i32;
+  int size1;
+  int size2;
+
+  assert (lwes_event_set_order (NULL, LWES_EVENT_ORDER_NAME) == -1);
+
+  /* by default the order they were set in is kept */
+  event1 = lwes_event_create (NULL, "Ordered");
+  event2 = lwes_event_create (NULL, "Ordered");
+  assert (event1 != NULL && event2 != NULL);
+  assert (lwes_event_set_order (event1, (LWES_EVENT_ORDER)7) == -1);
+  assert (lwes_event_set_STRING (event1, "b", "bee") == 1);
+  assert (lwes_event_set_INT_32 (event1, "c", 3) == 2);
+  assert (lwes_event_set_U_INT_16 (event1, "a", 1) == 3);
+  assert (lwes_event_set_INT_32 (event2, "c", 3) == 1);
+  assert (lwes_event_set_U_INT_16 (event2, "a", 1) == 2);
+  assert (lwes_event_set_STRING (event2, "b", "bee") == 3);
+  size1 = event_bytes (event1, bytes1, sizeof (bytes1));
+  size2 = event_bytes (event2, bytes2, sizeof (bytes2));
+  assert (size1 == size2);
+  assert (memcmp (bytes1, bytes2, size1) != 0);
+
+  /* sorting what is already set, and what is set afterwards */
+  assert (lwes_event_set_order (event1, LWES_EVENT_ORDER_NAME) == 0);
+  assert (lwes_event_set_order (event2, LWES_EVENT_ORDER_NAME) == 0);
+  assert (lwes_event_set_U_INT_16_ARRAY (event1, "d", 3, u16s) == 4);
+  assert (lwes_event_set_STRING (event1, "0", "zero") == 5);
+  assert (lwes_event_set_STRING (event2, "0", "zero") == 4);
+  assert (lwes_event_set_U_INT_16_ARRAY (event2, "d", 2, u16s) == 5);
+  assert (lwes_event_set_U_INT_16_ARRAY (event2, "d", 3, u16s) == 5);
+  size1 = event_bytes (event1, bytes1, sizeof (bytes1));
+  size2 = event_bytes (event2, bytes2, sizeof (bytes2));
+  assert (size1 == size2);
+  assert (memcmp (bytes1, bytes2, size1) == 0);
+  assert (event1->number_of_ordered == 5);
+  assert (strcmp (event1->ordered[0].name, "0") == 0);
+  assert (strcmp (event1->ordered[4].name, "d") == 0);
+
+  /* the order is kept across a clear, and decoding follows it too */
+  assert (lwes_event_clear (event2) == 0);
+  assert (event2->order == LWES_EVENT_ORDER_NAME);
+  assert (lwes_event_set_name (event2, "Ordered") == 0);
+  assert (lwes_event_set_STRING (event2, "0", "zero") == 1);
+  assert (lwes_event_set_U_INT_16_ARRAY (event2, "d", 3, u16s) == 2);
+  assert (lwes_event_set_STRING (event2, "b", "bee") == 3);
+  assert (lwes_event_set_U_INT_16 (event2, "a", 1) == 4);
+  assert (lwes_event_set_INT_32 (event2, "c", 3) == 5);
+  size2 = event_bytes (event2, bytes2, sizeof (bytes2));
+  assert (size1 == size2);
+  assert (memcmp (bytes1, bytes2, size1) == 0);
+  assert (lwes_event_clear (event2) == 0);
+  assert (lwes_event_from_bytes (event2, bytes1, size1, 0, &dtmp) == size1);
+  size2 = event_bytes (event2, bytes2, sizeof (bytes2));
+  assert (memcmp (bytes1, bytes2, size1) == 0);
+
+  /* going back to insertion order */
+  assert (lwes_event_set_order (event2, LWES_EVENT_ORDER_INSERTION) == 0);
+  assert (event2->number_of_ordered == 0);
+  assert (event_bytes (event2, bytes2, sizeof (bytes2)) == size1);
+
+  /* no memory to keep the order in leaves the event as it was */
+  assert (lwes_event_reset (event2) == 0);
+  assert (lwes_event_set_name (event2, "Ordered") == 0);
+  assert (lwes_event_set_order (event2, LWES_EVENT_ORDER_NAME) == 0);
+  malloc_count = 0;
+  null_at = 3;
+  assert (lwes_event_set_INT_32 (event2, "c", 3) == -3);
+  null_at = 0;
+  assert (lwes_event_get_INT_32 (event2, "c", &i32) == -1);
+  assert (lwes_event_set_INT_32 (event2, "c", 3) == 1);
+  assert (lwes_event_set_order (event2, LWES_EVENT_ORDER_INSERTION) == 0);
+  assert (lwes_event_reset (event2) == 0);
+  assert (event2->ordered == NULL);
+  assert (lwes_event_set_name (event2, "Ordered") == 0);
+  assert (lwes_event_set_INT_32 (event2, "c", 3) == 1);
+  malloc_count = 0;
+  null_at = 1;
+  assert (lwes_event_set_order (event2, LWES_EVENT_ORDER_NAME) == -3);
+  null_at = 0;
+  assert (event2->order == LWES_EVENT_ORDER_INSERTION);
+
+  assert (lwes_event_destroy (event1) == 0);
+  assert (lwes_event_destroy (event2) == 0);
+
+  /* schema order is the order of the esf, meta attributes last */
+  db = lwes_event_type_db_create ((char*)esffile);
+  assert (db != NULL);
+  event1 = lwes_event_create (db, eventname);
+  assert (event1 != NULL);
+  assert (lwes_event_set_STRING (event1, key01, value01) == 1);
+  assert (lwes_event_set_INT_32 (event1, "anInt32", -5) == 2);
+  assert (lwes_event_set_DOUBLE (event1, "aDouble", 1.5) == 3);
+  assert (lwes_event_set_U_INT_16 (event1, "SiteID", 4) == 4);
+  size1 = event_bytes (event1, bytes1, sizeof (bytes1));
+
+  event2 = lwes_event_create_in_arena (db, eventname, 0);
+  assert (event2 != NULL);
+  assert (lwes_event_set_order (event2, LWES_EVENT_ORDER_SCHEMA) == 0);
+  assert (lwes_event_set_U_INT_16 (event2, "SiteID", 4) == 1);
+  assert (lwes_event_set_DOUBLE (event2, "aDouble", 1.5) == 2);
+  assert (lwes_event_set_STRING (event2, key01, value01) == 3);
+  assert (lwes_event_set_INT_32 (event2, "anInt32", -5) == 4);
+  size2 = event_bytes (event2, bytes2, sizeof (bytes2));
+  assert (size1 == size2);
+  assert (memcmp (bytes1, bytes2, size1) == 0);
+
+  assert (lwes_event_clear (event2) == 0);
+  assert (lwes_event_set_name (event2, eventname) == 0);
+  assert (lwes_event_set_INT_32 (event2, "anInt32", -5) == 1);
+  assert (lwes_event_set_U_INT_16 (event2, "SiteID", 4) == 2);
+  assert (lwes_event_set_STRING (event2, key01, value01) == 3);
+  assert (lwes_event_set_DOUBLE (event2, "aDouble", 1.5) == 4);
+  size2 = event_bytes (event2, bytes2, sizeof (bytes2));
+  assert (memcmp (bytes1, bytes2, size1) == 0);
+
+  assert (lwes_event_destroy (event1) == 0);
+  assert (lwes_event_destroy (event2) == 0);
+  lwes_event_type_db_destroy (db);
+}
+
 int main (void)
 {
   value12.s_addr = inet_addr ("127.0.0.1");
@@ -2161,6 +2693,12 @@ int main (void)
   test_deserialize_errors ();
   test_enumeration ();
   test_add_headers ();
+  test_clear_and_reset ();
+  test_serialized_size ();
+  test_unmarshallable_values ();
+  test_interned_names ();
+  test_names_outlive_db ();
+  test_serialize_order ();
 
   return 0;
 }
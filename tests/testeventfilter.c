@@ -0,0 +1,250 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "lwes_event.h"
+#include "lwes_event_view.h"
+#include "lwes_event_filter.h"
+#include "testeventhelpers.h"
+
+static int size;
+
+/* the values are at the edges of their types, where comparing a signed
+   attribute with an unsigned value, or the other way around, goes wrong */
+static int
+build_event (void)
+{
+  static const struct test_event_values values =
+    { 65535, -32768, 4294967295U, -2147483647 - 1,
+      18446744073709551615ULL, -9223372036854775807LL - 1, FALSE,
+      "255.255.255.255", 0, -0.0f, 1e308 };
+  struct lwes_event *event;
+  int n;
+
+  event = lwes_event_create (NULL, "Filtered");
+  assert (event != NULL);
+  set_test_attributes (event, &values);
+  assert (lwes_event_set_DOUBLE   (event, "nan", NAN) > 0);
+  assert (lwes_event_set_STRING   (event, "str", "") > 0);
+  assert (lwes_event_set_STRING   (event, "quote", "say \"hi\"") > 0);
+  assert (lwes_event_set_STRING   (event, "url",
+                                   "http://www.test.com/a?b=c") > 0);
+
+  n = serialize_test_event (event, bytes, sizeof (bytes));
+  assert (lwes_event_destroy (event) == 0);
+  return n;
+}
+
+/* compiles expression and checks it against the event */
+static int
+matches (const char *expression)
+{
+  struct lwes_event_filter *filter;
+  int ret;
+
+  filter = lwes_event_filter_create (expression, NULL);
+  assert (filter != NULL);
+  ret = lwes_event_filter_matches (filter, bytes, (size_t)size);
+  lwes_event_filter_destroy (filter);
+  return ret;
+}
+
+/* returns where compiling expression fails */
+static size_t
+error_at (const char *expression)
+{
+  size_t offset = 12345;
+  assert (lwes_event_filter_create (expression, &offset) == NULL);
+  return offset;
+}
+
+static void
+test_comparisons (void)
+{
+  /* unsigned integers at their maximum */
+  assert (matches ("u16 = 65535") == 1);
+  assert (matches ("u16 == 65535") == 1);
+  assert (matches ("u16 != 65535") == 0);
+  assert (matches ("u16 > 65534") == 1);
+  assert (matches ("u16 >= 65536") == 0);
+  assert (matches ("u32 = 4294967295") == 1);
+  assert (matches ("u32 > -1") == 1);
+  assert (matches ("u32 < 4294967296") == 1);
+  assert (matches ("u64 = 18446744073709551615") == 1);
+  assert (matches ("u64 > 18446744073709551614") == 1);
+  assert (matches ("u64 != -1") == 1);
+  assert (matches ("u64 > 1.8e19") == 1);
+  assert (matches ("u64 = 18446744073709551616") == 0);
+  assert (matches ("u64 < 18446744073709551616") == 1);
+
+  /* signed integers at their minimum */
+  assert (matches ("i16 = -32768") == 1);
+  assert (matches ("i16 < -32767") == 1);
+  assert (matches ("i16 <= -32769") == 0);
+  assert (matches ("i32 = -2147483648") == 1);
+  assert (matches ("i32 < 2147483648") == 1);
+  assert (matches ("i64 = -9223372036854775808") == 1);
+  assert (matches ("i64 < -9223372036854775807") == 1);
+  assert (matches ("i64 < -9223372036854775808") == 0);
+  assert (matches ("i64 > -9223372036854775809") == 1);
+  assert (matches ("i64 < 18446744073709551615") == 1);
+  assert (matches ("i64 >= -9.3e18") == 1);
+
+  /* a byte is unsigned, so it is above any negative number */
+  assert (matches ("byte = 0") == 1);
+  assert (matches ("byte > -1") == 1);
+  assert (matches ("byte < 1") == 1);
+  assert (matches ("byte = -0") == 1);
+  assert (matches ("byte in (-0)") == 1);
+  assert (matches ("u64 > -0") == 1);
+
+  /* floating point, negative zero is zero */
+  assert (matches ("float = 0") == 1);
+  assert (matches ("float < 0") == 0);
+  assert (matches ("float >= -0") == 1);
+  assert (matches ("double = 1e308") == 1);
+  assert (matches ("double > 1e307") == 1);
+  assert (matches ("double < inf") == 1);
+
+  /* NaN does not compare with anything, not even itself */
+  assert (matches ("nan = 5") == 0);
+  assert (matches ("nan <= 5") == 0);
+  assert (matches ("nan >= 5") == 0);
+  assert (matches ("nan != 5") == 0);
+  assert (matches ("nan = nan") == 0);
+  assert (matches ("nan in (5, nan)") == 0);
+  assert (matches ("double != nan") == 0);
+  assert (matches ("i32 <= nan") == 0);
+  assert (matches ("u32 >= nan") == 0);
+
+  /* booleans and ip addresses */
+  assert (matches ("bool = false") == 1);
+  assert (matches ("bool = 0") == 1);
+  assert (matches ("bool = TRUE") == 0);
+  assert (matches ("bool != true") == 1);
+  assert (matches ("bool = no") == 0);
+  assert (matches ("ip = 255.255.255.255") == 1);
+  assert (matches ("ip > 255.255.255.254") == 1);
+  assert (matches ("ip < 0.0.0.1") == 0);
+  assert (matches ("ip = 255.255.255") == 0);
+
+  /* strings, the empty one sorts first and everything is a prefix of it */
+  assert (matches ("str = \"\"") == 1);
+  assert (matches ("str < a") == 1);
+  assert (matches ("str ^= \"\"") == 1);
+  assert (matches ("str ^= a") == 0);
+  assert (matches ("str ~= \"^$\"") == 1);
+  assert (matches ("quote = \"say \\\"hi\\\"\"") == 1);
+  assert (matches ("quote ^= \"say \\\"\"") == 1);
+  assert (matches ("quote = \"say hi\"") == 0);
+  assert (matches ("url ~= \"^http://[a-z.]+\\.com/\"") == 1);
+  assert (matches ("url ~= \"^https:\"") == 0);
+  assert (matches ("url = \"http://www.test.com/a?b=c\"") == 1);
+  assert (matches ("\"url\" ^= http") == 1);
+
+  /* prefix and regex only apply to strings */
+  assert (matches ("u16 ^= 6") == 0);
+  assert (matches ("u16 ~= 6") == 0);
+
+  /* numbers do not compare with words, missing attributes and arrays do
+     not compare with anything */
+  assert (matches ("u16 = abc") == 0);
+  assert (matches ("missing = 1") == 0);
+  assert (matches ("missing != 1") == 0);
+  assert (matches ("u16s = 1") == 0);
+}
+
+static void
+test_combinations (void)
+{
+  /* the old lwes-filter-listener syntax */
+  assert (matches ("u16=65535,i16=-32768") == 1);
+  assert (matches ("u16=65535,i16=-1") == 0);
+
+  assert (matches ("u16 = 1 || i16 = -32768") == 1);
+  assert (matches ("u16 = 1 || i16 = -1") == 0);
+  assert (matches ("u16 = 65535 && i16 = -32768") == 1);
+  assert (matches ("!(u16 = 1)") == 1);
+  assert (matches ("!(missing = 1)") == 1);
+  assert (matches ("! u16 = 65535") == 0);
+  assert (matches ("!!(u16 = 65535)") == 1);
+
+  /* && binds tighter than || */
+  assert (matches ("u16 = 1 && i16 = 1 || bool = false") == 1);
+  assert (matches ("u16 = 1 && (i16 = 1 || bool = false)") == 0);
+  assert (matches ("bool = false || u16 = 1 && i16 = 1") == 1);
+  assert (matches ("(bool = false || u16 = 1) && i16 = 1") == 0);
+
+  /* sets */
+  assert (matches ("i16 in (1, -32768, 3)") == 1);
+  assert (matches ("i16 IN (1, 2, 3)") == 0);
+  assert (matches ("str in (abc, \"\")") == 1);
+  assert (matches ("ip in (255.255.255.255)") == 1);
+  assert (matches ("u64 in (-1, 18446744073709551615)") == 1);
+  assert (matches ("i16 in (1, -32768), u16 in (65535)") == 1);
+  assert (matches ("missing in (1)") == 0);
+}
+
+static void
+test_errors (void)
+{
+  struct lwes_event_filter *filter;
+  struct lwes_event_view view;
+
+  assert (lwes_event_filter_create (NULL, NULL) == NULL);
+  assert (error_at ("") == 0);
+  assert (error_at ("u16") == 3);
+  assert (error_at ("u16 =") == 5);
+  assert (error_at ("u16 = 1 &") == 8);
+  assert (error_at ("u16 = 1 |& i16 = 2") == 8);
+  assert (error_at ("u16 ^ 1") == 4);
+  assert (error_at ("(u16 = 1") == 8);
+  assert (error_at ("u16 = 1)") == 7);
+  assert (error_at ("u16 = \"1") == 6);
+  assert (error_at ("u16 in 1") == 7);
+  assert (error_at ("u16 in (1 2)") == 10);
+  assert (error_at ("u16 1") == 4);
+  assert (error_at ("url ~= \"(\"") == 10);
+  assert (error_at ("= 1") == 0);
+
+  filter = lwes_event_filter_create ("u16 = 65535", NULL);
+  assert (filter != NULL);
+  assert (lwes_event_filter_matches (NULL, bytes, (size_t)size) == -1);
+  assert (lwes_event_filter_matches (filter, NULL, (size_t)size) == -1);
+  assert (lwes_event_filter_matches (filter, bytes, 0) == -2);
+  assert (lwes_event_filter_matches (filter, bytes, 20) == -2);
+
+  /* an existing view can be checked directly */
+  assert (lwes_event_view_from_bytes (&view, bytes, (size_t)size, 0) > 0);
+  assert (lwes_event_filter_matches_view (filter, &view) == 1);
+  assert (lwes_event_filter_matches_view (filter, NULL) == -1);
+  assert (lwes_event_filter_matches_view (NULL, &view) == -1);
+
+  lwes_event_filter_destroy (filter);
+  lwes_event_filter_destroy (NULL);
+}
+
+int
+main (void)
+{
+  size = build_event ();
+
+  test_comparisons ();
+  test_combinations ();
+  test_errors ();
+
+  return 0;
+}
@@ -0,0 +1,88 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#ifndef __TESTEVENTHELPERS_H
+#define __TESTEVENTHELPERS_H
+
+/* Helpers shared by the tests which build an event holding one attribute
+ * of each type.  Each test picks its own values, and adds whatever else
+ * it checks, such as strings and nullable arrays.
+ */
+
+#include <assert.h>
+#include <arpa/inet.h>
+
+#include "lwes_event.h"
+
+#define TEST_EVENT_SIZE 65535
+
+/* the buffer the tests serialize their events into */
+static LWES_BYTE bytes[TEST_EVENT_SIZE];
+
+/* the values of the attributes set by set_test_attributes */
+struct test_event_values
+{
+  LWES_U_INT_16 u16;
+  LWES_INT_16   i16;
+  LWES_U_INT_32 u32;
+  LWES_INT_32   i32;
+  LWES_U_INT_64 u64;
+  LWES_INT_64   i64;
+  LWES_BOOLEAN  boolean;
+  const char   *ip;
+  LWES_BYTE     byte;
+  LWES_FLOAT    f;
+  LWES_DOUBLE   d;
+};
+
+/* sets "u16", "i16", "u32", "i32", "u64", "i64", "bool", "ip", "byte",
+ * "float" and "double" to values, in that order, followed by "u16s",
+ * an array of 1, 2 and 3
+ */
+static void
+set_test_attributes (struct lwes_event *event,
+                     const struct test_event_values *values)
+{
+  LWES_U_INT_16 u16s[3] = { 1, 2, 3 };
+  LWES_IP_ADDR ip;
+
+  ip.s_addr = inet_addr (values->ip);
+
+  assert (lwes_event_set_U_INT_16 (event, "u16", values->u16) > 0);
+  assert (lwes_event_set_INT_16   (event, "i16", values->i16) > 0);
+  assert (lwes_event_set_U_INT_32 (event, "u32", values->u32) > 0);
+  assert (lwes_event_set_INT_32   (event, "i32", values->i32) > 0);
+  assert (lwes_event_set_U_INT_64 (event, "u64", values->u64) > 0);
+  assert (lwes_event_set_INT_64   (event, "i64", values->i64) > 0);
+  assert (lwes_event_set_BOOLEAN  (event, "bool", values->boolean) > 0);
+  assert (lwes_event_set_IP_ADDR  (event, "ip", ip) > 0);
+  assert (lwes_event_set_BYTE     (event, "byte", values->byte) > 0);
+  assert (lwes_event_set_FLOAT    (event, "float", values->f) > 0);
+  assert (lwes_event_set_DOUBLE   (event, "double", values->d) > 0);
+  assert (lwes_event_set_array (event, "u16s", LWES_TYPE_U_INT_16_ARRAY,
+                                3, u16s) > 0);
+}
+
+/* serializes event into buffer, returning the size */
+static int
+serialize_test_event (struct lwes_event *event,
+                      LWES_BYTE *buffer,
+                      size_t length)
+{
+  int size;
+
+  size = lwes_event_to_bytes (event, buffer, length, 0);
+  assert (size > 0);
+  return size;
+}
+
+#endif /* __TESTEVENTHELPERS_H */
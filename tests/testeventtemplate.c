@@ -0,0 +1,219 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#include <assert.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "lwes_event.h"
+#include "lwes_event_template.h"
+#include "testeventhelpers.h"
+
+static LWES_BYTE expected[TEST_EVENT_SIZE];
+
+static struct lwes_event *
+build_event (void)
+{
+  static const struct test_event_values values =
+    { 1, -1, 1, -1, 1, -1, FALSE, "10.1.2.3", 1, 1.0f, 1.0 };
+  struct lwes_event *event;
+  LWES_CONST_LONG_STRING nstrs[3] = { NULL, "bb", NULL };
+
+  event = lwes_event_create_with_encoding (NULL, "Templated", 1);
+  assert (event != NULL);
+  set_test_attributes (event, &values);
+  assert (lwes_event_set_STRING   (event, "str", "hello") > 0);
+  assert (lwes_event_set_nullable_array (event, "nstrs",
+                                         LWES_TYPE_N_STRING_ARRAY,
+                                         3, nstrs) > 0);
+  /* something of a fixed size after the strings, which they move */
+  assert (lwes_event_set_INT_32   (event, "last", 1) > 0);
+  return event;
+}
+
+/* the template holds exactly what serializing its event gives */
+static void
+check_template (struct lwes_event_template *tmpl)
+{
+  int size;
+
+  size = serialize_test_event (tmpl->event, expected, sizeof (expected));
+  assert (lwes_event_template_to_bytes (tmpl, bytes, sizeof (bytes), 0)
+          == size);
+  assert (memcmp (bytes, expected, size) == 0);
+}
+
+static int
+index_of (struct lwes_event_template *tmpl, const char *name)
+{
+  int index = lwes_event_template_get_index (tmpl, name);
+  assert (index >= 0);
+  return index;
+}
+
+static void
+test_in_place (void)
+{
+  struct lwes_event *event = build_event ();
+  struct lwes_event_template *tmpl;
+  LWES_IP_ADDR ip;
+  LWES_INT_64 i64;
+  int i;
+
+  assert (lwes_event_template_create (NULL) == NULL);
+  tmpl = lwes_event_template_create (event);
+  assert (tmpl != NULL);
+  assert (tmpl->encodes == 1);
+  check_template (tmpl);
+
+  ip.s_addr = inet_addr ("192.168.0.1");
+  for (i = 0; i < 3; i++)
+    {
+      assert (lwes_event_template_set_U_INT_16
+                (tmpl, index_of (tmpl, "u16"), 65535 - i) == 0);
+      assert (lwes_event_template_set_INT_16
+                (tmpl, index_of (tmpl, "i16"), -32768 + i) == 0);
+      assert (lwes_event_template_set_U_INT_32
+                (tmpl, index_of (tmpl, "u32"), 4000000000U + i) == 0);
+      assert (lwes_event_template_set_INT_32
+                (tmpl, index_of (tmpl, "i32"), -2000000000 - i) == 0);
+      assert (lwes_event_template_set_U_INT_64
+                (tmpl, index_of (tmpl, "u64"),
+                 18000000000000000000ULL + i) == 0);
+      assert (lwes_event_template_set_INT_64
+                (tmpl, index_of (tmpl, "i64"), -5000000000LL * i) == 0);
+      assert (lwes_event_template_set_BOOLEAN
+                (tmpl, index_of (tmpl, "bool"), i % 2) == 0);
+      assert (lwes_event_template_set_IP_ADDR
+                (tmpl, index_of (tmpl, "ip"), ip) == 0);
+      assert (lwes_event_template_set_BYTE
+                (tmpl, index_of (tmpl, "byte"), (LWES_BYTE) (0xf0 + i)) == 0);
+      assert (lwes_event_template_set_FLOAT
+                (tmpl, index_of (tmpl, "float"), 2.5f * i) == 0);
+      assert (lwes_event_template_set_DOUBLE
+                (tmpl, index_of (tmpl, "double"), -0.125 * i) == 0);
+      check_template (tmpl);
+    }
+
+  /* the event follows along */
+  assert (lwes_event_get_INT_64 (event, "i64", &i64) == 0);
+  assert (i64 == -10000000000LL);
+
+  /* a string of the same length is patched too */
+  assert (lwes_event_template_set_STRING
+            (tmpl, index_of (tmpl, "str"), "world") == 0);
+  check_template (tmpl);
+  assert (tmpl->encodes == 1);
+
+  assert (lwes_event_template_destroy (tmpl) == 0);
+  assert (lwes_event_template_destroy (NULL) == 0);
+  assert (lwes_event_destroy (event) == 0);
+}
+
+static void
+test_encode (void)
+{
+  struct lwes_event *event = build_event ();
+  struct lwes_event_template *tmpl;
+  LWES_LONG_STRING str;
+
+  tmpl = lwes_event_template_create (event);
+  assert (tmpl != NULL);
+
+  /* another length moves what follows, so the event is serialized again */
+  assert (lwes_event_template_set_STRING
+            (tmpl, index_of (tmpl, "str"), "a much longer value") == 0);
+  assert (tmpl->encodes == 2);
+  check_template (tmpl);
+  assert (lwes_event_template_set_DOUBLE
+            (tmpl, index_of (tmpl, "double"), 3.0) == 0);
+  assert (lwes_event_template_set_INT_32
+            (tmpl, index_of (tmpl, "last"), 3) == 0);
+  check_template (tmpl);
+  assert (lwes_event_template_set_STRING
+            (tmpl, index_of (tmpl, "str"), "") == 0);
+  assert (tmpl->encodes == 3);
+  check_template (tmpl);
+  assert (lwes_event_get_STRING (event, "str", &str) == 0);
+  assert (strcmp (str, "") == 0);
+
+  /* changes made to the event directly need an update */
+  assert (lwes_event_set_STRING (event, "added", "late") > 0);
+  assert (lwes_event_template_get_index (tmpl, "added") == -1);
+  assert (lwes_event_template_update (tmpl) == 0);
+  assert (lwes_event_template_set_STRING
+            (tmpl, index_of (tmpl, "added"), "LATE") == 0);
+  assert (lwes_event_template_set_U_INT_16
+            (tmpl, index_of (tmpl, "u16"), 7) == 0);
+  check_template (tmpl);
+
+  assert (lwes_event_template_destroy (tmpl) == 0);
+  assert (lwes_event_destroy (event) == 0);
+}
+
+static void
+test_errors (void)
+{
+  struct lwes_event *event = build_event ();
+  struct lwes_event *unnamed;
+  struct lwes_event_template *tmpl;
+  int size;
+
+  tmpl = lwes_event_template_create (event);
+  assert (tmpl != NULL);
+
+  assert (lwes_event_template_get_index (NULL, "u16") == -1);
+  assert (lwes_event_template_get_index (tmpl, NULL) == -1);
+  assert (lwes_event_template_get_index (tmpl, "missing") == -1);
+
+  assert (lwes_event_template_set_U_INT_16 (NULL, 0, 1) == -1);
+  assert (lwes_event_template_set_U_INT_16 (tmpl, -1, 1) == -1);
+  assert (lwes_event_template_set_U_INT_16 (tmpl, 1000, 1) == -1);
+  assert (lwes_event_template_set_U_INT_16
+            (tmpl, index_of (tmpl, "i16"), 1) == -2);
+  assert (lwes_event_template_set_STRING
+            (tmpl, index_of (tmpl, "u16"), "x") == -2);
+  assert (lwes_event_template_set_STRING
+            (tmpl, index_of (tmpl, "str"), NULL) == -1);
+  assert (lwes_event_template_set_STRING (NULL, 0, "x") == -1);
+  check_template (tmpl);
+
+  /* the copy is all or nothing */
+  size = (int) tmpl->length;
+  memset (bytes, 0, sizeof (bytes));
+  assert (lwes_event_template_to_bytes (tmpl, bytes, size, 1) == -21);
+  assert (bytes[1] == 0);
+  assert (lwes_event_template_to_bytes (tmpl, bytes, size + 1, 1) == size);
+  assert (lwes_event_template_to_bytes (NULL, bytes, size, 0) == -1);
+  assert (lwes_event_template_to_bytes (tmpl, NULL, size, 0) == -1);
+  assert (lwes_event_template_to_bytes (tmpl, bytes, 0, 0) == -1);
+
+  assert (lwes_event_template_update (NULL) == -1);
+  assert (lwes_event_template_destroy (tmpl) == 0);
+  assert (lwes_event_destroy (event) == 0);
+
+  /* an event which can't be serialized can't be a template */
+  unnamed = lwes_event_create_no_name (NULL);
+  assert (unnamed != NULL);
+  assert (lwes_event_template_create (unnamed) == NULL);
+  assert (lwes_event_destroy (unnamed) == 0);
+}
+
+int
+main (void)
+{
+  test_in_place ();
+  test_encode ();
+  test_errors ();
+
+  return 0;
+}
@@ -15,6 +15,9 @@
 #endif
 
 #include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
 
 #include <stdlib.h>
 
@@ -385,6 +388,309 @@ test_db (void)
   lwes_event_type_db_destroy(db);
 }
 
+static void
+test_freeze (void)
+{
+  struct lwes_event_type_db *db;
+  const struct lwes_event_field_db_attribute *attr;
+  const char *esffile = "testeventtypedb.esf";
+  char event_name[32];
+  char attr_name[32];
+  int i;
+  int j;
+
+  db = lwes_event_type_db_create ((char*)esffile);
+  assert ( db != NULL );
+  assert ( lwes_event_type_db_is_frozen (db) );
+  assert ( ! lwes_event_type_db_is_frozen (NULL) );
+  assert ( lwes_event_type_db_freeze (db) == 0 );
+  assert ( lwes_event_type_db_freeze (NULL) == -1 );
+
+  /* lookups in the index answer as the hashes do */
+  attr = lwes_event_type_db_lookup_attr (db, "aString", "TypeChecker");
+  assert ( attr != NULL && attr->type == LWES_TYPE_STRING );
+  attr = lwes_event_type_db_lookup_attr (db, "string_null_array",
+                                         "TypeChecker");
+  assert ( attr != NULL && attr->type == LWES_TYPE_N_STRING_ARRAY );
+  attr = lwes_event_type_db_lookup_attr (db, "SenderIP", "TypeChecker");
+  assert ( attr != NULL && attr->type == LWES_TYPE_IP_ADDR );
+  attr = lwes_event_type_db_lookup_attr (db, "SiteID", "Empty");
+  assert ( attr != NULL && attr->type == LWES_TYPE_U_INT_16 );
+  assert ( lwes_event_type_db_lookup_attr (db, "aString", "Empty") == NULL );
+  assert ( lwes_event_type_db_lookup_attr (db, "aString", "MetaEventInfo")
+           == NULL );
+  assert ( lwes_event_type_db_lookup_attr (db, "", "TypeChecker") == NULL );
+  assert ( lwes_event_type_db_lookup_attr (db, "aString", "Typechecker")
+           == NULL );
+
+  /* events which are not in the db still have the meta attributes */
+  attr = lwes_event_type_db_lookup_attr (db, "aMetaString", "Unknown");
+  assert ( attr != NULL && attr->type == LWES_TYPE_STRING );
+  assert ( lwes_event_type_db_check_for_event (db,
+                                               (LWES_SHORT_STRING)"Empty") );
+  assert ( ! lwes_event_type_db_check_for_event (db,
+                                                 (LWES_SHORT_STRING)"Unknown") );
+  assert ( lwes_event_type_db_check_for_type (db, LWES_TYPE_U_INT_16,
+                                              "SenderPort", "Empty") );
+
+  /* changing the db drops the index, many events can be frozen again */
+  assert ( lwes_event_type_db_add_event (db, (LWES_SHORT_STRING)"Event0")
+           == 0 );
+  assert ( ! lwes_event_type_db_is_frozen (db) );
+  for (i = 1; i < 2000; i++)
+    {
+      snprintf (event_name, sizeof (event_name), "Event%d", i);
+      assert ( lwes_event_type_db_add_event (db, event_name) == 0 );
+    }
+  for (i = 0; i < 2000; i++)
+    {
+      snprintf (event_name, sizeof (event_name), "Event%d", i);
+      for (j = 0; j < i % 7; j++)
+        {
+          snprintf (attr_name, sizeof (attr_name), "attr%d", j + i);
+          assert ( lwes_event_type_db_add_attribute (db, event_name,
+                                                     attr_name,
+                                                     (j % 2 ? (char*)"int32"
+                                                            : (char*)"string"))
+                   == 0 );
+        }
+    }
+
+  /* a failed freeze leaves the db working, only slower */
+  malloc_count = 0;
+  null_at = 1;
+  assert ( lwes_event_type_db_freeze (db) == -3 );
+  assert ( ! lwes_event_type_db_is_frozen (db) );
+  malloc_count = 0;
+  null_at = 3;
+  assert ( lwes_event_type_db_freeze (db) == -3 );
+  assert ( ! lwes_event_type_db_is_frozen (db) );
+  malloc_count = 0;
+  null_at = 4;
+  assert ( lwes_event_type_db_freeze (db) == -3 );
+  assert ( ! lwes_event_type_db_is_frozen (db) );
+  null_at = 0;
+  assert ( lwes_event_type_db_check_for_type (db, LWES_TYPE_INT_32,
+                                              "attr1000", "Event999") );
+
+  assert ( lwes_event_type_db_freeze (db) == 0 );
+  assert ( lwes_event_type_db_is_frozen (db) );
+  for (i = 0; i < 2000; i++)
+    {
+      snprintf (event_name, sizeof (event_name), "Event%d", i);
+      assert ( lwes_event_type_db_check_for_event (db, event_name) );
+      for (j = 0; j < 7; j++)
+        {
+          snprintf (attr_name, sizeof (attr_name), "attr%d", j + i);
+          attr = lwes_event_type_db_lookup_attr (db, attr_name, event_name);
+          if (j < i % 7)
+            {
+              assert ( attr != NULL );
+              assert ( attr->type == (j % 2 ? LWES_TYPE_INT_32
+                                            : LWES_TYPE_STRING) );
+            }
+          else
+            {
+              assert ( attr == NULL );
+            }
+        }
+      attr = lwes_event_type_db_lookup_attr (db, "ReceiptTime", event_name);
+      assert ( attr != NULL && attr->type == LWES_TYPE_INT_64 );
+    }
+  assert ( ! lwes_event_type_db_check_for_event
+               (db, (LWES_SHORT_STRING)"Event2000") );
+
+  lwes_event_type_db_destroy (db);
+}
+
+static const char esfbuffer[] =
+  "MetaEventInfo\n"
+  "{\n"
+  "  ip_addr SenderIP;\n"
+  "  int64   ReceiptTime;\n"
+  "}\n"
+  "# comments work too\n"
+  "Buffered\n"
+  "{\n"
+  "  string aString(100);\n"
+  "  nullable int32 anArray[4];\n"
+  "}\n";
+
+/* a frozen db hands out one copy of each name */
+static void
+test_intern (void)
+{
+  struct lwes_event_type_db *db;
+  const struct lwes_event_field_db_attribute *attr;
+  LWES_CONST_SHORT_STRING name1;
+  LWES_CONST_SHORT_STRING name2;
+  unsigned int hash_value = 0;
+  int position = 0;
+  char copy[32];
+
+  db = lwes_event_type_db_create ((char*)"testeventtypedb.esf");
+  assert ( db != NULL );
+
+  /* names are only handed out once the db is asked to share them */
+  assert ( lwes_event_type_db_intern (db, "aString") == NULL );
+  attr = lwes_event_type_db_lookup_interned_attr (db, "aString", "TypeChecker",
+                                                  &name1, NULL, NULL);
+  assert ( attr != NULL && name1 == NULL );
+  assert ( lwes_event_type_db_share_names (NULL) == -1 );
+  assert ( lwes_event_type_db_share_names (db) == 0 );
+
+  attr = lwes_event_type_db_lookup_interned_attr (db, "aString", "TypeChecker",
+                                                  &name1, &hash_value,
+                                                  &position);
+  assert ( attr != NULL && attr->type == LWES_TYPE_STRING );
+  assert ( position == 0 );
+  assert ( name1 != NULL && strcmp (name1, "aString") == 0 );
+  assert ( hash_value == lwes_hash (name1) );
+  strcpy (copy, "aString");
+  assert ( lwes_event_type_db_intern (db, copy) == name1 );
+
+  /* positions follow the esf, with the meta attributes after the event's */
+  assert ( lwes_event_type_db_lookup_interned_attr (db, "anInt32",
+                                                    "TypeChecker", NULL, NULL,
+                                                    &position) != NULL );
+  assert ( position == 6 );
+  assert ( lwes_event_type_db_lookup_interned_attr (db, "SiteID",
+                                                    "TypeChecker", NULL, NULL,
+                                                    &position) != NULL );
+  assert ( position == 19 );
+  assert ( lwes_event_type_db_lookup_interned_attr (db, "SiteID", "Empty",
+                                                    NULL, NULL, &position)
+           != NULL );
+  assert ( position == 3 );
+  assert ( lwes_event_type_db_lookup_interned_attr (db, "anInt32", "Empty",
+                                                    NULL, NULL, &position)
+           == NULL );
+  assert ( position == -1 );
+
+  /* meta attributes are shared by every event, even unknown ones */
+  attr = lwes_event_type_db_lookup_interned_attr (db, "SiteID", "Empty",
+                                                  &name1, NULL, NULL);
+  assert ( attr != NULL );
+  attr = lwes_event_type_db_lookup_interned_attr (db, "SiteID", "Unknown",
+                                                  &name2, NULL, NULL);
+  assert ( attr != NULL );
+  assert ( name1 == name2 );
+  attr = lwes_event_type_db_lookup_interned_attr (db, "SiteID",
+                                                  "MetaEventInfo",
+                                                  &name2, NULL, NULL);
+  assert ( attr != NULL && name1 == name2 );
+
+  name1 = lwes_event_type_db_intern (db, "TypeChecker");
+  assert ( name1 != NULL && strcmp (name1, "TypeChecker") == 0 );
+  assert ( lwes_event_type_db_intern (db, "Unknown") == NULL );
+  assert ( lwes_event_type_db_intern (db, NULL) == NULL );
+  assert ( lwes_event_type_db_intern (NULL, "TypeChecker") == NULL );
+  assert ( lwes_event_type_db_lookup_interned_attr (db, "aString", "Empty",
+                                                    &name1, NULL, NULL)
+           == NULL );
+  assert ( name1 == NULL );
+
+  /* a db which is not frozen has nothing to hand out, but still answers */
+  assert ( lwes_event_type_db_add_event (db, (LWES_SHORT_STRING)"Added")
+           == 0 );
+  assert ( lwes_event_type_db_intern (db, "TypeChecker") == NULL );
+  attr = lwes_event_type_db_lookup_interned_attr (db, "aString", "TypeChecker",
+                                                  &name1, NULL, NULL);
+  assert ( attr != NULL && name1 == NULL );
+  assert ( lwes_event_type_db_freeze (db) == 0 );
+  assert ( lwes_event_type_db_intern (db, "Added") != NULL );
+
+  lwes_event_type_db_destroy (db);
+}
+
+static void
+test_from_buffer (void)
+{
+  struct lwes_event_type_db *db;
+  struct lwes_event_type_db *db2;
+  const struct lwes_event_field_db_attribute *attr;
+  const char *bad = "Broken { string ; }";
+
+  assert ( lwes_event_type_db_create_from_buffer (NULL, 10) == NULL );
+  assert ( lwes_event_type_db_create_from_buffer (bad, strlen (bad))
+           == NULL );
+
+  /* the buffer need not be terminated, so only parse the first event */
+  db = lwes_event_type_db_create_from_buffer (esfbuffer,
+                                              strstr (esfbuffer, "#")
+                                                - esfbuffer);
+  assert ( db != NULL );
+  assert ( lwes_event_type_db_check_for_event
+             (db, (LWES_SHORT_STRING)LWES_META_INFO_STRING) );
+  assert ( ! lwes_event_type_db_check_for_event
+               (db, (LWES_SHORT_STRING)"Buffered") );
+
+  db2 = lwes_event_type_db_create_from_buffer (esfbuffer, strlen (esfbuffer));
+  assert ( db2 != NULL );
+  assert ( lwes_event_type_db_is_frozen (db2) );
+  attr = lwes_event_type_db_lookup_attr (db2, "aString", "Buffered");
+  assert ( attr != NULL && attr->type == LWES_TYPE_STRING );
+  assert ( attr->max_str_size == 100 );
+  attr = lwes_event_type_db_lookup_attr (db2, "anArray", "Buffered");
+  assert ( attr != NULL && attr->type == LWES_TYPE_N_INT_32_ARRAY );
+  assert ( attr->array_size == 4 );
+  attr = lwes_event_type_db_lookup_attr (db2, "ReceiptTime", "Buffered");
+  assert ( attr != NULL && attr->type == LWES_TYPE_INT_64 );
+
+  /* destroying one db leaves the parser working for the other */
+  lwes_event_type_db_destroy (db);
+  db = lwes_event_type_db_create_from_buffer (esfbuffer, strlen (esfbuffer));
+  assert ( db != NULL );
+  assert ( lwes_event_type_db_check_for_attribute (db, "anArray",
+                                                   "Buffered") );
+  assert ( lwes_event_type_db_check_for_attribute (db2, "anArray",
+                                                   "Buffered") );
+  lwes_event_type_db_destroy (db);
+  lwes_event_type_db_destroy (db2);
+}
+
+/* parses the same buffer from many threads at once */
+static void *
+parse_in_thread (void *arg)
+{
+  struct lwes_event_type_db *db;
+  int i;
+
+  (void)arg;
+  for (i = 0; i < 50; i++)
+    {
+      db = lwes_event_type_db_create_from_buffer (esfbuffer,
+                                                  strlen (esfbuffer));
+      if (db == NULL
+          || ! lwes_event_type_db_check_for_type (db, LWES_TYPE_IP_ADDR,
+                                                  "SenderIP", "Buffered"))
+        {
+          return (void *)1;
+        }
+      lwes_event_type_db_destroy (db);
+    }
+  return NULL;
+}
+
+static void
+test_parse_threads (void)
+{
+  pthread_t threads[4];
+  void *ret;
+  int i;
+
+  for (i = 0; i < 4; i++)
+    {
+      assert ( pthread_create (&threads[i], NULL, parse_in_thread, NULL)
+               == 0 );
+    }
+  for (i = 0; i < 4; i++)
+    {
+      assert ( pthread_join (threads[i], &ret) == 0 );
+      assert ( ret == NULL );
+    }
+}
+
 static void
 test_2_db (void)
 {
@@ -449,6 +755,10 @@ test_parser_duplicate_fail (void)
 int main(void)
 {
   test_db ();
+  test_freeze ();
+  test_intern ();
+  test_from_buffer ();
+  test_parse_threads ();
   test_2_db ();
   test_extended_esf ();
   test_bad_esf ();
@@ -0,0 +1,306 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#if HAVE_CONFIG_H
+  #include <config.h>
+#endif
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lwes_event.h"
+#include "lwes_event_type_db_reloader.h"
+
+static const char esffile[] = "testeventtypedbreloader.esf";
+static const char newfile[] = "testeventtypedbreloader.esf.tmp";
+
+static const char version1[] =
+  "Reloaded\n"
+  "{\n"
+  "  string aString;\n"
+  "}\n";
+
+static const char version2[] =
+  "Reloaded\n"
+  "{\n"
+  "  string aString;\n"
+  "  int32 anInt32;\n"
+  "}\n";
+
+/* the same size as version1 */
+static const char renamed[] =
+  "Reloaded\n"
+  "{\n"
+  "  string bString;\n"
+  "}\n";
+
+static const char broken[] =
+  "Reloaded\n"
+  "{\n"
+  "  strin aString;\n";
+
+/* writes a new version next to the esf and renames it over, as a deploy
+   would, so the inode always changes */
+static void
+write_esf (const char *contents)
+{
+  FILE *f = fopen (newfile, "w");
+  assert (f != NULL);
+  assert (fwrite (contents, 1, strlen (contents), f) == strlen (contents));
+  assert (fclose (f) == 0);
+  assert (rename (newfile, esffile) == 0);
+}
+
+/* writes a new version over the esf, keeping its inode */
+static void
+rewrite_esf (const char *contents)
+{
+  FILE *f = fopen (esffile, "w");
+  assert (f != NULL);
+  assert (fwrite (contents, 1, strlen (contents), f) == strlen (contents));
+  assert (fclose (f) == 0);
+}
+
+static void
+sleep_msec (long msec)
+{
+  struct timespec t;
+  t.tv_sec = msec / 1000;
+  t.tv_nsec = (msec % 1000) * 1000000L;
+  nanosleep (&t, NULL);
+}
+
+/* whether anInt32 of Reloaded is in the current version */
+static int
+has_int32 (struct lwes_event_type_db_reloader *reloader)
+{
+  struct lwes_event_type_db *db;
+  int token;
+  int ret;
+
+  db = lwes_event_type_db_reloader_acquire (reloader, &token);
+  assert (db != NULL);
+  ret = lwes_event_type_db_check_for_attribute (db, "anInt32", "Reloaded");
+  lwes_event_type_db_reloader_release (reloader, token);
+  return ret;
+}
+
+static void
+test_check (void)
+{
+  struct lwes_event_type_db_reloader *reloader;
+
+  unlink (esffile);
+  assert (lwes_event_type_db_reloader_create (esffile, 0) == NULL);
+  assert (lwes_event_type_db_reloader_create (NULL, 0) == NULL);
+  write_esf (broken);
+  assert (lwes_event_type_db_reloader_create (esffile, 0) == NULL);
+
+  write_esf (version1);
+  reloader = lwes_event_type_db_reloader_create (esffile, 0);
+  assert (reloader != NULL);
+  assert (! has_int32 (reloader));
+  assert (lwes_event_type_db_reloader_check (reloader) == 0);
+
+  write_esf (version2);
+  assert (lwes_event_type_db_reloader_check (reloader) == 1);
+  assert (has_int32 (reloader));
+  assert (lwes_event_type_db_reloader_check (reloader) == 0);
+  assert (lwes_event_type_db_reloader_get_reload_count (reloader) == 1);
+
+  /* a broken version is reported once and the last good one is kept */
+  write_esf (broken);
+  assert (lwes_event_type_db_reloader_check (reloader) == -2);
+  assert (lwes_event_type_db_reloader_check (reloader) == 0);
+  assert (lwes_event_type_db_reloader_get_failure_count (reloader) == 1);
+  assert (lwes_event_type_db_reloader_get_last_error (reloader) == -2);
+  assert (has_int32 (reloader));
+
+  /* so is a missing file */
+  unlink (esffile);
+  assert (lwes_event_type_db_reloader_check (reloader) == -1);
+  assert (lwes_event_type_db_reloader_check (reloader) == -1);
+  assert (lwes_event_type_db_reloader_get_failure_count (reloader) == 2);
+  assert (lwes_event_type_db_reloader_get_last_error (reloader) == -1);
+  assert (has_int32 (reloader));
+
+  write_esf (version1);
+  assert (lwes_event_type_db_reloader_check (reloader) == 1);
+  assert (! has_int32 (reloader));
+  assert (lwes_event_type_db_reloader_get_last_error (reloader) == 0);
+  assert (lwes_event_type_db_reloader_reload (reloader) == 1);
+  assert (lwes_event_type_db_reloader_get_reload_count (reloader) == 3);
+
+  assert (lwes_event_type_db_reloader_destroy (reloader) == 0);
+  assert (lwes_event_type_db_reloader_destroy (NULL) == 0);
+}
+
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+/* a version of the same size written in place, most likely within the
+   same second, is told apart by the nanoseconds of its modification time */
+static void
+test_rewrite (void)
+{
+  struct lwes_event_type_db_reloader *reloader;
+  struct lwes_event_type_db *db;
+  int token;
+
+  write_esf (version1);
+  reloader = lwes_event_type_db_reloader_create (esffile, 0);
+  assert (reloader != NULL);
+
+  /* past the granularity of the file system's clock */
+  sleep_msec (20);
+  rewrite_esf (renamed);
+  assert (lwes_event_type_db_reloader_check (reloader) == 1);
+  db = lwes_event_type_db_reloader_acquire (reloader, &token);
+  assert (lwes_event_type_db_check_for_attribute (db, "bString",
+                                                  "Reloaded"));
+  lwes_event_type_db_reloader_release (reloader, token);
+  assert (lwes_event_type_db_reloader_check (reloader) == 0);
+
+  assert (lwes_event_type_db_reloader_destroy (reloader) == 0);
+}
+#endif
+
+static int reloaded = 0;
+
+static void *
+reload_in_thread (void *arg)
+{
+  struct lwes_event_type_db_reloader *reloader =
+    (struct lwes_event_type_db_reloader *) arg;
+
+  assert (lwes_event_type_db_reloader_check (reloader) == 1);
+  __atomic_store_n (&reloaded, 1, __ATOMIC_SEQ_CST);
+  return NULL;
+}
+
+/* the old db is only destroyed once its readers are done */
+static void
+test_retire (void)
+{
+  struct lwes_event_type_db_reloader *reloader;
+  struct lwes_event_type_db *old;
+  struct lwes_event_type_db *db;
+  struct lwes_event *event;
+  pthread_t thread;
+  int token;
+  int token2;
+
+  write_esf (version1);
+  reloader = lwes_event_type_db_reloader_create (esffile, 0);
+  assert (reloader != NULL);
+
+  old = lwes_event_type_db_reloader_acquire (reloader, &token);
+  write_esf (version2);
+  assert (pthread_create (&thread, NULL, reload_in_thread, reloader) == 0);
+
+  /* the new version is published while the reload waits for us */
+  do
+    {
+      db = lwes_event_type_db_reloader_acquire (reloader, &token2);
+      lwes_event_type_db_reloader_release (reloader, token2);
+    }
+  while (db == old);
+  sleep_msec (50);
+  assert (__atomic_load_n (&reloaded, __ATOMIC_SEQ_CST) == 0);
+
+  /* and the old one still validates events */
+  event = lwes_event_create (old, "Reloaded");
+  assert (event != NULL);
+  assert (lwes_event_set_STRING (event, "aString", "old") == 1);
+  assert (lwes_event_set_INT_32 (event, "anInt32", 1) < 0);
+  assert (lwes_event_destroy (event) == 0);
+
+  lwes_event_type_db_reloader_release (reloader, token);
+  assert (pthread_join (thread, NULL) == 0);
+  assert (__atomic_load_n (&reloaded, __ATOMIC_SEQ_CST) == 1);
+  assert (has_int32 (reloader));
+
+  assert (lwes_event_type_db_reloader_destroy (reloader) == 0);
+}
+
+static int stop_readers = 0;
+
+static void *
+read_in_thread (void *arg)
+{
+  struct lwes_event_type_db_reloader *reloader =
+    (struct lwes_event_type_db_reloader *) arg;
+  struct lwes_event_type_db *db;
+  int token;
+
+  while (! __atomic_load_n (&stop_readers, __ATOMIC_SEQ_CST))
+    {
+      db = lwes_event_type_db_reloader_acquire (reloader, &token);
+      assert (lwes_event_type_db_check_for_attribute (db, "aString",
+                                                      "Reloaded"));
+      lwes_event_type_db_reloader_release (reloader, token);
+    }
+  return NULL;
+}
+
+/* the watcher thread picks up new versions while readers keep reading */
+static void
+test_watcher (void)
+{
+  struct lwes_event_type_db_reloader *reloader;
+  pthread_t readers[4];
+  int i;
+
+  write_esf (version1);
+  reloader = lwes_event_type_db_reloader_create (esffile, 5);
+  assert (reloader != NULL);
+  for (i = 0; i < 4; i++)
+    {
+      assert (pthread_create (&readers[i], NULL, read_in_thread,
+                              reloader) == 0);
+    }
+
+  for (i = 0; i < 10; i++)
+    {
+      write_esf (i % 2 ? version1 : version2);
+      while (lwes_event_type_db_reloader_get_reload_count (reloader)
+             < (LWES_U_INT_64) (i + 1))
+        {
+          sleep_msec (1);
+        }
+      assert (has_int32 (reloader) == ! (i % 2));
+    }
+
+  __atomic_store_n (&stop_readers, 1, __ATOMIC_SEQ_CST);
+  for (i = 0; i < 4; i++)
+    {
+      assert (pthread_join (readers[i], NULL) == 0);
+    }
+  assert (lwes_event_type_db_reloader_get_failure_count (reloader) == 0);
+  assert (lwes_event_type_db_reloader_destroy (reloader) == 0);
+  unlink (esffile);
+}
+
+int
+main (void)
+{
+  test_check ();
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+  test_rewrite ();
+#endif
+  test_retire ();
+  test_watcher ();
+
+  return 0;
+}
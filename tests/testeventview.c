@@ -0,0 +1,253 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#include <assert.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "lwes_event.h"
+#include "lwes_event_view.h"
+#include "testeventhelpers.h"
+
+static struct lwes_event_view view;
+
+static int
+build_event (void)
+{
+  static const struct test_event_values values =
+    { 65535, -2, 4000000000U, -3, 18000000000000000000ULL, -4, TRUE,
+      "10.1.2.3", 0xfe, 1.5f, -2.25 };
+  struct lwes_event *event;
+  LWES_CONST_LONG_STRING strs[2] = { "a", "bb" };
+  LWES_CONST_LONG_STRING nstrs[4] = { NULL, "ccc", NULL, "d" };
+  LWES_INT_32 n32s[3] = { -1, 0, 7 };
+  void *n32ps[3];
+  int size;
+
+  n32ps[0] = &n32s[0];
+  n32ps[1] = NULL;
+  n32ps[2] = &n32s[2];
+
+  event = lwes_event_create (NULL, "Viewed");
+  assert (event != NULL);
+  set_test_attributes (event, &values);
+  assert (lwes_event_set_array (event, "strs", LWES_TYPE_STRING_ARRAY,
+                                2, strs) > 0);
+  assert (lwes_event_set_nullable_array (event, "nstrs",
+                                         LWES_TYPE_N_STRING_ARRAY,
+                                         4, nstrs) > 0);
+  assert (lwes_event_set_nullable_array (event, "n32s",
+                                         LWES_TYPE_N_INT_32_ARRAY,
+                                         3, n32ps) > 0);
+  assert (lwes_event_set_STRING   (event, "str", "hello") > 0);
+
+  size = serialize_test_event (event, bytes, sizeof (bytes));
+  assert (lwes_event_destroy (event) == 0);
+  return size;
+}
+
+static void
+test_getters (void)
+{
+  int size = build_event ();
+  const LWES_CHAR *str;
+  size_t length;
+  LWES_U_INT_16 number;
+  LWES_U_INT_16 u16;
+  LWES_INT_16 i16;
+  LWES_U_INT_32 u32;
+  LWES_INT_32 i32;
+  LWES_U_INT_64 u64;
+  LWES_INT_64 i64;
+  LWES_BOOLEAN b = 12345;
+  LWES_IP_ADDR ip;
+  LWES_BYTE byte;
+  LWES_FLOAT f;
+  LWES_DOUBLE d;
+
+  assert (lwes_event_view_from_bytes (&view, bytes, size, 0) == size);
+
+  assert (lwes_event_view_get_name (&view, &str, &length) == 0);
+  assert (length == 6 && memcmp (str, "Viewed", 6) == 0);
+  assert (lwes_event_view_get_number_of_attributes (&view, &number) == 0);
+  assert (number == 16);
+  assert (view.expected_attributes == 16);
+
+  assert (lwes_event_view_get_U_INT_16 (&view, "u16", &u16) == 0);
+  assert (u16 == 65535);
+  assert (lwes_event_view_get_INT_16 (&view, "i16", &i16) == 0);
+  assert (i16 == -2);
+  assert (lwes_event_view_get_U_INT_32 (&view, "u32", &u32) == 0);
+  assert (u32 == 4000000000U);
+  assert (lwes_event_view_get_INT_32 (&view, "i32", &i32) == 0);
+  assert (i32 == -3);
+  assert (lwes_event_view_get_U_INT_64 (&view, "u64", &u64) == 0);
+  assert (u64 == 18000000000000000000ULL);
+  assert (lwes_event_view_get_INT_64 (&view, "i64", &i64) == 0);
+  assert (i64 == -4);
+  assert (lwes_event_view_get_BOOLEAN (&view, "bool", &b) == 0);
+  assert (b == TRUE);
+  assert (lwes_event_view_get_IP_ADDR (&view, "ip", &ip) == 0);
+  assert (ip.s_addr == inet_addr ("10.1.2.3"));
+  assert (lwes_event_view_get_BYTE (&view, "byte", &byte) == 0);
+  assert (byte == 0xfe);
+  assert (lwes_event_view_get_FLOAT (&view, "float", &f) == 0);
+  assert (f == 1.5f);
+  assert (lwes_event_view_get_DOUBLE (&view, "double", &d) == 0);
+  assert (d == -2.25);
+
+  /* strings point straight into the buffer */
+  assert (lwes_event_view_get_STRING (&view, "str", &str, &length) == 0);
+  assert (length == 5 && memcmp (str, "hello", 5) == 0);
+  assert (str > (const LWES_CHAR *)bytes
+          && str < (const LWES_CHAR *)bytes + size);
+
+  /* missing attributes, wrong types and bad arguments */
+  assert (lwes_event_view_get_INT_32 (&view, "missing", &i32) == -1);
+  assert (lwes_event_view_get_INT_32 (&view, "i3", &i32) == -1);
+  assert (lwes_event_view_get_INT_32 (&view, "i32x", &i32) == -1);
+  assert (lwes_event_view_get_INT_32 (&view, "u32", &i32) == -1);
+  assert (lwes_event_view_get_STRING (&view, "u16s", &str, &length) == -1);
+  assert (lwes_event_view_get_INT_32 (&view, NULL, &i32) == -1);
+  assert (lwes_event_view_get_INT_32 (&view, "i32", NULL) == -1);
+  assert (lwes_event_view_get_INT_32 (NULL, "i32", &i32) == -1);
+  assert (lwes_event_view_get_STRING (&view, "str", NULL, &length) == -1);
+  assert (lwes_event_view_get_attribute (&view, "missing") == NULL);
+  assert (lwes_event_view_get_attribute (&view, "n32s")->type
+          == LWES_TYPE_N_INT_32_ARRAY);
+}
+
+static void
+test_enumeration (void)
+{
+  static const char *names[] =
+    { "u16", "i16", "u32", "i32", "u64", "i64", "bool", "ip", "byte",
+      "float", "double", "u16s", "strs", "nstrs", "n32s", "str" };
+  struct lwes_event_view_enumeration e;
+  const struct lwes_event_view_attribute *attr;
+  int size = build_event ();
+  int i = 0;
+
+  assert (lwes_event_view_from_bytes (&view, bytes, size, 0) == size);
+  assert (! lwes_event_view_keys (NULL, &e));
+  assert (! lwes_event_view_keys (&view, NULL));
+  assert (lwes_event_view_keys (&view, &e));
+  while ((attr = lwes_event_view_enumeration_next_element (&e)) != NULL)
+    {
+      assert (i < 16);
+      assert (attr->name_length == strlen (names[i]));
+      assert (memcmp (attr->name, names[i], attr->name_length) == 0);
+      assert (attr->offset + attr->length <= (size_t)size);
+      ++i;
+    }
+  assert (i == 16);
+  assert (lwes_event_view_enumeration_next_element (&e) == NULL);
+}
+
+static void
+test_duplicates_and_offsets (void)
+{
+  int size = build_event ();
+  size_t offset;
+  const LWES_CHAR *str;
+  size_t length;
+
+  /* start the event at an offset, then append a second "str", like
+   * lwes_event_from_bytes the last one wins */
+  memmove (bytes + 4, bytes, size);
+  bytes[0] = bytes[1] = bytes[2] = bytes[3] = 0;
+  offset = 4 + size;
+  bytes[offset++] = 3;
+  memcpy (bytes + offset, "str", 3);
+  offset += 3;
+  bytes[offset++] = LWES_TYPE_STRING;
+  bytes[offset++] = 0;
+  bytes[offset++] = 2;
+  memcpy (bytes + offset, "hi", 2);
+  offset += 2;
+
+  assert (lwes_event_view_from_bytes (&view, bytes, offset, 4)
+          == (int)offset - 4);
+  assert (view.number_of_attributes == 17);
+  assert (view.expected_attributes == 16);
+  assert (lwes_event_view_get_STRING (&view, "str", &str, &length) == 0);
+  assert (length == 2 && memcmp (str, "hi", 2) == 0);
+}
+
+static void
+test_malformed (void)
+{
+  int size = build_event ();
+  int i;
+
+  assert (lwes_event_view_from_bytes (NULL, bytes, size, 0) == -1);
+  assert (lwes_event_view_from_bytes (&view, NULL, size, 0) == -1);
+  assert (lwes_event_view_from_bytes (&view, bytes, 0, 0) == -1);
+  assert (lwes_event_view_from_bytes (&view, bytes, size, size) == -1);
+
+  /* every truncation fails, apart from at the end of an attribute */
+  for (i = 1; i < size; ++i)
+    {
+      int ret = lwes_event_view_from_bytes (&view, bytes, i, 0);
+      if (ret >= 0)
+        {
+          assert (ret == i);
+          assert (view.number_of_attributes > 0 || i == 1 + 6 + 2);
+          assert (view.number_of_attributes == 0
+                  || view.attributes[view.number_of_attributes - 1].offset
+                     + view.attributes[view.number_of_attributes - 1].length
+                     == (size_t)i);
+        }
+      else
+        {
+          assert (ret == -2);
+        }
+    }
+
+  /* an unknown type */
+  bytes[size] = 1;
+  bytes[size + 1] = 'x';
+  bytes[size + 2] = 99;
+  assert (lwes_event_view_from_bytes (&view, bytes, size + 3, 0) == -2);
+}
+
+static void
+test_too_many (void)
+{
+  size_t offset = 0;
+  int i;
+
+  bytes[offset++] = 1;
+  bytes[offset++] = 'E';
+  bytes[offset++] = 0xff;
+  bytes[offset++] = 0xff;
+  for (i = 0; i <= LWES_EVENT_VIEW_MAX_ATTRIBUTES; ++i)
+    {
+      bytes[offset++] = 1;
+      bytes[offset++] = 'a';
+      bytes[offset++] = LWES_TYPE_BYTE;
+      bytes[offset++] = (LWES_BYTE)i;
+    }
+  assert (lwes_event_view_from_bytes (&view, bytes, offset - 4, 0)
+          == (int)offset - 4);
+  assert (lwes_event_view_from_bytes (&view, bytes, offset, 0) == -3);
+}
+
+int main (void)
+{
+  test_getters ();
+  test_enumeration ();
+  test_duplicates_and_offsets ();
+  test_malformed ();
+  test_too_many ();
+  return 0;
+}
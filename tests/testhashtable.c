@@ -97,6 +97,11 @@ int main(void)
   struct lwes_hash *hash = NULL;
   struct lwes_hash_enumeration e;
 
+  /* for growth test */
+  char many_keys[200][16];
+  char more_keys[200][16];
+  int j;
+
   /* for enumeration test */
   int i;
   int num_found[] = { 0, 0, 0, 0, 0, 0,
@@ -346,5 +351,88 @@ int main(void)
   assert ( lwes_hash_is_empty(hash) );
   assert ( lwes_hash_destroy(hash) == 0 );
 
+  /* grow well past the initial size, enumerating in insertion order */
+  hash = lwes_hash_create_with_bins (1);
+  assert ( hash != NULL );
+  for ( i = 0 ; i < 200 ; i++ )
+    {
+      snprintf (many_keys[i], sizeof (many_keys[i]), "k%d", i);
+      assert ( lwes_hash_put (hash, many_keys[i], &value1) == NULL );
+    }
+  assert ( lwes_hash_size (hash) == 200 );
+  for ( i = 0 ; i < 200 ; i++ )
+    {
+      assert ( lwes_hash_get (hash, many_keys[i]) == &value1 );
+    }
+  assert ( lwes_hash_keys (hash, &e) );
+  i = 0;
+  while ( lwes_hash_enumeration_has_more_elements (&e) )
+    {
+      assert ( lwes_hash_enumeration_next_element (&e) == many_keys[i] );
+      i++;
+    }
+  assert ( i == 200 );
+
+  /* remove every other key while enumerating */
+  assert ( lwes_hash_keys (hash, &e) );
+  i = 0;
+  while ( lwes_hash_enumeration_has_more_elements (&e) )
+    {
+      char *tmpKey = lwes_hash_enumeration_next_element (&e);
+      if ( i % 2 == 0 )
+        {
+          assert ( lwes_hash_remove (hash, tmpKey) == &value1 );
+        }
+      i++;
+    }
+  assert ( i == 200 );
+  assert ( lwes_hash_size (hash) == 100 );
+
+  /* removed keys are gone, and putting them back reuses their space */
+  for ( i = 0 ; i < 200 ; i++ )
+    {
+      assert ( lwes_hash_contains_key (hash, many_keys[i]) == (i % 2) );
+    }
+  assert ( lwes_hash_rehash (hash) == 0 );
+  for ( i = 0 ; i < 200 ; i += 2 )
+    {
+      assert ( lwes_hash_put (hash, many_keys[i], &value2) == NULL );
+    }
+  for ( i = 0 ; i < 200 ; i++ )
+    {
+      assert ( lwes_hash_get (hash, many_keys[i])
+               == ((i % 2) ? &value1 : &value2) );
+    }
+
+  /* a failure to grow leaves the hash as it was */
+  i = 0;
+  while ( hash->used_elements < LWES_HASH_CAPACITY (hash->index_size) )
+    {
+      snprintf (more_keys[i], sizeof (more_keys[i]), "x%d", i);
+      assert ( lwes_hash_put (hash, more_keys[i], &value3) == NULL );
+      i++;
+    }
+  snprintf (more_keys[i], sizeof (more_keys[i]), "x%d", i);
+  for ( j = 1 ; j <= 2 ; j++ )
+    {
+      malloc_count = 0;
+      null_at = (size_t)j;
+      assert ( lwes_hash_put (hash, more_keys[i], &value3) == &value3 );
+      assert ( lwes_hash_size (hash) == 200 + i );
+      assert ( lwes_hash_get (hash, more_keys[i]) == NULL );
+      assert ( lwes_hash_get (hash, "k1") == &value1 );
+    }
+  null_at = 0;
+  assert ( lwes_hash_put (hash, more_keys[i], &value3) == NULL );
+  assert ( lwes_hash_size (hash) == 201 + i );
+
+  assert ( lwes_hash_keys (hash, &e) );
+  while ( lwes_hash_enumeration_has_more_elements (&e) )
+    {
+      lwes_hash_remove (hash, lwes_hash_enumeration_next_element (&e));
+    }
+  assert ( lwes_hash_is_empty (hash) );
+  assert ( lwes_hash_destroy (hash) == 0 );
+
   return 0;
 }
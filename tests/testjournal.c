@@ -0,0 +1,433 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#include <assert.h>
+#include <glob.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+
+#include "lwes_event.h"
+#include "lwes_journal.h"
+#include "lwes_marshall_functions.h"
+
+static const char prefix[] = "testjournal.tmp";
+
+/* 2008-10-31 23:59:59 UTC, as nanoseconds since epoch */
+static const LWES_INT_64 start = 1225497599LL * 1000000000LL;
+
+/* the serialized event with a given index, names cycle through three */
+static size_t
+build_event (int index, size_t padding, LWES_BYTE *bytes)
+{
+  struct lwes_event *event;
+  char name[16];
+  char value[2048];
+  LWES_IP_ADDR ip;
+  size_t len;
+  int size;
+
+  assert (padding < sizeof (value));
+  snprintf (name, sizeof (name), "Event%d", index % 3);
+  memset (value, 'a' + index % 26, padding);
+  value[padding] = '\0';
+
+  event = lwes_event_create (NULL, name);
+  assert (event != NULL);
+  assert (lwes_event_set_INT_32 (event, "index", index) == 1);
+  assert (lwes_event_set_STRING (event, "padding", value) == 2);
+  size = lwes_event_to_bytes (event, bytes, MAX_MSG_SIZE, 0);
+  assert (size > 0);
+  assert (lwes_event_destroy (event) == 0);
+
+  /* journaled events carry the header fields */
+  ip.s_addr = inet_addr ("10.0.0.1");
+  len = (size_t)size;
+  assert (lwes_event_add_headers (bytes, MAX_MSG_SIZE, &len,
+                                  1225497599000LL + index, ip,
+                                  (LWES_U_INT_16)(1000 + index)) == 0);
+  return len;
+}
+
+static int
+write_event (struct lwes_journal *journal, int index, size_t padding,
+             LWES_INT_64 receipt_time)
+{
+  LWES_BYTE bytes[MAX_MSG_SIZE];
+  LWES_IP_ADDR ip;
+  size_t len = build_event (index, padding, bytes);
+
+  ip.s_addr = inet_addr ("10.0.0.1");
+  return lwes_journal_write (journal, bytes, len, receipt_time, ip,
+                             (LWES_U_INT_16)(1000 + index));
+}
+
+static int
+matches (const char *pattern)
+{
+  glob_t files;
+  int count = 0;
+
+  if (glob (pattern, 0, NULL, &files) == 0)
+    {
+      count = (int)files.gl_pathc;
+      globfree (&files);
+    }
+  return count;
+}
+
+static void
+remove_files (void)
+{
+  glob_t files;
+  size_t i;
+
+  if (glob ("testjournal.tmp*.lwj", 0, NULL, &files) == 0)
+    {
+      for (i = 0; i < files.gl_pathc; ++i)
+        {
+          unlink (files.gl_pathv[i]);
+        }
+      globfree (&files);
+    }
+}
+
+/* checks every block of a file against its header and footer, and every
+   record against the event it was built from, returning the number of
+   records, and the number of blocks in *blocks */
+static int
+check_file (const char *path, size_t padding, int *next_index,
+            LWES_INT_64 *receipt_times, int *blocks)
+{
+  static LWES_BYTE file[4 * 1024 * 1024];
+  LWES_BYTE expected[MAX_MSG_SIZE];
+  FILE *fp;
+  size_t file_size;
+  size_t block;
+  int records = 0;
+
+  fp = fopen (path, "rb");
+  assert (fp != NULL);
+  file_size = fread (file, 1, sizeof (file), fp);
+  assert (feof (fp));
+  fclose (fp);
+
+  *blocks = 0;
+  for (block = 0; block < file_size; )
+    {
+      LWES_U_INT_32 length, records_in_block, footer, count, name_count;
+      LWES_U_INT_16 names, event_length, port;
+      LWES_INT_64 first, last, receipt_time;
+      LWES_U_INT_32 ip;
+      LWES_U_INT_32 counts[3] = { 0, 0, 0 };
+      char name[256];
+      size_t offset = block;
+      size_t len;
+      int i;
+
+      assert (memcmp (file + block, LWES_JOURNAL_MAGIC, 4) == 0);
+      offset += 4;
+      assert (unmarshall_U_INT_32 (&length, file, file_size, &offset));
+      assert (unmarshall_U_INT_32 (&records_in_block, file, file_size,
+                                   &offset));
+      assert (unmarshall_U_INT_32 (&footer, file, file_size, &offset));
+      assert (block + length <= file_size);
+      assert (records_in_block > 0);
+
+      for (i = 0; i < (int)records_in_block; ++i)
+        {
+          assert (unmarshall_U_INT_16 (&event_length, file, file_size,
+                                       &offset));
+          assert (unmarshall_INT_64 (&receipt_time, file, file_size,
+                                     &offset));
+          assert (unmarshall_U_INT_32 (&ip, file, file_size, &offset));
+          assert (unmarshall_U_INT_16 (&port, file, file_size, &offset));
+          assert (receipt_time == receipt_times[*next_index]);
+          assert (ip == ntohl (inet_addr ("10.0.0.1")));
+          assert (port == 1000 + *next_index);
+          len = build_event (*next_index, padding, expected);
+          assert (len == event_length);
+          assert (memcmp (file + offset, expected, len) == 0);
+          counts[*next_index % 3]++;
+          offset += len;
+          (*next_index)++;
+        }
+      assert (offset == block + footer);
+
+      /* the footer has the time range and the count of each name */
+      assert (unmarshall_INT_64 (&first, file, file_size, &offset));
+      assert (unmarshall_INT_64 (&last, file, file_size, &offset));
+      assert (unmarshall_U_INT_16 (&names, file, file_size, &offset));
+      assert (first == receipt_times[*next_index - records_in_block]);
+      assert (last == receipt_times[*next_index - 1]);
+      name_count = 0;
+      for (i = 0; i < names; ++i)
+        {
+          assert (unmarshall_SHORT_STRING (name, sizeof (name), file,
+                                           file_size, &offset));
+          assert (strncmp (name, "Event", 5) == 0);
+          assert (unmarshall_U_INT_32 (&count, file, file_size, &offset));
+          assert (count == counts[name[5] - '0']);
+          name_count += count;
+        }
+      assert (offset == block + length);
+      assert (name_count == records_in_block);
+
+      block += length;
+      records += name_count;
+      (*blocks)++;
+    }
+  assert (block == file_size);
+
+  return records;
+}
+
+/* checks every file of the journal, in order, returning the number of
+   records in them */
+static int
+check_journal (size_t padding, LWES_INT_64 *receipt_times, int *files,
+               int *blocks, size_t *largest)
+{
+  glob_t paths;
+  struct stat st;
+  int next_index = 0;
+  int file_blocks;
+  size_t i;
+
+  *files = 0;
+  *blocks = 0;
+  *largest = 0;
+  if (glob ("testjournal.tmp*.lwj", 0, NULL, &paths) != 0)
+    {
+      return 0;
+    }
+  /* the sequence numbers sort as strings while there are fewer than 10 */
+  assert (paths.gl_pathc < 10);
+  for (i = 0; i < paths.gl_pathc; ++i)
+    {
+      assert (stat (paths.gl_pathv[i], &st) == 0);
+      if ((size_t)st.st_size > *largest)
+        {
+          *largest = (size_t)st.st_size;
+        }
+      check_file (paths.gl_pathv[i], padding, &next_index, receipt_times,
+                  &file_blocks);
+      *blocks += file_blocks;
+      (*files)++;
+    }
+  globfree (&paths);
+
+  return next_index;
+}
+
+static void
+test_arguments (void)
+{
+  struct lwes_journal *journal;
+  LWES_BYTE bytes[MAX_MSG_SIZE];
+  LWES_IP_ADDR ip;
+  size_t len;
+
+  ip.s_addr = 0;
+  assert (lwes_journal_create (NULL, 0, 0, 0) == NULL);
+  assert (lwes_journal_create ("", 0, 0, 0) == NULL);
+  assert (lwes_journal_write (NULL, bytes, 10, start, ip, 0) == -1);
+  assert (lwes_journal_tick (NULL, start) == -1);
+  assert (lwes_journal_rotate (NULL) == -1);
+  assert (lwes_journal_destroy (NULL) == -1);
+
+  journal = lwes_journal_create (prefix, 0, 0, 0);
+  assert (journal != NULL);
+  assert (journal->block_size == LWES_JOURNAL_DEFAULT_BLOCK_SIZE);
+  assert (lwes_journal_destroy (journal) == 0);
+
+  /* a block always has room for the largest event */
+  journal = lwes_journal_create (prefix, 100, 0, 0);
+  assert (journal != NULL);
+  assert (journal->block_size > MAX_MSG_SIZE);
+
+  len = build_event (0, 10, bytes);
+  assert (lwes_journal_write (journal, NULL, len, start, ip, 0) == -1);
+  assert (lwes_journal_write (journal, bytes, 0, start, ip, 0) == -1);
+  assert (lwes_journal_write (journal, bytes, MAX_MSG_SIZE + 1, start,
+                              ip, 0) == -1);
+  assert (lwes_journal_write (journal, bytes, bytes[0], start, ip, 0) == -1);
+  bytes[0] = 0;
+  assert (lwes_journal_write (journal, bytes, len, start, ip, 0) == -1);
+  assert (journal->block_records == 0);
+
+  /* nothing written means no file */
+  assert (lwes_journal_tick (journal, start) == 0);
+  assert (lwes_journal_destroy (journal) == 0);
+  assert (matches ("testjournal.tmp*.lwj") == 0);
+}
+
+static void
+test_blocks (void)
+{
+  struct lwes_journal *journal;
+  LWES_INT_64 receipt_times[400];
+  size_t largest;
+  int files, blocks;
+  int i;
+
+  /* one block, written when the journal is destroyed */
+  journal = lwes_journal_create (prefix, 0, 0, 0);
+  assert (journal != NULL);
+  for (i = 0; i < 5; ++i)
+    {
+      receipt_times[i] = start + i * 1000;
+      assert (write_event (journal, i, 20, receipt_times[i]) == 0);
+    }
+  assert (journal->fd == -1);
+  assert (journal->footer_size == LWES_JOURNAL_FOOTER_SIZE + 3 * 11);
+  assert (lwes_journal_destroy (journal) == 0);
+  assert (check_journal (20, receipt_times, &files, &blocks, &largest)
+          == 5);
+  assert (files == 1 && blocks == 1);
+  assert (matches ("testjournal.tmp.20081031235959.0.lwj") == 1);
+  remove_files ();
+
+  /* full blocks are written as they fill, and a tick writes a partial
+     one into the same file */
+  journal = lwes_journal_create (prefix, 1, 0, 0);
+  assert (journal != NULL);
+  for (i = 0; i < 300; ++i)
+    {
+      receipt_times[i] = start + i * 1000;
+      assert (write_event (journal, i, 1000, receipt_times[i]) == 0);
+    }
+  assert (journal->blocks > 2);
+  assert (journal->block_records > 0);
+  assert (lwes_journal_tick (journal, start + 1000000) == 0);
+  assert (journal->block_records == 0);
+  assert (journal->events == 300);
+  assert (journal->files == 1);
+  assert (journal->bytes == journal->file_size);
+  for (i = 300; i < 310; ++i)
+    {
+      receipt_times[i] = start + i * 1000;
+      assert (write_event (journal, i, 1000, receipt_times[i]) == 0);
+    }
+  assert (lwes_journal_destroy (journal) == 0);
+  assert (check_journal (1000, receipt_times, &files, &blocks, &largest)
+          == 310);
+  assert (files == 1 && blocks > 4);
+  assert (largest > 310 * 1000);
+  remove_files ();
+}
+
+static void
+test_rotation (void)
+{
+  struct lwes_journal *journal;
+  LWES_INT_64 receipt_times[400];
+  size_t largest;
+  size_t max_file_size = 3 * 80 * 1024;
+  int files, blocks;
+  int i;
+
+  /* by size, a file is never grown beyond the limit */
+  journal = lwes_journal_create (prefix, 80 * 1024, max_file_size, 0);
+  assert (journal != NULL);
+  for (i = 0; i < 400; ++i)
+    {
+      receipt_times[i] = start + i * 1000;
+      assert (write_event (journal, i, 1500, receipt_times[i]) == 0);
+    }
+  assert (lwes_journal_destroy (journal) == 0);
+  assert (check_journal (1500, receipt_times, &files, &blocks, &largest)
+          == 400);
+  assert (files > 2);
+  assert (blocks >= files * 3 - 2);
+  assert (largest <= max_file_size);
+  remove_files ();
+
+  /* by time, against the receipt times of the events */
+  journal = lwes_journal_create (prefix, 0, 0, 10);
+  assert (journal != NULL);
+  for (i = 0; i < 6; ++i)
+    {
+      receipt_times[i] = start + i * 3000000000LL;
+      assert (write_event (journal, i, 10, receipt_times[i]) == 0);
+      assert (lwes_journal_tick (journal, receipt_times[i]) == 0);
+    }
+  assert (journal->files == 2);
+  /* and against the clock when nothing arrives */
+  assert (lwes_journal_tick (journal, receipt_times[4] + 9000000000LL) == 0);
+  assert (journal->fd >= 0);
+  assert (lwes_journal_tick (journal, receipt_times[4] + 10000000000LL)
+          == 0);
+  assert (journal->fd == -1);
+  /* even before the first block of a file is written */
+  receipt_times[6] = receipt_times[5] + 20000000000LL;
+  assert (write_event (journal, 6, 10, receipt_times[6]) == 0);
+  receipt_times[7] = receipt_times[6] + 10000000000LL;
+  assert (write_event (journal, 7, 10, receipt_times[7]) == 0);
+  assert (journal->files == 3);
+  assert (lwes_journal_destroy (journal) == 0);
+  assert (check_journal (10, receipt_times, &files, &blocks, &largest)
+          == 8);
+  assert (files == 4 && blocks == 8);
+  remove_files ();
+
+  /* rotating by hand */
+  journal = lwes_journal_create (prefix, 0, 0, 0);
+  assert (journal != NULL);
+  for (i = 0; i < 4; ++i)
+    {
+      receipt_times[i] = start + i;
+      assert (write_event (journal, i, 10, receipt_times[i]) == 0);
+      assert (lwes_journal_rotate (journal) == 0);
+    }
+  assert (lwes_journal_rotate (journal) == 0);
+  assert (lwes_journal_destroy (journal) == 0);
+  assert (check_journal (10, receipt_times, &files, &blocks, &largest)
+          == 4);
+  assert (files == 4 && blocks == 4);
+  remove_files ();
+}
+
+static void
+test_write_failure (void)
+{
+  struct lwes_journal *journal;
+  int ret;
+  int i;
+
+  /* a block which cannot be written is dropped, and the next is tried */
+  journal = lwes_journal_create ("testjournal.tmp.missing/journal", 1, 0, 0);
+  assert (journal != NULL);
+  assert (write_event (journal, 0, 10, start) == 0);
+  assert (lwes_journal_tick (journal, start) == -2);
+  assert (journal->dropped == 1);
+  for (i = 1; i < 200 && journal->dropped == 1; ++i)
+    {
+      ret = write_event (journal, i, 1000, start);
+      assert (ret == 0 || ret == -2);
+    }
+  assert (journal->dropped > 1);
+  assert (journal->block_records == 1);
+  assert (lwes_journal_destroy (journal) == -2);
+}
+
+int main (void)
+{
+  remove_files ();
+  test_arguments ();
+  test_blocks ();
+  test_rotation ();
+  test_write_failure ();
+  remove_files ();
+  return 0;
+}
@@ -0,0 +1,102 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#ifndef __TESTJOURNALHELPERS_H
+#define __TESTJOURNALHELPERS_H
+
+/* Helpers shared by the tests which read back a journal.  Each test keeps
+ * its own copy of every event it journals, so it can check what is read
+ * or replayed against what was written.
+ */
+
+#include <assert.h>
+#include <glob.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#include "lwes_event.h"
+#include "lwes_journal.h"
+
+#define TEST_JOURNAL_EVENT_SIZE 512
+
+/* removes every file whose name starts with prefix */
+static void
+remove_journal_files (const char *prefix)
+{
+  char pattern[FILENAME_MAX];
+  glob_t paths;
+  size_t i;
+
+  snprintf (pattern, sizeof (pattern), "%s*", prefix);
+  if (glob (pattern, 0, NULL, &paths) == 0)
+    {
+      for (i = 0; i < paths.gl_pathc; ++i)
+        {
+          unlink (paths.gl_pathv[i]);
+        }
+      globfree (&paths);
+    }
+}
+
+/* journals count events from build into a single file under prefix, the
+ * event at index received at start + index * gap from 10.0.0.0 + index on
+ * port index, keeping the serialized events and their lengths and copying
+ * the name of the file to path
+ */
+static void
+write_journal_file (const char *prefix,
+                    size_t block_size,
+                    int count,
+                    struct lwes_event *(*build) (int index),
+                    LWES_INT_64 start,
+                    LWES_INT_64 gap,
+                    LWES_BYTE events[][TEST_JOURNAL_EVENT_SIZE],
+                    size_t *lengths,
+                    char *path)
+{
+  struct lwes_journal *journal;
+  struct lwes_event *event;
+  LWES_IP_ADDR ip;
+  glob_t paths;
+  char pattern[FILENAME_MAX];
+  int size;
+  int i;
+
+  journal = lwes_journal_create (prefix, block_size, 0, 0);
+  assert (journal != NULL);
+  for (i = 0; i < count; ++i)
+    {
+      event = build (i);
+      assert (event != NULL);
+      size = lwes_event_to_bytes (event, events[i],
+                                  TEST_JOURNAL_EVENT_SIZE, 0);
+      assert (size > 0);
+      lengths[i] = (size_t)size;
+      assert (lwes_event_destroy (event) == 0);
+
+      ip.s_addr = htonl (0x0a000000 + i);
+      assert (lwes_journal_write (journal, events[i], lengths[i],
+                                  start + i * gap, ip,
+                                  (LWES_U_INT_16)i) == 0);
+    }
+  assert (lwes_journal_destroy (journal) == 0);
+
+  snprintf (pattern, sizeof (pattern), "%s.*.lwj", prefix);
+  assert (glob (pattern, 0, NULL, &paths) == 0);
+  assert (paths.gl_pathc == 1);
+  strcpy (path, paths.gl_pathv[0]);
+  globfree (&paths);
+}
+
+#endif /* __TESTJOURNALHELPERS_H */
@@ -0,0 +1,458 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#include <assert.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <arpa/inet.h>
+
+#include "lwes_event.h"
+#include "lwes_journal.h"
+#include "lwes_journal_reader.h"
+#include "lwes_marshall_functions.h"
+#include "testjournalhelpers.h"
+
+#define NUM_EVENTS 3000
+#define NUM_THREADS 4
+#define BENCH_PASSES 20
+
+static const char prefix[] = "testjournalreader.tmp";
+static const char copy[] = "testjournalreader.tmp.copy";
+
+/* 2008-10-31 23:59:59 UTC, as nanoseconds since epoch */
+static const LWES_INT_64 start = 1225497599LL * 1000000000LL;
+
+static char path[FILENAME_MAX];
+static LWES_BYTE events[NUM_EVENTS][TEST_JOURNAL_EVENT_SIZE];
+static size_t lengths[NUM_EVENTS];
+
+static LWES_INT_64
+receipt_time (int index)
+{
+  return start + (LWES_INT_64)index * 1000000;
+}
+
+/* an Odd or Even event with a value of up to 199 letters */
+static struct lwes_event *
+build_event (int index)
+{
+  struct lwes_event *event;
+  char value[256];
+
+  event = lwes_event_create (NULL, (index % 2 ? "Odd" : "Even"));
+  assert (event != NULL);
+  memset (value, 'a' + index % 26, index % 200);
+  value[index % 200] = '\0';
+  assert (lwes_event_set_INT_32 (event, "index", index) == 1);
+  assert (lwes_event_set_STRING (event, "value", value) == 2);
+  return event;
+}
+
+/* journals NUM_EVENTS events into a single file */
+static void
+write_journal (void)
+{
+  write_journal_file (prefix, 1, NUM_EVENTS, build_event, start, 1000000,
+                      events, lengths, path);
+}
+
+static void
+check_record (struct lwes_journal_record *record, int index)
+{
+  assert (record->length == lengths[index]);
+  assert (memcmp (record->bytes, events[index], lengths[index]) == 0);
+  assert (record->receipt_time == receipt_time (index));
+  assert (record->sender_ip.s_addr == htonl (0x0a000000 + index));
+  assert (record->sender_port == index);
+}
+
+static void
+test_scan (void)
+{
+  struct lwes_journal_reader *reader;
+  struct lwes_journal_cursor cursor;
+  struct lwes_journal_record record;
+  struct lwes_event *event;
+  struct lwes_event_deserialize_tmp dtmp;
+  LWES_INT_32 index;
+  LWES_U_INT_32 records = 0;
+  int i;
+
+  assert (lwes_journal_reader_open (NULL) == NULL);
+  assert (lwes_journal_reader_open ("testjournalreader.tmp.missing")
+          == NULL);
+  assert (lwes_journal_reader_close (NULL) == -1);
+
+  reader = lwes_journal_reader_open (path);
+  assert (reader != NULL);
+  assert (reader->valid_size == reader->size);
+  assert (reader->number_of_blocks > 4);
+  for (i = 0; i < reader->number_of_blocks; ++i)
+    {
+      assert (reader->blocks[i].first
+              == receipt_time ((int)records));
+      records += reader->blocks[i].records;
+      assert (reader->blocks[i].last
+              == receipt_time ((int)records - 1));
+    }
+  assert (records == NUM_EVENTS);
+
+  assert (lwes_journal_cursor_init (NULL, &cursor, 0, reader->size) == -1);
+  assert (lwes_journal_cursor_init (reader, NULL, 0, reader->size) == -1);
+  assert (lwes_journal_cursor_init (reader, &cursor, 2, 1) == -1);
+  assert (lwes_journal_cursor_next (NULL, &record) == -1);
+  assert (lwes_journal_cursor_seek (NULL, 0) == -1);
+
+  /* every record, with the events decoding from the mapping */
+  event = lwes_event_create_no_name (NULL);
+  assert (event != NULL);
+  assert (lwes_journal_cursor_init (reader, &cursor, 0, reader->size) == 0);
+  assert (lwes_journal_cursor_next (&cursor, NULL) == -1);
+  for (i = 0; i < NUM_EVENTS; ++i)
+    {
+      assert (lwes_journal_cursor_next (&cursor, &record) == 1);
+      check_record (&record, i);
+      assert (lwes_event_clear (event) == 0);
+      assert (lwes_event_from_bytes (event, record.bytes, record.length, 0,
+                                     &dtmp) == (int)record.length);
+      assert (lwes_event_get_INT_32 (event, "index", &index) == 0);
+      assert (index == i);
+    }
+  assert (lwes_journal_cursor_next (&cursor, &record) == 0);
+  assert (lwes_journal_cursor_next (&cursor, &record) == 0);
+  assert (lwes_event_destroy (event) == 0);
+
+  /* an empty range */
+  assert (lwes_journal_cursor_init (reader, &cursor, 1, 1) == 0);
+  assert (lwes_journal_cursor_next (&cursor, &record) == 0);
+
+  assert (lwes_journal_reader_close (reader) == 0);
+}
+
+static void
+test_seek (void)
+{
+  struct lwes_journal_reader *reader;
+  struct lwes_journal_cursor cursor;
+  struct lwes_journal_record record;
+  int targets[6] = { 1500, 0, NUM_EVENTS - 1, 700, 701, 2 };
+  int i;
+
+  reader = lwes_journal_reader_open (path);
+  assert (reader != NULL);
+  assert (lwes_journal_cursor_init (reader, &cursor, 0, reader->size) == 0);
+
+  /* forwards and backwards, to exact times and between them */
+  for (i = 0; i < 6; ++i)
+    {
+      assert (lwes_journal_cursor_seek (&cursor,
+                                        receipt_time (targets[i])) == 0);
+      assert (lwes_journal_cursor_next (&cursor, &record) == 1);
+      check_record (&record, targets[i]);
+      assert (lwes_journal_cursor_seek (&cursor,
+                                        receipt_time (targets[i]) - 1) == 0);
+      assert (lwes_journal_cursor_next (&cursor, &record) == 1);
+      check_record (&record, targets[i]);
+    }
+  assert (lwes_journal_cursor_seek (&cursor, 0) == 0);
+  assert (lwes_journal_cursor_next (&cursor, &record) == 1);
+  check_record (&record, 0);
+  assert (lwes_journal_cursor_seek (&cursor,
+                                    receipt_time (NUM_EVENTS)) == 0);
+  assert (lwes_journal_cursor_next (&cursor, &record) == 0);
+
+  /* within a range, a time before it stops at its first record */
+  assert (lwes_journal_cursor_init (reader, &cursor,
+                                    reader->blocks[2].offset,
+                                    reader->blocks[3].offset) == 0);
+  assert (lwes_journal_cursor_seek (&cursor, 0) == 0);
+  assert (lwes_journal_cursor_next (&cursor, &record) == 1);
+  assert (record.receipt_time == reader->blocks[2].first);
+  assert (lwes_journal_cursor_seek (&cursor, reader->blocks[3].first) == 0);
+  assert (lwes_journal_cursor_next (&cursor, &record) == 0);
+
+  assert (lwes_journal_reader_close (reader) == 0);
+}
+
+struct scan_args
+{
+  struct lwes_journal_reader *reader;
+  size_t begin;
+  size_t end;
+  int records;
+  int seen[NUM_EVENTS];
+};
+
+static void *
+scan_range (void *arg)
+{
+  struct scan_args *args = (struct scan_args *)arg;
+  struct lwes_journal_cursor cursor;
+  struct lwes_journal_record record;
+  int index;
+
+  assert (lwes_journal_cursor_init (args->reader, &cursor,
+                                    args->begin, args->end) == 0);
+  while (lwes_journal_cursor_next (&cursor, &record) == 1)
+    {
+      index = (int)((record.receipt_time - start) / 1000000);
+      check_record (&record, index);
+      args->seen[index]++;
+      args->records++;
+    }
+  return NULL;
+}
+
+/* equal byte ranges, which mostly split blocks, cover each block once */
+static void
+test_parallel (void)
+{
+  static struct scan_args args[NUM_THREADS];
+  struct lwes_journal_reader *reader;
+  pthread_t threads[NUM_THREADS];
+  int total = 0;
+  int i, t;
+
+  reader = lwes_journal_reader_open (path);
+  assert (reader != NULL);
+  for (t = 0; t < NUM_THREADS; ++t)
+    {
+      memset (&args[t], 0, sizeof (args[t]));
+      args[t].reader = reader;
+      args[t].begin = reader->size * t / NUM_THREADS;
+      args[t].end = reader->size * (t + 1) / NUM_THREADS;
+      assert (pthread_create (&threads[t], NULL, scan_range, &args[t]) == 0);
+    }
+  for (t = 0; t < NUM_THREADS; ++t)
+    {
+      assert (pthread_join (threads[t], NULL) == 0);
+      assert (args[t].records > 0);
+      total += args[t].records;
+    }
+  assert (total == NUM_EVENTS);
+  for (i = 0; i < NUM_EVENTS; ++i)
+    {
+      for (total = 0, t = 0; t < NUM_THREADS; ++t)
+        {
+          total += args[t].seen[i];
+        }
+      assert (total == 1);
+    }
+  assert (lwes_journal_reader_close (reader) == 0);
+}
+
+/* writes the first length bytes of the journal file to the copy, with
+   the byte at corrupt, if not 0, overwritten */
+static void
+write_copy (size_t length, size_t corrupt)
+{
+  static LWES_BYTE bytes[4 * 1024 * 1024];
+  FILE *fp;
+  size_t size;
+
+  fp = fopen (path, "rb");
+  assert (fp != NULL);
+  size = fread (bytes, 1, sizeof (bytes), fp);
+  fclose (fp);
+  assert (length <= size);
+  if (corrupt != 0)
+    {
+      bytes[corrupt] = 0xff;
+    }
+  fp = fopen (copy, "wb");
+  assert (fp != NULL);
+  assert (fwrite (bytes, 1, length, fp) == length);
+  fclose (fp);
+}
+
+static void
+test_damaged (void)
+{
+  struct lwes_journal_reader *reader;
+  struct lwes_journal_cursor cursor;
+  struct lwes_journal_record record;
+  size_t last_block;
+  size_t last_record = 0;
+  size_t size;
+  int blocks;
+  int i;
+
+  reader = lwes_journal_reader_open (path);
+  assert (reader != NULL);
+  size = reader->size;
+  blocks = reader->number_of_blocks;
+  last_block = reader->blocks[blocks - 1].offset;
+  /* the high byte of the length of the first block's last record */
+  assert (lwes_journal_cursor_init (reader, &cursor, 0, 1) == 0);
+  while (lwes_journal_cursor_next (&cursor, &record) == 1)
+    {
+      last_record = (size_t)(record.bytes - reader->map)
+                    - LWES_JOURNAL_RECORD_HEADER_SIZE;
+    }
+  assert (lwes_journal_reader_close (reader) == 0);
+
+  /* an empty file has no blocks */
+  write_copy (0, 0);
+  reader = lwes_journal_reader_open (copy);
+  assert (reader != NULL);
+  assert (reader->number_of_blocks == 0);
+  assert (lwes_journal_cursor_init (reader, &cursor, 0, reader->size) == 0);
+  assert (lwes_journal_cursor_next (&cursor, &record) == 0);
+  assert (lwes_journal_reader_close (reader) == 0);
+
+  /* a block cut short is left out */
+  write_copy (size - 1, 0);
+  reader = lwes_journal_reader_open (copy);
+  assert (reader != NULL);
+  assert (reader->number_of_blocks == blocks - 1);
+  assert (reader->valid_size == last_block);
+  assert (lwes_journal_reader_close (reader) == 0);
+
+  /* as is everything after a block header which does not add up */
+  write_copy (size, last_block + 4);
+  reader = lwes_journal_reader_open (copy);
+  assert (reader != NULL);
+  assert (reader->number_of_blocks == blocks - 1);
+  assert (lwes_journal_reader_close (reader) == 0);
+
+  /* a record running into the footer is malformed */
+  write_copy (size, last_record);
+  reader = lwes_journal_reader_open (copy);
+  assert (reader != NULL);
+  assert (reader->number_of_blocks == blocks);
+  assert (lwes_journal_cursor_init (reader, &cursor, 0, reader->size) == 0);
+  for (i = 0; lwes_journal_cursor_next (&cursor, &record) == 1; ++i)
+    {
+    }
+  assert (i == (int)reader->blocks[0].records - 1);
+  assert (lwes_journal_cursor_next (&cursor, &record) == -2);
+  assert (lwes_journal_cursor_seek (&cursor, start) == 0);
+  assert (lwes_journal_cursor_seek (&cursor, reader->blocks[0].last) == -2);
+  /* and the other blocks can still be read */
+  assert (lwes_journal_cursor_init (reader, &cursor, 1, reader->size) == 0);
+  for (i = 0; lwes_journal_cursor_next (&cursor, &record) == 1; ++i)
+    {
+    }
+  assert (i == NUM_EVENTS - (int)reader->blocks[0].records);
+  assert (lwes_journal_reader_close (reader) == 0);
+}
+
+static double
+elapsed_usec (struct timeval *begin)
+{
+  struct timeval now;
+  gettimeofday (&now, NULL);
+  return (now.tv_sec - begin->tv_sec) * 1000000.0
+           + (now.tv_usec - begin->tv_usec);
+}
+
+/* not a pass/fail test, just numbers for comparing reading records with
+   read() into a buffer with scanning the mapping */
+static void
+benchmark_scan (void)
+{
+  struct lwes_journal_reader *reader;
+  struct lwes_journal_cursor cursor;
+  struct lwes_journal_record record;
+  struct lwes_event *event;
+  struct lwes_event_deserialize_tmp dtmp;
+  struct timeval begin;
+  LWES_BYTE header[LWES_JOURNAL_BLOCK_HEADER_SIZE];
+  LWES_BYTE bytes[MAX_MSG_SIZE];
+  LWES_U_INT_32 block_length, count, footer;
+  LWES_U_INT_16 length;
+  size_t offset;
+  double records, copied, mapped, mapped_only;
+  FILE *fp;
+  int pass;
+  LWES_U_INT_32 i;
+
+  event = lwes_event_create_no_name (NULL);
+  assert (event != NULL);
+  records = (double)NUM_EVENTS * BENCH_PASSES;
+
+  gettimeofday (&begin, NULL);
+  for (pass = 0; pass < BENCH_PASSES; ++pass)
+    {
+      fp = fopen (path, "rb");
+      assert (fp != NULL);
+      while (fread (header, 1, sizeof (header), fp) == sizeof (header))
+        {
+          offset = 4;
+          unmarshall_U_INT_32 (&block_length, header, sizeof (header),
+                               &offset);
+          unmarshall_U_INT_32 (&count, header, sizeof (header), &offset);
+          unmarshall_U_INT_32 (&footer, header, sizeof (header), &offset);
+          for (i = 0; i < count; ++i)
+            {
+              assert (fread (bytes, 1, LWES_JOURNAL_RECORD_HEADER_SIZE, fp)
+                      == LWES_JOURNAL_RECORD_HEADER_SIZE);
+              offset = 0;
+              unmarshall_U_INT_16 (&length, bytes, sizeof (bytes), &offset);
+              assert (fread (bytes, 1, length, fp) == length);
+              lwes_event_clear (event);
+              lwes_event_from_bytes (event, bytes, length, 0, &dtmp);
+            }
+          fseek (fp, block_length - footer, SEEK_CUR);
+        }
+      fclose (fp);
+    }
+  copied = elapsed_usec (&begin);
+
+  reader = lwes_journal_reader_open (path);
+  assert (reader != NULL);
+  gettimeofday (&begin, NULL);
+  for (pass = 0; pass < BENCH_PASSES; ++pass)
+    {
+      lwes_journal_cursor_init (reader, &cursor, 0, reader->size);
+      while (lwes_journal_cursor_next (&cursor, &record) == 1)
+        {
+          lwes_event_clear (event);
+          lwes_event_from_bytes (event, record.bytes, record.length, 0,
+                                 &dtmp);
+        }
+    }
+  mapped = elapsed_usec (&begin);
+
+  gettimeofday (&begin, NULL);
+  for (pass = 0; pass < BENCH_PASSES; ++pass)
+    {
+      lwes_journal_cursor_init (reader, &cursor, 0, reader->size);
+      while (lwes_journal_cursor_next (&cursor, &record) == 1)
+        {
+        }
+    }
+  mapped_only = elapsed_usec (&begin);
+  assert (lwes_journal_reader_close (reader) == 0);
+  assert (lwes_event_destroy (event) == 0);
+
+  printf ("%d passes over %d records, thousand records per second\n",
+          BENCH_PASSES, NUM_EVENTS);
+  printf ("  read and decode   %12.1f\n", records * 1000 / (copied + 1));
+  printf ("  mapped and decode %12.1f\n", records * 1000 / (mapped + 1));
+  printf ("  mapped only       %12.1f\n", records * 1000 / (mapped_only + 1));
+}
+
+int main (void)
+{
+  remove_journal_files (prefix);
+  write_journal ();
+  test_scan ();
+  test_seek ();
+  test_parallel ();
+  test_damaged ();
+  benchmark_scan ();
+  remove_journal_files (prefix);
+  return 0;
+}
@@ -0,0 +1,231 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#include <assert.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lwes_listener_group.h"
+#include "lwes_emitter.h"
+
+const int   ucast_port      = 12365;
+const char *ucast_ip        = "127.0.0.1";
+const char *mcast_ip        = "224.0.0.254";
+
+LWES_SHORT_STRING eventname = (LWES_SHORT_STRING)"TypeChecker";
+LWES_SHORT_STRING key       = (LWES_SHORT_STRING)"anInt32";
+const char *esffile         = "testeventtypedb.esf";
+
+#define NUM_WORKERS  4
+#define NUM_EMITTERS 8
+#define NUM_EVENTS   50
+
+static int total = 0;
+static int per_worker[NUM_WORKERS];
+static int bad = 0;
+
+static void callback (struct lwes_event *event,
+                      unsigned int worker,
+                      void *data)
+{
+  LWES_INT_32 value;
+  LWES_IP_ADDR sender;
+
+  if (data != (void *)&total
+      || worker >= NUM_WORKERS
+      || strcmp (event->eventName, (char *)eventname) != 0
+      || lwes_event_get_INT_32 (event, key, &value) != 0
+      || value < 0 || value >= NUM_EVENTS
+      || lwes_event_get_IP_ADDR (event, (LWES_SHORT_STRING)"SenderIP",
+                                 &sender) != 0)
+    {
+      __atomic_fetch_add (&bad, 1, __ATOMIC_SEQ_CST);
+      return;
+    }
+  __atomic_fetch_add (&per_worker[worker], 1, __ATOMIC_SEQ_CST);
+  __atomic_fetch_add (&total, 1, __ATOMIC_SEQ_CST);
+}
+
+static void test_group (void)
+{
+  struct lwes_listener_group *group;
+  struct lwes_emitter *emitters[NUM_EMITTERS];
+  struct lwes_event *event;
+  LWES_INT_64 received = 0;
+  int i;
+  int j;
+
+  group = lwes_listener_group_create ((char *) ucast_ip, NULL,
+                                      ucast_port, NUM_WORKERS, 1,
+                                      callback, &total);
+  assert (group != NULL);
+  assert (group->num_workers == NUM_WORKERS);
+  for (i = 0; i < NUM_WORKERS; i++)
+    {
+      assert (group->workers[i].listener != NULL);
+      assert (group->workers[i].listener->connection.socketfd
+              != group->workers[(i + 1) % NUM_WORKERS]
+                   .listener->connection.socketfd);
+    }
+
+  /* several emitters so the kernel has several senders to spread */
+  event = lwes_event_create (NULL, eventname);
+  assert (event != NULL);
+  for (i = 0; i < NUM_EMITTERS; i++)
+    {
+      emitters[i] = lwes_emitter_create ((char *) ucast_ip, NULL,
+                                         ucast_port, 0, 60);
+      assert (emitters[i] != NULL);
+    }
+  for (j = 0; j < NUM_EVENTS; j++)
+    {
+      assert (lwes_event_set_INT_32 (event, key, j) == 1);
+      for (i = 0; i < NUM_EMITTERS; i++)
+        {
+          assert (lwes_emitter_emit (emitters[i], event) == 0);
+        }
+    }
+
+  for (i = 0;
+       i < 5000
+         && __atomic_load_n (&total, __ATOMIC_SEQ_CST)
+              < NUM_EMITTERS * NUM_EVENTS;
+       i++)
+    {
+      usleep (1000);
+    }
+  assert (total == NUM_EMITTERS * NUM_EVENTS);
+  assert (bad == 0);
+
+  for (i = 0; i < NUM_WORKERS; i++)
+    {
+      assert (group->workers[i].received == per_worker[i]);
+      assert (group->workers[i].errors == 0);
+      received += group->workers[i].received;
+    }
+  assert (received == NUM_EMITTERS * NUM_EVENTS);
+
+  for (i = 0; i < NUM_EMITTERS; i++)
+    {
+      lwes_emitter_destroy (emitters[i]);
+    }
+  lwes_event_destroy (event);
+  assert (lwes_listener_group_destroy (group) == 0);
+}
+
+static int validated = 0;
+
+static void db_callback (struct lwes_event *event,
+                         unsigned int worker,
+                         void *data)
+{
+  (void)event;
+  (void)worker;
+  (void)data;
+  __atomic_fetch_add (&validated, 1, __ATOMIC_SEQ_CST);
+}
+
+/* events which do not match the group's db are counted as errors */
+static void test_db (void)
+{
+  struct lwes_listener_group *group;
+  struct lwes_event_type_db *db;
+  struct lwes_emitter *emitter;
+  struct lwes_event *good;
+  struct lwes_event *bad_event;
+  int i;
+
+  db = lwes_event_type_db_create ((char *) esffile);
+  assert (db != NULL);
+  group = lwes_listener_group_create_with_db ((char *) ucast_ip, NULL,
+                                              ucast_port, db, 1, 0,
+                                              db_callback, NULL);
+  assert (group != NULL);
+  assert (group->workers[0].event != NULL);
+  assert (group->workers[0].event->type_db == db);
+
+  emitter = lwes_emitter_create ((char *) ucast_ip, NULL, ucast_port, 0, 60);
+  assert (emitter != NULL);
+  good = lwes_event_create (db, eventname);
+  assert (good != NULL);
+  assert (lwes_event_set_INT_32 (good, key, 1) == 1);
+  bad_event = lwes_event_create (NULL, eventname);
+  assert (bad_event != NULL);
+  assert (lwes_event_set_INT_32 (bad_event, "notDeclared", 1) == 1);
+
+  for (i = 0; i < NUM_EVENTS; i++)
+    {
+      assert (lwes_emitter_emit (emitter, good) == 0);
+      assert (lwes_emitter_emit (emitter, bad_event) == 0);
+    }
+  for (i = 0;
+       i < 5000
+         && group->workers[0].received + group->workers[0].errors
+              < 2 * NUM_EVENTS;
+       i++)
+    {
+      usleep (1000);
+    }
+  assert (group->workers[0].received == NUM_EVENTS);
+  assert (group->workers[0].errors == NUM_EVENTS);
+  assert (validated == NUM_EVENTS);
+
+  lwes_event_destroy (good);
+  lwes_event_destroy (bad_event);
+  lwes_emitter_destroy (emitter);
+  assert (lwes_listener_group_destroy (group) == 0);
+  lwes_event_type_db_destroy (db);
+}
+
+static void test_failures (void)
+{
+  struct lwes_listener_group *group;
+
+  /* need a callback */
+  assert (lwes_listener_group_create ((char *) ucast_ip, NULL,
+                                      ucast_port, 2, 0, NULL, NULL)
+          == NULL);
+
+  /* bad address */
+  assert (lwes_listener_group_create ((char *) "not an address", NULL,
+                                      ucast_port, 2, 0, callback, NULL)
+          == NULL);
+
+  /* multicast would duplicate every packet */
+  assert (lwes_listener_group_create ((char *) mcast_ip, NULL,
+                                      ucast_port, 2, 0, callback, NULL)
+          == NULL);
+
+  /* but a single worker is fine */
+  group = lwes_listener_group_create ((char *) mcast_ip, NULL,
+                                      ucast_port, 1, 0, callback, NULL);
+  assert (group != NULL);
+  assert (lwes_listener_group_destroy (group) == 0);
+
+  /* 0 workers means one per cpu */
+  group = lwes_listener_group_create ((char *) ucast_ip, NULL,
+                                      ucast_port, 0, 0, callback, NULL);
+  assert (group != NULL);
+  assert (group->num_workers == (unsigned int)sysconf (_SC_NPROCESSORS_ONLN));
+  assert (lwes_listener_group_destroy (group) == 0);
+
+  assert (lwes_listener_group_destroy (NULL) == -1);
+}
+
+int main (void)
+{
+  test_group ();
+  test_db ();
+  test_failures ();
+
+  return 0;
+}
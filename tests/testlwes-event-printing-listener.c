@@ -379,41 +379,41 @@ check_event_1 (void)
   const char *output =
     "TypeChecker[15]\n"
     "{\n"
+    "\taString = \"http://www.test.com\";\n"
+    "\taBoolean = true;\n"
     "\tanIPAddress = 224.0.0.100;\n"
+    "\taUInt16 = 65535;\n"
     "\tanInt16 = -1;\n"
-    "\tanInt64 = -1;\n"
-    "\tReceiptTime = \1\1\1\1\1\1\1\1\1\1\1\1\1;\n"
-    "\tSenderIP = \1\1\1\1\1\1\1\1\1;\n"
     "\taUInt32 = 4294967295;\n"
-    "\tstring_null_array = [ , \"a\", , \"ccc\",  ];\n"
-    "\taUInt16 = 65535;\n"
+    "\tanInt32 = -1;\n"
     "\taUInt64 = 18446744073709551615;\n"
-    "\tSenderPort = \1\1\1\1\1;\n"
+    "\tanInt64 = -1;\n"
     "\tuint16_array = [ 123, 234, 345 ];\n"
-    "\taBoolean = true;\n"
-    "\taString = \"http://www.test.com\";\n"
     "\tstring_array = [ \"a\", \"bb\", \"ccc\", \"d\" ];\n"
-    "\tanInt32 = -1;\n"
+    "\tstring_null_array = [ , \"a\", , \"ccc\",  ];\n"
+    "\tReceiptTime = \1\1\1\1\1\1\1\1\1\1\1\1\1;\n"
+    "\tSenderIP = \1\1\1\1\1\1\1\1\1;\n"
+    "\tSenderPort = \1\1\1\1\1;\n"
     "}\n"
 
     "ArrayTestEvent[16]\n"
     "{\n"
     "\tend = \"This is the end field.\";\n"
-    "\tuint16Ar = [ 1, 2, 3, 5, 7, 11, 13 ];\n"
-    "\tReceiptTime = \1\1\1\1\1\1\1\1\1\1\1\1\1;\n"
     "\tstringNAr = [ \"a\", , \"bb\", , \"ccc\", , \"dddd\",  ];\n"
-    "\tSenderIP = \1\1\1\1\1\1\1\1\1;\n"
-    "\tx_svc_versions = \"gateway/11.117.0\";\n"
-    "\te_version = 90136;\n"
+    "\tuint16NAr = [ 1, 2, , 3, , 5, , 7, , , , 11, , 13 ];\n"
     "\tstringAr = [ \"won\", \"too\", \"Free\", \"for\" ];\n"
-    "\tx_app_name = \"gateway\";\n"
+    "\tuint16Ar = [ 1, 2, 3, 5, 7, 11, 13 ];\n"
+    "\tdub = 3.141593;\n"
+    "\tfloating = 602000017271895229464576.000000;\n"
+    "\tbite = 42;\n"
     "\tstart = \"This is the start field.\";\n"
+    "\tx_svc_versions = \"gateway/11.117.0\";\n"
+    "\tx_app_name = \"gateway\";\n"
     "\te_id = -6772852554325794715;\n"
+    "\te_version = 90136;\n"
+    "\tReceiptTime = \1\1\1\1\1\1\1\1\1\1\1\1\1;\n"
+    "\tSenderIP = \1\1\1\1\1\1\1\1\1;\n"
     "\tSenderPort = \1\1\1\1\1;\n"
-    "\tbite = 42;\n"
-    "\tfloating = 602000017271895229464576.000000;\n"
-    "\tuint16NAr = [ 1, 2, , 3, , 5, , 7, , , , 11, , 13 ];\n"
-    "\tdub = 3.141593;\n"
     "}\n";
 
   fork_and_wait (NORMAL_ARGC, NORMAL_ARGV, 500, TRUE, TRUE, TRUE, output, NULL);
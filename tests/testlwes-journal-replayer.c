@@ -0,0 +1,201 @@
+/*======================================================================*
+ * Copyright (c) 2008, Yahoo! Inc. All rights reserved.                 *
+ *                                                                      *
+ * Licensed under the New BSD License (the "License"); you may not use  *
+ * this file except in compliance with the License.  Unless required    *
+ * by applicable law or agreed to in writing, software distributed      *
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT        *
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.     *
+ * See the License for the specific language governing permissions and  *
+ * limitations under the License. See accompanying LICENSE file.        *
+ *======================================================================*/
+
+#include <assert.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lwes_listener.h"
+#include "lwes_journal.h"
+#include "testjournalhelpers.h"
+
+int lwes_journal_replayer_main (int argc, char *argv[]);
+
+#define main lwes_journal_replayer_main
+#include "lwes-journal-replayer.c"
+#undef main
+
+#define NUM_EVENTS 100
+
+static const char TEST_ADDRESS[] = "224.1.1.103";
+static const char TEST_PORT[] = "9131";
+static const char prefix[] = "testlwes-journal-replayer.tmp";
+
+/* the events are received 2 milliseconds apart */
+static const LWES_INT_64 gap = 2000000LL;
+
+static char path[FILENAME_MAX];
+static LWES_BYTE events[NUM_EVENTS][TEST_JOURNAL_EVENT_SIZE];
+static size_t lengths[NUM_EVENTS];
+
+static struct lwes_event *
+build_event (int index)
+{
+  struct lwes_event *event;
+
+  event = lwes_event_create (NULL, "Replayed");
+  assert (event != NULL);
+  assert (lwes_event_set_INT_32 (event, "index", index) == 1);
+  return event;
+}
+
+static int
+run (const char *option)
+{
+  const char *argv[10];
+  int argc = 0;
+
+  argv[argc++] = "lwes-journal-replayer";
+  argv[argc++] = "-m";
+  argv[argc++] = TEST_ADDRESS;
+  argv[argc++] = "-p";
+  argv[argc++] = TEST_PORT;
+  argv[argc++] = "-q";
+  if (option != NULL)
+    {
+      argv[argc++] = option;
+    }
+  argv[argc++] = path;
+  argv[argc] = NULL;
+
+  optind = 1;
+  return lwes_journal_replayer_main (argc, (char **)argv);
+}
+
+/* every event arrives, in order and as it was journaled */
+static void
+receive_all (struct lwes_listener *listener)
+{
+  LWES_BYTE bytes[MAX_MSG_SIZE];
+  int n;
+  int i;
+
+  for (i = 0; i < NUM_EVENTS; ++i)
+    {
+      n = lwes_listener_recv_bytes_by (listener, bytes, MAX_MSG_SIZE, 1000);
+      assert (n == (int)lengths[i]);
+      assert (memcmp (bytes, events[i], lengths[i]) == 0);
+    }
+  assert (lwes_listener_recv_bytes_by (listener, bytes,
+                                       MAX_MSG_SIZE, 10) < 0);
+}
+
+static void
+test_schedule (void)
+{
+  struct replay replay;
+  LWES_INT_64 due;
+  LWES_INT_64 now;
+  int i;
+
+  memset (&replay, 0, sizeof (replay));
+  replay.capture_start = 1000;
+  replay.replay_start = 5000;
+  replay.speedup = 1;
+  assert (replay_due (&replay, 1000) == 5000);
+  assert (replay_due (&replay, 3000) == 7000);
+  replay.speedup = 4;
+  assert (replay_due (&replay, 9000) == 7000);
+  replay.speedup = 0.5;
+  assert (replay_due (&replay, 3000) == 9000);
+  replay.speedup = 0;
+  assert (replay_due (&replay, 3000) == 5000);
+
+  /* sleeping, then spinning, to the due time */
+  replay.spin_nsec = REPLAY_MIN_SPIN_NSEC;
+  for (i = 0; i < 10; ++i)
+    {
+      due = replay_now () + 3000000;
+      now = replay_wait_until (&replay, due);
+      assert (now >= due);
+      assert (now - due < 20000000);
+      assert (replay.spin_nsec >= REPLAY_MIN_SPIN_NSEC);
+      assert (replay.spin_nsec <= REPLAY_MAX_SPIN_NSEC);
+    }
+  due = replay_now () + REPLAY_MIN_SPIN_NSEC / 2;
+  assert (replay_wait_until (&replay, due) >= due);
+  due = replay_now () - 1000;
+  assert (replay_wait_until (&replay, due) >= due);
+}
+
+static void
+test_replay (void)
+{
+  struct lwes_listener *listener;
+  LWES_INT_64 start;
+  LWES_INT_64 elapsed;
+  LWES_INT_64 span = (NUM_EVENTS - 1) * gap;
+
+  listener = lwes_listener_create ((LWES_SHORT_STRING) TEST_ADDRESS, NULL,
+                                   (LWES_U_INT_32) atoi (TEST_PORT));
+  assert (listener != NULL);
+
+  /* as fast as possible, one event at a time and in batches */
+  start = replay_now ();
+  assert (run ("-f") == 0);
+  assert (replay_now () - start < span);
+  receive_all (listener);
+  assert (run ("-fb1") == 0);
+  receive_all (listener);
+
+  /* at the original timing, and sped up */
+  start = replay_now ();
+  assert (run (NULL) == 0);
+  elapsed = replay_now () - start;
+  assert (elapsed >= span);
+  receive_all (listener);
+
+  start = replay_now ();
+  assert (run ("-r4") == 0);
+  elapsed = replay_now () - start;
+  assert (elapsed >= span / 4);
+  assert (elapsed < span);
+  receive_all (listener);
+
+  assert (lwes_listener_destroy (listener) == 0);
+}
+
+static void
+test_errors (void)
+{
+  const char *argv[3];
+
+  argv[0] = "lwes-journal-replayer";
+  argv[1] = NULL;
+  optind = 1;
+  assert (lwes_journal_replayer_main (1, (char **)argv) == 1);
+  argv[1] = "-h";
+  optind = 1;
+  assert (lwes_journal_replayer_main (2, (char **)argv) == 1);
+  argv[1] = "-z";
+  optind = 1;
+  assert (lwes_journal_replayer_main (2, (char **)argv) == 1);
+
+  assert (run ("-r0") == 1);
+  assert (run ("-b0") == 1);
+  assert (run ("-b65") == 1);
+
+  strcpy (path, "testlwes-journal-replayer.tmp.missing");
+  assert (run (NULL) == 1);
+}
+
+int main (void)
+{
+  remove_journal_files (prefix);
+  write_journal_file (prefix, 0, NUM_EVENTS, build_event,
+                      1225497599000000000LL, gap, events, lengths, path);
+  test_schedule ();
+  test_replay ();
+  test_errors ();
+  remove_journal_files (prefix);
+  return 0;
+}
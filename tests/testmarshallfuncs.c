@@ -18,6 +18,7 @@
 #include <assert.h>
 
 #include <sys/types.h>
+#include <sys/time.h>
 #include <netinet/in.h>
 #include <arpa/inet.h> /* for inet_addr below */
 
@@ -95,6 +96,297 @@ static LWES_BYTE scratch[512];
 static LWES_BYTE bad_short_string1[1]  = {0x01};
 static LWES_BYTE bad_long_string1 [2]  = {0x00, 0x01};
 
+#define SWAP_MAX_ELEMENTS 67
+#define BENCH_ELEMENTS 4096
+#define BENCH_ITERATIONS 2000
+
+static const LWES_BYTE swap_array_types[] = {
+  LWES_TYPE_BYTE_ARRAY,
+  LWES_TYPE_U_INT_16_ARRAY,
+  LWES_TYPE_INT_16_ARRAY,
+  LWES_TYPE_U_INT_32_ARRAY,
+  LWES_TYPE_INT_32_ARRAY,
+  LWES_TYPE_FLOAT_ARRAY,
+  LWES_TYPE_U_INT_64_ARRAY,
+  LWES_TYPE_INT_64_ARRAY,
+  LWES_TYPE_DOUBLE_ARRAY
+};
+
+/* the element by element encoding the bulk conversion must match */
+static size_t
+marshall_elements (LWES_BYTE baseType, LWES_BYTE *values, int count,
+                   LWES_BYTE *bytes, size_t length)
+{
+  size_t offset = 0;
+  int delta = lwes_type_to_size (baseType);
+  int i;
+
+  for (i = 0; i < count; ++i)
+    {
+      assert (marshall_generic (baseType, values + i * delta,
+                                bytes, length, &offset));
+    }
+  return offset;
+}
+
+static void
+check_swap_kernels (const struct lwes_swap_kernels *kernels)
+{
+  static LWES_BYTE values[SWAP_MAX_ELEMENTS * 8 + 1];
+  static LWES_BYTE expected[SWAP_MAX_ELEMENTS * 8];
+  static LWES_BYTE swapped[SWAP_MAX_ELEMENTS * 8 + 2];
+  static LWES_BYTE back[SWAP_MAX_ELEMENTS * 8];
+  LWES_BYTE baseTypes[3] = { LWES_TYPE_U_INT_16, LWES_TYPE_U_INT_32,
+                             LWES_TYPE_U_INT_64 };
+  lwes_swap_function swaps[3];
+  size_t length;
+  int i, t, count;
+
+  swaps[0] = kernels->swap_16;
+  swaps[1] = kernels->swap_32;
+  swaps[2] = kernels->swap_64;
+  for (i = 0; i < (int)sizeof (values); ++i)
+    {
+      values[i] = (LWES_BYTE)(i * 37 + 11);
+    }
+
+  /* every length around the vector widths, and unaligned buffers */
+  for (t = 0; t < 3; ++t)
+    {
+      for (count = 0; count <= SWAP_MAX_ELEMENTS; ++count)
+        {
+          length = marshall_elements (baseTypes[t], values, count,
+                                      expected, sizeof (expected));
+          memset (swapped, 0, sizeof (swapped));
+          swaps[t] (swapped + 1, values, count);
+          assert (memcmp (swapped + 1, expected, length) == 0);
+          assert (swapped[length + 1] == 0);
+          swaps[t] (back, swapped + 1, count);
+          assert (memcmp (back, values, length) == 0);
+          swaps[t] (swapped, values + 1, count);
+          swaps[t] (back, swapped, count);
+          assert (memcmp (back, values + 1, length) == 0);
+        }
+    }
+}
+
+static void
+test_swap_arrays (void)
+{
+  static LWES_BYTE values[SWAP_MAX_ELEMENTS * 8];
+  static LWES_BYTE bytes[SWAP_MAX_ELEMENTS * 8 + 64];
+  static LWES_BYTE expected[SWAP_MAX_ELEMENTS * 8 + 64];
+  struct lwes_event_attribute attr;
+  LWES_BYTE baseType;
+  size_t offset, length;
+  int i, t, count;
+
+  check_swap_kernels (&lwes_swap_scalar);
+#ifdef LWES_SWAP_X86
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("sse2"))
+    {
+      check_swap_kernels (&lwes_swap_sse2);
+    }
+  if (__builtin_cpu_supports ("avx2"))
+    {
+      check_swap_kernels (&lwes_swap_avx2);
+    }
+#endif
+  assert (lwes_swap_select () == lwes_swap_select ());
+
+  for (i = 0; i < (int)sizeof (values); ++i)
+    {
+      values[i] = (LWES_BYTE)(i * 53 + 7);
+    }
+
+  /* whole arrays encode as they always did, and decode back */
+  for (t = 0; t < (int)sizeof (swap_array_types); ++t)
+    {
+      baseType = lwes_array_type_to_base (swap_array_types[t]);
+      for (count = 0; count <= SWAP_MAX_ELEMENTS; count += 3)
+        {
+          offset = 0;
+          assert (marshall_U_INT_16 ((LWES_U_INT_16)count, expected,
+                                     sizeof (expected), &offset));
+          length = offset + marshall_elements (baseType, values, count,
+                                               expected + offset,
+                                               sizeof (expected) - offset);
+
+          attr.type = swap_array_types[t];
+          attr.array_len = (LWES_U_INT_16)count;
+          attr.value = values;
+          offset = 0;
+          assert (marshall_array_attribute (&attr, bytes, sizeof (bytes),
+                                            &offset) == (int)length);
+          assert (offset == length);
+          assert (memcmp (bytes, expected, length) == 0);
+
+          /* one byte short fails */
+          offset = 0;
+          assert (marshall_array_attribute (&attr, bytes, length - 1,
+                                            &offset) == 0);
+
+          attr.value = NULL;
+          offset = 0;
+          if (count == 0)
+            {
+              /* there is nothing to allocate for an empty array */
+              assert (unmarshall_array_attribute (&attr, bytes, length,
+                                                  &offset) == 0);
+              continue;
+            }
+          assert (unmarshall_array_attribute (&attr, bytes, length,
+                                              &offset) == (int)length);
+          assert (offset == length);
+          assert (attr.array_len == count);
+          assert (memcmp (attr.value, values,
+                          count * lwes_type_to_size (baseType)) == 0);
+          free (attr.value);
+
+          attr.value = NULL;
+          offset = 0;
+          assert (unmarshall_array_attribute (&attr, bytes, length - 1,
+                                              &offset) == 0);
+          assert (attr.value == NULL);
+        }
+    }
+}
+
+static void
+test_swap_nullable_arrays (void)
+{
+  LWES_INT_32 values[10] = { 1, -2, 3, -4, 5, -6, 7, -8, 9, -10 };
+  LWES_INT_32 *pointers[10];
+  LWES_INT_32 **decoded;
+  LWES_BYTE bytes[128];
+  struct lwes_event_attribute attr;
+  size_t offset = 0;
+  int i, length;
+
+  for (i = 0; i < 10; ++i)
+    {
+      pointers[i] = (i % 3 == 0) ? NULL : &values[i];
+    }
+  attr.type = LWES_TYPE_N_INT_32_ARRAY;
+  attr.array_len = 10;
+  attr.value = pointers;
+  assert (marshall_array_attribute (&attr, bytes, sizeof (bytes), &offset));
+  length = (int)offset;
+  assert (length == 2 + 2 + 2 + 6 * 4);
+
+  attr.value = NULL;
+  offset = 0;
+  assert (unmarshall_array_attribute (&attr, bytes, length, &offset));
+  assert (offset == (size_t)length);
+  decoded = (LWES_INT_32 **)attr.value;
+  for (i = 0; i < 10; ++i)
+    {
+      if (i % 3 == 0)
+        {
+          assert (decoded[i] == NULL);
+        }
+      else
+        {
+          assert (*decoded[i] == values[i]);
+        }
+    }
+  free (attr.value);
+
+  attr.value = NULL;
+  offset = 0;
+  assert (unmarshall_array_attribute (&attr, bytes, length - 1, &offset)
+          == 0);
+  assert (attr.value == NULL);
+}
+
+static double
+elapsed_usec (struct timeval *start)
+{
+  struct timeval now;
+  gettimeofday (&now, NULL);
+  return (now.tv_sec - start->tv_sec) * 1000000.0
+           + (now.tv_usec - start->tv_usec);
+}
+
+/* not a pass/fail test, just numbers for comparing element by element
+   encoding with the bulk conversion, for each type */
+static void
+benchmark_swap_arrays (void)
+{
+  static LWES_BYTE values[BENCH_ELEMENTS * 8];
+  static LWES_BYTE bytes[BENCH_ELEMENTS * 8 + 2];
+  struct lwes_event_attribute attr;
+  struct timeval start;
+  LWES_BYTE baseType;
+  size_t offset;
+  double elements, encode, bulk, decode, bulk_decode;
+  int delta, i, j, t;
+
+  memset (values, 0x5a, sizeof (values));
+  elements = (double)BENCH_ELEMENTS * BENCH_ITERATIONS;
+  printf ("%d arrays of %d elements, million elements per second "
+          "(bulk kernels: %s)\n",
+          BENCH_ITERATIONS, BENCH_ELEMENTS, lwes_swap_select ()->name);
+  printf ("  %-12s %12s %12s %12s %12s\n", "type",
+          "encode", "bulk encode", "decode", "bulk decode");
+
+  for (t = 0; t < (int)sizeof (swap_array_types); ++t)
+    {
+      baseType = lwes_array_type_to_base (swap_array_types[t]);
+
+      gettimeofday (&start, NULL);
+      for (i = 0; i < BENCH_ITERATIONS; ++i)
+        {
+          marshall_elements (baseType, values, BENCH_ELEMENTS,
+                             bytes, sizeof (bytes));
+        }
+      encode = elapsed_usec (&start);
+
+      attr.type = swap_array_types[t];
+      attr.array_len = BENCH_ELEMENTS;
+      attr.value = values;
+      gettimeofday (&start, NULL);
+      for (i = 0; i < BENCH_ITERATIONS; ++i)
+        {
+          offset = 0;
+          assert (marshall_array_attribute (&attr, bytes, sizeof (bytes),
+                                            &offset));
+        }
+      bulk = elapsed_usec (&start);
+
+      gettimeofday (&start, NULL);
+      for (i = 0; i < BENCH_ITERATIONS; ++i)
+        {
+          attr.value = NULL;
+          offset = 0;
+          assert (unmarshall_array_attribute (&attr, bytes, sizeof (bytes),
+                                              &offset));
+          free (attr.value);
+        }
+      bulk_decode = elapsed_usec (&start);
+
+      delta = lwes_type_to_size (baseType);
+      gettimeofday (&start, NULL);
+      for (i = 0; i < BENCH_ITERATIONS; ++i)
+        {
+          offset = 2;
+          for (j = 0; j < BENCH_ELEMENTS; ++j)
+            {
+              assert (unmarshall_generic (baseType, values + j * delta, delta,
+                                          bytes, sizeof (bytes), &offset));
+            }
+        }
+      decode = elapsed_usec (&start);
+
+      printf ("  %-12s %12.1f %12.1f %12.1f %12.1f\n",
+              lwes_type_to_string (swap_array_types[t]),
+              elements / (encode + 1), elements / (bulk + 1),
+              elements / (decode + 1), elements / (bulk_decode + 1));
+    }
+}
+
+
 static void test_typefuncs() 
 {
   assert(LWES_TYPE_UNDEFINED == lwes_string_to_type(LWES_UNDEFINED_STRING));
@@ -821,6 +1113,9 @@ int main(void)
   null_at=0;
   malloc_count=0;
 
+  test_swap_arrays ();
+  test_swap_nullable_arrays ();
+  benchmark_swap_arrays ();
 
   return 0;
 }
@@ -381,6 +381,9 @@ static void test_null_args (void)
   assert (lwes_net_send_bytes (NULL, buffer, 45) == -1);
   assert (lwes_net_send_bytes (&connection, NULL, 45) == -1);
 
+  assert (lwes_net_send_bytes_batch (NULL, NULL, NULL, 1) == -1);
+  assert (lwes_net_send_bytes_batch (&connection, NULL, NULL, 1) == -1);
+
   assert (lwes_net_sendto_bytes (NULL,
                                  (char*)mcast_ip,
                                  (char*)mcast_iface,
@@ -402,6 +405,10 @@ static void test_null_args (void)
 
   assert (lwes_net_recv_bytes_by (NULL, buffer, 500, 10000) == -1);
   assert (lwes_net_recv_bytes_by (&connection, NULL, 500, 10000) == -1);
+
+  assert (lwes_net_recv_bytes_batch (NULL, NULL, 500, NULL, NULL, 1) == -1);
+  assert (lwes_net_recv_bytes_batch_by (NULL, NULL, 500, NULL, NULL,
+                                        1, 10000) == -1);
 }
 
 static void
@@ -818,6 +825,200 @@ test_large_send ()
   lwes_net_close (&connection);
 }
 
+static void
+test_send_batch (void)
+{
+  struct lwes_net_connection connection;
+  struct lwes_net_connection receiver;
+  LWES_BYTE buffer[500];
+  LWES_BYTE_P bufs[LWES_NET_MAX_BATCH + 1];
+  size_t lens[LWES_NET_MAX_BATCH + 1];
+  LWES_BYTE recv_buffer[3][500];
+  LWES_BYTE_P recv_bufs[3];
+  size_t recv_lens[3];
+  struct sockaddr_in senders[3];
+  unsigned int i;
+  unsigned int got;
+  int n;
+
+  for (i = 0; i < 500; i++)
+    {
+      buffer[i] = (LWES_BYTE) i;
+    }
+  for (i = 0; i < LWES_NET_MAX_BATCH + 1; i++)
+    {
+      bufs[i] = buffer;
+      lens[i] = 45 + i;
+    }
+
+  assert (lwes_net_open (&connection,
+                         (char *)mcast_ip,
+                         (char *)mcast_iface,
+                         (int)mcast_port) == 0);
+  assert (lwes_net_open (&receiver,
+                         (char *)mcast_ip,
+                         (char *)mcast_iface,
+                         (int)mcast_port) == 0);
+  assert (lwes_net_recv_bind (&receiver) == 0);
+
+  assert (lwes_net_send_bytes_batch (&connection, bufs, lens, 0) == 0);
+  assert (lwes_net_send_bytes_batch (&connection, bufs, lens, 3) == 3);
+
+  /* receive them back, all of them could come in a single call */
+  for (i = 0; i < 3; i++)
+    {
+      recv_bufs[i] = recv_buffer[i];
+    }
+  for (got = 0; got < 3; got += n)
+    {
+      unsigned int j;
+      n = lwes_net_recv_bytes_batch_by (&receiver,
+                                        recv_bufs + got, 500,
+                                        recv_lens + got, senders + got,
+                                        3 - got, 1000);
+      assert (n > 0);
+      for (j = got; j < got + n; j++)
+        {
+          assert (recv_lens[j] == 45 + j);
+          assert (memcmp (recv_buffer[j], buffer, recv_lens[j]) == 0);
+        }
+    }
+  assert (lwes_net_recv_bytes_batch_by (&receiver, recv_bufs, 500,
+                                        recv_lens, senders, 3, 10) == -2);
+  lwes_net_close (&receiver);
+
+  /* never more than LWES_NET_MAX_BATCH in a call */
+  assert (lwes_net_send_bytes_batch (&connection, bufs, lens,
+                                     LWES_NET_MAX_BATCH + 1)
+          == LWES_NET_MAX_BATCH);
+  lwes_net_close (&connection);
+}
+
+#if defined(HAVE_LINUX_FILTER_H) && defined(SO_ATTACH_FILTER)
+/* sends a datagram holding just an event name */
+static void
+send_name
+  (struct lwes_net_connection *connection,
+   const char *name)
+{
+  LWES_BYTE buffer[300];
+  size_t length = strlen (name);
+
+  buffer[0] = (LWES_BYTE)length;
+  memcpy (buffer + 1, name, length);
+  /* something where the attribute count would be */
+  buffer[length + 1] = 0;
+  buffer[length + 2] = 0;
+  assert (lwes_net_send_bytes (connection, buffer, length + 3) > 0);
+}
+
+/* receives datagrams until none are left, checking they have the expected
+   names, in order */
+static void
+expect_names
+  (struct lwes_net_connection *receiver,
+   const char *const *names,
+   unsigned int count)
+{
+  LWES_BYTE buffer[500];
+  unsigned int i;
+  int n;
+
+  for (i = 0; i < count; i++)
+    {
+      n = lwes_net_recv_bytes_by (receiver, buffer, sizeof (buffer), 1000);
+      assert (n == (int)strlen (names[i]) + 3);
+      assert (buffer[0] == strlen (names[i]));
+      assert (memcmp (buffer + 1, names[i], buffer[0]) == 0);
+    }
+  assert (lwes_net_recv_bytes_by (receiver, buffer, sizeof (buffer), 10)
+          < 0);
+}
+#endif
+
+static void
+test_name_filter (void)
+{
+  struct lwes_net_connection connection;
+  struct lwes_net_connection receiver;
+  const char *wanted[] = { "Exact", "Abc", "Abcdefg", "Click::*" };
+  const char *received[] = { "Exact", "Abc", "Abcdefg", "Click::Buy",
+                             "Click::A::B" };
+  const char *everything[] = { "Exac", "Exact" };
+  const char *bad[] = { "Exact", "" };
+  const char *too_long[40];
+  LWES_BYTE one_byte = 5;
+  char long_name[256];
+  unsigned int i;
+
+  assert (lwes_net_open (&connection,
+                         (char *)mcast_ip,
+                         (char *)mcast_iface,
+                         (int)mcast_port) == 0);
+  assert (lwes_net_open (&receiver,
+                         (char *)mcast_ip,
+                         (char *)mcast_iface,
+                         (int)mcast_port) == 0);
+  assert (lwes_net_recv_bind (&receiver) == 0);
+
+  assert (lwes_net_set_name_filter (NULL, wanted, 4) == -1);
+  assert (lwes_net_set_name_filter (&receiver, NULL, 4) == -1);
+
+#if defined(HAVE_LINUX_FILTER_H) && defined(SO_ATTACH_FILTER)
+  /* removing a filter which is not there is fine */
+  assert (lwes_net_set_name_filter (&receiver, NULL, 0) == 0);
+
+  assert (lwes_net_set_name_filter (&receiver, bad, 2) == -1);
+  memset (long_name, 'x', 255);
+  long_name[255] = '\0';
+  for (i = 0; i < 40; i++)
+    {
+      too_long[i] = long_name;
+    }
+  assert (lwes_net_set_name_filter (&receiver, too_long, 40) == -4);
+
+  setsockopt_error_when = SO_ATTACH_FILTER;
+  assert (lwes_net_set_name_filter (&receiver, wanted, 4) == -2);
+  setsockopt_error_when = SETSOCKOPT_NO_ERROR;
+
+  /* the ones which do not match never arrive */
+  assert (lwes_net_set_name_filter (&receiver, wanted, 4) == 0);
+  send_name (&connection, "Exac");
+  send_name (&connection, "Exact");
+  send_name (&connection, "ExactX");
+  send_name (&connection, "Ab");
+  send_name (&connection, "Abc");
+  send_name (&connection, "Abd");
+  send_name (&connection, "Abcdefg");
+  send_name (&connection, "Abcdefh");
+  send_name (&connection, "Click");
+  send_name (&connection, "Click::");
+  send_name (&connection, "Click::Buy");
+  send_name (&connection, "Click:Buy");
+  send_name (&connection, "Click::A::B");
+  send_name (&connection, "Other");
+  assert (lwes_net_send_bytes (&connection, &one_byte, 1) > 0);
+  expect_names (&receiver, received, 5);
+
+  /* and without the filter everything does */
+  assert (lwes_net_set_name_filter (&receiver, NULL, 0) == 0);
+  send_name (&connection, "Exac");
+  send_name (&connection, "Exact");
+  expect_names (&receiver, everything, 2);
+#else
+  (void)received;
+  (void)everything;
+  (void)bad;
+  (void)too_long;
+  (void)one_byte;
+  (void)long_name;
+  (void)i;
+  assert (lwes_net_set_name_filter (&receiver, wanted, 4) == -2);
+#endif
+
+  lwes_net_close (&receiver);
+  lwes_net_close (&connection);
+}
 
 int main (void)
 {
@@ -904,6 +1105,16 @@ int main (void)
 #endif
   test_large_send ();
 
+#if DEBUG
+  printf ("test_send_batch\n");
+#endif
+  test_send_batch ();
+
+#if DEBUG
+  printf ("test_name_filter\n");
+#endif
+  test_name_filter ();
+
   return 0;
 }
 